@@ -33,6 +33,7 @@ There is still some work to be done:
 #include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -138,6 +139,11 @@ struct data_block
     cab_UWORD   uncompressed;
 };
 
+#define FCI_BATCH_BLOCKS 32  /* number of data blocks compressed together */
+#define FCI_MAX_THREADS  16  /* maximum number of threads compressing a batch */
+
+struct lzx_compressor;
+
 typedef struct FCI_Int
 {
   unsigned int       magic;
@@ -184,7 +190,17 @@ typedef struct FCI_Int
   cab_ULONG          pending_data_size;   /* size of data not yet assigned to a folder */
   cab_ULONG          folders_data_size;   /* total size of data contained in the current folders */
   TCOMP              compression;
-  cab_UWORD        (*compress)(struct FCI_Int *);
+  BOOL             (*compress)(struct FCI_Int *);
+  unsigned int       thread_count;
+  unsigned char     *batch_in;            /* uncompressed data blocks waiting for compression */
+  unsigned char     *batch_out;           /* compressed data of the waiting blocks */
+  unsigned char     *batch_data;          /* storage for batch_in when no history is needed */
+  cab_UWORD          batch_in_size[FCI_BATCH_BLOCKS];
+  cab_UWORD          batch_out_size[FCI_BATCH_BLOCKS];
+  unsigned int       batch_count;
+  z_stream           zstreams[FCI_MAX_THREADS];
+  unsigned int       zstream_count;
+  struct lzx_compressor *lzx;
 } FCI_Int;
 
 #define FCI_INT_MAGIC 0xfcfcfc05
@@ -305,46 +321,84 @@ static void free_file( FCI_Int *fci, struct file *file )
     fci->free( file );
 }
 
-/* create a new data block for the data in fci->data_in */
-static BOOL add_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
+static BOOL init_batch( FCI_Int *fci )
 {
-    int err;
-    struct data_block *block;
-
-    if (!fci->cdata_in) return TRUE;
-
-    if (fci->data.handle == -1 && !create_temp_file( fci, &fci->data )) return FALSE;
-
-    if (!(block = fci->alloc( sizeof(*block) )))
+    if (!fci->batch_out && !(fci->batch_out = fci->alloc( FCI_BATCH_BLOCKS * 2 * CAB_BLOCKMAX )))
     {
         set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
         return FALSE;
     }
-    block->uncompressed = fci->cdata_in;
-    block->compressed   = fci->compress( fci );
-
-    if (fci->write( fci->data.handle, fci->data_out,
-                    block->compressed, &err, fci->pv ) != block->compressed)
+    if (fci->batch_in) return TRUE;  /* the compressor provides its own storage */
+    if (!fci->batch_data && !(fci->batch_data = fci->alloc( FCI_BATCH_BLOCKS * CAB_BLOCKMAX )))
     {
-        set_error( fci, FCIERR_TEMP_FILE, err );
-        fci->free( block );
+        set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
         return FALSE;
     }
+    fci->batch_in = fci->batch_data;
+    return TRUE;
+}
 
-    fci->cdata_in = 0;
-    fci->pending_data_size += sizeof(CFDATA) + fci->ccab.cbReserveCFData + block->compressed;
-    fci->cCompressedBytesInFolder += block->compressed;
-    fci->cDataBlocks++;
-    list_add_tail( &fci->blocks_list, &block->entry );
+/* compress the waiting data blocks and append them to the data temp file */
+static BOOL flush_data_blocks( FCI_Int *fci, PFNFCISTATUS status_callback )
+{
+    int err;
+    unsigned int i;
+    struct data_block *block;
+
+    if (!fci->batch_count) return TRUE;
+
+    if (fci->data.handle == -1 && !create_temp_file( fci, &fci->data )) return FALSE;
+
+    if (!fci->compress( fci )) return FALSE;
 
-    if (status_callback( statusFile, block->compressed, block->uncompressed, fci->pv ) == -1)
+    for (i = 0; i < fci->batch_count; i++)
     {
-        set_error( fci, FCIERR_USER_ABORT, 0 );
-        return FALSE;
+        if (!(block = fci->alloc( sizeof(*block) )))
+        {
+            set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+            return FALSE;
+        }
+        block->uncompressed = fci->batch_in_size[i];
+        block->compressed   = fci->batch_out_size[i];
+
+        if (fci->write( fci->data.handle, fci->batch_out + i * 2 * CAB_BLOCKMAX,
+                        block->compressed, &err, fci->pv ) != block->compressed)
+        {
+            set_error( fci, FCIERR_TEMP_FILE, err );
+            fci->free( block );
+            return FALSE;
+        }
+
+        fci->pending_data_size += sizeof(CFDATA) + fci->ccab.cbReserveCFData + block->compressed;
+        fci->cCompressedBytesInFolder += block->compressed;
+        fci->cDataBlocks++;
+        list_add_tail( &fci->blocks_list, &block->entry );
+
+        if (status_callback( statusFile, block->compressed, block->uncompressed, fci->pv ) == -1)
+        {
+            set_error( fci, FCIERR_USER_ABORT, 0 );
+            return FALSE;
+        }
     }
+    fci->batch_count = 0;
     return TRUE;
 }
 
+/* queue a new data block for the data in fci->data_in */
+static BOOL add_data_block( FCI_Int *fci, PFNFCISTATUS status_callback )
+{
+    if (!fci->cdata_in) return TRUE;
+
+    if (!fci->batch_count && !init_batch( fci )) return FALSE;
+
+    memcpy( fci->batch_in + fci->batch_count * CAB_BLOCKMAX, fci->data_in, fci->cdata_in );
+    fci->batch_in_size[fci->batch_count++] = fci->cdata_in;
+    fci->cdata_in = 0;
+
+    if (fci->batch_count < FCI_BATCH_BLOCKS) return TRUE;
+    return flush_data_blocks( fci, status_callback );
+}
+
 /* add compressed blocks for all the data that can be read from the file */
 static BOOL add_file_data( FCI_Int *fci, char *sourcefile, char *filename, BOOL execute,
                            PFNFCIGETOPENINFO get_open_info, PFNFCISTATUS status_callback )
@@ -380,7 +434,7 @@ static BOOL add_file_data( FCI_Int *fci, char *sourcefile, char *filename, BOOL
         if (fci->cdata_in == CAB_BLOCKMAX && !add_data_block( fci, status_callback )) return FALSE;
     }
     fci->close( handle, &err, fci->pv );
-    return TRUE;
+    return flush_data_blocks( fci, status_callback );
 }
 
 static void free_data_block( FCI_Int *fci, struct data_block *block )
@@ -899,10 +953,74 @@ static BOOL add_files_to_folder( FCI_Int *fci, struct folder *folder, cab_ULONG
     return TRUE;
 }
 
-static cab_UWORD compress_NONE( FCI_Int *fci )
+struct compress_context
 {
-    memcpy( fci->data_out, fci->data_in, fci->cdata_in );
-    return fci->cdata_in;
+    FCI_Int     *fci;
+    void       (*func)( FCI_Int *fci, unsigned int thread, unsigned int job );
+    LONG         job_count;
+    LONG         next_job;
+    LONG         next_thread;
+    LONG         pending;
+    HANDLE       done_event;
+};
+
+static void run_jobs( struct compress_context *ctx )
+{
+    unsigned int thread = InterlockedIncrement( &ctx->next_thread ) - 1;
+    LONG job;
+
+    while ((job = InterlockedIncrement( &ctx->next_job ) - 1) < ctx->job_count)
+        ctx->func( ctx->fci, thread, job );
+}
+
+static void CALLBACK compress_jobs_callback( TP_CALLBACK_INSTANCE *instance, void *context )
+{
+    struct compress_context *ctx = context;
+
+    run_jobs( ctx );
+    if (!InterlockedDecrement( &ctx->pending )) SetEvent( ctx->done_event );
+}
+
+/* run independent compression jobs on up to fci->thread_count threads; the output
+ * of a job must only depend on its index, so that the result is deterministic */
+static void run_compress_jobs( FCI_Int *fci, unsigned int job_count,
+                               void (*func)( FCI_Int *, unsigned int, unsigned int ) )
+{
+    struct compress_context ctx;
+    unsigned int i, worker_count = min( fci->thread_count, job_count ) - 1;
+
+    ctx.fci         = fci;
+    ctx.func        = func;
+    ctx.job_count   = job_count;
+    ctx.next_job    = 0;
+    ctx.next_thread = 0;
+
+    if (worker_count && (ctx.done_event = CreateEventW( NULL, TRUE, FALSE, NULL )))
+    {
+        /* the calling thread holds a reference too, it takes its share of the jobs */
+        ctx.pending = worker_count + 1;
+        for (i = 0; i < worker_count; i++)
+        {
+            if (!TrySubmitThreadpoolCallback( compress_jobs_callback, &ctx, NULL ))
+                InterlockedDecrement( &ctx.pending );
+        }
+        run_jobs( &ctx );
+        if (InterlockedDecrement( &ctx.pending )) WaitForSingleObject( ctx.done_event, INFINITE );
+        CloseHandle( ctx.done_event );
+    }
+    else run_jobs( &ctx );
+}
+
+static BOOL compress_NONE( FCI_Int *fci )
+{
+    unsigned int i;
+
+    for (i = 0; i < fci->batch_count; i++)
+    {
+        memcpy( fci->batch_out + i * 2 * CAB_BLOCKMAX, fci->batch_in + i * CAB_BLOCKMAX, fci->batch_in_size[i] );
+        fci->batch_out_size[i] = fci->batch_in_size[i];
+    }
+    return TRUE;
 }
 
 static void *zalloc( void *opaque, unsigned int items, unsigned int size )
@@ -917,28 +1035,637 @@ static void zfree( void *opaque, void *ptr )
     fci->free( ptr );
 }
 
-static cab_UWORD compress_MSZIP( FCI_Int *fci )
+static void compress_MSZIP_block( FCI_Int *fci, unsigned int thread, unsigned int block )
 {
-    z_stream stream;
+    z_stream *stream = &fci->zstreams[thread];
+    unsigned char *out = fci->batch_out + block * 2 * CAB_BLOCKMAX;
+
+    deflateReset( stream );
+    stream->next_in   = fci->batch_in + block * CAB_BLOCKMAX;
+    stream->avail_in  = fci->batch_in_size[block];
+    stream->next_out  = out + 2;
+    stream->avail_out = 2 * CAB_BLOCKMAX - 2;
+    /* insert the signature */
+    out[0] = 'C';
+    out[1] = 'K';
+    deflate( stream, Z_FINISH );
+    fci->batch_out_size[block] = stream->total_out + 2;
+}
 
-    stream.zalloc = zalloc;
-    stream.zfree  = zfree;
-    stream.opaque = fci;
-    if (deflateInit2( &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK)
+static BOOL compress_MSZIP( FCI_Int *fci )
+{
+    unsigned int count = min( fci->thread_count, fci->batch_count );
+
+    /* the streams are set up here, so that the allocation callbacks are
+     * never called from the worker threads */
+    while (fci->zstream_count < count)
+    {
+        z_stream *stream = &fci->zstreams[fci->zstream_count];
+
+        stream->zalloc = zalloc;
+        stream->zfree  = zfree;
+        stream->opaque = fci;
+        if (deflateInit2( stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK)
+        {
+            set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+            return FALSE;
+        }
+        fci->zstream_count++;
+    }
+    run_compress_jobs( fci, fci->batch_count, compress_MSZIP_block );
+    return TRUE;
+}
+
+/*
+ * LZX compression
+ *
+ * Every data block is encoded as a single verbatim block, or as an uncompressed
+ * block when that turns out to be smaller. The matches are searched in chunks of
+ * LZX_CHUNK_FRAMES blocks, each chunk only seeing LZX_PRIME_SIZE bytes of history,
+ * so that the chunks can be parsed in parallel while the output stays the same
+ * whatever the number of threads. The tree lengths are then delta encoded and the
+ * bit stream is written serially.
+ */
+
+#define LZX_HASH_BITS     15
+#define LZX_MAX_CHAIN     48          /* maximum number of hash chain entries to check */
+#define LZX_NICE_MATCH    64          /* stop looking for better matches above that length */
+#define LZX_FAR_MATCH     (16 * 1024) /* maximum offset for matches of length 3 */
+#define LZX_CHUNK_FRAMES  2
+#define LZX_PRIME_SIZE    (128 * 1024)
+
+static const cab_UBYTE lzx_extra_bits[51] =
+{
+     0,  0,  0,  0,  1,  1,  2,  2,  3,  3,  4,  4,  5,  5,  6,  6,
+     7,  7,  8,  8,  9,  9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14,
+    15, 15, 16, 16, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17,
+    17, 17, 17
+};
+
+static const cab_ULONG lzx_position_base[51] =
+{
+          0,       1,       2,       3,       4,       6,       8,      12,
+         16,      24,      32,      48,      64,      96,     128,     192,
+        256,     384,     512,     768,    1024,    1536,    2048,    3072,
+       4096,    6144,    8192,   12288,   16384,   24576,   32768,   49152,
+      65536,   98304,  131072,  196608,  262144,  393216,  524288,  655360,
+     786432,  917504, 1048576, 1179648, 1310720, 1441792, 1572864, 1703936,
+    1835008, 1966080, 2097152
+};
+
+struct lzx_token
+{
+    cab_UWORD main;      /* main tree element */
+    cab_UWORD footer;    /* length tree element, for matches longer than 8 bytes */
+    cab_ULONG verbatim;  /* verbatim position bits */
+};
+
+struct lzx_frame
+{
+    cab_ULONG token_count;
+    cab_ULONG R[3];      /* repeated offsets at the end of the frame */
+    cab_UBYTE main_len[LZX_MAINTREE_MAXSYMBOLS];
+    cab_UBYTE length_len[LZX_NUM_SECONDARY_LENGTHS];
+};
+
+struct lzx_compressor
+{
+    cab_ULONG         window_size;
+    cab_ULONG         main_elements;
+    cab_ULONG         history_size;    /* size of the history area preceding the batch */
+    cab_ULONG         history;         /* number of valid bytes in the history area */
+    BOOL              header_written;
+    cab_UBYTE        *buffer;          /* history followed by the batch data */
+    struct lzx_token *tokens;          /* CAB_BLOCKMAX tokens for each frame of the batch */
+    LONG             *hash[FCI_MAX_THREADS];
+    struct lzx_frame  frames[FCI_BATCH_BLOCKS];
+    /* tree lengths of the last verbatim block, the new ones are delta encoded against them */
+    cab_UBYTE         main_len[LZX_MAINTREE_MAXSYMBOLS];
+    cab_UBYTE         length_len[LZX_NUM_SECONDARY_LENGTHS];
+};
+
+struct lzx_parser
+{
+    const cab_UBYTE  *base;            /* start of the history visible to the chunk */
+    cab_ULONG         end;             /* end of the chunk data, relative to base */
+    cab_ULONG         max_offset;
+    LONG             *head;
+    LONG             *chain;
+    cab_ULONG         R[3];            /* repeated offsets, 0 when not known yet */
+};
+
+struct lzx_writer
+{
+    cab_UBYTE        *ptr;
+    cab_UBYTE        *end;
+    cab_ULONG         bits;
+    unsigned int      count;
+};
+
+struct lzx_huff_leaf
+{
+    cab_ULONG         weight;
+    cab_UWORD         symbol;
+};
+
+static inline cab_ULONG lzx_hash( const cab_UBYTE *p )
+{
+    return ((p[0] | (p[1] << 8) | (p[2] << 16)) * 0x9e3779b1) >> (32 - LZX_HASH_BITS);
+}
+
+static void lzx_insert( struct lzx_parser *parser, cab_ULONG pos )
+{
+    cab_ULONG hash;
+
+    if (pos + 3 > parser->end) return;
+    hash = lzx_hash( parser->base + pos );
+    parser->chain[pos] = parser->head[hash];
+    parser->head[hash] = pos;
+}
+
+static unsigned int lzx_match_length( const cab_UBYTE *p, const cab_UBYTE *match, unsigned int max_len )
+{
+    unsigned int len = 0;
+
+    while (len < max_len && p[len] == match[len]) len++;
+    return len;
+}
+
+/* find the best match at pos, and insert pos into the hash chains */
+static unsigned int lzx_find_match( struct lzx_parser *parser, cab_ULONG pos, cab_ULONG limit, cab_ULONG *offset )
+{
+    const cab_UBYTE *p = parser->base + pos;
+    unsigned int i, len, rep_len = 0, best_len = 0, chain = LZX_MAX_CHAIN;
+    unsigned int max_len = min( limit - pos, LZX_MAX_MATCH );
+    cab_ULONG rep_offset = 0, best_offset = 0;
+    LONG min_pos = pos > parser->max_offset ? pos - parser->max_offset : 0;
+    LONG match;
+
+    /* repeated offsets are the cheapest to encode */
+    for (i = 0; i < 3; i++)
+    {
+        if (!parser->R[i] || parser->R[i] > pos) continue;
+        len = lzx_match_length( p, p - parser->R[i], max_len );
+        if (len > rep_len)
+        {
+            rep_len = len;
+            rep_offset = parser->R[i];
+        }
+    }
+
+    if (max_len >= 3)
+    {
+        cab_ULONG hash = lzx_hash( p );
+
+        match = parser->head[hash];
+        parser->chain[pos] = match;
+        parser->head[hash] = pos;
+
+        while (match >= min_pos && chain--)
+        {
+            const cab_UBYTE *q = parser->base + match;
+
+            if (q[best_len] == p[best_len] && (len = lzx_match_length( p, q, max_len )) > best_len)
+            {
+                best_len = len;
+                best_offset = pos - match;
+                if (len >= LZX_NICE_MATCH || len == max_len) break;
+            }
+            match = parser->chain[match];
+        }
+        if (best_len == 3 && best_offset > LZX_FAR_MATCH) best_len = 0;
+    }
+
+    if (rep_len >= LZX_MIN_MATCH && rep_len + 1 >= best_len)
+    {
+        *offset = rep_offset;
+        return rep_len;
+    }
+    if (best_len < 3) return 0;
+    *offset = best_offset;
+    return best_len;
+}
+
+static unsigned int lzx_position_slot( cab_ULONG formatted_offset )
+{
+    unsigned int low = 3, high = ARRAY_SIZE(lzx_position_base) - 1;
+
+    while (low < high)
+    {
+        unsigned int mid = (low + high + 1) / 2;
+        if (lzx_position_base[mid] <= formatted_offset) low = mid;
+        else high = mid - 1;
+    }
+    return low;
+}
+
+static void lzx_add_match( struct lzx_parser *parser, struct lzx_token *token, cab_ULONG *main_freq,
+                           cab_ULONG *length_freq, unsigned int len, cab_ULONG offset )
+{
+    unsigned int slot, header = min( len - LZX_MIN_MATCH, LZX_NUM_PRIMARY_LENGTHS );
+
+    token->verbatim = 0;
+    if (offset == parser->R[0]) slot = 0;
+    else if (offset == parser->R[1])
+    {
+        slot = 1;
+        parser->R[1] = parser->R[0];
+        parser->R[0] = offset;
+    }
+    else if (offset == parser->R[2])
+    {
+        slot = 2;
+        parser->R[2] = parser->R[0];
+        parser->R[0] = offset;
+    }
+    else
+    {
+        slot = lzx_position_slot( offset + 2 );
+        token->verbatim = offset + 2 - lzx_position_base[slot];
+        parser->R[2] = parser->R[1];
+        parser->R[1] = parser->R[0];
+        parser->R[0] = offset;
+    }
+
+    token->main = LZX_NUM_CHARS + (slot << 3) + header;
+    main_freq[token->main]++;
+    if (header == LZX_NUM_PRIMARY_LENGTHS)
+    {
+        token->footer = len - LZX_MIN_MATCH - LZX_NUM_PRIMARY_LENGTHS;
+        length_freq[token->footer]++;
+    }
+}
+
+static int __cdecl compare_huff_leaves( const void *a, const void *b )
+{
+    const struct lzx_huff_leaf *leaf_a = a, *leaf_b = b;
+
+    if (leaf_a->weight != leaf_b->weight) return leaf_a->weight < leaf_b->weight ? -1 : 1;
+    return leaf_a->symbol - leaf_b->symbol;
+}
+
+/* build Huffman code lengths of at most max_bits bits for the given frequencies */
+static void lzx_make_lengths( const cab_ULONG *freqs, unsigned int count, unsigned int max_bits, cab_UBYTE *lengths )
+{
+    struct lzx_huff_leaf leaves[LZX_MAINTREE_MAXSYMBOLS];
+    cab_ULONG weights[LZX_MAINTREE_MAXSYMBOLS];
+    cab_UWORD parent[2 * LZX_MAINTREE_MAXSYMBOLS];
+    cab_UBYTE depth[2 * LZX_MAINTREE_MAXSYMBOLS];
+    unsigned int i, k, n, shift, leaf, node, next, child[2], max_depth;
+
+    memset( lengths, 0, count );
+    for (i = n = 0; i < count; i++) if (freqs[i]) leaves[n++].symbol = i;
+    if (!n) return;
+    if (n == 1)
+    {
+        /* the decoder only accepts complete trees */
+        lengths[leaves[0].symbol] = 1;
+        lengths[leaves[0].symbol ? 0 : 1] = 1;
+        return;
+    }
+
+    for (shift = 0;; shift++)
+    {
+        for (i = 0; i < n; i++) leaves[i].weight = max( freqs[leaves[i].symbol] >> shift, 1 );
+        qsort( leaves, n, sizeof(*leaves), compare_huff_leaves );
+
+        /* leaves are nodes 0 to n - 1, internal nodes are created in order of weight after them */
+        for (leaf = node = next = 0; next < n - 1; next++)
+        {
+            for (k = 0; k < 2; k++)
+            {
+                if (leaf < n && (node == next || leaves[leaf].weight <= weights[node])) child[k] = leaf++;
+                else child[k] = n + node++;
+            }
+            weights[next] = (child[0] < n ? leaves[child[0]].weight : weights[child[0] - n]) +
+                            (child[1] < n ? leaves[child[1]].weight : weights[child[1] - n]);
+            parent[child[0]] = parent[child[1]] = n + next;
+        }
+
+        depth[2 * n - 2] = 0;
+        for (i = 2 * n - 2, max_depth = 0; i--;)
+        {
+            depth[i] = depth[parent[i]] + 1;
+            max_depth = max( max_depth, depth[i] );
+        }
+        if (max_depth <= max_bits) break;
+    }
+    for (i = 0; i < n; i++) lengths[leaves[i].symbol] = depth[i];
+}
+
+static void lzx_make_codes( const cab_UBYTE *lengths, unsigned int count, cab_UWORD *codes )
+{
+    unsigned int i, bits, code = 0, length_count[17] = { 0 }, next_code[17];
+
+    for (i = 0; i < count; i++) length_count[lengths[i]]++;
+    length_count[0] = 0;
+    for (bits = 1; bits <= 16; bits++)
+    {
+        code = (code + length_count[bits - 1]) << 1;
+        next_code[bits] = code;
+    }
+    for (i = 0; i < count; i++) if (lengths[i]) codes[i] = next_code[lengths[i]]++;
+}
+
+/* parse a chunk of frames into tokens, and compute the Huffman trees of each frame */
+static void lzx_parse_chunk( FCI_Int *fci, unsigned int thread, unsigned int chunk )
+{
+    struct lzx_compressor *lzx = fci->lzx;
+    unsigned int frame, first = chunk * LZX_CHUNK_FRAMES;
+    unsigned int last = min( first + LZX_CHUNK_FRAMES, fci->batch_count );
+    cab_ULONG start = first * CAB_BLOCKMAX, prime = min( lzx->history + start, LZX_PRIME_SIZE );
+    cab_ULONG pos, limit, offset, next_offset;
+    unsigned int i, len, next_len;
+    struct lzx_parser parser;
+
+    parser.base       = fci->batch_in + start - prime;
+    parser.end        = prime;
+    parser.max_offset = lzx->window_size - 3;
+    parser.head       = lzx->hash[thread];
+    parser.chain      = parser.head + (1 << LZX_HASH_BITS);
+    parser.R[0] = parser.R[1] = parser.R[2] = 0;
+    for (frame = first; frame < last; frame++) parser.end += fci->batch_in_size[frame];
+
+    memset( parser.head, 0xff, sizeof(LONG) << LZX_HASH_BITS );
+    for (pos = 0; pos < prime; pos++) lzx_insert( &parser, pos );
+
+    for (frame = first; frame < last; frame++)
+    {
+        struct lzx_frame *f = &lzx->frames[frame];
+        struct lzx_token *tokens = lzx->tokens + frame * CAB_BLOCKMAX;
+        cab_ULONG main_freq[LZX_MAINTREE_MAXSYMBOLS] = { 0 };
+        cab_ULONG length_freq[LZX_NUM_SECONDARY_LENGTHS] = { 0 };
+        cab_ULONG count = 0;
+
+        /* matches can't cross frame boundaries */
+        limit = pos + fci->batch_in_size[frame];
+        len = lzx_find_match( &parser, pos, limit, &offset );
+        while (pos < limit)
+        {
+            if (len && len < LZX_NICE_MATCH && pos + 1 < limit)
+            {
+                /* lazy evaluation: emit a literal if the next position has a longer match */
+                next_len = lzx_find_match( &parser, pos + 1, limit, &next_offset );
+                if (next_len > len)
+                {
+                    tokens[count].main = parser.base[pos++];
+                    main_freq[tokens[count++].main]++;
+                    len = next_len;
+                    offset = next_offset;
+                    continue;
+                }
+                lzx_add_match( &parser, &tokens[count++], main_freq, length_freq, len, offset );
+                for (i = 2; i < len; i++) lzx_insert( &parser, pos + i );
+                pos += len;
+            }
+            else if (len)
+            {
+                lzx_add_match( &parser, &tokens[count++], main_freq, length_freq, len, offset );
+                for (i = 1; i < len; i++) lzx_insert( &parser, pos + i );
+                pos += len;
+            }
+            else
+            {
+                tokens[count].main = parser.base[pos++];
+                main_freq[tokens[count++].main]++;
+            }
+            len = pos < limit ? lzx_find_match( &parser, pos, limit, &offset ) : 0;
+        }
+
+        f->token_count = count;
+        for (i = 0; i < 3; i++) f->R[i] = parser.R[i] ? parser.R[i] : 1;
+        lzx_make_lengths( main_freq, lzx->main_elements, 16, f->main_len );
+        lzx_make_lengths( length_freq, LZX_NUM_SECONDARY_LENGTHS, 16, f->length_len );
+    }
+}
+
+static void lzx_write_bits( struct lzx_writer *writer, cab_ULONG value, unsigned int count )
+{
+    writer->bits = (writer->bits << count) | value;
+    writer->count += count;
+    while (writer->count >= 16)
+    {
+        writer->count -= 16;
+        if (writer->ptr + 2 <= writer->end)
+        {
+            writer->ptr[0] = writer->bits >> writer->count;
+            writer->ptr[1] = writer->bits >> (writer->count + 8);
+        }
+        writer->ptr += 2;
+    }
+}
+
+/* write the lengths of a tree segment as deltas from the previous tree */
+static void lzx_write_lengths( struct lzx_writer *writer, const cab_UBYTE *prev, const cab_UBYTE *lengths,
+                               unsigned int first, unsigned int last )
+{
+    cab_UBYTE symbols[LZX_MAINTREE_MAXSYMBOLS], extra[LZX_MAINTREE_MAXSYMBOLS];
+    cab_ULONG freqs[LZX_PRETREE_NUM_ELEMENTS] = { 0 };
+    cab_UBYTE pre_len[LZX_PRETREE_NUM_ELEMENTS];
+    cab_UWORD pre_code[LZX_PRETREE_NUM_ELEMENTS];
+    unsigned int i, x, run, count = 0;
+
+    for (x = first; x < last; count++)
+    {
+        for (run = 0; x + run < last && !lengths[x + run] && run < 51; run++) ;
+        if (run >= 20)
+        {
+            symbols[count] = 18;
+            extra[count] = run - 20;
+            x += run;
+        }
+        else if (run >= 4)
+        {
+            symbols[count] = 17;
+            extra[count] = run - 4;
+            x += run;
+        }
+        else
+        {
+            symbols[count] = (prev[x] - lengths[x] + 17) % 17;
+            x++;
+        }
+        freqs[symbols[count]]++;
+    }
+
+    lzx_make_lengths( freqs, LZX_PRETREE_NUM_ELEMENTS, 15, pre_len );
+    lzx_make_codes( pre_len, LZX_PRETREE_NUM_ELEMENTS, pre_code );
+    for (i = 0; i < LZX_PRETREE_NUM_ELEMENTS; i++) lzx_write_bits( writer, pre_len[i], 4 );
+    for (i = 0; i < count; i++)
+    {
+        lzx_write_bits( writer, pre_code[symbols[i]], pre_len[symbols[i]] );
+        if (symbols[i] == 17) lzx_write_bits( writer, extra[i], 4 );
+        else if (symbols[i] == 18) lzx_write_bits( writer, extra[i], 5 );
+    }
+}
+
+static cab_UWORD lzx_encode_frame( struct lzx_compressor *lzx, const struct lzx_frame *frame,
+                                   const struct lzx_token *tokens, const cab_UBYTE *data,
+                                   cab_UWORD size, cab_UBYTE *out )
+{
+    cab_UWORD main_code[LZX_MAINTREE_MAXSYMBOLS], length_code[LZX_NUM_SECONDARY_LENGTHS];
+    struct lzx_writer writer;
+    unsigned int i, slot, extra;
+    cab_UBYTE *ptr;
+
+    /* a verbatim block larger than the data is never worth it */
+    writer.ptr   = out;
+    writer.end   = out + size;
+    writer.bits  = 0;
+    writer.count = 0;
+
+    if (!lzx->header_written) lzx_write_bits( &writer, 0, 1 );  /* no E8 translation */
+    lzx_write_bits( &writer, LZX_BLOCKTYPE_VERBATIM, 3 );
+    lzx_write_bits( &writer, size >> 8, 16 );
+    lzx_write_bits( &writer, size & 0xff, 8 );
+    lzx_write_lengths( &writer, lzx->main_len, frame->main_len, 0, LZX_NUM_CHARS );
+    lzx_write_lengths( &writer, lzx->main_len, frame->main_len, LZX_NUM_CHARS, lzx->main_elements );
+    lzx_write_lengths( &writer, lzx->length_len, frame->length_len, 0, LZX_NUM_SECONDARY_LENGTHS );
+
+    lzx_make_codes( frame->main_len, lzx->main_elements, main_code );
+    lzx_make_codes( frame->length_len, LZX_NUM_SECONDARY_LENGTHS, length_code );
+    for (i = 0; i < frame->token_count && writer.ptr <= writer.end; i++)
+    {
+        const struct lzx_token *token = &tokens[i];
+
+        lzx_write_bits( &writer, main_code[token->main], frame->main_len[token->main] );
+        if (token->main < LZX_NUM_CHARS) continue;
+
+        if (((token->main - LZX_NUM_CHARS) & LZX_NUM_PRIMARY_LENGTHS) == LZX_NUM_PRIMARY_LENGTHS)
+            lzx_write_bits( &writer, length_code[token->footer], frame->length_len[token->footer] );
+        slot = (token->main - LZX_NUM_CHARS) >> 3;
+        if ((extra = lzx_extra_bits[slot]) > 16)
+        {
+            lzx_write_bits( &writer, token->verbatim >> 16, extra - 16 );
+            lzx_write_bits( &writer, token->verbatim & 0xffff, 16 );
+        }
+        else if (extra) lzx_write_bits( &writer, token->verbatim, extra );
+    }
+    if (writer.count) lzx_write_bits( &writer, 0, 16 - writer.count );
+
+    if (writer.ptr <= writer.end)
+    {
+        lzx->header_written = TRUE;
+        memcpy( lzx->main_len, frame->main_len, lzx->main_elements );
+        memcpy( lzx->length_len, frame->length_len, sizeof(lzx->length_len) );
+        return writer.ptr - out;
+    }
+
+    /* store the data in an uncompressed block, the tree lengths are left untouched */
+    writer.ptr   = out;
+    writer.end   = out + 2 * CAB_BLOCKMAX;
+    writer.bits  = 0;
+    writer.count = 0;
+
+    if (!lzx->header_written) lzx_write_bits( &writer, 0, 1 );
+    lzx_write_bits( &writer, LZX_BLOCKTYPE_UNCOMPRESSED, 3 );
+    lzx_write_bits( &writer, size >> 8, 16 );
+    lzx_write_bits( &writer, size & 0xff, 8 );
+    /* the decoder skips a whole word if the stream is already aligned */
+    lzx_write_bits( &writer, 0, 16 - writer.count );
+    lzx->header_written = TRUE;
+
+    ptr = writer.ptr;
+    for (i = 0; i < 3; i++)
+    {
+        *ptr++ = frame->R[i];
+        *ptr++ = frame->R[i] >> 8;
+        *ptr++ = frame->R[i] >> 16;
+        *ptr++ = frame->R[i] >> 24;
+    }
+    memcpy( ptr, data, size );
+    ptr += size;
+    if (size & 1) *ptr++ = 0;
+    return ptr - out;
+}
+
+static BOOL compress_LZX( FCI_Int *fci )
+{
+    struct lzx_compressor *lzx = fci->lzx;
+    unsigned int i, chunks = (fci->batch_count + LZX_CHUNK_FRAMES - 1) / LZX_CHUNK_FRAMES;
+    unsigned int count = min( fci->thread_count, chunks );
+    cab_ULONG size, history;
+
+    for (i = 0; i < count; i++)
+    {
+        if (lzx->hash[i]) continue;
+        lzx->hash[i] = fci->alloc( ((1 << LZX_HASH_BITS) + LZX_PRIME_SIZE + LZX_CHUNK_FRAMES * CAB_BLOCKMAX) *
+                                   sizeof(LONG) );
+        if (!lzx->hash[i])
+        {
+            set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+            return FALSE;
+        }
+    }
+    run_compress_jobs( fci, chunks, lzx_parse_chunk );
+
+    for (i = size = 0; i < fci->batch_count; i++)
+    {
+        fci->batch_out_size[i] = lzx_encode_frame( lzx, &lzx->frames[i], lzx->tokens + i * CAB_BLOCKMAX,
+                                                   fci->batch_in + size, fci->batch_in_size[i],
+                                                   fci->batch_out + i * 2 * CAB_BLOCKMAX );
+        size += fci->batch_in_size[i];
+    }
+
+    /* keep the end of the data as history for the next batch */
+    history = min( lzx->history + size, lzx->history_size );
+    memmove( fci->batch_in - history, fci->batch_in + size - history, history );
+    lzx->history = history;
+    return TRUE;
+}
+
+/* start a new LZX stream at the beginning of a folder */
+static void reset_LZX( struct lzx_compressor *lzx )
+{
+    lzx->history = 0;
+    lzx->header_written = FALSE;
+    memset( lzx->main_len, 0, sizeof(lzx->main_len) );
+    memset( lzx->length_len, 0, sizeof(lzx->length_len) );
+}
+
+static void free_LZX( FCI_Int *fci )
+{
+    struct lzx_compressor *lzx = fci->lzx;
+    unsigned int i;
+
+    if (!lzx) return;
+    for (i = 0; i < FCI_MAX_THREADS; i++) if (lzx->hash[i]) fci->free( lzx->hash[i] );
+    if (lzx->tokens) fci->free( lzx->tokens );
+    if (lzx->buffer) fci->free( lzx->buffer );
+    fci->free( lzx );
+    fci->lzx = NULL;
+}
+
+static BOOL init_LZX( FCI_Int *fci, unsigned int window )
+{
+    struct lzx_compressor *lzx;
+
+    if (window < 15 || window > 21)
+    {
+        set_error( fci, FCIERR_BAD_COMPR_TYPE, ERROR_BAD_ARGUMENTS );
+        return FALSE;
+    }
+    if (!(lzx = fci->alloc( sizeof(*lzx) )))
     {
         set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
-        return 0;
+        return FALSE;
     }
-    stream.next_in   = fci->data_in;
-    stream.avail_in  = fci->cdata_in;
-    stream.next_out  = fci->data_out + 2;
-    stream.avail_out = sizeof(fci->data_out) - 2;
-    /* insert the signature */
-    fci->data_out[0] = 'C';
-    fci->data_out[1] = 'K';
-    deflate( &stream, Z_FINISH );
-    deflateEnd( &stream );
-    return stream.total_out + 2;
+    memset( lzx, 0, sizeof(*lzx) );
+    fci->lzx = lzx;
+
+    lzx->window_size   = 1 << window;
+    lzx->main_elements = LZX_NUM_CHARS + (window == 21 ? 50 : window == 20 ? 42 : window * 2) * 8;
+    lzx->history_size  = min( lzx->window_size, LZX_PRIME_SIZE );
+    lzx->buffer = fci->alloc( lzx->history_size + FCI_BATCH_BLOCKS * CAB_BLOCKMAX );
+    lzx->tokens = fci->alloc( FCI_BATCH_BLOCKS * CAB_BLOCKMAX * sizeof(*lzx->tokens) );
+    if (!lzx->buffer || !lzx->tokens)
+    {
+        free_LZX( fci );
+        set_error( fci, FCIERR_ALLOC_FAIL, ERROR_NOT_ENOUGH_MEMORY );
+        return FALSE;
+    }
+    fci->batch_in = lzx->buffer + lzx->history_size;
+    return TRUE;
 }
 
 
@@ -1003,6 +1730,7 @@ HFCI __cdecl FCICreate(
 	void *pv)
 {
   FCI_Int *p_fci_internal;
+  SYSTEM_INFO system_info;
 
   if (!perf) {
     SetLastError(ERROR_BAD_ARGUMENTS);
@@ -1046,6 +1774,8 @@ HFCI __cdecl FCICreate(
   p_fci_internal->pv = pv;
   p_fci_internal->data.handle = -1;
   p_fci_internal->compress = compress_NONE;
+  GetSystemInfo( &system_info );
+  p_fci_internal->thread_count = max( min( system_info.dwNumberOfProcessors, FCI_MAX_THREADS ), 1 );
 
   list_init( &p_fci_internal->folders_list );
   list_init( &p_fci_internal->files_list );
@@ -1102,7 +1832,10 @@ static BOOL fci_flush_folder( FCI_Int *p_fci_internal,
   p_fci_internal->fSplitFolder=FALSE;
 
   /* START of COPY */
-  if (!add_data_block( p_fci_internal, pfnfcis )) return FALSE;
+  if (!add_data_block( p_fci_internal, pfnfcis ) ||
+      !flush_data_blocks( p_fci_internal, pfnfcis )) return FALSE;
+  /* the next folder starts a new compressed stream */
+  if (p_fci_internal->lzx) reset_LZX( p_fci_internal->lzx );
 
   /* reset to get the number of data blocks of this folder which are */
   /* actually in this cabinet ( at least partially ) */
@@ -1410,12 +2143,21 @@ BOOL __cdecl FCIAddFile(
   if (typeCompress != p_fci_internal->compression)
   {
       if (!FCIFlushFolder( hfci, pfnfcignc, pfnfcis )) return FALSE;
-      switch (typeCompress)
+      free_LZX( p_fci_internal );
+      p_fci_internal->compression = tcompTYPE_NONE;
+      p_fci_internal->compress    = compress_NONE;
+      p_fci_internal->batch_in    = NULL;
+      switch (CompressionTypeFromTCOMP( typeCompress ))
       {
       case tcompTYPE_MSZIP:
           p_fci_internal->compression = tcompTYPE_MSZIP;
           p_fci_internal->compress    = compress_MSZIP;
           break;
+      case tcompTYPE_LZX:
+          if (!init_LZX( p_fci_internal, LZXCompressionWindowFromTCOMP( typeCompress ) )) return FALSE;
+          p_fci_internal->compression = typeCompress;
+          p_fci_internal->compress    = compress_LZX;
+          break;
       default:
           FIXME( "compression %x not supported, defaulting to none\n", typeCompress );
           /* fall through */
@@ -1702,6 +2444,7 @@ BOOL __cdecl FCIDestroy(HFCI hfci)
     struct file *file, *file_next;
     struct data_block *block, *block_next;
     FCI_Int *p_fci_internal = get_fci_ptr( hfci );
+    unsigned int i;
 
     if (!p_fci_internal) return FALSE;
 
@@ -1724,6 +2467,11 @@ BOOL __cdecl FCIDestroy(HFCI hfci)
 
     close_temp_file( p_fci_internal, &p_fci_internal->data );
 
+    for (i = 0; i < p_fci_internal->zstream_count; i++) deflateEnd( &p_fci_internal->zstreams[i] );
+    free_LZX( p_fci_internal );
+    if (p_fci_internal->batch_data) p_fci_internal->free( p_fci_internal->batch_data );
+    if (p_fci_internal->batch_out) p_fci_internal->free( p_fci_internal->batch_out );
+
     /* hfci can now be removed */
     p_fci_internal->free(hfci);
     return TRUE;
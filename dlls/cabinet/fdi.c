@@ -142,6 +142,7 @@ typedef struct fdi_cds_fwd {
   cab_UBYTE *outpos;               /* (high level) start of data to use up  */
   cab_UWORD outlen;                /* (high level) amount of data to use up */
   int (*decompress)(int, int, struct fdi_cds_fwd *); /* chosen compress fn  */
+  cab_UBYTE *inptr;                /* (low level) compressed block data     */
   cab_UBYTE inbuf[CAB_INPUTMAX+2]; /* +2 for lzx bitbuffer overflows!       */
   cab_UBYTE outbuf[CAB_BLOCKMAX];
   union {
@@ -853,7 +854,7 @@ static int NONEfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
 {
   if (inlen != outlen) return DECR_ILLEGALDATA;
   if (outlen > CAB_BLOCKMAX) return DECR_DATAFORMAT;
-  memcpy(CAB(outbuf), CAB(inbuf), (size_t) inlen);
+  memcpy(CAB(outbuf), CAB(inptr), (size_t) inlen);
   return DECR_OK;
 }
 
@@ -1409,7 +1410,7 @@ static int ZIPfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
 
   TRACE("(inlen == %d, outlen == %d)\n", inlen, outlen);
 
-  ZIP(inpos) = CAB(inbuf);
+  ZIP(inpos) = CAB(inptr);
   ZIP(bb) = ZIP(bk) = ZIP(window_posn) = 0;
   if(outlen > ZIPWSIZE)
     return DECR_DATAFORMAT;
@@ -1433,7 +1434,7 @@ static int ZIPfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
  */
 static int QTMfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
 {
-  cab_UBYTE *inpos  = CAB(inbuf);
+  cab_UBYTE *inpos  = CAB(inptr);
   cab_UBYTE *window = QTM(window);
   cab_UBYTE *runsrc, *rundest;
   cab_ULONG window_posn = QTM(window_posn);
@@ -1604,7 +1605,7 @@ static int fdi_lzx_read_lens(cab_UBYTE *lens, cab_ULONG first, cab_ULONG last, s
  * LZXfdi_decomp(internal)
  */
 static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state) {
-  cab_UBYTE *inpos  = CAB(inbuf);
+  cab_UBYTE *inpos  = CAB(inptr);
   const cab_UBYTE *endinp = inpos + inlen;
   cab_UBYTE *window = LZX(window);
   cab_UBYTE *runsrc, *rundest;
@@ -1923,6 +1924,31 @@ static int LZXfdi_decomp(int inlen, int outlen, fdi_decomp_state *decomp_state)
   return DECR_OK;
 }
 
+/**********************************************************
+ * fdi_init_decomp (internal)
+ *
+ * Select and initialize the decompressor for a folder.
+ */
+static int fdi_init_decomp(cab_UWORD comptype, fdi_decomp_state *decomp_state)
+{
+  switch (comptype & cffoldCOMPTYPE_MASK) {
+  case cffoldCOMPTYPE_NONE:
+    CAB(decompress) = NONEfdi_decomp;
+    return DECR_OK;
+  case cffoldCOMPTYPE_MSZIP:
+    CAB(decompress) = ZIPfdi_decomp;
+    return DECR_OK;
+  case cffoldCOMPTYPE_QUANTUM:
+    CAB(decompress) = QTMfdi_decomp;
+    return QTMfdi_init((comptype >> 8) & 0x1f, (comptype >> 4) & 0xF, decomp_state);
+  case cffoldCOMPTYPE_LZX:
+    CAB(decompress) = LZXfdi_decomp;
+    return LZXfdi_init((comptype >> 8) & 0x1f, decomp_state);
+  default:
+    return DECR_DATAFORMAT;
+  }
+}
+
 /**********************************************************
  * fdi_decomp (internal)
  *
@@ -2191,6 +2217,7 @@ static int fdi_decomp(const struct fdi_file *fi, int savemode, fdi_decomp_state
     }
 
     /* decompress block */
+    CAB(inptr) = CAB(inbuf);
     if ((err = CAB(decompress)(inlen, outlen, decomp_state)))
       return err;
     CAB(outlen) = outlen;
@@ -2251,6 +2278,354 @@ static void free_decompression_mem(FDI_Int *fdi, fdi_decomp_state *decomp_state)
   }
 }
 
+/*
+ * Folders of a standalone cabinet don't depend on each other, so when the
+ * cabinet is a file we can map, they are decoded concurrently by thread pool
+ * workers, straight from the mapping.  Each folder being decoded has a ring
+ * buffer that the calling thread drains while it hands the files out in
+ * order, so the user callbacks are still only called from that thread.
+ * Workers don't start more than max_ahead folders past the one being
+ * extracted, which bounds the memory use.
+ */
+
+#define FDI_MAX_THREADS 16
+#define FDI_RING_SIZE   0x100000
+
+struct fdi_folder_job
+{
+  const struct fdi_folder *fol;
+  ULONGLONG          size;       /* uncompressed bytes needed from the folder */
+  cab_UBYTE         *ring;
+  ULONGLONG          ring_size;
+  ULONGLONG          head;       /* bytes decoded, written by the worker      */
+  ULONGLONG          tail;       /* bytes consumed, written by the caller     */
+  int                err;
+  BOOL               done;
+};
+
+struct fdi_parallel
+{
+  FDI_Int            fdi;        /* private allocator for the workers */
+  HANDLE             mapping;
+  const cab_UBYTE   *base;
+  cab_ULONG          cab_size;
+  cab_UBYTE          block_resv;
+  struct fdi_folder_job *jobs;
+  unsigned int       job_count;
+  unsigned int       current;    /* folder the caller is extracting from */
+  unsigned int       max_ahead;
+  BOOL               abort;
+  fdi_decomp_state  *states[FDI_MAX_THREADS];
+  LONG               next_job;
+  LONG               next_thread;
+  LONG               pending;
+  HANDLE             done_event;
+  CRITICAL_SECTION   cs;
+  CONDITION_VARIABLE data_ready;
+  CONDITION_VARIABLE space_ready;
+};
+
+static void * CDECL fdi_worker_alloc(ULONG cb)
+{
+  return HeapAlloc(GetProcessHeap(), 0, cb);
+}
+
+static void CDECL fdi_worker_free(void *pv)
+{
+  HeapFree(GetProcessHeap(), 0, pv);
+}
+
+/* queue decoded data, waiting for the caller to make room for it */
+static BOOL fdi_put_output(struct fdi_parallel *par, struct fdi_folder_job *job,
+  const cab_UBYTE *data, cab_UWORD len)
+{
+  unsigned int index = job - par->jobs;
+  ULONGLONG pos, chunk;
+  BOOL ret;
+
+  EnterCriticalSection(&par->cs);
+  while (!par->abort && index >= par->current && job->ring_size - (job->head - job->tail) < len)
+    SleepConditionVariableCS(&par->space_ready, &par->cs, INFINITE);
+  ret = !par->abort && index >= par->current;
+  LeaveCriticalSection(&par->cs);
+  if (!ret) return FALSE;
+
+  pos = job->head % job->ring_size;
+  chunk = min(len, job->ring_size - pos);
+  memcpy(job->ring + pos, data, chunk);
+  memcpy(job->ring, data + chunk, len - chunk);
+
+  EnterCriticalSection(&par->cs);
+  job->head += len;
+  LeaveCriticalSection(&par->cs);
+  WakeConditionVariable(&par->data_ready);
+  return TRUE;
+}
+
+static int fdi_decode_folder(struct fdi_parallel *par, struct fdi_folder_job *job,
+  fdi_decomp_state *decomp_state)
+{
+  const cab_UBYTE *ptr = par->base + job->fol->offset, *end = par->base + par->cab_size, *data;
+  LARGE_INTEGER freq, start, stop, elapsed;
+  cab_UWORD len, outlen;
+  cab_ULONG cksum;
+  unsigned int i;
+  int err;
+
+  if ((err = fdi_init_decomp(job->fol->comp_type, decomp_state))) return err;
+
+  QueryPerformanceFrequency(&freq);
+  elapsed.QuadPart = 0;
+
+  for (i = 0; i < job->fol->num_blocks && job->head < job->size; i++) {
+    if (end - ptr < cfdata_SIZEOF + par->block_resv) return DECR_INPUT;
+    data = ptr + cfdata_SIZEOF + par->block_resv;
+    len = EndGetI16(ptr+cfdata_CompressedSize);
+    outlen = EndGetI16(ptr+cfdata_UncompressedSize);
+
+    /* split blocks can't happen in a standalone cabinet */
+    if (len > CAB_INPUTMAX || !outlen || outlen > CAB_BLOCKMAX || end - data < len)
+      return DECR_INPUT;
+
+    cksum = EndGetI32(ptr+cfdata_CheckSum);
+    if (cksum && cksum != checksum(ptr+4, 4, checksum(data, len, 0)))
+      return DECR_CHECKSUM;
+    ptr = data + len;
+
+    /* decode in place, unless the bit readers could run off the end of the mapping */
+    if (end - ptr >= 4)
+      CAB(inptr) = (cab_UBYTE *)data;
+    else {
+      memcpy(CAB(inbuf), data, len);
+      CAB(inbuf)[len] = CAB(inbuf)[len+1] = 0;
+      CAB(inptr) = CAB(inbuf);
+    }
+
+    QueryPerformanceCounter(&start);
+    err = CAB(decompress)(len, outlen, decomp_state);
+    QueryPerformanceCounter(&stop);
+    elapsed.QuadPart += stop.QuadPart - start.QuadPart;
+    if (err) return err;
+
+    if (!fdi_put_output(par, job, CAB(outbuf), outlen)) return DECR_USERABORT;
+  }
+
+  TRACE("folder %u: decoded %s bytes from %u blocks in %s ticks, %u MB/s\n",
+        (unsigned int)(job - par->jobs), wine_dbgstr_longlong(job->head), i,
+        wine_dbgstr_longlong(elapsed.QuadPart),
+        (unsigned int)(job->head * freq.QuadPart / max(elapsed.QuadPart, 1) / 1000000));
+
+  return job->head < job->size ? DECR_INPUT : DECR_OK;
+}
+
+static void CALLBACK fdi_folder_callback(TP_CALLBACK_INSTANCE *instance, void *context)
+{
+  struct fdi_parallel *par = context;
+  fdi_decomp_state *decomp_state = par->states[InterlockedIncrement(&par->next_thread) - 1];
+  struct fdi_folder_job *job;
+  unsigned int index;
+  int err;
+
+  CAB(fdi) = &par->fdi;
+
+  while ((index = InterlockedIncrement(&par->next_job) - 1) < par->job_count) {
+    job = &par->jobs[index];
+
+    EnterCriticalSection(&par->cs);
+    while (!par->abort && index >= par->current + par->max_ahead)
+      SleepConditionVariableCS(&par->space_ready, &par->cs, INFINITE);
+    err = par->abort || index < par->current ? DECR_USERABORT : DECR_OK;
+    LeaveCriticalSection(&par->cs);
+
+    if (!err && !(job->ring = HeapAlloc(GetProcessHeap(), 0, job->ring_size))) err = DECR_NOMEMORY;
+    if (!err) {
+      memset(&decomp_state->methods, 0, sizeof(decomp_state->methods));
+      err = fdi_decode_folder(par, job, decomp_state);
+      free_decompression_temps(&par->fdi, job->fol, decomp_state);
+    }
+
+    EnterCriticalSection(&par->cs);
+    job->err = err;
+    job->done = TRUE;
+    /* the caller is done with the folder, nobody will read the ring anymore */
+    if (index < par->current) {
+      HeapFree(GetProcessHeap(), 0, job->ring);
+      job->ring = NULL;
+    }
+    LeaveCriticalSection(&par->cs);
+    WakeConditionVariable(&par->data_ready);
+  }
+
+  if (!InterlockedDecrement(&par->pending)) SetEvent(par->done_event);
+}
+
+static void fdi_end_parallel(struct fdi_parallel *par)
+{
+  unsigned int i;
+
+  EnterCriticalSection(&par->cs);
+  par->abort = TRUE;
+  LeaveCriticalSection(&par->cs);
+  WakeAllConditionVariable(&par->space_ready);
+
+  if (InterlockedDecrement(&par->pending)) WaitForSingleObject(par->done_event, INFINITE);
+  CloseHandle(par->done_event);
+
+  for (i = 0; i < par->job_count; i++) HeapFree(GetProcessHeap(), 0, par->jobs[i].ring);
+  for (i = 0; i < FDI_MAX_THREADS; i++) HeapFree(GetProcessHeap(), 0, par->states[i]);
+  HeapFree(GetProcessHeap(), 0, par->jobs);
+  UnmapViewOfFile(par->base);
+  CloseHandle(par->mapping);
+  DeleteCriticalSection(&par->cs);
+  HeapFree(GetProcessHeap(), 0, par);
+}
+
+/* map the cabinet, making sure it is the one the user callbacks gave us */
+static BOOL fdi_map_cabinet(struct fdi_parallel *par, const char *path, const FDICABINETINFO *fdici)
+{
+  LARGE_INTEGER size;
+  HANDLE file;
+
+  file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                     NULL, OPEN_EXISTING, 0, NULL);
+  if (file == INVALID_HANDLE_VALUE) return FALSE;
+  if (GetFileSizeEx(file, &size) && size.QuadPart >= fdici->cbCabinet)
+    par->mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (!par->mapping) return FALSE;
+
+  if (!(par->base = MapViewOfFile(par->mapping, FILE_MAP_READ, 0, 0, fdici->cbCabinet))) return FALSE;
+  par->cab_size = fdici->cbCabinet;
+
+  return fdici->cbCabinet >= cfhead_SIZEOF && !memcmp(par->base, "MSCF", 4)
+      && EndGetI32(par->base+cfhead_CabinetSize) == fdici->cbCabinet
+      && EndGetI16(par->base+cfhead_SetID) == fdici->setID
+      && EndGetI16(par->base+cfhead_CabinetIndex) == fdici->iCabinet;
+}
+
+/* set up parallel extraction, if the cabinet allows it */
+static struct fdi_parallel *fdi_start_parallel(const char *path, const FDICABINETINFO *fdici,
+  fdi_decomp_state *decomp_state)
+{
+  struct fdi_parallel *par;
+  const struct fdi_folder *fol;
+  const struct fdi_file *file, *prev = NULL;
+  unsigned int i, count, thread_count;
+  SYSTEM_INFO system_info;
+
+  GetSystemInfo(&system_info);
+  thread_count = min(min(system_info.dwNumberOfProcessors, FDI_MAX_THREADS), fdici->cFolders);
+  if (thread_count < 2 || fdici->hasprev || fdici->hasnext) return NULL;
+
+  /* the files have to be in folder order, without going backwards */
+  for (file = CAB(firstfile); file; prev = file, file = file->next) {
+    if (file->index >= fdici->cFolders) return NULL;
+    if (!prev) continue;
+    if (file->index < prev->index) return NULL;
+    if (file->index == prev->index && file->offset < prev->offset + prev->length) return NULL;
+  }
+
+  if (!(par = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*par)))) return NULL;
+  if (!fdi_map_cabinet(par, path, fdici) ||
+      !(par->jobs = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, fdici->cFolders * sizeof(*par->jobs))) ||
+      !(par->done_event = CreateEventW(NULL, TRUE, FALSE, NULL))) {
+    HeapFree(GetProcessHeap(), 0, par->jobs);
+    if (par->base) UnmapViewOfFile(par->base);
+    if (par->mapping) CloseHandle(par->mapping);
+    HeapFree(GetProcessHeap(), 0, par);
+    return NULL;
+  }
+  par->fdi.alloc = fdi_worker_alloc;
+  par->fdi.free = fdi_worker_free;
+  par->block_resv = CAB(mii).block_resv;
+  par->job_count = fdici->cFolders;
+  par->max_ahead = 2 * thread_count;
+  par->pending = 1;
+  InitializeCriticalSection(&par->cs);
+  InitializeConditionVariable(&par->data_ready);
+  InitializeConditionVariable(&par->space_ready);
+
+  for (fol = CAB(firstfol), i = 0; fol && i < par->job_count; fol = fol->next, i++)
+    par->jobs[i].fol = fol;
+  for (file = CAB(firstfile); file; file = file->next)
+    par->jobs[file->index].size = max(par->jobs[file->index].size, (ULONGLONG)file->offset + file->length);
+  for (i = 0; i < par->job_count; i++) {
+    /* folders with no data or out of the cabinet bounds are left to the sequential code */
+    if (!par->jobs[i].fol || par->jobs[i].fol->offset >= par->cab_size) {
+      fdi_end_parallel(par);
+      return NULL;
+    }
+    par->jobs[i].ring_size = min(par->jobs[i].size + CAB_BLOCKMAX, FDI_RING_SIZE);
+  }
+
+  for (i = 0; i < thread_count; i++)
+    if (!(par->states[i] = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(fdi_decomp_state)))) break;
+  thread_count = i;
+
+  par->pending = thread_count + 1;
+  for (i = 0; i < thread_count; i++)
+    if (!TrySubmitThreadpoolCallback(fdi_folder_callback, par, NULL)) break;
+  for (count = i; i < thread_count; i++) InterlockedDecrement(&par->pending);
+  if (!count) {
+    fdi_end_parallel(par);
+    return NULL;
+  }
+
+  TRACE("extracting %u folders with %u threads\n", par->job_count, count);
+  return par;
+}
+
+/* write out a file from the decoded data of its folder */
+static int fdi_decomp_parallel(FDI_Int *fdi, struct fdi_parallel *par,
+  const struct fdi_file *file, INT_PTR filehf)
+{
+  struct fdi_folder_job *job = &par->jobs[file->index];
+  ULONGLONG skip = file->offset - job->tail, bytes = file->length, avail, pos, len;
+  unsigned int i;
+  int err;
+
+  /* the caller moved on, drop the folders it no longer needs */
+  if (file->index != par->current) {
+    EnterCriticalSection(&par->cs);
+    for (i = par->current; i < file->index; i++) {
+      if (!par->jobs[i].done) continue;
+      HeapFree(GetProcessHeap(), 0, par->jobs[i].ring);
+      par->jobs[i].ring = NULL;
+    }
+    par->current = file->index;
+    LeaveCriticalSection(&par->cs);
+    WakeAllConditionVariable(&par->space_ready);
+  }
+
+  while (skip || bytes) {
+    EnterCriticalSection(&par->cs);
+    while (job->head == job->tail && !job->done)
+      SleepConditionVariableCS(&par->data_ready, &par->cs, INFINITE);
+    avail = job->head - job->tail;
+    err = job->err;
+    LeaveCriticalSection(&par->cs);
+    if (!avail) return err ? err : DECR_INPUT;
+
+    pos = job->tail % job->ring_size;
+    len = min(avail, job->ring_size - pos);
+    if (skip) {
+      /* data before the start of the file goes to /dev/null */
+      len = min(len, skip);
+      skip -= len;
+    } else {
+      len = min(len, bytes);
+      fdi->write(filehf, job->ring + pos, len);
+      bytes -= len;
+    }
+
+    EnterCriticalSection(&par->cs);
+    job->tail += len;
+    LeaveCriticalSection(&par->cs);
+    WakeAllConditionVariable(&par->space_ready);
+  }
+  return DECR_OK;
+}
+
 /***********************************************************************
  *		FDICopy (CABINET.22)
  *
@@ -2435,6 +2810,8 @@ BOOL __cdecl FDICopy(
   struct fdi_folder *fol = NULL, *linkfol = NULL; 
   struct fdi_file   *file = NULL, *linkfile = NULL;
   fdi_decomp_state *decomp_state;
+  struct fdi_parallel *par = NULL;
+  int err;
   FDI_Int *fdi = get_fdi_ptr( hfdi );
 
   TRACE("(hfdi == ^%p, pszCabinet == %s, pszCabPath == %s, flags == %x, "
@@ -2567,6 +2944,8 @@ BOOL __cdecl FDICopy(
     linkfile = file;
   }
 
+  par = fdi_start_parallel(fullpath, &fdici, decomp_state);
+
   for (file = CAB(firstfile); (file); file = file->next) {
 
     /*
@@ -2649,7 +3028,7 @@ BOOL __cdecl FDICopy(
     }
 
     /* find the folder for this file if necc. */
-    if (filehf) {
+    if (filehf && !par) {
       fol = CAB(firstfol);
       if ((file->index & cffileCONTINUED_TO_NEXT) == cffileCONTINUED_TO_NEXT) {
         /* pick the last folder */
@@ -2663,11 +3042,16 @@ BOOL __cdecl FDICopy(
       }
     }
 
-    if (filehf) {
+    if (filehf && par) {
+      TRACE("Extracting file %s as requested by callee, in parallel mode.\n", debugstr_a(file->filename));
+
+      err = fdi_decomp_parallel(fdi, par, file, filehf);
+    } else if (filehf) {
       cab_UWORD comptype = fol->comp_type;
       int ct1 = comptype & cffoldCOMPTYPE_MASK;
       int ct2 = CAB(current) ? (CAB(current)->comp_type & cffoldCOMPTYPE_MASK) : 0;
-      int err = 0;
+
+      err = 0;
 
       TRACE("Extracting file %s as requested by callee.\n", debugstr_a(file->filename));
 
@@ -2695,6 +3079,8 @@ BOOL __cdecl FDICopy(
           }
           break;
         }
+        /* the decompressors share their state, don't let the new one see stale pointers */
+        if (ct1 != ct2) memset(&decomp_state->methods, 0, sizeof(decomp_state->methods));
 
         CAB(decomp_cab) = NULL;
         CAB(fdi)->seek(CAB(cabhf), fol->offset, SEEK_SET);
@@ -2702,24 +3088,7 @@ BOOL __cdecl FDICopy(
         CAB(outlen) = 0;
 
         /* initialize the new decompressor */
-        switch (ct1) {
-        case cffoldCOMPTYPE_NONE:
-          CAB(decompress) = NONEfdi_decomp;
-          break;
-        case cffoldCOMPTYPE_MSZIP:
-          CAB(decompress) = ZIPfdi_decomp;
-          break;
-        case cffoldCOMPTYPE_QUANTUM:
-          CAB(decompress) = QTMfdi_decomp;
-          err = QTMfdi_init((comptype >> 8) & 0x1f, (comptype >> 4) & 0xF, decomp_state);
-          break;
-        case cffoldCOMPTYPE_LZX:
-          CAB(decompress) = LZXfdi_decomp;
-          err = LZXfdi_init((comptype >> 8) & 0x1f, decomp_state);
-          break;
-        default:
-          err = DECR_DATAFORMAT;
-        }
+        err = fdi_init_decomp(comptype, decomp_state);
       }
 
       CAB(current) = fol;
@@ -2756,7 +3125,9 @@ BOOL __cdecl FDICopy(
       /* now do the actual decompression */
       err = fdi_decomp(file, 1, decomp_state, pszCabPath, pfnfdin, pvUser);
       if (err) CAB(current) = NULL; else CAB(offset) += file->length;
+    }
 
+    if (filehf) {
       /* fdintCLOSE_FILE_INFO notification */
       ZeroMemory(&fdin, sizeof(FDINOTIFICATION));
       fdin.pv = pvUser;
@@ -2786,6 +3157,7 @@ BOOL __cdecl FDICopy(
     }
   }
 
+  if (par) fdi_end_parallel(par);
   if (fol) free_decompression_temps(fdi, fol, decomp_state);
   free_decompression_mem(fdi, decomp_state);
  
@@ -2793,6 +3165,7 @@ BOOL __cdecl FDICopy(
 
   bail_and_fail: /* here we free ram before error returns */
 
+  if (par) fdi_end_parallel(par);
   if (fol) free_decompression_temps(fdi, fol, decomp_state);
 
   if (filehf) fdi->close(filehf);
@@ -942,10 +942,226 @@ static void test_FDICopy(void)
 }
 
 
+#define TEST_BLOCK_SIZE 0x10000
+
+struct compress_file
+{
+    char      name[16];
+    BOOL      random;
+    BOOL      skipped;
+    ULONGLONG size;
+    ULONGLONG pos;
+    ULONG     block;
+    BOOL      mismatch;
+    BYTE      data[TEST_BLOCK_SIZE];
+};
+
+static struct compress_file compress_files[3];
+
+/* generate some text-like data, every block can be generated independently */
+static void fill_test_block(const struct compress_file *file, ULONG block, BYTE *data)
+{
+    static const char *words[] = { "cabinet ", "folder ", "file ", "data ", "block ", "window ",
+                                   "compression ", "the ", "of ", "a ", "wine ", "\r\n", "0x1234 " };
+    unsigned int pos = 0, len, seed = (block + 1) * 2654435761u + (file - compress_files);
+
+    while (pos < TEST_BLOCK_SIZE)
+    {
+        seed = seed * 1103515245 + 12345;
+        if (file->random) data[pos++] = seed >> 16;
+        else if (pos > 1024 && !((seed >> 16) % 16))
+        {
+            /* repeat some earlier data */
+            unsigned int offset = 1 + (seed >> 8) % (pos - 1);
+            for (len = 4 + (seed >> 24); len && pos < TEST_BLOCK_SIZE; len--, pos++)
+                data[pos] = data[pos - offset];
+        }
+        else
+        {
+            const char *word = words[(seed >> 16) % ARRAY_SIZE(words)];
+            while (*word && pos < TEST_BLOCK_SIZE) data[pos++] = *word++;
+        }
+    }
+}
+
+static void create_compress_file(struct compress_file *file)
+{
+    ULONGLONG pos;
+    DWORD written;
+    HANDLE handle;
+
+    handle = CreateFileA(file->name, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    ok(handle != INVALID_HANDLE_VALUE, "Failure to open file %s\n", file->name);
+    for (pos = 0; pos < file->size; pos += TEST_BLOCK_SIZE)
+    {
+        fill_test_block(file, pos / TEST_BLOCK_SIZE, file->data);
+        WriteFile(handle, file->data, min(file->size - pos, TEST_BLOCK_SIZE), &written, NULL);
+    }
+    CloseHandle(handle);
+}
+
+static UINT CDECL fdi_check_write(INT_PTR hf, void *pv, UINT cb)
+{
+    struct compress_file *file = (struct compress_file *)hf;
+    const BYTE *ptr = pv;
+    UINT len, offset, done;
+
+    for (done = 0; done < cb; done += len)
+    {
+        if (file->pos / TEST_BLOCK_SIZE != file->block)
+        {
+            file->block = file->pos / TEST_BLOCK_SIZE;
+            fill_test_block(file, file->block, file->data);
+        }
+        offset = file->pos % TEST_BLOCK_SIZE;
+        len = min(cb - done, TEST_BLOCK_SIZE - offset);
+        if (memcmp(file->data + offset, ptr + done, len)) file->mismatch = TRUE;
+        file->pos += len;
+    }
+    return cb;
+}
+
+static INT_PTR CDECL fdi_check_notify(FDINOTIFICATIONTYPE fdint, FDINOTIFICATION *info)
+{
+    struct compress_file *file;
+    unsigned int i;
+
+    switch (fdint)
+    {
+    case fdintCOPY_FILE:
+        for (i = 0; i < ARRAY_SIZE(compress_files); i++)
+        {
+            if (strcmp(info->psz1, compress_files[i].name)) continue;
+            file = &compress_files[i];
+            if (file->skipped) return 0;
+            file->pos = 0;
+            file->block = ~0u;
+            file->mismatch = FALSE;
+            return (INT_PTR)file;
+        }
+        ok(0, "unexpected file %s\n", info->psz1);
+        return 0;
+
+    case fdintCLOSE_FILE_INFO:
+        file = (struct compress_file *)info->hf;
+        ok(file->pos == file->size, "%s: got size %I64u, expected %I64u\n", file->name, file->pos, file->size);
+        ok(!file->mismatch, "%s: extracted data doesn't match\n", file->name);
+        return TRUE;
+
+    default:
+        return 0;
+    }
+}
+
+static void test_FCI_compression(void)
+{
+    static const TCOMP types[] = { tcompTYPE_NONE, tcompTYPE_MSZIP, TCOMPfromLZXWindow(15), TCOMPfromLZXWindow(21) };
+    ULONGLONG text_size = winetest_interactive ? 1024 * 1024 * 1024 : 3 * 1024 * 1024 + 12345;
+    LARGE_INTEGER freq, start, end;
+    char path[MAX_PATH], cab_name[] = "compress.cab";
+    ULONGLONG total = 0;
+    CCAB cabParams;
+    unsigned int i, j;
+    HANDLE handle;
+    HFCI hfci;
+    HFDI hfdi;
+    ERF erf;
+    BOOL ret;
+
+    /* multiple files, so that the compressed stream continues across them */
+    strcpy(compress_files[0].name, "text1.dat");
+    compress_files[0].size = text_size;
+    strcpy(compress_files[1].name, "random.dat");
+    compress_files[1].random = TRUE;
+    compress_files[1].size = 200001;
+    strcpy(compress_files[2].name, "text2.dat");
+    compress_files[2].size = winetest_interactive ? text_size : 70000;
+    for (i = 0; i < ARRAY_SIZE(compress_files); i++)
+    {
+        create_compress_file(&compress_files[i]);
+        total += compress_files[i].size;
+    }
+
+    QueryPerformanceFrequency(&freq);
+    lstrcpyA(path, CURR_DIR);
+    lstrcatA(path, "\\");
+
+    /* the last pass puts each file in its own folder, with different compression types */
+    for (i = 0; i <= ARRAY_SIZE(types); i++)
+    {
+        TCOMP type = i < ARRAY_SIZE(types) ? types[i] : 0xffff;
+
+        set_cab_parameters(&cabParams);
+        cabParams.cb = cabParams.cbFolderThresh = 0x7fffffff;
+        lstrcpyA(cabParams.szCab, cab_name);
+
+        QueryPerformanceCounter(&start);
+        hfci = FCICreate(&erf, file_placed, mem_alloc, mem_free, fci_open,
+                         fci_read, fci_write, fci_close, fci_seek, fci_delete,
+                         get_temp_file, &cabParams, NULL);
+        ok(hfci != NULL, "Failed to create an FCI context\n");
+        for (j = 0; j < ARRAY_SIZE(compress_files); j++)
+        {
+            char source[MAX_PATH];
+
+            lstrcpyA(source, path);
+            lstrcatA(source, compress_files[j].name);
+            ret = FCIAddFile(hfci, source, compress_files[j].name, FALSE, get_next_cabinet, progress,
+                             get_open_info, i < ARRAY_SIZE(types) ? type : types[(j + 1) % ARRAY_SIZE(types)]);
+            ok(ret, "%#x: FCIAddFile failed, error %d\n", type, erf.erfOper);
+            if (i < ARRAY_SIZE(types)) continue;
+            ret = FCIFlushFolder(hfci, get_next_cabinet, progress);
+            ok(ret, "%#x: FCIFlushFolder failed, error %d\n", type, erf.erfOper);
+        }
+        ret = FCIFlushCabinet(hfci, FALSE, get_next_cabinet, progress);
+        ok(ret, "%#x: Failed to flush the cabinet\n", type);
+        FCIDestroy(hfci);
+        QueryPerformanceCounter(&end);
+
+        handle = CreateFileA(cab_name, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+        ok(handle != INVALID_HANDLE_VALUE, "%#x: cabinet not created\n", type);
+        trace("%#x: compressed %I64u bytes to %u at %.1f MB/s\n", type, total, GetFileSize(handle, NULL),
+              total * freq.QuadPart / 1e6 / max(end.QuadPart - start.QuadPart, 1));
+        CloseHandle(handle);
+
+        /* skipped files don't stop the extraction of the following folders */
+        compress_files[1].skipped = (i == ARRAY_SIZE(types));
+
+        QueryPerformanceCounter(&start);
+        hfdi = FDICreate(fdi_alloc, fdi_free, fdi_open, fdi_read, fdi_check_write,
+                         fdi_close, fdi_seek, cpuUNKNOWN, &erf);
+        ret = FDICopy(hfdi, cab_name, path, 0, fdi_check_notify, NULL, NULL);
+        ok(ret, "%#x: FDICopy failed, error %d\n", type, erf.erfOper);
+        FDIDestroy(hfdi);
+        QueryPerformanceCounter(&end);
+        trace("%#x: extracted at %.1f MB/s\n", type,
+              total * freq.QuadPart / 1e6 / max(end.QuadPart - start.QuadPart, 1));
+
+        DeleteFileA(cab_name);
+    }
+
+    /* invalid LZX window */
+    set_cab_parameters(&cabParams);
+    hfci = FCICreate(&erf, file_placed, mem_alloc, mem_free, fci_open,
+                     fci_read, fci_write, fci_close, fci_seek, fci_delete,
+                     get_temp_file, &cabParams, NULL);
+    lstrcpyA(path, CURR_DIR);
+    lstrcatA(path, "\\");
+    lstrcatA(path, compress_files[1].name);
+    ret = FCIAddFile(hfci, path, compress_files[1].name, FALSE, get_next_cabinet, progress,
+                     get_open_info, TCOMPfromLZXWindow(22));
+    ok(!ret, "FCIAddFile succeeded\n");
+    ok(erf.erfOper == FCIERR_BAD_COMPR_TYPE, "got error %d\n", erf.erfOper);
+    FCIDestroy(hfci);
+
+    for (i = 0; i < ARRAY_SIZE(compress_files); i++) DeleteFileA(compress_files[i].name);
+}
+
 START_TEST(fdi)
 {
     test_FDICreate();
     test_FDIDestroy();
     test_FDIIsCabinet();
     test_FDICopy();
+    test_FCI_compression();
 }
@@ -27550,6 +27550,262 @@ static void test_filling_convention(void)
     DestroyWindow(window);
 }
 
+struct redundant_state_run
+{
+    const D3DMATRIX *world;
+    D3DCOLOR tfactor;
+    DWORD colour_op;
+    DWORD max_mip_level;
+};
+
+static void set_redundant_states(IDirect3DDevice9 *device, const struct redundant_state_run *run, BOOL clip)
+{
+    static const D3DCOLOR colours[] = {0x00ff00ff, 0x0000ffff, 0x00808080};
+    static const float clip_all[] = {0.0f, 0.0f, 0.0f, -1.0f}, clip_none[] = {0.0f, 0.0f, 0.0f, 1.0f};
+    static const D3DMATRIX offscreen =
+    {{{
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        4.0f, 4.0f, 0.0f, 1.0f,
+    }}};
+    unsigned int i;
+    HRESULT hr;
+
+    /* Every value changes several times, only the last one may be used by the next draw. */
+    for (i = 0; i < 16; ++i)
+    {
+        hr = IDirect3DDevice9_SetTransform(device, D3DTS_WORLD, &offscreen);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        hr = IDirect3DDevice9_SetRenderState(device, D3DRS_TEXTUREFACTOR, colours[i % ARRAY_SIZE(colours)]);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        hr = IDirect3DDevice9_SetTextureStageState(device, 0, D3DTSS_COLOROP,
+                i & 1 ? D3DTOP_SELECTARG2 : D3DTOP_MODULATE);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        hr = IDirect3DDevice9_SetSamplerState(device, 0, D3DSAMP_MAXMIPLEVEL, i);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        if (!clip)
+            continue;
+        hr = IDirect3DDevice9_SetClipPlane(device, 0, clip_all);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        hr = IDirect3DDevice9_SetRenderState(device, D3DRS_CLIPPLANEENABLE, i & 1);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    }
+
+    hr = IDirect3DDevice9_SetTransform(device, D3DTS_WORLD, run->world);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_TEXTUREFACTOR, run->tfactor);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetTextureStageState(device, 0, D3DTSS_COLOROP, run->colour_op);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetSamplerState(device, 0, D3DSAMP_MAXMIPLEVEL, run->max_mip_level);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    if (clip)
+    {
+        hr = IDirect3DDevice9_SetClipPlane(device, 0, clip_none);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+        hr = IDirect3DDevice9_SetRenderState(device, D3DRS_CLIPPLANEENABLE, 1);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    }
+}
+
+static void check_redundant_states(IDirect3DDevice9 *device, const struct redundant_state_run *run, BOOL clip)
+{
+    D3DMATRIX world;
+    float plane[4];
+    DWORD value;
+    HRESULT hr;
+
+    hr = IDirect3DDevice9_GetTransform(device, D3DTS_WORLD, &world);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(!memcmp(&world, run->world, sizeof(world)), "Got unexpected world matrix.\n");
+    hr = IDirect3DDevice9_GetRenderState(device, D3DRS_TEXTUREFACTOR, &value);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(value == run->tfactor, "Got unexpected texture factor 0x%08x.\n", value);
+    hr = IDirect3DDevice9_GetTextureStageState(device, 0, D3DTSS_COLOROP, &value);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(value == run->colour_op, "Got unexpected colour op %#x.\n", value);
+    hr = IDirect3DDevice9_GetSamplerState(device, 0, D3DSAMP_MAXMIPLEVEL, &value);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(value == run->max_mip_level, "Got unexpected max mip level %u.\n", value);
+    if (!clip)
+        return;
+    hr = IDirect3DDevice9_GetClipPlane(device, 0, plane);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    ok(plane[0] == 0.0f && plane[1] == 0.0f && plane[2] == 0.0f && plane[3] == 1.0f,
+            "Got unexpected clip plane {%.8e, %.8e, %.8e, %.8e}.\n", plane[0], plane[1], plane[2], plane[3]);
+}
+
+static void test_redundant_state_changes(void)
+{
+    static const D3DMATRIX identity =
+    {{{
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    }}},
+    top_left =
+    {{{
+         0.5f, 0.0f, 0.0f, 0.0f,
+         0.0f, 0.5f, 0.0f, 0.0f,
+         0.0f, 0.0f, 1.0f, 0.0f,
+        -0.5f, 0.5f, 0.0f, 1.0f,
+    }}},
+    top_right =
+    {{{
+        0.5f, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.5f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.5f, 0.5f, 0.0f, 1.0f,
+    }}},
+    centre =
+    {{{
+        0.25f, 0.0f,  0.0f, 0.0f,
+        0.0f,  0.25f, 0.0f, 0.0f,
+        0.0f,  0.0f,  1.0f, 0.0f,
+        0.0f,  0.0f,  0.0f, 1.0f,
+    }}};
+    static const struct redundant_state_run runs[] =
+    {
+        {&top_left,  0x00ff0000, D3DTOP_SELECTARG1, 3},
+        {&top_right, 0x0000ff00, D3DTOP_SELECTARG1, 5},
+        {&centre,    0x000000ff, D3DTOP_SELECTARG2, 7},
+    };
+    static const struct vec3 quad[] =
+    {
+        {-1.0f, -1.0f, 0.5f},
+        {-1.0f,  1.0f, 0.5f},
+        { 1.0f, -1.0f, 0.5f},
+        { 1.0f,  1.0f, 0.5f},
+    };
+    IDirect3DSurface9 *rt, *surface;
+    static const POINT bottom_left = {0, 240};
+    static const D3DRECT bottom_right = {320, 240, 640, 480};
+    IDirect3DDevice9 *device;
+    D3DLOCKED_RECT lr;
+    unsigned int x, y;
+    IDirect3D9 *d3d;
+    BOOL draws, clip;
+    ULONG refcount;
+    D3DCOLOR color;
+    D3DCAPS9 caps;
+    HWND window;
+    HRESULT hr;
+
+    window = create_window();
+    d3d = Direct3DCreate9(D3D_SDK_VERSION);
+    ok(!!d3d, "Failed to create a D3D object.\n");
+    if (!(device = create_device(d3d, window, window, TRUE)))
+    {
+        skip("Failed to create a D3D device, skipping tests.\n");
+        goto done;
+    }
+
+    hr = IDirect3DDevice9_GetDeviceCaps(device, &caps);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    clip = caps.MaxUserClipPlanes > 0;
+    hr = IDirect3DDevice9_GetRenderTarget(device, 0, &rt);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    hr = IDirect3DDevice9_CreateOffscreenPlainSurface(device, 320, 240, D3DFMT_A8R8G8B8,
+            D3DPOOL_SYSTEMMEM, &surface, NULL);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DSurface9_LockRect(surface, &lr, NULL, 0);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    for (y = 0; y < 240; ++y)
+    {
+        for (x = 0; x < 320; ++x)
+            ((DWORD *)((BYTE *)lr.pBits + y * lr.Pitch))[x] = 0xffffff00;
+    }
+    hr = IDirect3DSurface9_UnlockRect(surface);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_LIGHTING, FALSE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_ZENABLE, D3DZB_FALSE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_CULLMODE, D3DCULL_NONE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetTextureStageState(device, 0, D3DTSS_COLORARG1, D3DTA_TFACTOR);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetTextureStageState(device, 0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetTextureStageState(device, 0, D3DTSS_COLOROP, D3DTOP_SELECTARG1);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetRenderState(device, D3DRS_TEXTUREFACTOR, 0x00ffffff);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetFVF(device, D3DFVF_XYZ);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    /* The no3d adapter doesn't rasterise draws, the queue still has to be
+     * processed correctly around them though. */
+    hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0x00000000, 1.0f, 0);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLESTRIP, 2, quad, sizeof(*quad));
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    draws = getPixelColor(device, 320, 240) == 0x00ffffff;
+    if (!draws)
+        skip("Draws are not rendered, only checking clears and resource updates.\n");
+
+    hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0x00000000, 1.0f, 0);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    set_redundant_states(device, &runs[0], clip);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLESTRIP, 2, quad, sizeof(*quad));
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    check_redundant_states(device, &runs[0], clip);
+
+    /* The following changes must not leak into the previous draw. */
+    set_redundant_states(device, &runs[1], clip);
+    hr = IDirect3DDevice9_UpdateSurface(device, surface, NULL, rt, &bottom_left);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    set_redundant_states(device, &runs[1], clip);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLESTRIP, 2, quad, sizeof(*quad));
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    check_redundant_states(device, &runs[1], clip);
+
+    set_redundant_states(device, &runs[2], clip);
+    hr = IDirect3DDevice9_Clear(device, 1, &bottom_right, D3DCLEAR_TARGET, 0x00ff00ff, 1.0f, 0);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    set_redundant_states(device, &runs[2], clip);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLESTRIP, 2, quad, sizeof(*quad));
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    check_redundant_states(device, &runs[2], clip);
+
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    color = getPixelColor(device, 160, 120);
+    ok(color == (draws ? 0x00ff0000 : 0x00000000), "Got unexpected color 0x%08x.\n", color);
+    color = getPixelColor(device, 480, 120);
+    ok(color == (draws ? 0x0000ff00 : 0x00000000), "Got unexpected color 0x%08x.\n", color);
+    color = getPixelColor(device, 160, 360);
+    ok(color == 0x00ffff00, "Got unexpected color 0x%08x.\n", color);
+    color = getPixelColor(device, 600, 440);
+    ok(color == 0x00ff00ff, "Got unexpected color 0x%08x.\n", color);
+    /* The last draw selects the diffuse colour, which is white without a diffuse component. */
+    color = getPixelColor(device, 320, 240);
+    ok(color == (draws ? 0x00ffffff : 0x00ff00ff), "Got unexpected color 0x%08x.\n", color);
+
+    hr = IDirect3DDevice9_Present(device, NULL, NULL, NULL, NULL);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    IDirect3DSurface9_Release(surface);
+    IDirect3DSurface9_Release(rt);
+    refcount = IDirect3DDevice9_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+done:
+    IDirect3D9_Release(d3d);
+    DestroyWindow(window);
+}
+
 START_TEST(visual)
 {
     D3DADAPTER_IDENTIFIER9 identifier;
@@ -27700,4 +27956,5 @@ START_TEST(visual)
     test_sample_mask();
     test_dynamic_map_synchronization();
     test_filling_convention();
+    test_redundant_state_changes();
 }
@@ -1634,6 +1634,337 @@ static HRESULT remap_faces_for_attrsort(struct d3dx9_mesh *This, const DWORD *in
     return D3D_OK;
 }
 
+/* Creates a vertex_remap that orders the vertices by their first use in the
+ * new face order, removing unused vertices. Indices are updated according to
+ * the vertex_remap. */
+static HRESULT remap_vertices_by_first_use(struct d3dx9_mesh *This, DWORD *indices,
+        const DWORD *face_remap, DWORD *new_num_vertices, ID3DXBuffer **vertex_remap)
+{
+    DWORD *vertex_remap_ptr;
+    DWORD *old_to_new, *face_order;
+    DWORD num_used_vertices;
+    HRESULT hr;
+    DWORD i, j;
+
+    old_to_new = HeapAlloc(GetProcessHeap(), 0, (This->numvertices + This->numfaces) * sizeof(DWORD));
+    if (!old_to_new)
+        return E_OUTOFMEMORY;
+    face_order = old_to_new + This->numvertices;
+
+    hr = D3DXCreateBuffer(This->numvertices * sizeof(DWORD), vertex_remap);
+    if (FAILED(hr))
+    {
+        HeapFree(GetProcessHeap(), 0, old_to_new);
+        return hr;
+    }
+    vertex_remap_ptr = ID3DXBuffer_GetBufferPointer(*vertex_remap);
+
+    for (i = 0; i < This->numfaces; i++)
+        face_order[face_remap ? face_remap[i] : i] = i;
+    memset(old_to_new, 0xff, This->numvertices * sizeof(DWORD));
+
+    num_used_vertices = 0;
+    for (i = 0; i < This->numfaces; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            DWORD vertex = indices[face_order[i] * 3 + j];
+
+            if (old_to_new[vertex] == -1)
+            {
+                vertex_remap_ptr[num_used_vertices] = vertex;
+                old_to_new[vertex] = num_used_vertices++;
+            }
+        }
+    }
+    for (i = num_used_vertices; i < This->numvertices; i++)
+        vertex_remap_ptr[i] = -1;
+
+    for (i = 0; i < This->numfaces * 3; i++)
+        indices[i] = old_to_new[indices[i]];
+
+    *new_num_vertices = num_used_vertices;
+
+    HeapFree(GetProcessHeap(), 0, old_to_new);
+    return D3D_OK;
+}
+
+#define VERTEX_CACHE_SIZE 32
+
+struct vertex_cache_entry
+{
+    float score;
+    int cache_pos;
+    DWORD face_offset;
+    DWORD face_count; /* number of faces left to emit */
+};
+
+/* Vertex scoring from Tom Forsyth's linear-speed vertex cache optimisation:
+ * favour vertices recently used and vertices with few faces left. */
+static float vertex_cache_score(const struct vertex_cache_entry *vertex)
+{
+    static const float cache_decay_power = 1.5f;
+    static const float last_face_score = 0.75f;
+    static const float valence_boost_scale = 2.0f;
+    static const float valence_boost_power = 0.5f;
+    float score = 0.0f;
+
+    if (!vertex->face_count)
+        return -1.0f;
+
+    if (vertex->cache_pos >= 0)
+    {
+        if (vertex->cache_pos < 3)
+            score = last_face_score;
+        else
+            score = powf(1.0f - (vertex->cache_pos - 3) * (1.0f / (VERTEX_CACHE_SIZE - 3)), cache_decay_power);
+    }
+
+    return score + valence_boost_scale * powf(vertex->face_count, -valence_boost_power);
+}
+
+/* Reorders the faces listed in face_order (old face indices) to improve the
+ * post-transform vertex cache hit rate. The vertices entries must be
+ * initialized with face_offset -1 and cache_pos -1, and are left that way. */
+static void optimize_faces_vertex_cache(const DWORD *indices, const DWORD *face_order, DWORD num_faces,
+        DWORD *new_face_order, struct vertex_cache_entry *vertices, DWORD *face_list,
+        float *face_scores, BYTE *emitted)
+{
+    DWORD cache[VERTEX_CACHE_SIZE + 3], new_cache[VERTEX_CACHE_SIZE + 3];
+    DWORD cache_size = 0, new_cache_size;
+    DWORD i, j, k, face_offset = 0, next = 0, best = 0;
+    float best_score = -1.0f;
+
+    for (i = 0; i < num_faces; i++)
+    {
+        for (j = 0; j < 3; j++)
+            vertices[indices[face_order[i] * 3 + j]].face_count++;
+    }
+    for (i = 0; i < num_faces; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            struct vertex_cache_entry *vertex = &vertices[indices[face_order[i] * 3 + j]];
+
+            if (vertex->face_offset == -1)
+            {
+                vertex->face_offset = face_offset;
+                face_offset += vertex->face_count;
+                vertex->face_count = 0;
+            }
+            face_list[vertex->face_offset + vertex->face_count++] = i;
+        }
+    }
+    for (i = 0; i < num_faces; i++)
+    {
+        emitted[i] = 0;
+        face_scores[i] = 0.0f;
+        for (j = 0; j < 3; j++)
+        {
+            struct vertex_cache_entry *vertex = &vertices[indices[face_order[i] * 3 + j]];
+
+            vertex->score = vertex_cache_score(vertex);
+            face_scores[i] += vertex->score;
+        }
+        if (face_scores[i] > best_score)
+        {
+            best_score = face_scores[i];
+            best = i;
+        }
+    }
+
+    for (k = 0; k < num_faces; k++)
+    {
+        const DWORD *face = &indices[face_order[best] * 3];
+
+        new_face_order[k] = face_order[best];
+        emitted[best] = 1;
+
+        for (j = 0; j < 3; j++)
+        {
+            struct vertex_cache_entry *vertex = &vertices[face[j]];
+
+            for (i = 0; i < vertex->face_count; i++)
+            {
+                if (face_list[vertex->face_offset + i] != best) continue;
+                face_list[vertex->face_offset + i] = face_list[vertex->face_offset + --vertex->face_count];
+                break;
+            }
+        }
+
+        /* move the face vertices to the front of the simulated LRU cache */
+        new_cache_size = 0;
+        for (j = 0; j < 3; j++)
+        {
+            for (i = 0; i < new_cache_size; i++)
+                if (new_cache[i] == face[j]) break;
+            if (i == new_cache_size) new_cache[new_cache_size++] = face[j];
+        }
+        for (i = 0; i < cache_size; i++)
+        {
+            if (cache[i] != face[0] && cache[i] != face[1] && cache[i] != face[2])
+                new_cache[new_cache_size++] = cache[i];
+        }
+
+        /* update the scores of the vertices in the cache, and those just evicted */
+        for (i = 0; i < new_cache_size; i++)
+        {
+            struct vertex_cache_entry *vertex = &vertices[new_cache[i]];
+            float score, delta;
+
+            vertex->cache_pos = i < VERTEX_CACHE_SIZE ? i : -1;
+            score = vertex_cache_score(vertex);
+            delta = score - vertex->score;
+            vertex->score = score;
+            for (j = 0; j < vertex->face_count; j++)
+                face_scores[face_list[vertex->face_offset + j]] += delta;
+        }
+
+        cache_size = min(new_cache_size, VERTEX_CACHE_SIZE);
+        memcpy(cache, new_cache, cache_size * sizeof(*cache));
+
+        /* only faces using cached vertices are candidates for the next one */
+        best_score = -1.0f;
+        for (i = 0; i < cache_size; i++)
+        {
+            const struct vertex_cache_entry *vertex = &vertices[cache[i]];
+
+            for (j = 0; j < vertex->face_count; j++)
+            {
+                DWORD candidate = face_list[vertex->face_offset + j];
+
+                if (face_scores[candidate] > best_score)
+                {
+                    best_score = face_scores[candidate];
+                    best = candidate;
+                }
+            }
+        }
+        if (best_score < 0.0f)
+        {
+            while (next < num_faces && emitted[next]) next++;
+            best = next;
+        }
+    }
+
+    for (i = 0; i < num_faces; i++)
+    {
+        for (j = 0; j < 3; j++)
+        {
+            struct vertex_cache_entry *vertex = &vertices[indices[face_order[i] * 3 + j]];
+
+            vertex->face_offset = -1;
+            vertex->face_count = 0;
+            vertex->cache_pos = -1;
+        }
+    }
+}
+
+/* Reorders the faces listed in face_order (old face indices) by walking along
+ * adjacent faces with the same attribute, the way a triangle strip would. */
+static void optimize_faces_strip(const DWORD *adjacency, const DWORD *attrib_buffer, DWORD total_faces,
+        const DWORD *face_order, DWORD num_faces, DWORD *new_face_order, BYTE *visited)
+{
+    DWORD i, j, k = 0;
+
+    for (i = 0; i < num_faces; i++)
+    {
+        DWORD face = face_order[i], edge = 0;
+        BOOL turn = FALSE;
+
+        while (!visited[face])
+        {
+            DWORD next = -1;
+
+            visited[face] = 1;
+            new_face_order[k++] = face;
+
+            for (j = 0; j < 3; j++)
+            {
+                DWORD neighbor = adjacency[face * 3 + (edge + j) % 3];
+
+                if (neighbor < total_faces && !visited[neighbor] && attrib_buffer[neighbor] == attrib_buffer[face])
+                {
+                    next = neighbor;
+                    break;
+                }
+            }
+            if (next == -1)
+                break;
+
+            /* leave the next face through the edge following the shared one,
+             * alternating sides like a strip */
+            for (edge = 0; edge < 2; edge++)
+                if (adjacency[next * 3 + edge] == face) break;
+            turn = !turn;
+            edge = (edge + (turn ? 1 : 2)) % 3;
+            face = next;
+        }
+    }
+}
+
+/* Reorders the faces within each attribute range, updating face_remap. */
+static HRESULT optimize_face_order(struct d3dx9_mesh *This, DWORD flags, const DWORD *indices,
+        const DWORD *adjacency, const DWORD *attrib_buffer, const DWORD *sorted_attrib_buffer, DWORD *face_remap)
+{
+    struct vertex_cache_entry *vertices = NULL;
+    DWORD *face_order, *new_face_order, *face_list = NULL;
+    float *face_scores = NULL;
+    BYTE *emitted;
+    DWORD start, end, i;
+    HRESULT hr = E_OUTOFMEMORY;
+
+    face_order = HeapAlloc(GetProcessHeap(), 0, This->numfaces * 2 * sizeof(*face_order));
+    emitted = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, This->numfaces);
+    if (!face_order || !emitted)
+        goto done;
+    new_face_order = face_order + This->numfaces;
+
+    if (flags & D3DXMESHOPT_VERTEXCACHE)
+    {
+        vertices = HeapAlloc(GetProcessHeap(), 0, This->numvertices * sizeof(*vertices));
+        face_list = HeapAlloc(GetProcessHeap(), 0, This->numfaces * 3 * sizeof(*face_list));
+        face_scores = HeapAlloc(GetProcessHeap(), 0, This->numfaces * sizeof(*face_scores));
+        if (!vertices || !face_list || !face_scores)
+            goto done;
+        for (i = 0; i < This->numvertices; i++)
+        {
+            vertices[i].score = 0.0f;
+            vertices[i].cache_pos = -1;
+            vertices[i].face_offset = -1;
+            vertices[i].face_count = 0;
+        }
+    }
+
+    for (i = 0; i < This->numfaces; i++)
+        face_order[face_remap[i]] = i;
+
+    for (start = 0; start < This->numfaces; start = end)
+    {
+        for (end = start + 1; end < This->numfaces; end++)
+            if (sorted_attrib_buffer[end] != sorted_attrib_buffer[start]) break;
+
+        if (flags & D3DXMESHOPT_VERTEXCACHE)
+            optimize_faces_vertex_cache(indices, face_order + start, end - start, new_face_order + start,
+                    vertices, face_list, face_scores, emitted);
+        else
+            optimize_faces_strip(adjacency, attrib_buffer, This->numfaces, face_order + start, end - start,
+                    new_face_order + start, emitted);
+    }
+
+    for (i = 0; i < This->numfaces; i++)
+        face_remap[new_face_order[i]] = i;
+    hr = D3D_OK;
+
+done:
+    HeapFree(GetProcessHeap(), 0, face_scores);
+    HeapFree(GetProcessHeap(), 0, face_list);
+    HeapFree(GetProcessHeap(), 0, vertices);
+    HeapFree(GetProcessHeap(), 0, emitted);
+    HeapFree(GetProcessHeap(), 0, face_order);
+    return hr;
+}
+
 static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags, const DWORD *adjacency_in,
         DWORD *adjacency_out, DWORD *face_remap_out, ID3DXBuffer **vertex_remap_out)
 {
@@ -1660,14 +1991,9 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
     if ((flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER)) == (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
         return D3DERR_INVALIDCALL;
 
+    /* Reordering faces for the vertex cache implies sorting them by attribute. */
     if (flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
-    {
-        if (flags & D3DXMESHOPT_VERTEXCACHE)
-            FIXME("D3DXMESHOPT_VERTEXCACHE not implemented.\n");
-        if (flags & D3DXMESHOPT_STRIPREORDER)
-            FIXME("D3DXMESHOPT_STRIPREORDER not implemented.\n");
-        return E_NOTIMPL;
-    }
+        flags |= D3DXMESHOPT_ATTRSORT;
 
     hr = iface->lpVtbl->LockIndexBuffer(iface, 0, &indices);
     if (FAILED(hr)) goto cleanup;
@@ -1688,14 +2014,25 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
         hr = compact_mesh(This, dword_indices, &new_num_vertices, &vertex_remap);
         if (FAILED(hr)) goto cleanup;
     } else if (flags & D3DXMESHOPT_ATTRSORT) {
-        if (!(flags & D3DXMESHOPT_IGNOREVERTS))
-            FIXME("D3DXMESHOPT_ATTRSORT vertex reordering not implemented.\n");
-
         hr = iface->lpVtbl->LockAttributeBuffer(iface, 0, &attrib_buffer);
         if (FAILED(hr)) goto cleanup;
 
         hr = remap_faces_for_attrsort(This, dword_indices, attrib_buffer, &sorted_attrib_buffer, &face_remap);
         if (FAILED(hr)) goto cleanup;
+
+        if (flags & (D3DXMESHOPT_VERTEXCACHE | D3DXMESHOPT_STRIPREORDER))
+        {
+            hr = optimize_face_order(This, flags, dword_indices, adjacency_in, attrib_buffer,
+                    sorted_attrib_buffer, face_remap);
+            if (FAILED(hr)) goto cleanup;
+        }
+
+        if (!(flags & D3DXMESHOPT_IGNOREVERTS))
+        {
+            new_num_alloc_vertices = This->numvertices;
+            hr = remap_vertices_by_first_use(This, dword_indices, face_remap, &new_num_vertices, &vertex_remap);
+            if (FAILED(hr)) goto cleanup;
+        }
     }
 
     if (vertex_remap)
@@ -1788,9 +2125,11 @@ static HRESULT WINAPI d3dx9_mesh_OptimizeInplace(ID3DXMesh *iface, DWORD flags,
             for (i = 0; i < This->numfaces; i++) {
                 DWORD old_pos = i * 3;
                 DWORD new_pos = face_remap[i] * 3;
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
-                adjacency_out[new_pos++] = face_remap[adjacency_in[old_pos++]];
+                DWORD j;
+
+                for (j = 0; j < 3; j++, old_pos++)
+                    adjacency_out[new_pos++] = adjacency_in[old_pos] < This->numfaces
+                            ? face_remap[adjacency_in[old_pos]] : adjacency_in[old_pos];
             }
         } else {
             memcpy(adjacency_out, adjacency_in, This->numfaces * 3 * sizeof(*adjacency_out));
@@ -257,6 +257,30 @@ struct d3dx_pres_ins
     struct d3dx_pres_operand output;
 };
 
+struct d3dx_pres_code_arg
+{
+    const float *f;
+    const double *d;
+    /* 0 for the propagated scalar argument. */
+    unsigned int stride;
+};
+
+/* Preshader instruction with resolved register pointers, as executed on parameter updates. */
+struct d3dx_pres_code_ins
+{
+    const struct d3dx_pres_ins *ins;
+    /* Executed component by component through exec_get_arg() / exec_set_arg(). */
+    BOOL generic;
+    /* All the inputs are constant, the result is stored in 'values'. */
+    BOOL folded;
+    unsigned int output_count;
+    /* Output components which are actually written. */
+    unsigned int mask;
+    struct d3dx_pres_code_arg inputs[MAX_INPUTS_COUNT];
+    float *output;
+    double values[4];
+};
+
 struct const_upload_info
 {
     BOOL transpose;
@@ -1220,6 +1244,238 @@ static HRESULT parse_preshader(struct d3dx_preshader *pres, unsigned int *ptr, u
     return D3D_OK;
 }
 
+static unsigned int get_pres_ins_input_offset(const struct d3dx_pres_ins *ins, unsigned int input,
+        unsigned int comp)
+{
+    return ins->inputs[input].reg.offset + (ins->scalar_op && !input ? 0 : comp);
+}
+
+static void init_pres_code_ins(struct d3dx_regstore *rs, const struct d3dx_pres_ins *ins,
+        struct d3dx_pres_code_ins *code)
+{
+    const struct op_info *oi = &pres_op_info[ins->op];
+    const struct d3dx_pres_reg *out = &ins->output.reg;
+    unsigned int i, j, k;
+
+    code->ins = ins;
+    code->output_count = oi->func_all_comps ? 1 : ins->component_count;
+    code->mask = (1u << code->output_count) - 1;
+    if (table_info[out->table].type == PRES_VT_FLOAT)
+        code->output = (float *)rs->tables[out->table] + out->offset;
+
+    for (i = 0; i < oi->input_count; ++i)
+    {
+        const struct d3dx_pres_operand *opr = &ins->inputs[i];
+
+        if (opr->index_reg.table != PRES_REGTAB_COUNT)
+        {
+            code->generic = TRUE;
+            return;
+        }
+        switch (table_info[opr->reg.table].type)
+        {
+            case PRES_VT_FLOAT:
+                code->inputs[i].f = (float *)rs->tables[opr->reg.table] + opr->reg.offset;
+                break;
+            case PRES_VT_DOUBLE:
+                code->inputs[i].d = (double *)rs->tables[opr->reg.table] + opr->reg.offset;
+                break;
+            default:
+                code->generic = TRUE;
+                return;
+        }
+        code->inputs[i].stride = ins->scalar_op && !i ? 0 : 1;
+
+        /* The components are written one at a time, an input can see the preceding output components. */
+        if (opr->reg.table != out->table || oi->func_all_comps)
+            continue;
+        for (j = 1; j < ins->component_count; ++j)
+        {
+            for (k = 0; k < j; ++k)
+            {
+                if (get_pres_ins_input_offset(ins, i, j) == out->offset + k)
+                {
+                    code->generic = TRUE;
+                    return;
+                }
+            }
+        }
+    }
+}
+
+static BOOL get_pres_code_const_input(struct d3dx_regstore *rs, const struct d3dx_pres_ins *ins,
+        unsigned int input, unsigned int comp, const BYTE *known, const double *known_values, double *value)
+{
+    unsigned int offset = get_pres_ins_input_offset(ins, input, comp);
+
+    switch (ins->inputs[input].reg.table)
+    {
+        case PRES_REGTAB_IMMED:
+            *value = regstore_get_double(rs, PRES_REGTAB_IMMED, offset);
+            return TRUE;
+        case PRES_REGTAB_TEMP:
+            if (!known[offset])
+                return FALSE;
+            *value = known_values[offset];
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+static void fold_pres_code_ins(struct d3dx_regstore *rs, struct d3dx_pres_code_ins *code,
+        const BYTE *known, const double *known_values)
+{
+    const struct d3dx_pres_ins *ins = code->ins;
+    const struct op_info *oi = &pres_op_info[ins->op];
+    double args[MAX_INPUTS_COUNT];
+    unsigned int i, j;
+
+    if (code->generic)
+        return;
+
+    if (oi->func_all_comps)
+    {
+        if (oi->input_count * ins->component_count > ARRAY_SIZE(args))
+            return;
+        for (i = 0; i < oi->input_count; ++i)
+            for (j = 0; j < ins->component_count; ++j)
+                if (!get_pres_code_const_input(rs, ins, i, j, known, known_values,
+                        &args[i * ins->component_count + j]))
+                    return;
+        code->values[0] = oi->func(args, ins->component_count);
+    }
+    else
+    {
+        for (j = 0; j < ins->component_count; ++j)
+        {
+            for (i = 0; i < oi->input_count; ++i)
+                if (!get_pres_code_const_input(rs, ins, i, j, known, known_values, &args[i]))
+                    return;
+            code->values[j] = oi->func(args, ins->component_count);
+        }
+    }
+    code->folded = TRUE;
+}
+
+static void mark_pres_code_temp_reads(const struct d3dx_pres_code_ins *code, const BYTE *written, BYTE *live)
+{
+    const struct d3dx_pres_ins *ins = code->ins;
+    const struct op_info *oi = &pres_op_info[ins->op];
+    unsigned int i, j, offset;
+
+    if (code->folded)
+        return;
+
+    for (i = 0; i < oi->input_count; ++i)
+    {
+        if (ins->inputs[i].index_reg.table == PRES_REGTAB_TEMP
+                && !(written && written[ins->inputs[i].index_reg.offset]))
+            live[ins->inputs[i].index_reg.offset] = 1;
+        if (ins->inputs[i].reg.table != PRES_REGTAB_TEMP)
+            continue;
+        for (j = 0; j < ins->component_count; ++j)
+        {
+            if (!code->generic && !oi->func_all_comps && !(code->mask & (1u << j)))
+                continue;
+            offset = get_pres_ins_input_offset(ins, i, j);
+            if (!(written && written[offset]))
+                live[offset] = 1;
+        }
+    }
+}
+
+/* Translates the parsed instructions into the form executed on parameter updates. Instructions
+ * with constant inputs are evaluated once here, and temporary register components which are
+ * never read are not computed. */
+static HRESULT compile_preshader(struct d3dx_preshader *pres)
+{
+    struct d3dx_regstore *rs = &pres->regs;
+    struct d3dx_pres_code_ins *code;
+    unsigned int temp_count, i, j, offset;
+    BOOL temp_relative = FALSE;
+    double *known_values;
+    BYTE *known, *live;
+
+    if (!pres->ins_count)
+        return D3D_OK;
+
+    temp_count = get_offset_reg(PRES_REGTAB_TEMP, rs->table_sizes[PRES_REGTAB_TEMP]);
+    if (!(code = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*code) * pres->ins_count)))
+        return E_OUTOFMEMORY;
+    if (!(known_values = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+            temp_count * (sizeof(*known_values) + 2))))
+    {
+        HeapFree(GetProcessHeap(), 0, code);
+        return E_OUTOFMEMORY;
+    }
+    known = (BYTE *)(known_values + temp_count);
+    live = known + temp_count;
+
+    for (i = 0; i < pres->ins_count; ++i)
+    {
+        const struct d3dx_pres_ins *ins = &pres->ins[i];
+
+        init_pres_code_ins(rs, ins, &code[i]);
+        fold_pres_code_ins(rs, &code[i], known, known_values);
+
+        for (j = 0; j < pres_op_info[ins->op].input_count; ++j)
+            if (ins->inputs[j].reg.table == PRES_REGTAB_TEMP && ins->inputs[j].index_reg.table != PRES_REGTAB_COUNT)
+                temp_relative = TRUE;
+
+        if (ins->output.reg.table != PRES_REGTAB_TEMP)
+            continue;
+        for (j = 0; j < code[i].output_count; ++j)
+        {
+            known[ins->output.reg.offset + j] = code[i].folded;
+            known_values[ins->output.reg.offset + j] = (float)code[i].values[j];
+        }
+    }
+
+    if (!temp_relative)
+    {
+        /* Temporary registers read before being written keep their value from the previous run. */
+        memset(known, 0, temp_count);
+        for (i = 0; i < pres->ins_count; ++i)
+        {
+            mark_pres_code_temp_reads(&code[i], known, live);
+            if (pres->ins[i].output.reg.table == PRES_REGTAB_TEMP)
+                memset(known + pres->ins[i].output.reg.offset, 1, code[i].output_count);
+        }
+
+        for (i = pres->ins_count; i--;)
+        {
+            if (pres->ins[i].output.reg.table == PRES_REGTAB_TEMP)
+            {
+                code[i].mask = 0;
+                for (j = 0; j < code[i].output_count; ++j)
+                {
+                    offset = pres->ins[i].output.reg.offset + j;
+                    if (live[offset])
+                        code[i].mask |= 1u << j;
+                    live[offset] = 0;
+                }
+                if (!code[i].mask)
+                    continue;
+            }
+            mark_pres_code_temp_reads(&code[i], NULL, live);
+        }
+    }
+    HeapFree(GetProcessHeap(), 0, known_values);
+
+    pres->code = code;
+    pres->code_count = 0;
+    for (i = 0, j = 0; i < pres->ins_count; ++i)
+    {
+        if (!code[i].mask)
+            continue;
+        j += code[i].folded;
+        code[pres->code_count++] = code[i];
+    }
+    TRACE("%u instructions compiled to %u, %u folded.\n", pres->ins_count, pres->code_count, j);
+    return D3D_OK;
+}
+
 HRESULT d3dx_create_param_eval(struct d3dx_effect *effect, void *byte_code, unsigned int byte_code_size,
         D3DXPARAMETER_TYPE type, struct d3dx_param_eval **peval_out, ULONG64 *version_counter,
         const char **skip_constants, unsigned int skip_constants_count)
@@ -1306,6 +1562,9 @@ HRESULT d3dx_create_param_eval(struct d3dx_effect *effect, void *byte_code, unsi
             goto err_out;
     }
 
+    if (FAILED(ret = compile_preshader(&peval->pres)))
+        goto err_out;
+
     if (TRACE_ON(d3dx))
     {
         dump_bytecode(byte_code, byte_code_size);
@@ -1340,6 +1599,7 @@ static void d3dx_free_const_tab(struct d3dx_const_tab *ctab)
 static void d3dx_free_preshader(struct d3dx_preshader *pres)
 {
     HeapFree(GetProcessHeap(), 0, pres->ins);
+    HeapFree(GetProcessHeap(), 0, pres->code);
 
     regstore_free_tables(&pres->regs);
     d3dx_free_const_tab(&pres->inputs);
@@ -1646,46 +1906,155 @@ static void exec_set_arg(struct d3dx_regstore *rs, const struct d3dx_pres_reg *r
 }
 
 #define ARGS_ARRAY_SIZE 8
-static HRESULT execute_preshader(struct d3dx_preshader *pres)
+static HRESULT execute_pres_ins(struct d3dx_regstore *rs, const struct d3dx_pres_ins *ins)
 {
-    unsigned int i, j, k;
+    const struct op_info *oi = &pres_op_info[ins->op];
     double args[ARGS_ARRAY_SIZE];
+    unsigned int j, k;
     double res;
 
-    for (i = 0; i < pres->ins_count; ++i)
+    if (oi->func_all_comps)
     {
-        const struct d3dx_pres_ins *ins;
-        const struct op_info *oi;
+        if (oi->input_count * ins->component_count > ARGS_ARRAY_SIZE)
+        {
+            FIXME("Too many arguments (%u) for one instruction.\n", oi->input_count * ins->component_count);
+            return E_FAIL;
+        }
+        for (k = 0; k < oi->input_count; ++k)
+            for (j = 0; j < ins->component_count; ++j)
+                args[k * ins->component_count + j] = exec_get_arg(rs, &ins->inputs[k],
+                        ins->scalar_op && !k ? 0 : j);
+        res = oi->func(args, ins->component_count);
 
-        ins = &pres->ins[i];
-        oi = &pres_op_info[ins->op];
-        if (oi->func_all_comps)
+        /* only 'dot' instruction currently falls here */
+        exec_set_arg(rs, &ins->output.reg, 0, res);
+    }
+    else
+    {
+        for (j = 0; j < ins->component_count; ++j)
         {
-            if (oi->input_count * ins->component_count > ARGS_ARRAY_SIZE)
-            {
-                FIXME("Too many arguments (%u) for one instruction.\n", oi->input_count * ins->component_count);
-                return E_FAIL;
-            }
             for (k = 0; k < oi->input_count; ++k)
-                for (j = 0; j < ins->component_count; ++j)
-                    args[k * ins->component_count + j] = exec_get_arg(&pres->regs, &ins->inputs[k],
-                            ins->scalar_op && !k ? 0 : j);
+                args[k] = exec_get_arg(rs, &ins->inputs[k], ins->scalar_op && !k ? 0 : j);
             res = oi->func(args, ins->component_count);
+            exec_set_arg(rs, &ins->output.reg, j, res);
+        }
+    }
+    return D3D_OK;
+}
+
+static HRESULT execute_pres_code_ins(struct d3dx_regstore *rs, const struct d3dx_pres_code_ins *code)
+{
+    const struct d3dx_pres_ins *ins = code->ins;
+    const struct op_info *oi = &pres_op_info[ins->op];
+    unsigned int count = ins->component_count;
+    double args[MAX_INPUTS_COUNT][4], res[4];
+    unsigned int i, j;
+
+    if (code->generic)
+        return execute_pres_ins(rs, ins);
+
+    if (code->folded)
+    {
+        memcpy(res, code->values, sizeof(res));
+    }
+    else
+    {
+        for (i = 0; i < oi->input_count; ++i)
+        {
+            const struct d3dx_pres_code_arg *arg = &code->inputs[i];
 
-            /* only 'dot' instruction currently falls here */
-            exec_set_arg(&pres->regs, &ins->output.reg, 0, res);
+            if (arg->f)
+                for (j = 0; j < count; ++j)
+                    args[i][j] = arg->f[j * arg->stride];
+            else
+                for (j = 0; j < count; ++j)
+                    args[i][j] = arg->d[j * arg->stride];
         }
-        else
+
+        switch (ins->op)
         {
-            for (j = 0; j < ins->component_count; ++j)
-            {
-                for (k = 0; k < oi->input_count; ++k)
-                    args[k] = exec_get_arg(&pres->regs, &ins->inputs[k], ins->scalar_op && !k ? 0 : j);
-                res = oi->func(args, ins->component_count);
-                exec_set_arg(&pres->regs, &ins->output.reg, j, res);
-            }
+            case PRESHADER_OP_MOV:
+                for (j = 0; j < count; ++j)
+                    res[j] = args[0][j];
+                break;
+            case PRESHADER_OP_NEG:
+                for (j = 0; j < count; ++j)
+                    res[j] = -args[0][j];
+                break;
+            case PRESHADER_OP_ADD:
+                for (j = 0; j < count; ++j)
+                    res[j] = args[0][j] + args[1][j];
+                break;
+            case PRESHADER_OP_MUL:
+                for (j = 0; j < count; ++j)
+                    res[j] = args[0][j] * args[1][j];
+                break;
+            case PRESHADER_OP_MIN:
+                for (j = 0; j < count; ++j)
+                    res[j] = fmin(args[0][j], args[1][j]);
+                break;
+            case PRESHADER_OP_MAX:
+                for (j = 0; j < count; ++j)
+                    res[j] = fmax(args[0][j], args[1][j]);
+                break;
+            case PRESHADER_OP_LT:
+                for (j = 0; j < count; ++j)
+                    res[j] = args[0][j] < args[1][j] ? 1.0 : 0.0;
+                break;
+            case PRESHADER_OP_GE:
+                for (j = 0; j < count; ++j)
+                    res[j] = args[0][j] >= args[1][j] ? 1.0 : 0.0;
+                break;
+            case PRESHADER_OP_CMP:
+                for (j = 0; j < count; ++j)
+                    res[j] = args[0][j] >= 0.0 ? args[1][j] : args[2][j];
+                break;
+            case PRESHADER_OP_DOT:
+                res[0] = 0.0;
+                for (j = 0; j < count; ++j)
+                    res[0] += args[0][j] * args[1][j];
+                break;
+            default:
+                for (j = 0; j < count; ++j)
+                {
+                    double comp_args[MAX_INPUTS_COUNT];
+
+                    for (i = 0; i < oi->input_count; ++i)
+                        comp_args[i] = args[i][j];
+                    res[j] = oi->func(comp_args, count);
+                }
+                break;
         }
     }
+
+    for (j = 0; j < code->output_count; ++j)
+    {
+        if (!(code->mask & (1u << j)))
+            continue;
+        if (code->output)
+            code->output[j] = res[j];
+        else
+            exec_set_arg(rs, &ins->output.reg, j, res[j]);
+    }
+    return D3D_OK;
+}
+
+static HRESULT execute_preshader(struct d3dx_preshader *pres)
+{
+    unsigned int i;
+    HRESULT hr;
+
+    if (pres->code)
+    {
+        for (i = 0; i < pres->code_count; ++i)
+            if (FAILED(hr = execute_pres_code_ins(&pres->regs, &pres->code[i])))
+                return hr;
+        return D3D_OK;
+    }
+
+    for (i = 0; i < pres->ins_count; ++i)
+        if (FAILED(hr = execute_pres_ins(&pres->regs, &pres->ins[i])))
+            return hr;
     return D3D_OK;
 }
 
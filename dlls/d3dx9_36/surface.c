@@ -1875,6 +1875,392 @@ void point_filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slic
     }
 }
 
+struct filter_taps
+{
+    unsigned int *offsets; /* first tap of each destination pixel, plus one past the last */
+    unsigned int *indices;
+    float *weights;
+};
+
+static void free_filter_taps(struct filter_taps *taps)
+{
+    heap_free(taps->offsets);
+    heap_free(taps->indices);
+    heap_free(taps->weights);
+}
+
+/* Computes the source pixels, and their weight, contributing to each
+ * destination pixel along one axis. */
+static HRESULT init_filter_taps(struct filter_taps *taps, unsigned int src_len, unsigned int dst_len,
+        DWORD filter, BOOL mirror)
+{
+    float scale = (float)src_len / dst_len, width = max(scale, 1.0f);
+    unsigned int i, count = 0, max_taps = (unsigned int)ceilf(2.0f * width) + 3;
+
+    taps->offsets = heap_alloc((dst_len + 1) * sizeof(*taps->offsets));
+    taps->indices = heap_alloc(dst_len * max_taps * sizeof(*taps->indices));
+    taps->weights = heap_alloc(dst_len * max_taps * sizeof(*taps->weights));
+    if (!taps->offsets || !taps->indices || !taps->weights)
+    {
+        free_filter_taps(taps);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < dst_len; i++)
+    {
+        float center = (i + 0.5f) * scale, total = 0.0f;
+        unsigned int first = count, j;
+        int start, end, k;
+
+        switch (filter & 0xf)
+        {
+            case D3DX_FILTER_LINEAR:
+                start = floorf(center - 0.5f);
+                end = start + 1;
+                break;
+            case D3DX_FILTER_BOX:
+                start = floorf(center - scale * 0.5f);
+                end = ceilf(center + scale * 0.5f) - 1;
+                break;
+            default:
+                start = floorf(center - width - 0.5f);
+                end = ceilf(center + width - 0.5f);
+                break;
+        }
+
+        for (k = start; k <= end && count - first < max_taps; k++)
+        {
+            float weight, distance = k + 0.5f - center;
+            int index = k;
+
+            switch (filter & 0xf)
+            {
+                case D3DX_FILTER_LINEAR:
+                    weight = 1.0f - fabsf(distance);
+                    break;
+                case D3DX_FILTER_BOX:
+                    weight = min(center + scale * 0.5f, k + 1.0f) - max(center - scale * 0.5f, (float)k);
+                    break;
+                default:
+                    weight = 1.0f - fabsf(distance) / width;
+                    break;
+            }
+            if (weight <= 0.0f)
+                continue;
+
+            if (index < 0 || index >= src_len)
+            {
+                if (mirror)
+                    index = index < 0 ? -index - 1 : 2 * (int)src_len - index - 1;
+                else
+                    index = (index % (int)src_len + src_len) % src_len;
+                index = min(max(index, 0), (int)src_len - 1);
+            }
+            taps->indices[count] = index;
+            taps->weights[count++] = weight;
+            total += weight;
+        }
+        for (j = first; j < count; j++)
+            taps->weights[j] /= total;
+        taps->offsets[i] = first;
+    }
+    taps->offsets[dst_len] = count;
+
+    return D3D_OK;
+}
+
+static inline float srgb_to_linear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static inline float linear_to_srgb(float c)
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+struct filter_context
+{
+    const BYTE *src;
+    UINT src_row_pitch;
+    UINT src_slice_pitch;
+    const struct volume *src_size;
+    const struct pixel_format_desc *src_format;
+    BYTE *dst;
+    UINT dst_row_pitch;
+    UINT dst_slice_pitch;
+    const struct volume *dst_size;
+    const struct pixel_format_desc *dst_format;
+    const struct pixel_format_desc *ck_format;
+    D3DCOLOR color_key;
+    const PALETTEENTRY *palette;
+    DWORD filter;
+    struct filter_taps taps[3];
+    unsigned int cache_size;
+    LONG next_band;
+    unsigned int band_count;
+    LONG pending;
+    HANDLE done_event;
+    LONG failed;
+};
+
+/* Converts a source row to linear RGBA and filters it horizontally. */
+static void filter_source_row(const struct filter_context *ctx, unsigned int z, unsigned int y,
+        struct vec4 *row, struct vec4 *out)
+{
+    const BYTE *src_ptr = ctx->src + z * ctx->src_slice_pitch + y * ctx->src_row_pitch;
+    const struct filter_taps *taps = &ctx->taps[0];
+    unsigned int x, i;
+
+    for (x = 0; x < ctx->src_size->width; x++, src_ptr += ctx->src_format->bytes_per_pixel)
+    {
+        struct vec4 color;
+
+        format_to_vec4(ctx->src_format, src_ptr, &color);
+        if (ctx->src_format->to_rgba)
+            ctx->src_format->to_rgba(&color, &row[x], ctx->palette);
+        else
+            row[x] = color;
+
+        if (ctx->ck_format)
+        {
+            DWORD ck_pixel;
+
+            format_from_vec4(ctx->ck_format, &row[x], (BYTE *)&ck_pixel);
+            if (ck_pixel == ctx->color_key)
+                row[x].w = 0.0f;
+        }
+        if (ctx->filter & D3DX_FILTER_SRGB_IN)
+        {
+            row[x].x = srgb_to_linear(row[x].x);
+            row[x].y = srgb_to_linear(row[x].y);
+            row[x].z = srgb_to_linear(row[x].z);
+        }
+    }
+
+    for (x = 0; x < ctx->dst_size->width; x++)
+    {
+        struct vec4 sum = {0.0f, 0.0f, 0.0f, 0.0f};
+
+        for (i = taps->offsets[x]; i < taps->offsets[x + 1]; i++)
+        {
+            const struct vec4 *color = &row[taps->indices[i]];
+            float weight = taps->weights[i];
+
+            sum.x += color->x * weight;
+            sum.y += color->y * weight;
+            sum.z += color->z * weight;
+            sum.w += color->w * weight;
+        }
+        out[x] = sum;
+    }
+}
+
+static void filter_destination_rows(struct filter_context *ctx, unsigned int first_row, unsigned int end_row)
+{
+    const struct filter_taps *taps_y = &ctx->taps[1], *taps_z = &ctx->taps[2];
+    unsigned int dst_width = ctx->dst_size->width;
+    unsigned int *cache_tags, cache_next = 0;
+    struct vec4 *row, *acc, *cache;
+    unsigned int row_idx, x, i, j, k;
+
+    row = heap_alloc((ctx->src_size->width + dst_width * (ctx->cache_size + 1)) * sizeof(*row));
+    cache_tags = heap_alloc(ctx->cache_size * sizeof(*cache_tags));
+    if (!row || !cache_tags)
+    {
+        heap_free(cache_tags);
+        heap_free(row);
+        InterlockedExchange(&ctx->failed, 1);
+        return;
+    }
+    acc = row + ctx->src_size->width;
+    cache = acc + dst_width;
+    memset(cache_tags, 0xff, ctx->cache_size * sizeof(*cache_tags));
+
+    for (row_idx = first_row; row_idx < end_row; row_idx++)
+    {
+        unsigned int z = row_idx / ctx->dst_size->height, y = row_idx % ctx->dst_size->height;
+        BYTE *dst_ptr = ctx->dst + z * ctx->dst_slice_pitch + y * ctx->dst_row_pitch;
+
+        memset(acc, 0, dst_width * sizeof(*acc));
+        for (i = taps_z->offsets[z]; i < taps_z->offsets[z + 1]; i++)
+        {
+            for (j = taps_y->offsets[y]; j < taps_y->offsets[y + 1]; j++)
+            {
+                unsigned int tag = taps_z->indices[i] * ctx->src_size->height + taps_y->indices[j];
+                float weight = taps_z->weights[i] * taps_y->weights[j];
+                const struct vec4 *src_row;
+
+                /* Horizontally filtered source rows are shared by neighbouring
+                 * destination rows, keep the most recent ones around. */
+                for (k = 0; k < ctx->cache_size; k++)
+                    if (cache_tags[k] == tag) break;
+                if (k == ctx->cache_size)
+                {
+                    k = cache_next;
+                    cache_next = (cache_next + 1) % ctx->cache_size;
+                    cache_tags[k] = tag;
+                    filter_source_row(ctx, taps_z->indices[i], taps_y->indices[j], row, cache + k * dst_width);
+                }
+                src_row = cache + k * dst_width;
+
+                for (x = 0; x < dst_width; x++)
+                {
+                    acc[x].x += src_row[x].x * weight;
+                    acc[x].y += src_row[x].y * weight;
+                    acc[x].z += src_row[x].z * weight;
+                    acc[x].w += src_row[x].w * weight;
+                }
+            }
+        }
+
+        for (x = 0; x < dst_width; x++, dst_ptr += ctx->dst_format->bytes_per_pixel)
+        {
+            struct vec4 color = acc[x], tmp;
+
+            if (ctx->dst_format->type == FORMAT_ARGB)
+            {
+                color.x = min(max(color.x, 0.0f), 1.0f);
+                color.y = min(max(color.y, 0.0f), 1.0f);
+                color.z = min(max(color.z, 0.0f), 1.0f);
+                color.w = min(max(color.w, 0.0f), 1.0f);
+            }
+            if (ctx->filter & D3DX_FILTER_SRGB_OUT)
+            {
+                color.x = linear_to_srgb(color.x);
+                color.y = linear_to_srgb(color.y);
+                color.z = linear_to_srgb(color.z);
+            }
+            if (ctx->dst_format->from_rgba)
+            {
+                ctx->dst_format->from_rgba(&color, &tmp);
+                color = tmp;
+            }
+            format_from_vec4(ctx->dst_format, &color, dst_ptr);
+        }
+    }
+
+    heap_free(cache_tags);
+    heap_free(row);
+}
+
+static void filter_bands(struct filter_context *ctx)
+{
+    unsigned int row_count = ctx->dst_size->depth * ctx->dst_size->height;
+    LONG band;
+
+    while ((band = InterlockedIncrement(&ctx->next_band) - 1) < ctx->band_count)
+        filter_destination_rows(ctx, row_count * band / ctx->band_count,
+                row_count * (band + 1) / ctx->band_count);
+}
+
+static void CALLBACK filter_bands_callback(TP_CALLBACK_INSTANCE *instance, void *context)
+{
+    struct filter_context *ctx = context;
+
+    filter_bands(ctx);
+    if (!InterlockedDecrement(&ctx->pending))
+        SetEvent(ctx->done_event);
+}
+
+/************************************************************
+ * filter_argb_pixels
+ *
+ * Copies the source buffer to the destination buffer, performing
+ * any necessary format conversion, color keying and stretching
+ * using a separable linear, triangle or box filter.
+ * Large images are filtered in bands on the thread pool.
+ */
+HRESULT filter_argb_pixels(const BYTE *src, UINT src_row_pitch, UINT src_slice_pitch, const struct volume *src_size,
+        const struct pixel_format_desc *src_format, BYTE *dst, UINT dst_row_pitch, UINT dst_slice_pitch,
+        const struct volume *dst_size, const struct pixel_format_desc *dst_format, D3DCOLOR color_key,
+        const PALETTEENTRY *palette, DWORD filter)
+{
+    struct filter_context ctx;
+    unsigned int i, row_count, worker_count = 0;
+    SYSTEM_INFO system_info;
+    HRESULT hr;
+
+    TRACE("src %p, src_row_pitch %u, src_slice_pitch %u, src_size %p, src_format %p, dst %p, "
+            "dst_row_pitch %u, dst_slice_pitch %u, dst_size %p, dst_format %p, color_key 0x%08x, palette %p, "
+            "filter %#x.\n",
+            src, src_row_pitch, src_slice_pitch, src_size, src_format, dst, dst_row_pitch, dst_slice_pitch, dst_size,
+            dst_format, color_key, palette, filter);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.src = src;
+    ctx.src_row_pitch = src_row_pitch;
+    ctx.src_slice_pitch = src_slice_pitch;
+    ctx.src_size = src_size;
+    ctx.src_format = src_format;
+    ctx.dst = dst;
+    ctx.dst_row_pitch = dst_row_pitch;
+    ctx.dst_slice_pitch = dst_slice_pitch;
+    ctx.dst_size = dst_size;
+    ctx.dst_format = dst_format;
+    ctx.color_key = color_key;
+    ctx.palette = palette;
+    ctx.filter = filter;
+    /* Color keys are always represented in D3DFMT_A8R8G8B8 format. */
+    if (color_key)
+        ctx.ck_format = get_format_info(D3DFMT_A8R8G8B8);
+
+    if (FAILED(hr = init_filter_taps(&ctx.taps[0], src_size->width, dst_size->width,
+            filter, filter & D3DX_FILTER_MIRROR_U)))
+        return hr;
+    if (FAILED(hr = init_filter_taps(&ctx.taps[1], src_size->height, dst_size->height,
+            filter, filter & D3DX_FILTER_MIRROR_V)))
+        goto done;
+    if (FAILED(hr = init_filter_taps(&ctx.taps[2], src_size->depth, dst_size->depth,
+            filter, filter & D3DX_FILTER_MIRROR_W)))
+        goto done;
+
+    ctx.cache_size = 1;
+    for (i = 1; i < 3; i++)
+    {
+        unsigned int j, max_taps = 1;
+
+        for (j = 0; j < (i == 1 ? dst_size->height : dst_size->depth); j++)
+            max_taps = max(max_taps, ctx.taps[i].offsets[j + 1] - ctx.taps[i].offsets[j]);
+        ctx.cache_size *= max_taps;
+    }
+    ctx.cache_size = min(ctx.cache_size, 64);
+
+    row_count = dst_size->depth * dst_size->height;
+    GetSystemInfo(&system_info);
+    if (dst_size->width * row_count >= 256 * 256)
+        worker_count = max(min(min(system_info.dwNumberOfProcessors, 16), row_count / 16), 1) - 1;
+
+    if (worker_count && (ctx.done_event = CreateEventW(NULL, TRUE, FALSE, NULL)))
+    {
+        ctx.band_count = (worker_count + 1) * 4;
+        /* the calling thread holds a reference too, so that the event is
+         * only signaled once, before it gets closed */
+        ctx.pending = worker_count + 1;
+        for (i = 0; i < worker_count; i++)
+        {
+            if (!TrySubmitThreadpoolCallback(filter_bands_callback, &ctx, NULL))
+                InterlockedDecrement(&ctx.pending);
+        }
+        /* the calling thread takes its share of the bands too */
+        filter_bands(&ctx);
+        if (InterlockedDecrement(&ctx.pending))
+            WaitForSingleObject(ctx.done_event, INFINITE);
+        CloseHandle(ctx.done_event);
+    }
+    else
+    {
+        ctx.band_count = 1;
+        filter_bands(&ctx);
+    }
+    hr = ctx.failed ? E_OUTOFMEMORY : D3D_OK;
+
+done:
+    for (i = 0; i < 3; i++)
+        free_filter_taps(&ctx.taps[i]);
+    return hr;
+}
+
 /************************************************************
  * D3DXLoadSurfaceFromMemory
  *
@@ -2111,16 +2497,26 @@ HRESULT WINAPI D3DXLoadSurfaceFromMemory(IDirect3DSurface9 *dst_surface,
             convert_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
                     dst_mem, dst_pitch, 0, &dst_size, dst_format, color_key, src_palette);
         }
-        else /* if ((filter & 0xf) == D3DX_FILTER_POINT) */
+        else if ((filter & 0xf) == D3DX_FILTER_POINT
+                || (src_size.width == dst_size.width && src_size.height == dst_size.height))
         {
-            if ((filter & 0xf) != D3DX_FILTER_POINT)
-                FIXME("Unhandled filter %#x.\n", filter);
-
-            /* Always apply a point filter until D3DX_FILTER_LINEAR,
-             * D3DX_FILTER_TRIANGLE and D3DX_FILTER_BOX are implemented. */
             point_filter_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
                     dst_mem, dst_pitch, 0, &dst_size, dst_format, color_key, src_palette);
         }
+        else
+        {
+            if ((filter & 0xf) > D3DX_FILTER_BOX)
+                FIXME("Unhandled filter %#x.\n", filter);
+
+            if (FAILED(hr = filter_argb_pixels(src_memory, src_pitch, 0, &src_size, srcformatdesc,
+                    dst_mem, dst_pitch, 0, &dst_size, dst_format, color_key, src_palette, filter)))
+            {
+                heap_free(src_uncompressed);
+                heap_free(dst_uncompressed);
+                unlock_surface(dst_surface, &dst_rect_aligned, surface, FALSE);
+                return hr;
+            }
+        }
 
         heap_free(src_uncompressed);
 
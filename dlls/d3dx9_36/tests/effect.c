@@ -5811,6 +5811,60 @@ static void test_effect_commitchanges(IDirect3DDevice9 *device)
     effect->lpVtbl->Release(effect);
 }
 
+static void test_effect_preshader_commit_performance(IDirect3DDevice9 *device)
+{
+    static const char *param_names[] = {"opvect1", "opvect2", "g_Pos1", "m4x3column"};
+    unsigned int count = winetest_interactive ? 100000 : 2000;
+    LARGE_INTEGER freq, start, end;
+    D3DXHANDLE params[ARRAY_SIZE(param_names)];
+    unsigned int i, passes_count;
+    ID3DXEffect *effect;
+    float values[16];
+    HRESULT hr;
+
+    hr = D3DXCreateEffect(device, test_effect_preshader_effect_blob, sizeof(test_effect_preshader_effect_blob),
+            NULL, NULL, 0, NULL, &effect, NULL);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(param_names); ++i)
+    {
+        params[i] = effect->lpVtbl->GetParameterByName(effect, NULL, param_names[i]);
+        ok(!!params[i], "Failed to get parameter %s.\n", param_names[i]);
+    }
+
+    hr = effect->lpVtbl->Begin(effect, &passes_count, 0);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    hr = effect->lpVtbl->BeginPass(effect, 0);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; ++i)
+    {
+        unsigned int j;
+
+        for (j = 0; j < ARRAY_SIZE(values); ++j)
+            values[j] = (float)((i + j) % 17) * 0.25f;
+        hr = effect->lpVtbl->SetValue(effect, params[i % ARRAY_SIZE(params)], values,
+                i % ARRAY_SIZE(params) == 3 ? sizeof(float) * 12 : sizeof(float) * 4);
+        if (hr != D3D_OK)
+            break;
+        if ((hr = effect->lpVtbl->CommitChanges(effect)) != D3D_OK)
+            break;
+    }
+    QueryPerformanceCounter(&end);
+    ok(hr == D3D_OK, "Got result %#x, iteration %u.\n", hr, i);
+    trace("%u preshader parameter commits in %.2f ms\n", count,
+            (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart);
+
+    hr = effect->lpVtbl->EndPass(effect);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    hr = effect->lpVtbl->End(effect);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
+    effect->lpVtbl->Release(effect);
+}
+
 static void test_effect_preshader_relative_addressing(IDirect3DDevice9 *device)
 {
     static const struct
@@ -8724,6 +8778,7 @@ START_TEST(effect)
     test_effect_isparameterused(device);
     test_effect_out_of_bounds_selector(device);
     test_effect_commitchanges(device);
+    test_effect_preshader_commit_performance(device);
     test_effect_preshader_relative_addressing(device);
     test_effect_state_manager(device);
     test_cross_effect_handle(device);
@@ -10542,6 +10542,174 @@ static void test_optimize_faces(void)
     ok(hr == D3DERR_INVALIDCALL, "Got unexpected hr %#x.\n", hr);
 }
 
+/* Average number of vertex cache misses per face, with a 16 entries FIFO cache. */
+static float compute_acmr(const DWORD *indices, DWORD num_faces)
+{
+    DWORD cache[16], cache_size = 0, cache_pos = 0, misses = 0;
+    DWORD i, j;
+
+    for (i = 0; i < num_faces * 3; i++)
+    {
+        for (j = 0; j < cache_size; j++)
+            if (cache[j] == indices[i]) break;
+        if (j < cache_size) continue;
+
+        misses++;
+        if (cache_size < ARRAY_SIZE(cache))
+            cache[cache_size++] = indices[i];
+        else
+        {
+            cache[cache_pos] = indices[i];
+            cache_pos = (cache_pos + 1) % ARRAY_SIZE(cache);
+        }
+    }
+    return (float)misses / num_faces;
+}
+
+static void test_optimize_vertex_cache(void)
+{
+    static const D3DVERTEXELEMENT9 declaration[] =
+    {
+        {0, 0, D3DDECLTYPE_FLOAT3, D3DDECLMETHOD_DEFAULT, D3DDECLUSAGE_POSITION, 0},
+        D3DDECL_END()
+    };
+    static const DWORD flags[] = {D3DXMESHOPT_VERTEXCACHE, D3DXMESHOPT_STRIPREORDER};
+    const DWORD grid = winetest_interactive ? 128 : 32;
+    const DWORD num_vertices = (grid + 1) * (grid + 1), num_faces = grid * grid * 2;
+    struct test_context *test_context;
+    DWORD *indices, *attributes, *adjacency, *adjacency_out, *face_remap, *new_indices, *new_attributes;
+    D3DXVECTOR3 *vertices, *new_vertices;
+    ID3DXBuffer *vertex_remap;
+    LARGE_INTEGER freq, start, end;
+    float acmr_before, acmr_after;
+    unsigned int seed = 0;
+    ID3DXMesh *mesh;
+    DWORD i, j, x, y;
+    HRESULT hr;
+
+    if (!(test_context = new_test_context()))
+    {
+        skip("Couldn't create test context\n");
+        return;
+    }
+
+    vertices = HeapAlloc(GetProcessHeap(), 0, num_vertices * sizeof(*vertices));
+    indices = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*indices));
+    attributes = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*attributes));
+    adjacency = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*adjacency));
+    adjacency_out = HeapAlloc(GetProcessHeap(), 0, num_faces * 3 * sizeof(*adjacency_out));
+    face_remap = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*face_remap));
+
+    for (y = 0; y <= grid; y++)
+    {
+        for (x = 0; x <= grid; x++)
+        {
+            vertices[y * (grid + 1) + x].x = x;
+            vertices[y * (grid + 1) + x].y = y;
+            vertices[y * (grid + 1) + x].z = 0.0f;
+        }
+    }
+    /* generate the faces of a grid, in a random order */
+    for (i = 0; i < num_faces; i++)
+        face_remap[i] = i;
+    for (i = num_faces - 1; i > 0; i--)
+    {
+        DWORD tmp;
+
+        seed = seed * 1103515245 + 12345;
+        j = (seed >> 16) % (i + 1);
+        tmp = face_remap[i];
+        face_remap[i] = face_remap[j];
+        face_remap[j] = tmp;
+    }
+    for (i = 0; i < num_faces; i++)
+    {
+        DWORD quad = face_remap[i] / 2, v = quad / grid * (grid + 1) + quad % grid;
+
+        if (face_remap[i] & 1)
+        {
+            indices[i * 3] = v + 1;
+            indices[i * 3 + 1] = v + grid + 1;
+            indices[i * 3 + 2] = v + grid + 2;
+        }
+        else
+        {
+            indices[i * 3] = v;
+            indices[i * 3 + 1] = v + grid + 1;
+            indices[i * 3 + 2] = v + 1;
+        }
+        attributes[i] = quad % grid < grid / 2;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(flags); i++)
+    {
+        hr = init_test_mesh(num_faces, num_vertices, D3DXMESH_32BIT, declaration, test_context->device,
+                &mesh, vertices, sizeof(*vertices), indices, attributes);
+        if (FAILED(hr))
+        {
+            skip("Couldn't initialize test mesh, hr %#x.\n", hr);
+            break;
+        }
+        hr = mesh->lpVtbl->GenerateAdjacency(mesh, 0.0f, adjacency);
+        ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+        acmr_before = compute_acmr(indices, num_faces);
+
+        QueryPerformanceFrequency(&freq);
+        QueryPerformanceCounter(&start);
+        hr = mesh->lpVtbl->OptimizeInplace(mesh, flags[i], adjacency, adjacency_out, face_remap, &vertex_remap);
+        QueryPerformanceCounter(&end);
+        ok(hr == D3D_OK, "Flags %#x: got unexpected hr %#x.\n", flags[i], hr);
+        if (FAILED(hr))
+        {
+            mesh->lpVtbl->Release(mesh);
+            continue;
+        }
+
+        mesh->lpVtbl->LockIndexBuffer(mesh, D3DLOCK_READONLY, (void **)&new_indices);
+        mesh->lpVtbl->LockVertexBuffer(mesh, D3DLOCK_READONLY, (void **)&new_vertices);
+        mesh->lpVtbl->LockAttributeBuffer(mesh, D3DLOCK_READONLY, &new_attributes);
+
+        /* the remaps must describe the optimized mesh */
+        for (j = 0; j < num_faces * 3; j++)
+        {
+            DWORD old_face = face_remap[j / 3], new_vertex = new_indices[j];
+            DWORD *old_vertex = (DWORD *)ID3DXBuffer_GetBufferPointer(vertex_remap) + new_vertex;
+
+            if (old_face >= num_faces || new_vertex >= mesh->lpVtbl->GetNumVertices(mesh)
+                    || *old_vertex != indices[old_face * 3 + j % 3]
+                    || memcmp(&new_vertices[new_vertex], &vertices[*old_vertex], sizeof(*vertices)))
+            {
+                ok(0, "Flags %#x: got inconsistent index %u.\n", flags[i], j);
+                break;
+            }
+        }
+        for (j = 1; j < num_faces; j++)
+            if (new_attributes[j] < new_attributes[j - 1]) break;
+        ok(j == num_faces, "Flags %#x: faces not sorted by attribute.\n", flags[i]);
+
+        acmr_after = compute_acmr(new_indices, num_faces);
+        ok(acmr_after < acmr_before, "Flags %#x: got ACMR %.3f, was %.3f.\n", flags[i], acmr_after, acmr_before);
+        trace("Flags %#x: ACMR %.3f -> %.3f for %u faces, %.0f faces per second.\n", flags[i],
+                acmr_before, acmr_after, num_faces,
+                (double)num_faces * freq.QuadPart / max(end.QuadPart - start.QuadPart, 1));
+
+        mesh->lpVtbl->UnlockAttributeBuffer(mesh);
+        mesh->lpVtbl->UnlockVertexBuffer(mesh);
+        mesh->lpVtbl->UnlockIndexBuffer(mesh);
+        ID3DXBuffer_Release(vertex_remap);
+        mesh->lpVtbl->Release(mesh);
+    }
+
+    HeapFree(GetProcessHeap(), 0, face_remap);
+    HeapFree(GetProcessHeap(), 0, adjacency_out);
+    HeapFree(GetProcessHeap(), 0, adjacency);
+    HeapFree(GetProcessHeap(), 0, attributes);
+    HeapFree(GetProcessHeap(), 0, indices);
+    HeapFree(GetProcessHeap(), 0, vertices);
+    free_test_context(test_context);
+}
+
 static HRESULT clear_normals(ID3DXMesh *mesh)
 {
     HRESULT hr;
@@ -11480,6 +11648,7 @@ START_TEST(mesh)
     test_clone_mesh();
     test_valid_mesh();
     test_optimize_faces();
+    test_optimize_vertex_cache();
     test_compute_normals();
     test_D3DXFrameFind();
     test_load_skin_mesh_from_xof();
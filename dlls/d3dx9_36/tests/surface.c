@@ -1524,6 +1524,92 @@ static void test_D3DXLoadSurface(IDirect3DDevice9 *device)
     if(testbitmap_ok) DeleteFileA("testbitmap.bmp");
 }
 
+static void test_D3DXLoadSurface_filters(IDirect3DDevice9 *device)
+{
+    static const DWORD blocks[] =
+    {
+        0xff000000, 0xff000000, 0xffffffff, 0xffffffff,
+        0xff000000, 0xff000000, 0xffffffff, 0xffffffff,
+        0x80ff0000, 0x80ff0000, 0xff0000ff, 0xff0000ff,
+        0x80ff0000, 0x80ff0000, 0xff0000ff, 0xff0000ff,
+    };
+    static const DWORD uniform[] = { 0xff336699, 0xff336699, 0xff336699, 0xff336699 };
+    unsigned int size = winetest_interactive ? 4096 : 1024;
+    LARGE_INTEGER freq, start, end;
+    IDirect3DSurface9 *surf;
+    IDirect3DTexture9 *tex;
+    D3DLOCKED_RECT lockrect;
+    RECT rect;
+    unsigned int x, y;
+    BOOL all_ok;
+    DWORD *data;
+    HRESULT hr;
+
+    hr = IDirect3DDevice9_CreateOffscreenPlainSurface(device, 2, 2, D3DFMT_A8R8G8B8, D3DPOOL_SCRATCH, &surf, NULL);
+    ok(hr == D3D_OK, "Failed to create surface, hr %#x.\n", hr);
+
+    SetRect(&rect, 0, 0, 4, 4);
+    hr = D3DXLoadSurfaceFromMemory(surf, NULL, NULL, blocks, D3DFMT_A8R8G8B8, 16, NULL, &rect, D3DX_FILTER_BOX, 0);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+    check_pixel_4bpp(&lockrect, 0, 0, 0xff000000);
+    check_pixel_4bpp(&lockrect, 1, 0, 0xffffffff);
+    check_pixel_4bpp(&lockrect, 0, 1, 0x80ff0000);
+    check_pixel_4bpp(&lockrect, 1, 1, 0xff0000ff);
+    IDirect3DSurface9_UnlockRect(surf);
+
+    check_release((IUnknown *)surf, 0);
+
+    hr = IDirect3DDevice9_CreateOffscreenPlainSurface(device, 5, 5, D3DFMT_A8R8G8B8, D3DPOOL_SCRATCH, &surf, NULL);
+    ok(hr == D3D_OK, "Failed to create surface, hr %#x.\n", hr);
+    SetRect(&rect, 0, 0, 2, 2);
+    for (x = D3DX_FILTER_LINEAR; x <= D3DX_FILTER_BOX; ++x)
+    {
+        hr = D3DXLoadSurfaceFromMemory(surf, NULL, NULL, uniform, D3DFMT_A8R8G8B8, 8, NULL, &rect, x, 0);
+        ok(hr == D3D_OK, "Filter %u: got unexpected hr %#x.\n", x, hr);
+        IDirect3DSurface9_LockRect(surf, &lockrect, NULL, D3DLOCK_READONLY);
+        all_ok = TRUE;
+        for (y = 0; y < 25; ++y)
+            all_ok &= ((DWORD *)lockrect.pBits)[y % 5 + y / 5 * lockrect.Pitch / 4] == 0xff336699;
+        ok(all_ok, "Filter %u: got non uniform output.\n", x);
+        IDirect3DSurface9_UnlockRect(surf);
+    }
+    check_release((IUnknown *)surf, 0);
+
+    hr = IDirect3DDevice9_CreateTexture(device, size, size, 0, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &tex, NULL);
+    if (FAILED(hr))
+    {
+        skip("Failed to create %ux%u texture, hr %#x.\n", size, size, hr);
+        return;
+    }
+    hr = IDirect3DTexture9_LockRect(tex, 0, &lockrect, NULL, 0);
+    ok(hr == D3D_OK, "Failed to lock texture, hr %#x.\n", hr);
+    for (y = 0; y < size; ++y)
+    {
+        data = (DWORD *)((BYTE *)lockrect.pBits + y * lockrect.Pitch);
+        for (x = 0; x < size; ++x)
+            data[x] = (x & 1) ^ (y & 1) ? 0xffffffff : 0xff000000;
+    }
+    IDirect3DTexture9_UnlockRect(tex, 0);
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    hr = D3DXFilterTexture((IDirect3DBaseTexture9 *)tex, NULL, 0, D3DX_FILTER_BOX);
+    QueryPerformanceCounter(&end);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    trace("box filtered %ux%u mip chain in %.2f ms\n", size, size,
+            (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart);
+
+    /* a checkerboard averages to uniform grey in every box filtered level */
+    hr = IDirect3DTexture9_LockRect(tex, 1, &lockrect, NULL, D3DLOCK_READONLY);
+    ok(hr == D3D_OK, "Failed to lock texture, hr %#x.\n", hr);
+    check_pixel_4bpp(&lockrect, 0, 0, 0xff808080);
+    check_pixel_4bpp(&lockrect, size / 2 - 1, size / 2 - 1, 0xff808080);
+    IDirect3DTexture9_UnlockRect(tex, 1);
+
+    check_release((IUnknown *)tex, 0);
+}
+
 static void test_D3DXSaveSurfaceToFileInMemory(IDirect3DDevice9 *device)
 {
     static const struct
@@ -1787,6 +1873,7 @@ START_TEST(surface)
 
     test_D3DXGetImageInfo();
     test_D3DXLoadSurface(device);
+    test_D3DXLoadSurface_filters(device);
     test_D3DXSaveSurfaceToFileInMemory(device);
     test_D3DXSaveSurfaceToFile(device);
 
@@ -1214,9 +1214,9 @@ HRESULT WINAPI D3DXCreateVolumeTextureFromFileInMemoryEx(IDirect3DDevice9 *devic
     if (FAILED(hr))
         return D3DERR_INVALIDCALL;
 
-    if (mip_levels > image_info.MipLevels)
+    if (mip_levels > image_info.MipLevels && get_format_info(format)->type == FORMAT_DXT)
     {
-        FIXME("Generation of mipmaps for volume textures is not implemented yet.\n");
+        FIXME("Generation of mipmaps for compressed volume textures is not implemented yet.\n");
         mip_levels = image_info.MipLevels;
     }
 
@@ -1234,6 +1234,8 @@ HRESULT WINAPI D3DXCreateVolumeTextureFromFileInMemoryEx(IDirect3DDevice9 *devic
     if (FAILED(hr)) return hr;
 
     hr = load_volume_texture_from_dds(tex, data, palette, filter, color_key, &image_info);
+    if (SUCCEEDED(hr) && IDirect3DVolumeTexture9_GetLevelCount(tex) > image_info.MipLevels)
+        hr = D3DXFilterTexture((IDirect3DBaseTexture9 *)tex, palette, image_info.MipLevels - 1, mip_filter);
     if (FAILED(hr))
     {
         IDirect3DVolumeTexture9_Release(tex);
@@ -207,14 +207,26 @@ HRESULT WINAPI D3DXLoadVolumeFromMemory(IDirect3DVolume9 *dst_volume,
                     locked_box.pBits, locked_box.RowPitch, locked_box.SlicePitch, &dst_size, dst_format_desc, color_key,
                     src_palette);
         }
+        else if ((filter & 0xf) == D3DX_FILTER_POINT || (src_size.width == dst_size.width
+                && src_size.height == dst_size.height && src_size.depth == dst_size.depth))
+        {
+            point_filter_argb_pixels(src_addr, src_row_pitch, src_slice_pitch, &src_size, src_format_desc,
+                    locked_box.pBits, locked_box.RowPitch, locked_box.SlicePitch, &dst_size, dst_format_desc, color_key,
+                    src_palette);
+        }
         else
         {
-            if ((filter & 0xf) != D3DX_FILTER_POINT)
+            if ((filter & 0xf) > D3DX_FILTER_BOX)
                 FIXME("Unhandled filter %#x.\n", filter);
 
-            point_filter_argb_pixels(src_addr, src_row_pitch, src_slice_pitch, &src_size, src_format_desc,
+            hr = filter_argb_pixels(src_addr, src_row_pitch, src_slice_pitch, &src_size, src_format_desc,
                     locked_box.pBits, locked_box.RowPitch, locked_box.SlicePitch, &dst_size, dst_format_desc, color_key,
-                    src_palette);
+                    src_palette, filter);
+            if (FAILED(hr))
+            {
+                IDirect3DVolume9_UnlockBox(dst_volume);
+                return hr;
+            }
         }
 
         IDirect3DVolume9_UnlockBox(dst_volume);
@@ -942,26 +942,6 @@ static BOOL symt_enum_module(struct module_pair* pair, const WCHAR* match,
     return FALSE;
 }
 
-static inline unsigned where_to_insert(struct module* module, unsigned high, const struct symt_ht* elt)
-{
-    unsigned    low = 0, mid = high / 2;
-    ULONG64     addr;
-
-    if (!high) return 0;
-    symt_get_address(&elt->symt, &addr);
-    do
-    {
-        switch (cmp_sorttab_addr(module, mid, addr))
-        {
-        case 0: return mid;
-        case -1: low = mid + 1; break;
-        case 1: high = mid; break;
-        }
-        mid = low + (high - low) / 2;
-    } while (low < high);
-    return mid;
-}
-
 /***********************************************************************
  *              resort_symbols
  *
@@ -969,7 +949,7 @@ static inline unsigned where_to_insert(struct module* module, unsigned high, con
  */
 static BOOL resort_symbols(struct module* module)
 {
-    int delta;
+    unsigned delta;
 
     if (!(module->module.NumSyms = module->num_symbols))
         return FALSE;
@@ -980,39 +960,38 @@ static BOOL resort_symbols(struct module* module)
      */
     delta = module->num_symbols - module->num_sorttab;
     qsort(&module->addr_sorttab[module->num_sorttab], delta, sizeof(struct symt_ht*), symt_cmp_addr);
-    if (module->num_sorttab)
+    if (module->num_sorttab && delta)
     {
-        int     i, ins_idx = module->num_sorttab, prev_ins_idx;
-        static struct symt_ht** tmp;
-        static unsigned num_tmp;
+        struct symt_ht**    tmp;
+        int                 i = module->num_sorttab - 1, j = delta - 1, dst = module->num_symbols - 1;
+        ULONG64             addr_i, addr_j;
 
-        if (num_tmp < delta)
+        if (!(tmp = HeapAlloc(GetProcessHeap(), 0, delta * sizeof(struct symt_ht*))))
         {
-            static struct symt_ht** new;
-            if (tmp)
-                new = HeapReAlloc(GetProcessHeap(), 0, tmp, delta * sizeof(struct symt_ht*));
-            else
-                new = HeapAlloc(GetProcessHeap(), 0, delta * sizeof(struct symt_ht*));
-            if (!new)
-            {
-                module->num_sorttab = 0;
-                return resort_symbols(module);
-            }
-            tmp = new;
-            num_tmp = delta;
+            module->num_sorttab = 0;
+            return resort_symbols(module);
         }
         memcpy(tmp, &module->addr_sorttab[module->num_sorttab], delta * sizeof(struct symt_ht*));
-        qsort(tmp, delta, sizeof(struct symt_ht*), symt_cmp_addr);
 
-        for (i = delta - 1; i >= 0; i--)
+        /* merge from the end, so that each element is moved only once; on equal
+         * addresses, keep the already sorted symbols first
+         */
+        symt_get_address(&module->addr_sorttab[i]->symt, &addr_i);
+        symt_get_address(&tmp[j]->symt, &addr_j);
+        while (j >= 0)
         {
-            prev_ins_idx = ins_idx;
-            ins_idx = where_to_insert(module, ins_idx, tmp[i]);
-            memmove(&module->addr_sorttab[ins_idx + i + 1],
-                    &module->addr_sorttab[ins_idx],
-                    (prev_ins_idx - ins_idx) * sizeof(struct symt_ht*));
-            module->addr_sorttab[ins_idx + i] = tmp[i];
+            if (i >= 0 && addr_i > addr_j)
+            {
+                module->addr_sorttab[dst--] = module->addr_sorttab[i--];
+                if (i >= 0) symt_get_address(&module->addr_sorttab[i]->symt, &addr_i);
+            }
+            else
+            {
+                module->addr_sorttab[dst--] = tmp[j--];
+                if (j >= 0) symt_get_address(&tmp[j]->symt, &addr_j);
+            }
         }
+        HeapFree(GetProcessHeap(), 0, tmp);
     }
     module->num_sorttab = module->num_symbols;
     return module->sortlist_valid = TRUE;
@@ -1061,47 +1040,89 @@ static int symt_get_best_at(struct module* module, int idx_sorttab)
 struct symt_ht* symt_find_nearest(struct module* module, DWORD_PTR addr)
 {
     int         mid, high, low;
-    ULONG64     ref_addr, ref_size;
+    unsigned    i, delta = 0;
+    ULONG64     ref_addr, ref_size, best_addr = 0, last_addr = 0;
+    struct symt_ht* best = NULL;
+    struct symt_ht* last = NULL;
 
     if (!module->sortlist_valid || !module->addr_sorttab)
     {
-        if (!resort_symbols(module)) return NULL;
+        /* Symbols added since last sort are kept at the end of the table.
+         * As long as they are only a few of them, just scan them linearly instead
+         * of merging them, so that interleaving symbol additions and lookups (as
+         * most debug info readers do) doesn't end up in merging on every lookup.
+         */
+        delta = module->num_symbols - module->num_sorttab;
+        if (!module->num_sorttab || (ULONG64)delta * delta > module->num_sorttab)
+        {
+            if (!resort_symbols(module)) return NULL;
+            delta = 0;
+        }
+        else module->module.NumSyms = module->num_symbols;
     }
 
     /*
      * Binary search to find closest symbol.
      */
-    low = 0;
-    high = module->num_sorttab;
+    if (module->num_sorttab)
+    {
+        low = 0;
+        high = module->num_sorttab;
 
-    symt_get_address(&module->addr_sorttab[0]->symt, &ref_addr);
-    if (addr < ref_addr) return NULL;
+        last = module->addr_sorttab[high - 1];
+        symt_get_address(&last->symt, &last_addr);
 
-    if (high)
-    {
-        symt_get_address(&module->addr_sorttab[high - 1]->symt, &ref_addr);
-        symt_get_length(module, &module->addr_sorttab[high - 1]->symt, &ref_size);
-        if (addr >= ref_addr + ref_size) return NULL;
+        symt_get_address(&module->addr_sorttab[0]->symt, &ref_addr);
+        if (addr >= ref_addr)
+        {
+            while (high > low + 1)
+            {
+                mid = (high + low) / 2;
+                if (cmp_sorttab_addr(module, mid, addr) < 0)
+                    low = mid;
+                else
+                    high = mid;
+            }
+            if (low != high && high != module->num_sorttab &&
+                cmp_sorttab_addr(module, high, addr) <= 0)
+                low = high;
+
+            /* If found symbol is a public symbol, check if there are any other entries that
+             * might also have the same address, but would get better information
+             */
+            best = module->addr_sorttab[symt_get_best_at(module, low)];
+            symt_get_address(&best->symt, &best_addr);
+        }
     }
-    
-    while (high > low + 1)
+
+    /* then look into the not yet sorted symbols, with the same preferences */
+    for (i = module->num_sorttab; i < module->num_sorttab + delta; i++)
     {
-        mid = (high + low) / 2;
-        if (cmp_sorttab_addr(module, mid, addr) < 0)
-            low = mid;
-        else
-            high = mid;
-    }
-    if (low != high && high != module->num_sorttab &&
-        cmp_sorttab_addr(module, high, addr) <= 0)
-        low = high;
+        struct symt_ht* sym = module->addr_sorttab[i];
 
-    /* If found symbol is a public symbol, check if there are any other entries that
-     * might also have the same address, but would get better information
-     */
-    low = symt_get_best_at(module, low);
+        symt_get_address(&sym->symt, &ref_addr);
+        if (!last || ref_addr > last_addr)
+        {
+            last = sym;
+            last_addr = ref_addr;
+        }
+        if (ref_addr > addr) continue;
+        if (!best || ref_addr > best_addr ||
+            (ref_addr == best_addr && best->symt.tag == SymTagPublicSymbol &&
+             sym->symt.tag != SymTagPublicSymbol))
+        {
+            best = sym;
+            best_addr = ref_addr;
+        }
+    }
+    if (!best) return NULL;
 
-    return module->addr_sorttab[low];
+    if (addr >= last_addr)
+    {
+        symt_get_length(module, &last->symt, &ref_size);
+        if (addr >= last_addr + ref_size) return NULL;
+    }
+    return best;
 }
 
 static BOOL symt_enum_locals_helper(struct module_pair* pair,
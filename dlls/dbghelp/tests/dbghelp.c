@@ -190,6 +190,61 @@ static void test_search_path(void)
     ok(!strcmp(search_path, "."), "Got search path '%s', expected '.'\n", search_path);
 }
 
+static void test_symbol_lookup(void)
+{
+    static const DWORD64 base = 0x10000000;
+    HANDLE dummy = (HANDLE)(ULONG_PTR)0x1234;
+    char buffer[sizeof(SYMBOL_INFO) + 64];
+    SYMBOL_INFO *si = (SYMBOL_INFO *)buffer;
+    unsigned int i, j, count = winetest_interactive ? 50000 : 2000, seed = 0;
+    LARGE_INTEGER freq, start, end;
+    DWORD64 disp, addr;
+    DWORD64 ret64;
+    char name[16];
+    BOOL ret;
+
+    ret = SymInitialize(dummy, NULL, FALSE);
+    ok(ret, "got error %lu\n", GetLastError());
+    ret64 = SymLoadModuleEx(dummy, NULL, "fake.dll", NULL, base, count * 16, NULL, SLMFLAG_VIRTUAL);
+    ok(ret64 == base, "got %#I64x\n", ret64);
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+
+    /* interleave symbol additions (in no particular address order) and lookups */
+    for (i = 0; i < count; i++)
+    {
+        j = (i * 7919) % count;
+        sprintf(name, "sym%u", j);
+        ret = SymAddSymbol(dummy, base, name, base + j * 16, 16, 0);
+        ok(ret, "%u: got error %lu\n", i, GetLastError());
+
+        seed = seed * 1103515245 + 12345;
+        j = (((seed >> 16) % (i + 1)) * 7919) % count;
+        addr = base + j * 16 + 3;
+        memset(si, 0, sizeof(*si));
+        si->SizeOfStruct = sizeof(*si);
+        si->MaxNameLen = sizeof(buffer) - sizeof(*si);
+        disp = 0;
+        ret = SymFromAddr(dummy, addr, &disp, si);
+        ok(ret, "%u: got error %lu\n", i, GetLastError());
+        if (!ret) break;
+        sprintf(name, "sym%u", j);
+        ok(!strcmp(si->Name, name), "%u: got %s, expected %s\n", i, si->Name, name);
+        ok(disp == 3, "%u: got displacement %I64u\n", i, disp);
+    }
+
+    QueryPerformanceCounter(&end);
+    trace("%u symbols: %.0f add+lookup per second\n", count,
+          (double)count * freq.QuadPart / max(end.QuadPart - start.QuadPart, 1));
+
+    ret = SymFromAddr(dummy, base + count * 16 + 16, &disp, si);
+    ok(!ret, "expected failure past the last symbol\n");
+
+    ret = SymCleanup(dummy);
+    ok(ret, "got error %lu\n", GetLastError());
+}
+
 START_TEST(dbghelp)
 {
     BOOL ret;
@@ -203,6 +258,7 @@ START_TEST(dbghelp)
 
     test_stack_walk();
     test_search_path();
+    test_symbol_lookup();
 
     ret = SymCleanup(GetCurrentProcess());
     ok(ret, "got error %lu\n", GetLastError());
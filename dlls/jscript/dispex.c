@@ -1970,6 +1970,32 @@ HRESULT jsdisp_get_id(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, DISPID *
     return DISP_E_UNKNOWNNAME;
 }
 
+/*
+ * Same as jsdisp_get_id, but first tries the DISPID that the previous lookup from the
+ * same instruction returned. Properties are never moved once allocated, so objects built
+ * the same way have the same layout, and the cached id is valid for any object that has
+ * a property of that name at that position.
+ */
+HRESULT jsdisp_get_id_cached(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, DISPID *cache, DISPID *id)
+{
+    dispex_prop_t *prop;
+    HRESULT hres;
+
+    if(!cache)
+        return jsdisp_get_id(jsdisp, name, flags, id);
+
+    prop = get_prop(jsdisp, *cache);
+    if(prop && !wcscmp(prop->name, name)) {
+        *id = *cache;
+        return S_OK;
+    }
+
+    hres = jsdisp_get_id(jsdisp, name, flags, id);
+    if(SUCCEEDED(hres))
+        *cache = *id;
+    return hres;
+}
+
 HRESULT jsdisp_call_value(jsdisp_t *jsfunc, IDispatch *jsthis, WORD flags, unsigned argc, jsval_t *argv, jsval_t *r)
 {
     HRESULT hres;
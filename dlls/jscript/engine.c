@@ -450,7 +450,8 @@ void scope_release(scope_chain_t *scope)
     heap_free(scope);
 }
 
-static HRESULT disp_get_id(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name, BSTR name_bstr, DWORD flags, DISPID *id)
+static HRESULT disp_get_id(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name, BSTR name_bstr, DWORD flags,
+                           DISPID *cache, DISPID *id)
 {
     IDispatchEx *dispex;
     jsdisp_t *jsdisp;
@@ -459,7 +460,7 @@ static HRESULT disp_get_id(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name
 
     jsdisp = iface_to_jsdisp(disp);
     if(jsdisp) {
-        hres = jsdisp_get_id(jsdisp, name, flags, id);
+        hres = jsdisp_get_id_cached(jsdisp, name, flags, cache, id);
         jsdisp_release(jsdisp);
         return hres;
     }
@@ -653,7 +654,7 @@ static BOOL lookup_global_members(script_ctx_t *ctx, BSTR identifier, exprval_t
 
     LIST_FOR_EACH_ENTRY(item, &ctx->named_items, named_item_t, entry) {
         if(item->flags & SCRIPTITEM_GLOBALMEMBERS) {
-            hres = disp_get_id(ctx, item->disp, identifier, identifier, 0, &id);
+            hres = disp_get_id(ctx, item->disp, identifier, identifier, 0, NULL, &id);
             if(SUCCEEDED(hres)) {
                 if(ret)
                     exprval_set_disp_ref(ret, item->disp, id);
@@ -692,7 +693,7 @@ local_ref_t *lookup_local(const function_code_t *function, const WCHAR *identifi
 }
 
 /* ECMA-262 3rd Edition    10.1.4 */
-static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *ret)
+static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, DISPID *cache, exprval_t *ret)
 {
     scope_chain_t *scope;
     named_item_t *item;
@@ -733,9 +734,9 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
                 continue;
 
             if(scope->jsobj)
-                hres = jsdisp_get_id(scope->jsobj, identifier, fdexNameImplicit, &id);
+                hres = jsdisp_get_id_cached(scope->jsobj, identifier, fdexNameImplicit, cache, &id);
             else
-                hres = disp_get_id(ctx, scope->obj, identifier, identifier, fdexNameImplicit, &id);
+                hres = disp_get_id(ctx, scope->obj, identifier, identifier, fdexNameImplicit, cache, &id);
             if(SUCCEEDED(hres)) {
                 exprval_set_disp_ref(ret, scope->obj, id);
                 return S_OK;
@@ -744,13 +745,13 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
 
         item = ctx->call_ctx->bytecode->named_item;
         if(item) {
-            hres = jsdisp_get_id(item->script_obj, identifier, 0, &id);
+            hres = jsdisp_get_id_cached(item->script_obj, identifier, 0, cache, &id);
             if(SUCCEEDED(hres)) {
                 exprval_set_disp_ref(ret, to_disp(item->script_obj), id);
                 return S_OK;
             }
             if(!(item->flags & SCRIPTITEM_CODEONLY)) {
-                hres = disp_get_id(ctx, item->disp, identifier, identifier, 0, &id);
+                hres = disp_get_id(ctx, item->disp, identifier, identifier, 0, NULL, &id);
                 if(SUCCEEDED(hres)) {
                     exprval_set_disp_ref(ret, item->disp, id);
                     return S_OK;
@@ -759,7 +760,7 @@ static HRESULT identifier_eval(script_ctx_t *ctx, BSTR identifier, exprval_t *re
         }
     }
 
-    hres = jsdisp_get_id(ctx->global, identifier, 0, &id);
+    hres = jsdisp_get_id_cached(ctx->global, identifier, 0, cache, &id);
     if(SUCCEEDED(hres)) {
         exprval_set_disp_ref(ret, to_disp(ctx->global), id);
         return S_OK;
@@ -798,6 +799,13 @@ static inline unsigned get_op_int(script_ctx_t *ctx, int i)
     return frame->bytecode->instrs[frame->ip].u.arg[i].lng;
 }
 
+/* The last argument of property lookup instructions caches the DISPID they resolved to. */
+static inline DISPID *get_op_cache(script_ctx_t *ctx, int i)
+{
+    call_frame_t *frame = ctx->call_ctx;
+    return &frame->bytecode->instrs[frame->ip].u.arg[i].lng;
+}
+
 static inline jsstr_t *get_op_str(script_ctx_t *ctx, int i)
 {
     call_frame_t *frame = ctx->call_ctx;
@@ -1236,7 +1244,7 @@ static HRESULT interp_array(script_ctx_t *ctx)
         return hres;
     }
 
-    hres = disp_get_id(ctx, obj, name, NULL, 0, &id);
+    hres = disp_get_id(ctx, obj, name, NULL, 0, NULL, &id);
     jsstr_release(name_str);
     if(SUCCEEDED(hres)) {
         hres = disp_propget(ctx, obj, id, &v);
@@ -1266,7 +1274,7 @@ static HRESULT interp_member(script_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx, obj, arg, arg, 0, &id);
+    hres = disp_get_id(ctx, obj, arg, arg, 0, get_op_cache(ctx, 1), &id);
     if(SUCCEEDED(hres)) {
         hres = disp_propget(ctx, obj, id, &v);
     }else if(hres == DISP_E_UNKNOWNNAME) {
@@ -1308,7 +1316,7 @@ static HRESULT interp_memberid(script_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx, obj, name, NULL, arg, &id);
+    hres = disp_get_id(ctx, obj, name, NULL, arg, get_op_cache(ctx, 1), &id);
     jsstr_release(name_str);
     if(SUCCEEDED(hres)) {
         ref.type = EXPRVAL_IDREF;
@@ -1431,7 +1439,7 @@ static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigne
     exprval_t exprval;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, identifier, &exprval);
+    hres = identifier_eval(ctx, identifier, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1459,13 +1467,13 @@ static HRESULT interp_identifier_ref(script_ctx_t *ctx, BSTR identifier, unsigne
     return stack_push_exprval(ctx, &exprval);
 }
 
-static HRESULT identifier_value(script_ctx_t *ctx, BSTR identifier)
+static HRESULT identifier_value(script_ctx_t *ctx, BSTR identifier, DISPID *cache)
 {
     exprval_t exprval;
     jsval_t v;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, identifier, &exprval);
+    hres = identifier_eval(ctx, identifier, cache, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -1505,7 +1513,7 @@ static HRESULT interp_local(script_ctx_t *ctx)
 
     if(!frame->base_scope || !frame->base_scope->frame) {
         TRACE("%s\n", debugstr_w(local_name(frame, arg)));
-        return identifier_value(ctx, local_name(frame, arg));
+        return identifier_value(ctx, local_name(frame, arg), get_op_cache(ctx, 1));
     }
 
     hres = jsval_copy(ctx->stack[local_off(frame, arg)], &copy);
@@ -1523,7 +1531,7 @@ static HRESULT interp_ident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    return identifier_value(ctx, arg);
+    return identifier_value(ctx, arg, get_op_cache(ctx, 1));
 }
 
 /* ECMA-262 3rd Edition    10.1.4 */
@@ -1880,7 +1888,7 @@ static HRESULT interp_in(script_ctx_t *ctx)
         return hres;
     }
 
-    hres = disp_get_id(ctx, get_object(obj), str, NULL, 0, &id);
+    hres = disp_get_id(ctx, get_object(obj), str, NULL, 0, NULL, &id);
     IDispatch_Release(get_object(obj));
     jsstr_release(jsstr);
     if(SUCCEEDED(hres))
@@ -2077,7 +2085,7 @@ static HRESULT interp_delete_ident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    hres = identifier_eval(ctx, arg, &exprval);
+    hres = identifier_eval(ctx, arg, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -2188,7 +2196,7 @@ static HRESULT interp_typeofident(script_ctx_t *ctx)
 
     TRACE("%s\n", debugstr_w(arg));
 
-    hres = identifier_eval(ctx, arg, &exprval);
+    hres = identifier_eval(ctx, arg, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -3106,7 +3114,7 @@ static HRESULT bind_event_target(script_ctx_t *ctx, function_code_t *func, jsdis
     jsval_t v;
     HRESULT hres;
 
-    hres = identifier_eval(ctx, func->event_target, &exprval);
+    hres = identifier_eval(ctx, func->event_target, NULL, &exprval);
     if(FAILED(hres))
         return hres;
 
@@ -3297,7 +3305,7 @@ HRESULT exec_source(script_ctx_t *ctx, DWORD flags, bytecode_t *bytecode, functi
             }
 
             if(item && !(item->flags & SCRIPTITEM_CODEONLY)
-                && SUCCEEDED(disp_get_id(ctx, item->disp, function->variables[i].name, function->variables[i].name, 0, &id)))
+                && SUCCEEDED(disp_get_id(ctx, item->disp, function->variables[i].name, function->variables[i].name, 0, NULL, &id)))
                     continue;
 
             if(!item && (flags & EXEC_GLOBAL) && lookup_global_members(ctx, function->variables[i].name, NULL))
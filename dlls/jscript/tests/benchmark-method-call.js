@@ -0,0 +1,46 @@
+/*
+ * Copyright 2022 Wine Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Method calls through the prototype chain and global function calls. */
+
+function Counter() {
+    this.count = 0;
+}
+
+Counter.prototype.increment = function(n) {
+    this.count += n;
+    return this;
+};
+
+Counter.prototype.get = function() {
+    return this.count;
+};
+
+function add(a, b) {
+    return a + b;
+}
+
+var counter = new Counter(), i, total = 0;
+
+for(i = 0; i < 100000; i++) {
+    counter.increment(1).increment(2);
+    total = add(total, counter.get());
+}
+
+for(i = 0; i < 100000; i++)
+    total = Math.max(total, Math.abs(i - 50000));
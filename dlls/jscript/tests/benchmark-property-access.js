@@ -0,0 +1,41 @@
+/*
+ * Copyright 2022 Wine Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Property reads and writes on objects sharing the same layout. */
+
+function Point(x, y) {
+    this.x = x;
+    this.y = y;
+}
+
+var points = [], i, j, sum = 0;
+
+for(i = 0; i < 1000; i++)
+    points.push(new Point(i, 2 * i));
+
+for(j = 0; j < 200; j++) {
+    for(i = 0; i < points.length; i++) {
+        var p = points[i];
+        sum += p.x + p.y;
+        p.x = p.y - p.x;
+    }
+}
+
+var counter = { value: 0 };
+for(i = 0; i < 200000; i++)
+    counter.value++;
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2022 Wine Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* String building with concatenation and arrays. */
+
+var str = "", parts = [], i;
+
+for(i = 0; i < 20000; i++)
+    str += String.fromCharCode(97 + i % 26);
+
+for(i = 0; i < 20000; i++)
+    parts.push("item" + i);
+str = parts.join(",");
+
+var words = str.split(","), lengths = 0;
+for(i = 0; i < words.length; i++)
+    lengths += words[i].length + words[i].toUpperCase().charCodeAt(0);
@@ -2108,3 +2108,30 @@ function test_es5_keywords() {
     ok(tmp === true, "Expected exception for 'const c1 = 1;'");
 }
 test_es5_keywords();
+
+/* The same member access instruction must handle objects with different layouts. */
+function getMemberX(o) {
+    return o.x;
+}
+
+(function() {
+    var objs = [{x: 1}, {a: 0, x: 2}, {a: 0, b: 0, y: 3}, {a: 0, b: 0}, {x: 5}], i;
+
+    ok(getMemberX(objs[0]) === 1, "getMemberX(objs[0]) = " + getMemberX(objs[0]));
+    ok(getMemberX(objs[1]) === 2, "getMemberX(objs[1]) = " + getMemberX(objs[1]));
+    ok(getMemberX(objs[2]) === undefined, "getMemberX(objs[2]) = " + getMemberX(objs[2]));
+    ok(getMemberX(objs[4]) === 5, "getMemberX(objs[4]) = " + getMemberX(objs[4]));
+
+    for(i = 0; i < 3; i++) {
+        objs[i].x = 10 + i;
+        ok(objs[i].x === 10 + i, "objs[" + i + "].x = " + objs[i].x);
+    }
+
+    delete objs[0].x;
+    ok(getMemberX(objs[0]) === undefined, "getMemberX(objs[0]) after delete = " + getMemberX(objs[0]));
+    Object.prototype.x = "proto";
+    ok(getMemberX(objs[0]) === "proto", "getMemberX(objs[0]) with proto = " + getMemberX(objs[0]));
+    ok(getMemberX(objs[1]) === 11, "getMemberX(objs[1]) with proto = " + getMemberX(objs[1]));
+    delete Object.prototype.x;
+    ok(getMemberX(objs[0]) === undefined, "getMemberX(objs[0]) after proto delete = " + getMemberX(objs[0]));
+})();
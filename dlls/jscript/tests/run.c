@@ -3769,6 +3769,9 @@ static void run_benchmarks(void)
     run_benchmark("dna.js");
     run_benchmark("base64.js");
     run_benchmark("validateinput.js");
+    run_benchmark("propaccess.js");
+    run_benchmark("methodcall.js");
+    run_benchmark("stringbuild.js");
 }
 
 static BOOL check_jscript(void)
@@ -1169,23 +1169,17 @@ static void test_CopyFileEx(void)
     ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %ld\n", GetLastError());
     SetLastError(0xdeadbeef);
     retok = CopyFileExA(source, dest, copy_progress_cb, hfile, NULL, 0);
-    todo_wine
     ok(!retok, "CopyFileExA unexpectedly succeeded\n");
-    todo_wine
     ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %ld\n", GetLastError());
     ok(GetFileAttributesA(dest) != INVALID_FILE_ATTRIBUTES, "file was deleted\n");
 
     hfile = CreateFileA(dest, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_WRITE | FILE_SHARE_DELETE,
                         NULL, OPEN_EXISTING, 0, 0);
-    todo_wine
     ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %ld\n", GetLastError());
     SetLastError(0xdeadbeef);
     retok = CopyFileExA(source, dest, copy_progress_cb, hfile, NULL, 0);
-    todo_wine
     ok(!retok, "CopyFileExA unexpectedly succeeded\n");
-    todo_wine
     ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %ld\n", GetLastError());
-    todo_wine
     ok(GetFileAttributesA(dest) == INVALID_FILE_ATTRIBUTES, "file was not deleted\n");
 
     retok = CopyFileExA(source, NULL, copy_progress_cb, hfile, NULL, 0);
@@ -1201,6 +1195,115 @@ static void test_CopyFileEx(void)
     ok(!ret, "DeleteFileA unexpectedly succeeded\n");
 }
 
+struct copy_progress
+{
+    DWORD result;
+    unsigned int calls;
+    LARGE_INTEGER transferred;
+};
+
+static DWORD WINAPI copy_progress_chunk_cb(LARGE_INTEGER total_size, LARGE_INTEGER total_transferred,
+                                           LARGE_INTEGER stream_size, LARGE_INTEGER stream_transferred,
+                                           DWORD stream, DWORD reason, HANDLE source, HANDLE dest, LPVOID userdata)
+{
+    struct copy_progress *progress = userdata;
+
+    if (!progress->calls)
+        ok(reason == CALLBACK_STREAM_SWITCH, "expected CALLBACK_STREAM_SWITCH, got %lu\n", reason);
+    else
+        ok(reason == CALLBACK_CHUNK_FINISHED, "expected CALLBACK_CHUNK_FINISHED, got %lu\n", reason);
+    ok(total_transferred.QuadPart >= progress->transferred.QuadPart, "transferred size went backwards\n");
+    ok(total_transferred.QuadPart <= total_size.QuadPart, "got transferred %s, size %s\n",
+       wine_dbgstr_longlong(total_transferred.QuadPart), wine_dbgstr_longlong(total_size.QuadPart));
+    progress->transferred = total_transferred;
+    progress->calls++;
+    return progress->result;
+}
+
+static void test_CopyFileEx_progress(void)
+{
+    unsigned int size = winetest_interactive ? 2048 : 8;  /* in MiB */
+    char temp_path[MAX_PATH], source[MAX_PATH], dest[MAX_PATH];
+    static const char prefix[] = "pfx";
+    struct copy_progress progress;
+    LARGE_INTEGER freq, start, end;
+    DWORD ret, count, i, j;
+    BOOL cancel, retok;
+    HANDLE hfile;
+    DWORD *buffer, *buffer2;
+
+    GetTempPathA(MAX_PATH, temp_path);
+    ret = GetTempFileNameA(temp_path, prefix, 0, source);
+    ok(ret != 0, "GetTempFileNameA error %ld\n", GetLastError());
+    ret = GetTempFileNameA(temp_path, prefix, 0, dest);
+    ok(ret != 0, "GetTempFileNameA error %ld\n", GetLastError());
+
+    buffer = HeapAlloc(GetProcessHeap(), 0, 1024 * 1024);
+    buffer2 = HeapAlloc(GetProcessHeap(), 0, 1024 * 1024);
+
+    hfile = CreateFileA(source, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to create source file, error %ld\n", GetLastError());
+    for (i = 0; i < size; i++)
+    {
+        for (j = 0; j < 1024 * 1024 / sizeof(*buffer); j++) buffer[j] = i * 0x10001 + j;
+        retok = WriteFile(hfile, buffer, 1024 * 1024, &count, NULL);
+        ok(retok && count == 1024 * 1024, "WriteFile failed, error %ld\n", GetLastError());
+    }
+    /* make sure the tail doesn't end on a block boundary */
+    retok = WriteFile(hfile, buffer, 123, &count, NULL);
+    ok(retok && count == 123, "WriteFile failed, error %ld\n", GetLastError());
+    CloseHandle(hfile);
+
+    memset(&progress, 0, sizeof(progress));
+    progress.result = PROGRESS_CONTINUE;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    retok = CopyFileExA(source, dest, copy_progress_chunk_cb, &progress, NULL, 0);
+    QueryPerformanceCounter(&end);
+    ok(retok, "CopyFileExA failed, error %ld\n", GetLastError());
+    ok(progress.calls >= 2, "got %u progress calls\n", progress.calls);
+    ok(progress.transferred.QuadPart == (LONGLONG)size * 1024 * 1024 + 123, "got transferred %s\n",
+       wine_dbgstr_longlong(progress.transferred.QuadPart));
+    trace("copied %u MiB in %.1f ms, %u progress calls\n", size,
+          (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart, progress.calls);
+
+    hfile = CreateFileA(dest, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, 0);
+    ok(hfile != INVALID_HANDLE_VALUE, "failed to open destination file, error %ld\n", GetLastError());
+    ok(GetFileSize(hfile, NULL) == size * 1024 * 1024 + 123, "got size %lu\n", GetFileSize(hfile, NULL));
+    for (i = 0; i < size; i++)
+    {
+        for (j = 0; j < 1024 * 1024 / sizeof(*buffer); j++) buffer[j] = i * 0x10001 + j;
+        retok = ReadFile(hfile, buffer2, 1024 * 1024, &count, NULL);
+        ok(retok && count == 1024 * 1024, "ReadFile failed, error %ld\n", GetLastError());
+        if (memcmp(buffer, buffer2, 1024 * 1024))
+        {
+            ok(0, "data mismatch in MiB %lu\n", i);
+            break;
+        }
+    }
+    CloseHandle(hfile);
+
+    /* no more callbacks after PROGRESS_QUIET */
+    memset(&progress, 0, sizeof(progress));
+    progress.result = PROGRESS_QUIET;
+    retok = CopyFileExA(source, dest, copy_progress_chunk_cb, &progress, NULL, 0);
+    ok(retok, "CopyFileExA failed, error %ld\n", GetLastError());
+    ok(progress.calls == 1, "got %u progress calls\n", progress.calls);
+
+    memset(&progress, 0, sizeof(progress));
+    progress.result = PROGRESS_CONTINUE;
+    cancel = TRUE;
+    SetLastError(0xdeadbeef);
+    retok = CopyFileExA(source, dest, copy_progress_chunk_cb, &progress, &cancel, 0);
+    ok(!retok, "CopyFileExA unexpectedly succeeded\n");
+    ok(GetLastError() == ERROR_REQUEST_ABORTED, "expected ERROR_REQUEST_ABORTED, got %ld\n", GetLastError());
+
+    HeapFree(GetProcessHeap(), 0, buffer);
+    HeapFree(GetProcessHeap(), 0, buffer2);
+    DeleteFileA(source);
+    DeleteFileA(dest);
+}
+
 /*
  *   Debugging routine to dump a buffer in a hexdump-like fashion.
  */
@@ -6157,6 +6260,7 @@ START_TEST(file)
     test_CopyFileW();
     test_CopyFile2();
     test_CopyFileEx();
+    test_CopyFileEx_progress();
     test_CreateFile();
     test_CreateFileA();
     test_CreateFileW();
@@ -4012,6 +4012,180 @@ static void test_dll_file( const char *name )
 #undef OK_FIELD
 }
 
+static unsigned int check_image_relocations( char *base1, char *base2 )
+{
+    IMAGE_NT_HEADERS *nt1 = pRtlImageNtHeader( (HMODULE)base1 );
+    IMAGE_NT_HEADERS *nt2 = pRtlImageNtHeader( (HMODULE)base2 );
+    const IMAGE_DATA_DIRECTORY *dir = &nt1->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+    const IMAGE_BASE_RELOCATION *rel = (const IMAGE_BASE_RELOCATION *)(base1 + dir->VirtualAddress);
+    const IMAGE_BASE_RELOCATION *end = (const IMAGE_BASE_RELOCATION *)(base1 + dir->VirtualAddress + dir->Size);
+    ULONG_PTR delta = nt2->OptionalHeader.ImageBase - nt1->OptionalHeader.ImageBase;
+    unsigned int i, count, errors = 0;
+
+    /* whether or not the views are relocated, their contents must match the header base address */
+    while (dir->Size && rel < end - 1 && rel->SizeOfBlock)
+    {
+        const USHORT *relocs = (const USHORT *)(rel + 1);
+
+        count = (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT);
+        for (i = 0; i < count; i++)
+        {
+            ULONG offset = rel->VirtualAddress + (relocs[i] & 0xfff);
+
+            switch (relocs[i] >> 12)
+            {
+            case IMAGE_REL_BASED_HIGHLOW:
+                if (*(DWORD *)(base2 + offset) - *(DWORD *)(base1 + offset) != (DWORD)delta) errors++;
+                break;
+            case IMAGE_REL_BASED_DIR64:
+                if (*(ULONGLONG *)(base2 + offset) - *(ULONGLONG *)(base1 + offset) != delta) errors++;
+                break;
+            }
+        }
+        rel = (const IMAGE_BASE_RELOCATION *)((const char *)rel + rel->SizeOfBlock);
+    }
+    return errors;
+}
+
+static void test_relocated_image_mapping( const char *name )
+{
+    HMODULE module = GetModuleHandleA( name );
+    unsigned int i, count = winetest_interactive ? 64 : 8;
+    char path[MAX_PATH], *views[64];
+    DWORD start, end, errors;
+    HANDLE file, mapping;
+
+    GetModuleFileNameA( module, path, MAX_PATH );
+    file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0 );
+    ok( file != INVALID_HANDLE_VALUE, "can't open '%s': %lu\n", path, GetLastError() );
+    mapping = CreateFileMappingA( file, NULL, PAGE_READONLY | SEC_IMAGE, 0, 0, NULL );
+    ok( mapping != NULL, "%s: CreateFileMappingA failed err %lu\n", name, GetLastError() );
+    CloseHandle( file );
+
+    /* the dll is already loaded, so all the views end up at a different address */
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        views[i] = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+        ok( views[i] != NULL, "%s: MapViewOfFile failed err %lu\n", name, GetLastError() );
+        if (!views[i]) break;
+    }
+    end = GetTickCount();
+    count = i;
+    trace( "%s: mapped %u image views in %lu ms\n", name, count, end - start );
+
+    for (i = 1; i < count; i++)
+    {
+        errors = check_image_relocations( views[0], views[i] );
+        ok( !errors, "%s: %lu relocation mismatches between %p and %p\n", name, errors, views[0], views[i] );
+    }
+    for (i = 0; i < count; i++) UnmapViewOfFile( views[i] );
+    CloseHandle( mapping );
+}
+
+static void test_export_lookup( const char *name )
+{
+    const IMAGE_EXPORT_DIRECTORY *exports;
+    const DWORD *names;
+    const WORD *ordinals;
+    LARGE_INTEGER freq, start, load_end, end;
+    unsigned int i, errors = 0;
+    HMODULE module;
+    ULONG size;
+
+    QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &start );
+    module = LoadLibraryA( name );
+    QueryPerformanceCounter( &load_end );
+    if (!module)
+    {
+        skip( "%s not available\n", name );
+        return;
+    }
+
+    exports = pRtlImageDirectoryEntryToData( module, TRUE, IMAGE_DIRECTORY_ENTRY_EXPORT, &size );
+    ok( exports != NULL, "%s: no exports\n", name );
+    if (!exports)
+    {
+        FreeLibrary( module );
+        return;
+    }
+    names = (const DWORD *)((char *)module + exports->AddressOfNames);
+    ordinals = (const WORD *)((char *)module + exports->AddressOfNameOrdinals);
+
+    /* lookups by name and by ordinal must agree */
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        const char *export = (const char *)module + names[i];
+        FARPROC proc = GetProcAddress( module, export );
+
+        if (proc != GetProcAddress( module, (const char *)(ULONG_PTR)(ordinals[i] + exports->Base) )) errors++;
+    }
+    QueryPerformanceCounter( &end );
+    ok( !errors, "%s: %u mismatches between name and ordinal lookups\n", name, errors );
+
+    trace( "%s: loaded in %.2f ms, %lu names resolved in %.2f ms\n", name,
+           (load_end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart, exports->NumberOfNames,
+           (end.QuadPart - load_end.QuadPart) * 1000.0 / freq.QuadPart );
+    FreeLibrary( module );
+}
+
+static void test_relocated_image_rewrite(void)
+{
+    static const DWORD stamps[2] = { 0x12345678, 0x87654321 };
+    char path[MAX_PATH], temp_path[MAX_PATH], dll_path[MAX_PATH], *views[2];
+    IMAGE_NT_HEADERS *nt;
+    HANDLE file, mapping;
+    IMAGE_DOS_HEADER dos;
+    DWORD size, errors;
+    unsigned int i;
+    BOOL ret;
+
+    GetModuleFileNameA( GetModuleHandleA( "advapi32.dll" ), path, MAX_PATH );
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "rel", 0, dll_path );
+    ret = CopyFileA( path, dll_path, FALSE );
+    ok( ret, "CopyFileA failed err %lu\n", GetLastError() );
+
+    /* rewrite the image in place between two relocated loads, keeping its size */
+    for (i = 0; i < ARRAY_SIZE(stamps); i++)
+    {
+        file = CreateFileA( dll_path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, 0 );
+        ok( file != INVALID_HANDLE_VALUE, "can't open '%s': %lu\n", dll_path, GetLastError() );
+        ret = ReadFile( file, &dos, sizeof(dos), &size, NULL );
+        ok( ret && size == sizeof(dos), "ReadFile failed err %lu\n", GetLastError() );
+        SetFilePointer( file, dos.e_lfanew + FIELD_OFFSET( IMAGE_NT_HEADERS, FileHeader.TimeDateStamp ),
+                        NULL, FILE_BEGIN );
+        ret = WriteFile( file, &stamps[i], sizeof(stamps[i]), &size, NULL );
+        ok( ret && size == sizeof(stamps[i]), "WriteFile failed err %lu\n", GetLastError() );
+        CloseHandle( file );
+
+        file = CreateFileA( dll_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0 );
+        ok( file != INVALID_HANDLE_VALUE, "can't open '%s': %lu\n", dll_path, GetLastError() );
+        mapping = CreateFileMappingA( file, NULL, PAGE_READONLY | SEC_IMAGE, 0, 0, NULL );
+        ok( mapping != NULL, "CreateFileMappingA failed err %lu\n", GetLastError() );
+        CloseHandle( file );
+        if (!mapping) break;
+
+        views[0] = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+        ok( views[0] != NULL, "MapViewOfFile failed err %lu\n", GetLastError() );
+        views[1] = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+        ok( views[1] != NULL, "MapViewOfFile failed err %lu\n", GetLastError() );
+        if (views[0] && views[1])
+        {
+            nt = pRtlImageNtHeader( (HMODULE)views[1] );
+            ok( nt->FileHeader.TimeDateStamp == stamps[i], "%u: got stale image, stamp %08lx\n",
+                i, nt->FileHeader.TimeDateStamp );
+            errors = check_image_relocations( views[0], views[1] );
+            ok( !errors, "%u: %lu relocation mismatches\n", i, errors );
+        }
+        UnmapViewOfFile( views[0] );
+        UnmapViewOfFile( views[1] );
+        CloseHandle( mapping );
+    }
+    DeleteFileA( dll_path );
+}
+
 static void test_LoadPackagedLibrary(void)
 {
     HMODULE h;
@@ -4132,6 +4306,12 @@ START_TEST(loader)
     test_dll_file( "kernel32.dll" );
     test_dll_file( "advapi32.dll" );
     test_dll_file( "user32.dll" );
+    test_relocated_image_mapping( "advapi32.dll" );
+    test_relocated_image_mapping( "user32.dll" );
+    test_relocated_image_rewrite();
+    test_export_lookup( "mshtml.dll" );
+    test_export_lookup( "d3dx9_43.dll" );
+    test_export_lookup( "msvcp140.dll" );
     test_Wow64Transition();
     /* loader test must be last, it can corrupt the internal loader state on Windows */
     test_Loader();
@@ -491,45 +491,81 @@ BOOL WINAPI DECLSPEC_HOTPATCH AreFileApisANSI(void)
 }
 
 
+/* returns FALSE if the copy has to be aborted */
+static BOOL copy_file_progress( LPPROGRESS_ROUTINE *progress, void *param, BOOL *cancel_ptr,
+                                LARGE_INTEGER size, LARGE_INTEGER transferred, DWORD reason,
+                                HANDLE h1, HANDLE h2, BOOL *delete_dest )
+{
+    DWORD res;
+
+    if (cancel_ptr && *cancel_ptr)
+    {
+        *delete_dest = TRUE;
+        SetLastError( ERROR_REQUEST_ABORTED );
+        return FALSE;
+    }
+    if (!*progress) return TRUE;
+
+    res = (*progress)( size, transferred, size, transferred, 1, reason, h1, h2, param );
+    switch (res)
+    {
+    case PROGRESS_CONTINUE:
+        return TRUE;
+    case PROGRESS_QUIET:
+        *progress = NULL;
+        return TRUE;
+    case PROGRESS_CANCEL:
+        *delete_dest = TRUE;
+        /* fall through */
+    case PROGRESS_STOP:
+        SetLastError( ERROR_REQUEST_ABORTED );
+        return FALSE;
+    default:
+        FIXME( "unhandled progress result %lu\n", res );
+        return TRUE;
+    }
+}
+
+
 /***********************************************************************
  *	CopyFileExW   (kernelbase.@)
  */
 BOOL WINAPI CopyFileExW( const WCHAR *source, const WCHAR *dest, LPPROGRESS_ROUTINE progress,
                          void *param, BOOL *cancel_ptr, DWORD flags )
 {
-    static const int buffer_size = 65536;
+    static const int buffer_size = 1024 * 1024;
+    static const LONGLONG chunk_size = 32 * 1024 * 1024;
     HANDLE h1, h2;
     FILE_BASIC_INFORMATION info;
+    FILE_STANDARD_INFORMATION std_info;
+    FILE_DISPOSITION_INFORMATION disposition;
+    LARGE_INTEGER transferred;
     IO_STATUS_BLOCK io;
-    DWORD count;
-    BOOL ret = FALSE;
-    char *buffer;
+    NTSTATUS status = STATUS_SUCCESS;
+    DWORD count, access = GENERIC_READ;
+    BOOL ret = FALSE, delete_dest = FALSE, can_delete = TRUE;
+    char *buffer = NULL;
 
     if (!source || !dest)
     {
         SetLastError( ERROR_INVALID_PARAMETER );
         return FALSE;
     }
-    if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size )))
-    {
-        SetLastError( ERROR_NOT_ENOUGH_MEMORY );
-        return FALSE;
-    }
 
     TRACE("%s -> %s, %lx\n", debugstr_w(source), debugstr_w(dest), flags);
 
-    if ((h1 = CreateFileW( source, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+    if (flags & COPY_FILE_OPEN_SOURCE_FOR_WRITE) access |= GENERIC_WRITE;
+    if ((h1 = CreateFileW( source, access, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
                            NULL, OPEN_EXISTING, 0, 0 )) == INVALID_HANDLE_VALUE)
     {
         WARN("Unable to open source %s\n", debugstr_w(source));
-        HeapFree( GetProcessHeap(), 0, buffer );
         return FALSE;
     }
 
-    if (!set_ntstatus( NtQueryInformationFile( h1, &io, &info, sizeof(info), FileBasicInformation )))
+    if (!set_ntstatus( NtQueryInformationFile( h1, &io, &info, sizeof(info), FileBasicInformation )) ||
+        !set_ntstatus( NtQueryInformationFile( h1, &io, &std_info, sizeof(std_info), FileStandardInformation )))
     {
         WARN("GetFileInformationByHandle returned error for %s\n", debugstr_w(source));
-        HeapFree( GetProcessHeap(), 0, buffer );
         CloseHandle( h1 );
         return FALSE;
     }
@@ -545,39 +581,95 @@ BOOL WINAPI CopyFileExW( const WCHAR *source, const WCHAR *dest, LPPROGRESS_ROUT
         }
         if (same_file)
         {
-            HeapFree( GetProcessHeap(), 0, buffer );
             CloseHandle( h1 );
             SetLastError( ERROR_SHARING_VIOLATION );
             return FALSE;
         }
     }
 
-    if ((h2 = CreateFileW( dest, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
-                           (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
-                           info.FileAttributes, h1 )) == INVALID_HANDLE_VALUE)
+    /* the destination can only be removed on cancel if other openers allow it */
+    h2 = CreateFileW( dest, GENERIC_WRITE | DELETE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                      (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
+                      info.FileAttributes, h1 );
+    if (h2 == INVALID_HANDLE_VALUE && GetLastError() == ERROR_SHARING_VIOLATION)
+    {
+        can_delete = FALSE;
+        h2 = CreateFileW( dest, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                          (flags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
+                          info.FileAttributes, h1 );
+    }
+    if (h2 == INVALID_HANDLE_VALUE)
     {
         WARN("Unable to open dest %s\n", debugstr_w(dest));
-        HeapFree( GetProcessHeap(), 0, buffer );
         CloseHandle( h1 );
         return FALSE;
     }
 
-    while (ReadFile( h1, buffer, buffer_size, &count, NULL ) && count)
+    transferred.QuadPart = 0;
+    if (!copy_file_progress( &progress, param, cancel_ptr, std_info.EndOfFile, transferred,
+                             CALLBACK_STREAM_SWITCH, h1, h2, &delete_dest ))
+        goto done;
+
+    /* let the file system share or copy the data without bouncing it through our buffer */
+    while (transferred.QuadPart < std_info.EndOfFile.QuadPart)
     {
-        char *p = buffer;
-        while (count != 0)
+        count = min( std_info.EndOfFile.QuadPart - transferred.QuadPart, chunk_size );
+        if ((status = __wine_copy_file_range( h1, h2, transferred.QuadPart, count ))) break;
+
+        transferred.QuadPart += count;
+        if (!copy_file_progress( &progress, param, cancel_ptr, std_info.EndOfFile, transferred,
+                                 CALLBACK_CHUNK_FINISHED, h1, h2, &delete_dest ))
+            goto done;
+    }
+
+    if (status)
+    {
+        if (status != STATUS_NOT_SUPPORTED && status != STATUS_END_OF_FILE)
+        {
+            SetLastError( RtlNtStatusToDosError( status ));
+            goto done;
+        }
+        TRACE("falling back to a buffered copy at %s\n", wine_dbgstr_longlong( transferred.QuadPart ));
+
+        if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size )))
+        {
+            SetLastError( ERROR_NOT_ENOUGH_MEMORY );
+            goto done;
+        }
+        if (!SetFilePointerEx( h1, transferred, NULL, FILE_BEGIN ) ||
+            !SetFilePointerEx( h2, transferred, NULL, FILE_BEGIN ))
+            goto done;
+
+        while (ReadFile( h1, buffer, buffer_size, &count, NULL ) && count)
         {
-            DWORD res;
-            if (!WriteFile( h2, p, count, &res, NULL ) || !res) goto done;
-            p += res;
-            count -= res;
+            char *p = buffer;
+
+            transferred.QuadPart += count;
+            while (count != 0)
+            {
+                DWORD res;
+                if (!WriteFile( h2, p, count, &res, NULL ) || !res) goto done;
+                p += res;
+                count -= res;
+            }
+            if (!copy_file_progress( &progress, param, cancel_ptr, std_info.EndOfFile, transferred,
+                                     CALLBACK_CHUNK_FINISHED, h1, h2, &delete_dest ))
+                goto done;
         }
     }
     ret =  TRUE;
 done:
-    /* Maintain the timestamp of source file to destination file */
-    info.FileAttributes = 0;
-    NtSetInformationFile( h2, &io, &info, sizeof(info), FileBasicInformation );
+    if (delete_dest && can_delete)
+    {
+        disposition.DoDeleteFile = TRUE;
+        NtSetInformationFile( h2, &io, &disposition, sizeof(disposition), FileDispositionInformation );
+    }
+    else
+    {
+        /* Maintain the timestamp of source file to destination file */
+        info.FileAttributes = 0;
+        NtSetInformationFile( h2, &io, &info, sizeof(info), FileBasicInformation );
+    }
     HeapFree( GetProcessHeap(), 0, buffer );
     CloseHandle( h1 );
     CloseHandle( h2 );
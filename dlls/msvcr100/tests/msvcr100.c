@@ -230,6 +230,7 @@ static Scheduler* (__cdecl *p_Scheduler_Create)(SchedulerPolicy*);
 static Scheduler* (__cdecl *p_CurrentScheduler_Get)(void);
 static void (__cdecl *p_CurrentScheduler_Detach)(void);
 static unsigned int (__cdecl *p_CurrentScheduler_Id)(void);
+static void (__cdecl *p_CurrentScheduler_ScheduleTask)(void (__cdecl*)(void*), void*);
 
 static int (__cdecl *p__memicmp)(const char*, const char*, size_t);
 static int (__cdecl *p__memicmp_l)(const char*, const char*, size_t,_locale_t);
@@ -318,6 +319,7 @@ static BOOL init(void)
         SET(p_SchedulerPolicy_dtor, "??1SchedulerPolicy@Concurrency@@QEAA@XZ");
         SET(p_Scheduler_Create, "?Create@Scheduler@Concurrency@@SAPEAV12@AEBVSchedulerPolicy@2@@Z");
         SET(p_CurrentScheduler_Get, "?Get@CurrentScheduler@Concurrency@@SAPEAVScheduler@2@XZ");
+        SET(p_CurrentScheduler_ScheduleTask, "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPEAX@Z0@Z");
     } else {
         SET(pSpinWait_ctor_yield, "??0?$_SpinWait@$00@details@Concurrency@@QAE@P6AXXZ@Z");
         SET(pSpinWait_dtor, "??_F?$_SpinWait@$00@details@Concurrency@@QAEXXZ");
@@ -359,6 +361,7 @@ static BOOL init(void)
         SET(p_SchedulerPolicy_dtor, "??1SchedulerPolicy@Concurrency@@QAE@XZ");
         SET(p_Scheduler_Create, "?Create@Scheduler@Concurrency@@SAPAV12@ABVSchedulerPolicy@2@@Z");
         SET(p_CurrentScheduler_Get, "?Get@CurrentScheduler@Concurrency@@SAPAVScheduler@2@XZ");
+        SET(p_CurrentScheduler_ScheduleTask, "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPAX@Z0@Z");
     }
 
     init_thiscall_thunk();
@@ -989,6 +992,127 @@ static void test_Scheduler(void)
     call_func1(p_SchedulerPolicy_dtor, &policy);
 }
 
+struct parallel_for
+{
+    LONG pending;
+    HANDLE done;
+    unsigned int chunk;
+    unsigned int *results;
+};
+
+struct parallel_for_range
+{
+    struct parallel_for *pf;
+    unsigned int begin;
+    unsigned int end;
+};
+
+static unsigned int parallel_for_item(unsigned int i)
+{
+    unsigned int j, ret = i;
+
+    for(j=0; j<64; j++)
+        ret = ret * 1103515245 + 12345;
+    return ret;
+}
+
+static void __cdecl parallel_for_task(void *arg)
+{
+    struct parallel_for_range *range = arg, *split;
+    struct parallel_for *pf = range->pf;
+    unsigned int i;
+
+    /* split the range like parallel_for does, so idle virtual processors can steal the halves */
+    while(range->end - range->begin > pf->chunk) {
+        split = HeapAlloc(GetProcessHeap(), 0, sizeof(*split));
+        split->pf = pf;
+        split->begin = (range->begin + range->end) / 2;
+        split->end = range->end;
+        range->end = split->begin;
+        InterlockedIncrement(&pf->pending);
+        p_CurrentScheduler_ScheduleTask(parallel_for_task, split);
+    }
+
+    for(i=range->begin; i<range->end; i++)
+        pf->results[i] = parallel_for_item(i);
+
+    HeapFree(GetProcessHeap(), 0, range);
+    if(!InterlockedDecrement(&pf->pending))
+        SetEvent(pf->done);
+}
+
+static void __cdecl wait_event_task(void *arg)
+{
+    HANDLE *events = arg;
+
+    /* the other task only runs if a worker is started while this one is busy */
+    if(WaitForSingleObject(events[0], 5000) == WAIT_OBJECT_0)
+        SetEvent(events[1]);
+}
+
+static void __cdecl set_event_task(void *arg)
+{
+    SetEvent(arg);
+}
+
+static void test_CurrentScheduler_ScheduleTask(void)
+{
+    unsigned int count = winetest_interactive ? 1 << 22 : 1 << 16;
+    LARGE_INTEGER freq, start, end, serial_start, serial_end;
+    struct parallel_for_range *range;
+    struct parallel_for pf;
+    Scheduler *scheduler;
+    unsigned int i, errors = 0;
+    HANDLE events[2];
+    DWORD ret;
+
+    pf.pending = 1;
+    pf.done = CreateEventW(NULL, TRUE, FALSE, NULL);
+    pf.chunk = 1024;
+    pf.results = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, count * sizeof(*pf.results));
+    range = HeapAlloc(GetProcessHeap(), 0, sizeof(*range));
+    range->pf = &pf;
+    range->begin = 0;
+    range->end = count;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    p_CurrentScheduler_ScheduleTask(parallel_for_task, range);
+    ret = WaitForSingleObject(pf.done, 30000);
+    QueryPerformanceCounter(&end);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", ret);
+    ok(!pf.pending, "%ld tasks still pending\n", pf.pending);
+
+    /* checking the results serially gives the single threaded baseline */
+    QueryPerformanceCounter(&serial_start);
+    for(i=0; i<count; i++)
+        if(pf.results[i] != parallel_for_item(i)) errors++;
+    QueryPerformanceCounter(&serial_end);
+    ok(!errors, "%u items were not computed correctly\n", errors);
+
+    scheduler = p_CurrentScheduler_Get();
+    trace("%u virtual processors: %.1f ms scheduled, %.1f ms serial\n",
+            (unsigned int)call_func1(scheduler->vtable->GetNumberOfVirtualProcessors, scheduler),
+            (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart,
+            (serial_end.QuadPart - serial_start.QuadPart) * 1000.0 / freq.QuadPart);
+
+    HeapFree(GetProcessHeap(), 0, pf.results);
+    CloseHandle(pf.done);
+
+    if((unsigned int)call_func1(scheduler->vtable->GetNumberOfVirtualProcessors, scheduler) < 2) {
+        skip("a single virtual processor can't run dependent tasks\n");
+        return;
+    }
+    events[0] = CreateEventW(NULL, TRUE, FALSE, NULL);
+    events[1] = CreateEventW(NULL, TRUE, FALSE, NULL);
+    p_CurrentScheduler_ScheduleTask(wait_event_task, events);
+    p_CurrentScheduler_ScheduleTask(set_event_task, events[0]);
+    ret = WaitForSingleObject(events[1], 10000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %lu\n", ret);
+    CloseHandle(events[0]);
+    CloseHandle(events[1]);
+}
+
 static void test__memicmp(void)
 {
     static const char *s1 = "abc";
@@ -1113,6 +1237,7 @@ START_TEST(msvcr100)
 
     test_ExternalContextBase();
     test_Scheduler();
+    test_CurrentScheduler_ScheduleTask();
     test_wmemcpy_s();
     test_wmemmove_s();
     test_fread_s();
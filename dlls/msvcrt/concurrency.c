@@ -89,11 +89,17 @@ struct scheduler_list {
     struct scheduler_list *next;
 };
 
+struct ThreadScheduler;
+
 typedef struct {
     Context context;
     struct scheduler_list scheduler;
     unsigned int id;
     union allocator_cache_entry *allocator_cache[8];
+    struct ThreadScheduler *worker_scheduler;
+    unsigned int vproc;
+    unsigned int oversubscribed;
+    LONG blocked;
 } ExternalContextBase;
 extern const vtable_ptr ExternalContextBase_vtable;
 static void ExternalContextBase_ctor(ExternalContextBase*);
@@ -125,7 +131,22 @@ typedef struct Scheduler {
         void, (Scheduler*,void (__cdecl*)(void*),void*), (this,proc,data))
 #endif
 
-typedef struct {
+struct scheduled_task {
+    void (__cdecl *proc)(void*);
+    void *data;
+};
+
+/* Tasks of a virtual processor, its worker pops from the tail
+ * while idle workers steal from the head. */
+struct scheduler_queue {
+    SRWLOCK lock;
+    struct scheduled_task *tasks;
+    unsigned int size;
+    unsigned int head;
+    unsigned int count;
+};
+
+typedef struct ThreadScheduler {
     Scheduler scheduler;
     LONG ref;
     unsigned int id;
@@ -135,6 +156,12 @@ typedef struct {
     int shutdown_size;
     HANDLE *shutdown_events;
     CRITICAL_SECTION cs;
+    struct scheduler_queue *queues;
+    LONG next_vproc;
+    LONG queued;
+    LONG workers;
+    LONG idle_workers;
+    LONG oversubscribed;
 } ThreadScheduler;
 extern const vtable_ptr ThreadScheduler_vtable;
 
@@ -362,6 +389,12 @@ static ThreadScheduler *default_scheduler;
 static HANDLE keyed_event;
 
 static void create_default_scheduler(void);
+static void context_oversubscribe(ExternalContextBase*, BOOL);
+static void __cdecl spin_wait_yield(void);
+SpinWait* __thiscall SpinWait_ctor(SpinWait*, yield_func);
+void __thiscall SpinWait_dtor(SpinWait*);
+void __thiscall SpinWait__Reset(SpinWait*);
+bool __thiscall SpinWait__SpinOnce(SpinWait*);
 
 /* ??0improper_lock@Concurrency@@QAE@PBD@Z */
 /* ??0improper_lock@Concurrency@@QEAA@PEBD@Z */
@@ -627,10 +660,9 @@ static BOOL WINAPI init_context_tls_index(INIT_ONCE *once, void *param, void **c
     return context_tls_index != TLS_OUT_OF_INDEXES;
 }
 
-static Context* get_current_context(void)
+static void init_context_tls(void)
 {
     static INIT_ONCE init_once = INIT_ONCE_STATIC_INIT;
-    Context *ret;
 
     if(!InitOnceExecuteOnce(&init_once, init_context_tls_index, NULL, NULL))
     {
@@ -639,7 +671,13 @@ static Context* get_current_context(void)
                 HRESULT_FROM_WIN32(GetLastError()));
         _CxxThrowException(&e, &scheduler_resource_allocation_error_exception_type);
     }
+}
 
+static Context* get_current_context(void)
+{
+    Context *ret;
+
+    init_context_tls();
     ret = TlsGetValue(context_tls_index);
     if (!ret) {
         ExternalContextBase *context = operator_new(sizeof(ExternalContextBase));
@@ -650,6 +688,27 @@ static Context* get_current_context(void)
     return ret;
 }
 
+/* returns the context of the current thread if it's a scheduler worker */
+static ExternalContextBase* try_get_worker_context(void)
+{
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+
+    if (!context || context->context.vtable != &ExternalContextBase_vtable)
+        return NULL;
+    return context->worker_scheduler ? context : NULL;
+}
+
+static void init_keyed_event(void)
+{
+    if(!keyed_event) {
+        HANDLE event;
+
+        NtCreateKeyedEvent(&event, GENERIC_READ|GENERIC_WRITE, NULL, 0);
+        if(InterlockedCompareExchangePointer(&keyed_event, event, NULL) != NULL)
+            NtClose(event);
+    }
+}
+
 static Scheduler* try_get_current_scheduler(void)
 {
     ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
@@ -694,20 +753,36 @@ unsigned int __cdecl Context_Id(void)
 /* ?Block@Context@Concurrency@@SAXXZ */
 void __cdecl Context_Block(void)
 {
-    FIXME("()\n");
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+
+    TRACE("()\n");
+
+    if (context->context.vtable != &ExternalContextBase_vtable) {
+        ERR("unknown context set\n");
+        return;
+    }
+
+    init_keyed_event();
+    if (InterlockedDecrement(&context->blocked) < 0) {
+        context_oversubscribe(context, TRUE);
+        NtWaitForKeyedEvent(keyed_event, &context->blocked, 0, NULL);
+        context_oversubscribe(context, FALSE);
+    }
 }
 
 /* ?Yield@Context@Concurrency@@SAXXZ */
 /* ?_Yield@_Context@details@Concurrency@@SAXXZ */
 void __cdecl Context_Yield(void)
 {
-    FIXME("()\n");
+    TRACE("()\n");
+    SwitchToThread();
 }
 
 /* ?_SpinYield@Context@Concurrency@@SAXXZ */
 void __cdecl Context__SpinYield(void)
 {
-    FIXME("()\n");
+    TRACE("()\n");
+    SwitchToThread();
 }
 
 /* ?IsCurrentTaskCollectionCanceling@Context@Concurrency@@SA_NXZ */
@@ -720,7 +795,15 @@ bool __cdecl Context_IsCurrentTaskCollectionCanceling(void)
 /* ?Oversubscribe@Context@Concurrency@@SAX_N@Z */
 void __cdecl Context_Oversubscribe(bool begin)
 {
-    FIXME("(%x)\n", begin);
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+
+    TRACE("(%x)\n", begin);
+
+    if (context->context.vtable != &ExternalContextBase_vtable) {
+        ERR("unknown context set\n");
+        return;
+    }
+    context_oversubscribe(context, begin);
 }
 
 /* ?ScheduleGroupId@Context@Concurrency@@SAIXZ */
@@ -759,8 +842,8 @@ unsigned int __thiscall ExternalContextBase_GetId(const ExternalContextBase *thi
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetVirtualProcessorId, 4)
 unsigned int __thiscall ExternalContextBase_GetVirtualProcessorId(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return -1;
+    TRACE("(%p)->()\n", this);
+    return this->vproc;
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetScheduleGroupId, 4)
@@ -773,7 +856,11 @@ unsigned int __thiscall ExternalContextBase_GetScheduleGroupId(const ExternalCon
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_Unblock, 4)
 void __thiscall ExternalContextBase_Unblock(ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
+    TRACE("(%p)->()\n", this);
+
+    init_keyed_event();
+    if (!InterlockedIncrement(&this->blocked))
+        NtReleaseKeyedEvent(keyed_event, &this->blocked, 0, NULL);
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_IsSynchronouslyBlocked, 4)
@@ -835,6 +922,7 @@ static void ExternalContextBase_ctor(ExternalContextBase *this)
     memset(this, 0, sizeof(*this));
     this->context.vtable = &ExternalContextBase_vtable;
     this->id = InterlockedIncrement(&context_id);
+    this->vproc = -1;
 
     create_default_scheduler();
     this->scheduler.scheduler = &default_scheduler->scheduler;
@@ -1105,6 +1193,11 @@ static void ThreadScheduler_dtor(ThreadScheduler *this)
     if(this->ref != 0) WARN("ref = %ld\n", this->ref);
     SchedulerPolicy_dtor(&this->policy);
 
+    if(this->queued) WARN("%ld tasks were not run\n", this->queued);
+    for(i=0; i<this->virt_proc_no; i++)
+        free(this->queues[i].tasks);
+    operator_delete(this->queues);
+
     for(i=0; i<this->shutdown_count; i++)
         SetEvent(this->shutdown_events[i]);
     operator_delete(this->shutdown_events);
@@ -1220,18 +1313,203 @@ DEFINE_THISCALL_WRAPPER(ThreadScheduler_CreateScheduleGroup, 4)
     return NULL;
 }
 
-DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
-void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
-        void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
+static BOOL scheduler_queue_push(struct scheduler_queue *queue, const struct scheduled_task *task)
+{
+    AcquireSRWLockExclusive(&queue->lock);
+    if(queue->count == queue->size) {
+        unsigned int i, size = queue->size ? queue->size * 2 : 16;
+        struct scheduled_task *tasks = malloc(size * sizeof(*tasks));
+
+        if(!tasks) {
+            ReleaseSRWLockExclusive(&queue->lock);
+            return FALSE;
+        }
+        for(i=0; i<queue->count; i++)
+            tasks[i] = queue->tasks[(queue->head + i) & (queue->size - 1)];
+        free(queue->tasks);
+        queue->tasks = tasks;
+        queue->size = size;
+        queue->head = 0;
+    }
+    queue->tasks[(queue->head + queue->count++) & (queue->size - 1)] = *task;
+    ReleaseSRWLockExclusive(&queue->lock);
+    return TRUE;
+}
+
+static BOOL scheduler_pop_task(ThreadScheduler *this, unsigned int vproc, struct scheduled_task *task)
+{
+    struct scheduler_queue *queue = &this->queues[vproc];
+    unsigned int i;
+
+    /* run the most recently queued task first, its data is most likely still in cache */
+    AcquireSRWLockExclusive(&queue->lock);
+    if(queue->count) {
+        *task = queue->tasks[(queue->head + --queue->count) & (queue->size - 1)];
+        ReleaseSRWLockExclusive(&queue->lock);
+        InterlockedDecrement(&this->queued);
+        return TRUE;
+    }
+    ReleaseSRWLockExclusive(&queue->lock);
+
+    /* otherwise steal the oldest task of another virtual processor */
+    for(i=1; i<this->virt_proc_no; i++) {
+        queue = &this->queues[(vproc + i) % this->virt_proc_no];
+        if(!queue->count) continue;
+
+        AcquireSRWLockExclusive(&queue->lock);
+        if(queue->count) {
+            *task = queue->tasks[queue->head];
+            queue->head = (queue->head + 1) & (queue->size - 1);
+            queue->count--;
+            ReleaseSRWLockExclusive(&queue->lock);
+            InterlockedDecrement(&this->queued);
+            return TRUE;
+        }
+        ReleaseSRWLockExclusive(&queue->lock);
+    }
+    return FALSE;
+}
+
+/* Don't start more workers than there are virtual processors (plus the ones
+ * given up by blocked contexts), or than needed to pick up the queued tasks
+ * besides the idle workers. Busy workers don't count, their task may be
+ * waiting for a queued one. */
+static BOOL scheduler_claim_worker(ThreadScheduler *this)
+{
+    LONG workers;
+
+    while((workers = this->workers) < this->virt_proc_no + this->oversubscribed
+            && this->idle_workers < this->queued) {
+        if(InterlockedCompareExchange(&this->workers, workers + 1, workers) == workers) {
+            InterlockedIncrement(&this->idle_workers);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void CALLBACK scheduler_worker(TP_CALLBACK_INSTANCE *instance, void *arg)
+{
+    ThreadScheduler *this = arg;
+    ExternalContextBase *context;
+    struct scheduled_task task;
+    Context *prev_context;
+    SpinWait sw;
+
+    context = operator_new(sizeof(*context));
+    memset(context, 0, sizeof(*context));
+    context->context.vtable = &ExternalContextBase_vtable;
+    context->id = InterlockedIncrement(&context_id);
+    /* the context takes over the reference held for the worker */
+    context->scheduler.scheduler = &this->scheduler;
+    context->worker_scheduler = this;
+    context->vproc = (unsigned int)InterlockedIncrement(&this->next_vproc) % this->virt_proc_no;
+
+    prev_context = TlsGetValue(context_tls_index);
+    TlsSetValue(context_tls_index, context);
+
+    TRACE("(%p) worker %p started on virtual processor %u\n", this, context, context->vproc);
+
+    SpinWait_ctor(&sw, &spin_wait_yield);
+    for(;;) {
+        /* count ourselves busy before taking a task, so that a task queued in
+         * the meantime starts another worker if all the others are busy too */
+        InterlockedDecrement(&this->idle_workers);
+        while(scheduler_pop_task(this, context->vproc, &task))
+            task.proc(task.data);
+        InterlockedIncrement(&this->idle_workers);
+
+        /* spin for a while before giving the thread back to the pool */
+        SpinWait__Reset(&sw);
+        while(!this->queued && SpinWait__SpinOnce(&sw));
+        if(this->queued) continue;
+
+        /* a task queued after the decrement sees the worker gone and starts a new one */
+        InterlockedDecrement(&this->idle_workers);
+        InterlockedDecrement(&this->workers);
+        if(!this->queued || !scheduler_claim_worker(this)) break;
+    }
+    SpinWait_dtor(&sw);
+
+    TRACE("(%p) worker %p exiting\n", this, context);
+
+    TlsSetValue(context_tls_index, prev_context);
+    call_Context_dtor(&context->context, 1);
+}
+
+static void scheduler_add_worker(ThreadScheduler *this)
 {
-    FIXME("(%p %p %p %p) stub\n", this, proc, data, placement);
+    if(!scheduler_claim_worker(this))
+        return;
+
+    ThreadScheduler_Reference(this);
+    if(!TrySubmitThreadpoolCallback(scheduler_worker, this, NULL)) {
+        ERR("failed to start worker: %lu\n", GetLastError());
+        InterlockedDecrement(&this->idle_workers);
+        InterlockedDecrement(&this->workers);
+        ThreadScheduler_Release(this);
+    }
+}
+
+/* Lets the scheduler start another worker while the worker running on the
+ * current context's virtual processor is blocked. */
+static void context_oversubscribe(ExternalContextBase *context, BOOL begin)
+{
+    ThreadScheduler *scheduler = context->worker_scheduler;
+
+    /* external contexts don't occupy a virtual processor */
+    if(!scheduler)
+        return;
+
+    if(begin) {
+        if(context->oversubscribed++)
+            return;
+        InterlockedIncrement(&scheduler->oversubscribed);
+        scheduler_add_worker(scheduler);
+    }else if(context->oversubscribed && !--context->oversubscribed) {
+        InterlockedDecrement(&scheduler->oversubscribed);
+    }
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask, 12)
 void __thiscall ThreadScheduler_ScheduleTask(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data)
 {
-    FIXME("(%p %p %p) stub\n", this, proc, data);
+    ExternalContextBase *context = try_get_worker_context();
+    struct scheduled_task task;
+    unsigned int vproc;
+
+    TRACE("(%p %p %p)\n", this, proc, data);
+
+    task.proc = proc;
+    task.data = data;
+
+    /* tasks created by our workers stay on their virtual processor,
+     * other threads spread them over all of them */
+    if(context && context->worker_scheduler == this)
+        vproc = context->vproc;
+    else
+        vproc = (unsigned int)InterlockedIncrement(&this->next_vproc) % this->virt_proc_no;
+
+    InterlockedIncrement(&this->queued);
+    if(!scheduler_queue_push(&this->queues[vproc], &task)) {
+        scheduler_resource_allocation_error e;
+
+        InterlockedDecrement(&this->queued);
+        scheduler_resource_allocation_error_ctor_name(&e, NULL, E_OUTOFMEMORY);
+        _CxxThrowException(&e, &scheduler_resource_allocation_error_exception_type);
+    }
+    scheduler_add_worker(this);
+}
+
+DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
+void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
+        void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
+{
+    static int once;
+
+    if(!once++) FIXME("(%p %p %p %p) placement ignored\n", this, proc, data, placement);
+    ThreadScheduler_ScheduleTask(this, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_IsAvailableLocation, 8)
@@ -1265,6 +1543,7 @@ Scheduler* __thiscall ThreadScheduler_vector_dtor(ThreadScheduler *this, unsigne
 static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
         const SchedulerPolicy *policy)
 {
+    unsigned int min_concurrency;
     SYSTEM_INFO si;
 
     TRACE("(%p)->()\n", this);
@@ -1278,10 +1557,20 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
     this->virt_proc_no = SchedulerPolicy_GetPolicyValue(&this->policy, MaxConcurrency);
     if(this->virt_proc_no > si.dwNumberOfProcessors)
         this->virt_proc_no = si.dwNumberOfProcessors;
+    min_concurrency = SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency);
+    if(min_concurrency != -1 && this->virt_proc_no < min_concurrency)
+        this->virt_proc_no = min_concurrency;
 
     this->shutdown_count = this->shutdown_size = 0;
     this->shutdown_events = NULL;
 
+    /* workers install their context in TLS */
+    init_context_tls();
+    this->queues = operator_new(this->virt_proc_no * sizeof(*this->queues));
+    memset(this->queues, 0, this->virt_proc_no * sizeof(*this->queues));
+    this->next_vproc = -1;
+    this->queued = this->workers = this->idle_workers = this->oversubscribed = 0;
+
     InitializeCriticalSection(&this->cs);
     this->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler");
     return this;
@@ -1713,13 +2002,7 @@ critical_section* __thiscall critical_section_ctor(critical_section *this)
 {
     TRACE("(%p)\n", this);
 
-    if(!keyed_event) {
-        HANDLE event;
-
-        NtCreateKeyedEvent(&event, GENERIC_READ|GENERIC_WRITE, NULL, 0);
-        if(InterlockedCompareExchangePointer(&keyed_event, event, NULL) != NULL)
-            NtClose(event);
-    }
+    init_keyed_event();
 
     this->unk_thread_id = 0;
     this->head = this->tail = NULL;
@@ -1772,8 +2055,12 @@ static inline void cs_lock(critical_section *cs, cs_queue *q)
     memset(q, 0, sizeof(*q));
     last = InterlockedExchangePointer(&cs->tail, q);
     if(last) {
+        ExternalContextBase *context = try_get_worker_context();
+
         last->next = q;
+        if(context) context_oversubscribe(context, TRUE);
         NtWaitForKeyedEvent(keyed_event, q, 0, NULL);
+        if(context) context_oversubscribe(context, FALSE);
     }
 
     cs_set_head(cs, q);
@@ -2116,6 +2403,7 @@ static inline int evt_transition(void **state, void *from, void *to)
 
 static size_t evt_wait(thread_wait *wait, event **events, int count, bool wait_all, unsigned int timeout)
 {
+    ExternalContextBase *context;
     int i;
     NTSTATUS status;
     LARGE_INTEGER ntto;
@@ -2144,7 +2432,10 @@ static size_t evt_wait(thread_wait *wait, event **events, int count, bool wait_a
     if(!evt_transition(&wait->signaled, EVT_RUNNING, EVT_WAITING))
         return evt_end_wait(wait, events, count);
 
+    context = try_get_worker_context();
+    if(context) context_oversubscribe(context, TRUE);
     status = NtWaitForKeyedEvent(keyed_event, wait, 0, evt_timeout(&ntto, timeout));
+    if(context) context_oversubscribe(context, FALSE);
 
     if(status && !evt_transition(&wait->signaled, EVT_WAITING, EVT_RUNNING))
         NtWaitForKeyedEvent(keyed_event, wait, 0, NULL);
@@ -2428,13 +2719,7 @@ reader_writer_lock* __thiscall reader_writer_lock_ctor(reader_writer_lock *this)
 {
     TRACE("(%p)\n", this);
 
-    if (!keyed_event) {
-        HANDLE event;
-
-        NtCreateKeyedEvent(&event, GENERIC_READ|GENERIC_WRITE, NULL, 0);
-        if (InterlockedCompareExchangePointer(&keyed_event, event, NULL) != NULL)
-            NtClose(event);
-    }
+    init_keyed_event();
 
     memset(this, 0, sizeof(*this));
     return this;
@@ -76,6 +76,7 @@ typedef struct
 /* Value for arena 'magic' field */
 #define ARENA_INUSE_MAGIC      0x455355
 #define ARENA_PENDING_MAGIC    0xbedead
+#define ARENA_CACHED_MAGIC     0x48464c  /* block sitting in a LFH cache */
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
 
@@ -119,6 +120,26 @@ static const SIZE_T HEAP_freeListSizes[] =
 };
 #define HEAP_NB_FREE_LISTS (ARRAY_SIZE( HEAP_freeListSizes ) + HEAP_NB_SMALL_FREE_LISTS)
 
+/* HeapCompatibilityInformation values */
+#define HEAP_STD  0
+#define HEAP_LAL  1
+#define HEAP_LFH  2
+
+/* Low-fragmentation heap front end: freed small blocks are kept in per size
+ * class caches that allocations pop without taking the heap lock, with several
+ * affinity slots per size class so that threads don't all hit the same list head. */
+
+/* largest block size served by the LFH caches */
+#define HEAP_LFH_MAX_SIZE      ROUND_SIZE(0x400)
+/* there is one size class for every arena size up to HEAP_LFH_MAX_SIZE */
+#define HEAP_LFH_NB_BINS       ((HEAP_LFH_MAX_SIZE - HEAP_MIN_DATA_SIZE) / ALIGNMENT + 1)
+/* number of thread affinity slots for each size class */
+#define HEAP_LFH_NB_SLOTS      8
+/* maximum number of blocks kept in a single cache slot */
+#define HEAP_LFH_MAX_DEPTH     64
+/* number of blocks carved at once when a cache slot is empty */
+#define HEAP_LFH_BATCH_SIZE    8
+
 typedef union
 {
     ARENA_FREE  arena;
@@ -163,6 +184,8 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    DWORD            compat_info;   /* HeapCompatibilityInformation value */
+    SLIST_HEADER    *lfh_slots;     /* LFH block caches, HEAP_LFH_NB_BINS per affinity slot */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -177,6 +200,10 @@ typedef struct tagHEAP
 #define HEAP_VALIDATE_ALL     0x20000000
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
+/* heap flags that prevent the LFH caches from being used */
+#define HEAP_LFH_DISABLE_FLAGS (HEAP_NO_SERIALIZE | HEAP_PAGE_ALLOCS | HEAP_VALIDATE | \
+                                HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED)
+
 static HEAP *processHeap;  /* main process heap */
 
 static BOOL HEAP_IsRealArena( HEAP *heapPtr, DWORD flags, LPCVOID block, BOOL quiet );
@@ -295,7 +322,8 @@ static void subheap_notify_free_all(SUBHEAP const *subheap)
         {
             ARENA_INUSE const *pArena = (ARENA_INUSE const *)ptr;
             if (pArena->magic == ARENA_INUSE_MAGIC) notify_free(pArena + 1);
-            else if (pArena->magic != ARENA_PENDING_MAGIC) ERR("bad inuse_magic @%p\n", pArena);
+            else if (pArena->magic != ARENA_PENDING_MAGIC && pArena->magic != ARENA_CACHED_MAGIC)
+                ERR("bad inuse_magic @%p\n", pArena);
             ptr += sizeof(*pArena) + (pArena->size & ARENA_SIZE_MASK);
         }
     }
@@ -386,7 +414,8 @@ static void HEAP_Dump( HEAP *heap )
             {
                 ARENA_INUSE *pArena = (ARENA_INUSE *)ptr;
                 TRACE( "%p %08x %s %08x\n",
-                         pArena, pArena->magic, pArena->magic == ARENA_INUSE_MAGIC ? "used" : "pend",
+                         pArena, pArena->magic, pArena->magic == ARENA_INUSE_MAGIC ? "used" :
+                         pArena->magic == ARENA_CACHED_MAGIC ? "lfh " : "pend",
                          pArena->size & ARENA_SIZE_MASK );
                 ptr += sizeof(*pArena) + (pArena->size & ARENA_SIZE_MASK);
                 arenaSize += sizeof(ARENA_INUSE);
@@ -1213,7 +1242,8 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
     }
 
     /* Check magic number */
-    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC)
+    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC &&
+        pArena->magic != ARENA_CACHED_MAGIC)
     {
         if (quiet == NOISY) {
             ERR("Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, pArena->magic, pArena );
@@ -1419,7 +1449,7 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
         ret = HEAP_ValidateInUseArena( subheap, arena, QUIET );
     else if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET)
         WARN( "Heap %p: unaligned arena pointer %p\n", subheap->heap, arena );
-    else if (arena->magic == ARENA_PENDING_MAGIC)
+    else if (arena->magic == ARENA_PENDING_MAGIC || arena->magic == ARENA_CACHED_MAGIC)
         WARN( "Heap %p: block %p used after free\n", subheap->heap, arena + 1 );
     else if (arena->magic != ARENA_INUSE_MAGIC)
         WARN( "Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, arena->magic, arena );
@@ -1437,6 +1467,153 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
 }
 
 
+/***********************************************************************
+ *           allocate_block
+ *
+ * Allocate an in-use block from the heap free lists. The heap must be locked.
+ */
+static ARENA_INUSE *allocate_block( HEAP *heap, SIZE_T rounded_size )
+{
+    ARENA_FREE *pArena;
+    ARENA_INUSE *pInUse;
+    SUBHEAP *subheap;
+
+    if (!(pArena = HEAP_FindFreeBlock( heap, rounded_size, &subheap ))) return NULL;
+
+    /* Remove the arena from the free list */
+
+    list_remove( &pArena->entry );
+
+    /* Build the in-use arena */
+
+    pInUse = (ARENA_INUSE *)pArena;
+
+    /* in-use arena is smaller than free arena,
+     * so we have to add the difference to the size */
+    pInUse->size  = (pInUse->size & ~ARENA_FLAG_FREE) + sizeof(ARENA_FREE) - sizeof(ARENA_INUSE);
+    pInUse->magic = ARENA_INUSE_MAGIC;
+
+    /* Shrink the block */
+
+    HEAP_ShrinkBlock( subheap, pInUse, rounded_size );
+    return pInUse;
+}
+
+
+/***********************************************************************
+ *           heap_lfh_slot
+ *
+ * Get the LFH cache used by the current thread for blocks of a given size.
+ */
+static inline SLIST_HEADER *heap_lfh_slot( HEAP *heap, SIZE_T size )
+{
+    ULONG slot = (HandleToULong( NtCurrentTeb()->ClientId.UniqueThread ) >> 2) % HEAP_LFH_NB_SLOTS;
+    return heap->lfh_slots + slot * HEAP_LFH_NB_BINS + (size - HEAP_MIN_DATA_SIZE) / ALIGNMENT;
+}
+
+
+/***********************************************************************
+ *           heap_enable_lfh
+ *
+ * Switch a heap to the low-fragmentation front end. The heap must be locked.
+ */
+static void heap_enable_lfh( HEAP *heap )
+{
+    SLIST_HEADER *slots;
+    unsigned int i;
+
+    heap->compat_info = HEAP_LFH;
+
+    /* debugging checks need to see every allocation and free */
+    if (heap->lfh_slots || (heap->flags & HEAP_LFH_DISABLE_FLAGS) || heap->pending_free) return;
+
+    if (!(slots = RtlAllocateHeap( heap, 0, HEAP_LFH_NB_SLOTS * HEAP_LFH_NB_BINS * sizeof(*slots) )))
+        return;
+    for (i = 0; i < HEAP_LFH_NB_SLOTS * HEAP_LFH_NB_BINS; i++) RtlInitializeSListHead( &slots[i] );
+
+    TRACE( "heap %p: enabling LFH\n", heap );
+    InterlockedExchangePointer( (void **)&heap->lfh_slots, slots );
+}
+
+
+/***********************************************************************
+ *           heap_lfh_alloc
+ *
+ * Lock-free allocation of a block from the LFH caches.
+ */
+static void *heap_lfh_alloc( HEAP *heap, DWORD flags, SIZE_T size, SIZE_T rounded_size )
+{
+    ARENA_INUSE *arena;
+    SLIST_ENTRY *entry;
+
+    if (!(entry = RtlInterlockedPopEntrySList( heap_lfh_slot( heap, rounded_size )))) return NULL;
+
+    arena = (ARENA_INUSE *)entry - 1;
+    arena->magic = ARENA_INUSE_MAGIC;
+    arena->unused_bytes = (arena->size & ARENA_SIZE_MASK) - size;
+
+    notify_alloc( arena + 1, size, flags & HEAP_ZERO_MEMORY );
+    initialize_block( arena + 1, size, arena->unused_bytes, flags );
+    return arena + 1;
+}
+
+
+/***********************************************************************
+ *           heap_lfh_refill
+ *
+ * Carve a batch of blocks into the current thread LFH cache, so that the
+ * next allocations of that size don't need to take the heap lock.
+ * The heap must be locked.
+ */
+static void heap_lfh_refill( HEAP *heap, SIZE_T rounded_size )
+{
+    ARENA_INUSE *arena;
+    SIZE_T size;
+    unsigned int i;
+
+    for (i = 1; i < HEAP_LFH_BATCH_SIZE; i++)
+    {
+        if (!(arena = allocate_block( heap, rounded_size ))) break;
+        size = arena->size & ARENA_SIZE_MASK;
+        arena->unused_bytes = 0;
+        if (size > HEAP_LFH_MAX_SIZE)
+        {
+            HEAP_MakeInUseBlockFree( HEAP_FindSubHeap( heap, arena ), arena );
+            break;
+        }
+        arena->magic = ARENA_CACHED_MAGIC;
+        RtlInterlockedPushEntrySList( heap_lfh_slot( heap, size ), (SLIST_ENTRY *)(arena + 1) );
+    }
+}
+
+
+/***********************************************************************
+ *           heap_lfh_free
+ *
+ * Release a small, already validated block into the LFH caches.
+ * The heap must be locked.
+ *
+ * RETURNS
+ *	TRUE: the block was cached
+ *	FALSE: the block needs to go through the normal free path
+ */
+static BOOL heap_lfh_free( HEAP *heap, ARENA_INUSE *arena )
+{
+    SLIST_HEADER *slot;
+    SIZE_T size;
+
+    size = arena->size & ARENA_SIZE_MASK;
+    if (size > HEAP_LFH_MAX_SIZE) return FALSE;
+
+    slot = heap_lfh_slot( heap, size );
+    if (RtlQueryDepthSList( slot ) >= HEAP_LFH_MAX_DEPTH) return FALSE;
+
+    arena->magic = ARENA_CACHED_MAGIC;
+    RtlInterlockedPushEntrySList( slot, (SLIST_ENTRY *)(arena + 1) );
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           heap_set_debug_flags
  */
@@ -1650,11 +1827,10 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
  */
 void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
 {
-    ARENA_FREE *pArena;
     ARENA_INUSE *pInUse;
-    SUBHEAP *subheap;
     HEAP *heapPtr = HEAP_GetPtr( heap );
     SIZE_T rounded_size;
+    void *ret;
 
     /* Validate the parameters */
 
@@ -1669,11 +1845,18 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (rounded_size <= HEAP_LFH_MAX_SIZE && heapPtr->lfh_slots &&
+        (ret = heap_lfh_alloc( heapPtr, flags, size, rounded_size )))
+    {
+        TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
+        return ret;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
     {
-        void *ret = allocate_large_block( heap, flags, size );
+        ret = allocate_large_block( heap, flags, size );
         if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
         if (!ret && (flags & HEAP_GENERATE_EXCEPTIONS)) RtlRaiseStatus( STATUS_NO_MEMORY );
         TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
@@ -1682,7 +1865,7 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
 
     /* Locate a suitable free block */
 
-    if (!(pArena = HEAP_FindFreeBlock( heapPtr, rounded_size, &subheap )))
+    if (!(pInUse = allocate_block( heapPtr, rounded_size )))
     {
         TRACE("(%p,%08x,%08lx): returning NULL\n",
                   heap, flags, size  );
@@ -1691,22 +1874,8 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
         return NULL;
     }
 
-    /* Remove the arena from the free list */
-
-    list_remove( &pArena->entry );
+    if (rounded_size <= HEAP_LFH_MAX_SIZE && heapPtr->lfh_slots) heap_lfh_refill( heapPtr, rounded_size );
 
-    /* Build the in-use arena */
-
-    pInUse = (ARENA_INUSE *)pArena;
-
-    /* in-use arena is smaller than free arena,
-     * so we have to add the difference to the size */
-    pInUse->size  = (pInUse->size & ~ARENA_FLAG_FREE) + sizeof(ARENA_FREE) - sizeof(ARENA_INUSE);
-    pInUse->magic = ARENA_INUSE_MAGIC;
-
-    /* Shrink the block */
-
-    HEAP_ShrinkBlock( subheap, pInUse, rounded_size );
     pInUse->unused_bytes = (pInUse->size & ARENA_SIZE_MASK) - size;
 
     notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
@@ -1752,18 +1921,19 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *pt
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+    pInUse  = (ARENA_INUSE *)ptr - 1;
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
     notify_free( ptr );
 
     /* Some sanity checks */
-    pInUse  = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
 
     if (!subheap)
         free_large_block( heapPtr, flags, ptr );
-    else
+    else if (!heapPtr->lfh_slots || !heap_lfh_free( heapPtr, pInUse ))
         HEAP_MakeInUseBlockFree( subheap, pInUse );
 
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
@@ -2119,7 +2289,8 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         }
 
         if (((ARENA_INUSE *)ptr - 1)->magic == ARENA_INUSE_MAGIC ||
-            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC)
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC ||
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_CACHED_MAGIC)
         {
             ARENA_INUSE *pArena = (ARENA_INUSE *)ptr - 1;
             ptr += pArena->size & ARENA_SIZE_MASK;
@@ -2167,6 +2338,7 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         entry->lpData = pArena + 1;
         entry->cbData = pArena->size & ARENA_SIZE_MASK;
         entry->cbOverhead = sizeof(ARENA_INUSE);
+        /* blocks sitting in the LFH caches are still allocated from the heap point of view */
         entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC) ?
                         PROCESS_HEAP_UNCOMMITTED_RANGE : PROCESS_HEAP_ENTRY_BUSY;
         /* FIXME: can't handle PROCESS_HEAP_ENTRY_MOVEABLE
@@ -2232,6 +2404,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2240,7 +2414,8 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+        *(ULONG *)info = heapPtr->compat_info;
         return STATUS_SUCCESS;
 
     default:
@@ -2254,6 +2429,34 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class, PVOID info, SIZE_T size)
 {
-    FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
-    return STATUS_SUCCESS;
+    HEAP *heapPtr;
+    ULONG compat_info;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        TRACE("%p %d %p %ld\n", heap, info_class, info, size);
+
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        compat_info = *(ULONG *)info;
+        if (compat_info > HEAP_LFH)
+        {
+            FIXME("HeapCompatibilityInformation %u not implemented\n", compat_info);
+            return STATUS_UNSUCCESSFUL;
+        }
+        /* there are no look-aside lists, and the LFH can't be turned off once enabled */
+        if (compat_info != HEAP_LFH || heapPtr->compat_info == HEAP_LFH) return STATUS_SUCCESS;
+        if (heapPtr->flags & HEAP_NO_SERIALIZE) return STATUS_INVALID_PARAMETER;
+
+        RtlEnterCriticalSection( &heapPtr->critSection );
+        heap_enable_lfh( heapPtr );
+        RtlLeaveCriticalSection( &heapPtr->critSection );
+        return STATUS_SUCCESS;
+
+    default:
+        FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
 }
@@ -128,14 +128,32 @@ struct file_id
 };
 
 /* internal representation of loaded modules */
+struct export_hash_entry
+{
+    DWORD                 hash;          /* hash of the export name */
+    DWORD                 index;         /* index in the names table, plus one */
+};
+
 typedef struct _wine_modref
 {
     LDR_DATA_TABLE_ENTRY  ldr;
     struct file_id        id;
     ULONG                 CheckSum;
     BOOL                  system;
+    struct export_hash_entry *export_hash; /* hash table of export names, built on demand */
+    DWORD                 export_hash_mask;
+    DWORD                 export_hash_names; /* AddressOfNames of the hashed exports */
+    FARPROC              *forwards;      /* resolved forwarded exports, indexed by ordinal */
+    DWORD                 forwards_count;
+    ULONG                 forwards_generation;
 } WINE_MODREF;
 
+/* minimum number of names to use a hash table instead of a binary search */
+#define MIN_EXPORT_HASH_NAMES 32
+
+/* incremented when a module is unloaded, which invalidates the resolved forwards */
+static ULONG forwards_generation;
+
 static UINT tls_module_count;      /* number of modules with TLS directory */
 static IMAGE_TLS_DIRECTORY *tls_dirs;  /* array of TLS directories */
 LIST_ENTRY tls_links = { &tls_links, &tls_links };
@@ -891,6 +909,41 @@ static FARPROC find_forwarded_export( HMODULE module, const char *forward, LPCWS
 }
 
 
+/*************************************************************************
+ *		get_forwards_cache
+ *
+ * Get the modref holding the resolved forwards of a module, allocating the cache if needed.
+ * The loader_section must be locked while calling this function.
+ */
+static WINE_MODREF *get_forwards_cache( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports )
+{
+    WINE_MODREF *wm;
+
+    /* relay and snoop thunks depend on the importing module */
+    if (TRACE_ON(relay) || TRACE_ON(snoop)) return NULL;
+    if (!(wm = get_modref( module ))) return NULL;
+
+    if (wm->forwards && wm->forwards_count == exports->NumberOfFunctions)
+    {
+        if (wm->forwards_generation != forwards_generation)
+        {
+            memset( wm->forwards, 0, wm->forwards_count * sizeof(*wm->forwards) );
+            wm->forwards_generation = forwards_generation;
+        }
+        return wm;
+    }
+
+    RtlFreeHeap( GetProcessHeap(), 0, wm->forwards );
+    wm->forwards_count = 0;
+    if (!(wm->forwards = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                          exports->NumberOfFunctions * sizeof(*wm->forwards) )))
+        return NULL;
+    wm->forwards_count = exports->NumberOfFunctions;
+    wm->forwards_generation = forwards_generation;
+    return wm;
+}
+
+
 /*************************************************************************
  *		find_ordinal_export
  *
@@ -916,7 +969,14 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
     /* if the address falls into the export dir, it's a forward */
     if (((const char *)proc >= (const char *)exports) && 
         ((const char *)proc < (const char *)exports + exp_size))
-        return find_forwarded_export( module, (const char *)proc, load_path );
+    {
+        WINE_MODREF *wm = get_forwards_cache( module, exports );
+
+        if (wm && wm->forwards[ordinal]) return wm->forwards[ordinal];
+        proc = find_forwarded_export( module, (const char *)proc, load_path );
+        if (wm && proc && wm->forwards_generation == forwards_generation) wm->forwards[ordinal] = proc;
+        return proc;
+    }
 
     if (TRACE_ON(snoop))
     {
@@ -955,6 +1015,77 @@ static int find_name_in_exports( HMODULE module, const IMAGE_EXPORT_DIRECTORY *e
 }
 
 
+/*************************************************************************
+ *		hash_export_name
+ */
+static inline DWORD hash_export_name( const char *name )
+{
+    DWORD hash = 2166136261u;
+
+    while (*name) hash = (hash ^ (unsigned char)*name++) * 16777619;
+    return hash;
+}
+
+
+/*************************************************************************
+ *		get_export_hash
+ *
+ * Get the modref holding the export names hash table of a module, building it if needed.
+ * The loader_section must be locked while calling this function.
+ */
+static WINE_MODREF *get_export_hash( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports )
+{
+    const DWORD *names = get_rva( module, exports->AddressOfNames );
+    struct export_hash_entry *table;
+    WINE_MODREF *wm;
+    DWORD i, pos, size = 64;
+
+    if (exports->NumberOfNames < MIN_EXPORT_HASH_NAMES) return NULL;
+    if (!(wm = get_modref( module ))) return NULL;
+    if (wm->export_hash && wm->export_hash_names == exports->AddressOfNames) return wm;
+
+    while (size < exports->NumberOfNames * 2) size *= 2;
+    if (!(table = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(*table) ))) return NULL;
+
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        DWORD hash = hash_export_name( get_rva( module, names[i] ));
+
+        pos = hash & (size - 1);
+        while (table[pos].index) pos = (pos + 1) & (size - 1);
+        table[pos].hash = hash;
+        table[pos].index = i + 1;
+    }
+
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
+    wm->export_hash = table;
+    wm->export_hash_mask = size - 1;
+    wm->export_hash_names = exports->AddressOfNames;
+    return wm;
+}
+
+
+/*************************************************************************
+ *		find_name_in_export_hash
+ *
+ * Helper for find_named_export.
+ */
+static int find_name_in_export_hash( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports, const char *name )
+{
+    const WORD *ordinals = get_rva( wm->ldr.DllBase, exports->AddressOfNameOrdinals );
+    const DWORD *names = get_rva( wm->ldr.DllBase, exports->AddressOfNames );
+    DWORD hash = hash_export_name( name ), pos = hash & wm->export_hash_mask, index;
+
+    while ((index = wm->export_hash[pos].index))
+    {
+        if (wm->export_hash[pos].hash == hash && !strcmp( get_rva( wm->ldr.DllBase, names[index - 1] ), name ))
+            return ordinals[index - 1];
+        pos = (pos + 1) & wm->export_hash_mask;
+    }
+    return -1;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
@@ -966,6 +1097,7 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
 {
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
+    WINE_MODREF *wm;
     int ordinal;
 
     /* first check the hint */
@@ -976,8 +1108,10 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
-    /* then do a binary search */
-    if ((ordinal = find_name_in_exports( module, exports, name )) == -1) return NULL;
+    /* then use the hash table, or a binary search for small export tables */
+    if ((wm = get_export_hash( module, exports ))) ordinal = find_name_in_export_hash( wm, exports, name );
+    else ordinal = find_name_in_exports( module, exports, name );
+    if (ordinal == -1) return NULL;
     return find_ordinal_export( module, exports, exp_size, ordinal, load_path );
 
 }
@@ -3752,7 +3886,10 @@ static void free_modref( WINE_MODREF *wm )
     RtlReleaseActivationContext( wm->ldr.ActivationContext );
     NtUnmapViewOfSection( NtCurrentProcess(), wm->ldr.DllBase );
     if (cached_modref == wm) cached_modref = NULL;
+    forwards_generation++;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->forwards );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
 
@@ -1815,6 +1815,15 @@ NTSTATUS WINAPI RtlGetCompressionWorkSpaceSize(USHORT format, PULONG compress_wo
                 *decompress_workspace = 0x1000;
             return STATUS_SUCCESS;
 
+        case COMPRESSION_FORMAT_XPRESS:
+        case COMPRESSION_FORMAT_XPRESS_HUFF:
+            /* the hash chains and tokens are allocated by RtlCompressBuffer */
+            if (compress_workspace)
+                *compress_workspace = 16;
+            if (decompress_workspace)
+                *decompress_workspace = 0;
+            return STATUS_SUCCESS;
+
         case COMPRESSION_FORMAT_NONE:
         case COMPRESSION_FORMAT_DEFAULT:
             return STATUS_INVALID_PARAMETER;
@@ -1856,6 +1865,544 @@ static NTSTATUS lznt1_compress(UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst
     return STATUS_SUCCESS;
 }
 
+#define XPRESS_BLOCK_SIZE       0x10000
+#define XPRESS_BATCH_BLOCKS     16
+#define XPRESS_HASH_BITS        15
+#define XPRESS_MAX_MATCH        0xffff
+#define XPRESS_MAX_OFFSET       0x2000
+#define XPRESS_HUFF_MAX_OFFSET  0xffff
+#define XPRESS_HUFF_SYMBOLS     512
+#define XPRESS_HUFF_MAX_BITS    15
+
+struct xpress_parser
+{
+    const UCHAR *base;
+    ULONG        end;
+    ULONG        max_offset;
+    ULONG        max_chain;
+    ULONG        nice_len;
+    LONG        *head;
+    LONG        *chain;
+};
+
+/* a block of input, tokens are either a literal byte or length << 16 | offset */
+struct xpress_block
+{
+    ULONG *tokens;
+    ULONG  token_count;
+    UCHAR *out;             /* encoded XPRESS_HUFF block */
+    ULONG  out_size;
+};
+
+struct xpress_compressor
+{
+    const UCHAR *src;
+    ULONG        src_size;
+    ULONG        block_count;
+    ULONG        workspace_size;
+    BOOL         huffman;
+    BOOL         maximum;
+    ULONG        first;     /* first block of the current batch */
+    LONG         count;     /* number of blocks in the current batch */
+    LONG         next;      /* next block of the batch to parse */
+    LONG         pending;   /* thread pool workers still running */
+    struct xpress_block blocks[XPRESS_BATCH_BLOCKS];
+};
+
+struct xpress_huff_leaf
+{
+    ULONG weight;
+    ULONG symbol;
+};
+
+/* XPRESS_HUFF bit stream, 16-bit units are interleaved with the raw length bytes */
+struct xpress_bit_writer
+{
+    UCHAR       *next_bits;
+    UCHAR       *next_bits2;
+    UCHAR       *ptr;
+    ULONG        bits;
+    unsigned int count;
+};
+
+struct xpress_writer
+{
+    UCHAR       *ptr;
+    UCHAR       *end;
+    UCHAR       *flags_ptr;
+    UCHAR       *nibble;
+    ULONG        flags;
+    unsigned int flag_count;
+};
+
+static inline ULONG xpress_hash(const UCHAR *p)
+{
+    return ((p[0] | (p[1] << 8) | (p[2] << 16)) * 0x9e3779b1) >> (32 - XPRESS_HASH_BITS);
+}
+
+static void xpress_insert(struct xpress_parser *parser, ULONG pos)
+{
+    ULONG hash;
+
+    if (pos + 3 > parser->end) return;
+    hash = xpress_hash(parser->base + pos);
+    parser->chain[pos] = parser->head[hash];
+    parser->head[hash] = pos;
+}
+
+/* find the longest match at pos, and insert pos into the hash chains */
+static ULONG xpress_find_match(struct xpress_parser *parser, ULONG pos, ULONG limit, ULONG *offset)
+{
+    const UCHAR *p = parser->base + pos, *q;
+    ULONG len, best_len = 0, chain = parser->max_chain;
+    ULONG max_len = min(limit - pos, XPRESS_MAX_MATCH);
+    LONG match, min_pos = pos > parser->max_offset ? pos - parser->max_offset : 0;
+    ULONG hash;
+
+    if (max_len < 3) return 0;
+
+    hash = xpress_hash(p);
+    match = parser->head[hash];
+    parser->chain[pos] = match;
+    parser->head[hash] = pos;
+
+    while (match >= min_pos && chain--)
+    {
+        q = parser->base + match;
+        if (q[best_len] == p[best_len])
+        {
+            for (len = 0; len < max_len && p[len] == q[len]; len++) ;
+            if (len > best_len)
+            {
+                best_len = len;
+                *offset = pos - match;
+                if (len >= parser->nice_len || len == max_len) break;
+            }
+        }
+        match = parser->chain[match];
+    }
+
+    /* a 3 byte match at offset 1 would be taken for the end of an XPRESS_HUFF stream */
+    if (best_len == 3 && *offset == 1 && parser->max_offset == XPRESS_HUFF_MAX_OFFSET) return 0;
+    return best_len >= 3 ? best_len : 0;
+}
+
+static inline ULONG xpress_huff_symbol(ULONG token)
+{
+    ULONG len = (token >> 16) - 3;
+    DWORD bits;
+
+    if (token < 0x10000) return token;
+    BitScanReverse(&bits, token & 0xffff);
+    return 256 + (bits << 4) + min(len, 15);
+}
+
+static int __cdecl compare_xpress_leaves(const void *a, const void *b)
+{
+    const struct xpress_huff_leaf *leaf_a = a, *leaf_b = b;
+
+    if (leaf_a->weight != leaf_b->weight) return leaf_a->weight < leaf_b->weight ? -1 : 1;
+    return leaf_a->symbol - leaf_b->symbol;
+}
+
+/* build Huffman code lengths of at most XPRESS_HUFF_MAX_BITS bits for the given frequencies */
+static void xpress_make_lengths(const ULONG *freqs, UCHAR *lengths)
+{
+    struct xpress_huff_leaf leaves[XPRESS_HUFF_SYMBOLS];
+    ULONG weights[XPRESS_HUFF_SYMBOLS];
+    USHORT parent[2 * XPRESS_HUFF_SYMBOLS];
+    UCHAR depth[2 * XPRESS_HUFF_SYMBOLS];
+    unsigned int i, k, n, shift, leaf, node, next, child[2], max_depth;
+
+    memset(lengths, 0, XPRESS_HUFF_SYMBOLS);
+    for (i = n = 0; i < XPRESS_HUFF_SYMBOLS; i++) if (freqs[i]) leaves[n++].symbol = i;
+    if (!n) return;
+    if (n == 1)
+    {
+        /* the decoder only accepts complete trees */
+        lengths[leaves[0].symbol] = 1;
+        lengths[leaves[0].symbol ? 0 : 1] = 1;
+        return;
+    }
+
+    for (shift = 0;; shift++)
+    {
+        for (i = 0; i < n; i++) leaves[i].weight = max(freqs[leaves[i].symbol] >> shift, 1);
+        qsort(leaves, n, sizeof(*leaves), compare_xpress_leaves);
+
+        /* leaves are nodes 0 to n - 1, internal nodes are created in order of weight after them */
+        for (leaf = node = next = 0; next < n - 1; next++)
+        {
+            for (k = 0; k < 2; k++)
+            {
+                if (leaf < n && (node == next || leaves[leaf].weight <= weights[node])) child[k] = leaf++;
+                else child[k] = n + node++;
+            }
+            weights[next] = (child[0] < n ? leaves[child[0]].weight : weights[child[0] - n]) +
+                            (child[1] < n ? leaves[child[1]].weight : weights[child[1] - n]);
+            parent[child[0]] = parent[child[1]] = n + next;
+        }
+
+        depth[2 * n - 2] = 0;
+        for (i = 2 * n - 2, max_depth = 0; i--;)
+        {
+            depth[i] = depth[parent[i]] + 1;
+            max_depth = max(max_depth, depth[i]);
+        }
+        if (max_depth <= XPRESS_HUFF_MAX_BITS) break;
+    }
+    for (i = 0; i < n; i++) lengths[leaves[i].symbol] = depth[i];
+}
+
+static void xpress_make_codes(const UCHAR *lengths, USHORT *codes)
+{
+    unsigned int i, bits, code = 0, length_count[XPRESS_HUFF_MAX_BITS + 1] = { 0 };
+    unsigned int next_code[XPRESS_HUFF_MAX_BITS + 1];
+
+    for (i = 0; i < XPRESS_HUFF_SYMBOLS; i++) length_count[lengths[i]]++;
+    length_count[0] = 0;
+    for (bits = 1; bits <= XPRESS_HUFF_MAX_BITS; bits++)
+    {
+        code = (code + length_count[bits - 1]) << 1;
+        next_code[bits] = code;
+    }
+    for (i = 0; i < XPRESS_HUFF_SYMBOLS; i++) if (lengths[i]) codes[i] = next_code[lengths[i]]++;
+}
+
+static void xpress_write_bits(struct xpress_bit_writer *writer, ULONG value, unsigned int count)
+{
+    writer->bits = (writer->bits << count) | value;
+    writer->count += count;
+    if (writer->count > 16)
+    {
+        writer->count -= 16;
+        *(WORD *)writer->next_bits = writer->bits >> writer->count;
+        writer->next_bits = writer->next_bits2;
+        writer->next_bits2 = writer->ptr;
+        writer->ptr += sizeof(WORD);
+    }
+}
+
+/* encode a parsed block as a standalone XPRESS_HUFF block, returns its size */
+static ULONG xpress_huff_encode_block(struct xpress_block *block, BOOL last)
+{
+    ULONG freqs[XPRESS_HUFF_SYMBOLS] = { 0 };
+    UCHAR lengths[XPRESS_HUFF_SYMBOLS];
+    USHORT codes[XPRESS_HUFF_SYMBOLS];
+    struct xpress_bit_writer writer;
+    ULONG i, token, symbol, len, offset;
+    DWORD bits;
+
+    for (i = 0; i < block->token_count; i++) freqs[xpress_huff_symbol(block->tokens[i])]++;
+    if (last) freqs[256]++;
+    xpress_make_lengths(freqs, lengths);
+    xpress_make_codes(lengths, codes);
+
+    for (i = 0; i < XPRESS_HUFF_SYMBOLS / 2; i++)
+        block->out[i] = lengths[2 * i] | (lengths[2 * i + 1] << 4);
+
+    writer.next_bits  = block->out + XPRESS_HUFF_SYMBOLS / 2;
+    writer.next_bits2 = writer.next_bits + sizeof(WORD);
+    writer.ptr        = writer.next_bits2 + sizeof(WORD);
+    writer.bits       = 0;
+    writer.count      = 0;
+
+    for (i = 0; i < block->token_count; i++)
+    {
+        token = block->tokens[i];
+        symbol = xpress_huff_symbol(token);
+        xpress_write_bits(&writer, codes[symbol], lengths[symbol]);
+        if (token < 0x10000) continue;
+
+        len = (token >> 16) - 3;
+        offset = token & 0xffff;
+        if (len >= 15)
+        {
+            if (len - 15 < 0xff) *writer.ptr++ = len - 15;
+            else
+            {
+                *writer.ptr++ = 0xff;
+                *(WORD *)writer.ptr = len;
+                writer.ptr += sizeof(WORD);
+            }
+        }
+        BitScanReverse(&bits, offset);
+        xpress_write_bits(&writer, offset - (1 << bits), bits);
+    }
+    if (last) xpress_write_bits(&writer, codes[256], lengths[256]);
+
+    *(WORD *)writer.next_bits = writer.bits << (16 - writer.count);
+    *(WORD *)writer.next_bits2 = 0;
+    return writer.ptr - block->out;
+}
+
+/* parse a block of the current batch into tokens */
+static void xpress_parse_block(struct xpress_compressor *comp, LONG *workspace, ULONG index)
+{
+    struct xpress_block *block = &comp->blocks[index];
+    ULONG start = (comp->first + index) * XPRESS_BLOCK_SIZE;
+    ULONG size = min(comp->src_size - start, XPRESS_BLOCK_SIZE);
+    ULONG window = comp->huffman ? XPRESS_HUFF_MAX_OFFSET : XPRESS_MAX_OFFSET;
+    ULONG prime = min(start, window);
+    ULONG pos, limit, len, next_len, offset, next_offset, count = 0;
+    struct xpress_parser parser;
+    ULONG *tokens = block->tokens;
+
+    parser.base       = comp->src + start - prime;
+    parser.end        = prime + size;
+    parser.max_offset = window;
+    parser.max_chain  = comp->maximum ? 256 : 16;
+    parser.nice_len   = comp->maximum ? 258 : 32;
+    parser.head       = workspace;
+    parser.chain      = workspace + (1 << XPRESS_HASH_BITS);
+
+    /* prime the hash chains with the preceding window, so that blocks can be parsed independently */
+    memset(parser.head, 0xff, sizeof(LONG) << XPRESS_HASH_BITS);
+    for (pos = 0; pos < prime; pos++) xpress_insert(&parser, pos);
+
+    limit = parser.end;
+    len = xpress_find_match(&parser, pos, limit, &offset);
+    while (pos < limit)
+    {
+        if (len && len < parser.nice_len && pos + 1 < limit)
+        {
+            /* lazy evaluation: emit a literal if the next position has a longer match */
+            next_len = xpress_find_match(&parser, pos + 1, limit, &next_offset);
+            if (next_len > len)
+            {
+                tokens[count++] = parser.base[pos++];
+                len = next_len;
+                offset = next_offset;
+                continue;
+            }
+            tokens[count++] = (len << 16) | offset;
+            for (pos += 2, len -= 2; len; len--) xpress_insert(&parser, pos++);
+        }
+        else if (len)
+        {
+            tokens[count++] = (len << 16) | offset;
+            for (pos++, len--; len; len--) xpress_insert(&parser, pos++);
+        }
+        else tokens[count++] = parser.base[pos++];
+
+        len = pos < limit ? xpress_find_match(&parser, pos, limit, &offset) : 0;
+    }
+    block->token_count = count;
+
+    if (comp->huffman)
+        block->out_size = xpress_huff_encode_block(block, comp->first + index == comp->block_count - 1);
+}
+
+static void xpress_parse_blocks(struct xpress_compressor *comp, LONG *workspace)
+{
+    LONG index;
+
+    while ((index = InterlockedIncrement(&comp->next) - 1) < comp->count)
+        xpress_parse_block(comp, workspace, index);
+}
+
+static void CALLBACK xpress_worker(TP_CALLBACK_INSTANCE *instance, void *arg)
+{
+    struct xpress_compressor *comp = arg;
+    LONG *workspace;
+
+    if ((workspace = RtlAllocateHeap(GetProcessHeap(), 0, comp->workspace_size)))
+    {
+        xpress_parse_blocks(comp, workspace);
+        RtlFreeHeap(GetProcessHeap(), 0, workspace);
+    }
+    if (!InterlockedDecrement(&comp->pending)) RtlWakeAddressAll(&comp->pending);
+}
+
+static BOOL xpress_put_flag(struct xpress_writer *writer, ULONG flag)
+{
+    writer->flags = (writer->flags << 1) | flag;
+    if (++writer->flag_count < 32) return TRUE;
+
+    *(ULONG *)writer->flags_ptr = writer->flags;
+    if (writer->end - writer->ptr < sizeof(ULONG)) return FALSE;
+    writer->flags_ptr = writer->ptr;
+    writer->ptr += sizeof(ULONG);
+    writer->flag_count = 0;
+    return TRUE;
+}
+
+/* encode the tokens of a block as plain LZ77 XPRESS */
+static BOOL xpress_encode_block(struct xpress_writer *writer, const struct xpress_block *block)
+{
+    ULONG i, token, len, size;
+
+    for (i = 0; i < block->token_count; i++)
+    {
+        token = block->tokens[i];
+        if (token < 0x10000)
+        {
+            if (writer->ptr >= writer->end) return FALSE;
+            *writer->ptr++ = token;
+            if (!xpress_put_flag(writer, 0)) return FALSE;
+            continue;
+        }
+
+        len = (token >> 16) - 3;
+        size = sizeof(WORD);
+        if (len >= 7)
+        {
+            if (!writer->nibble) size++;
+            if (len >= 7 + 15) size += len >= 7 + 15 + 0xff ? 3 : 1;
+        }
+        if (writer->end - writer->ptr < size) return FALSE;
+
+        *(WORD *)writer->ptr = (((token & 0xffff) - 1) << 3) | min(len, 7);
+        writer->ptr += sizeof(WORD);
+        if (len >= 7)
+        {
+            /* the length is continued in half a byte, shared by two matches */
+            if (!writer->nibble)
+            {
+                writer->nibble = writer->ptr++;
+                *writer->nibble = min(len - 7, 15);
+            }
+            else
+            {
+                *writer->nibble |= min(len - 7, 15) << 4;
+                writer->nibble = NULL;
+            }
+            if (len >= 7 + 15)
+            {
+                if (len - 7 - 15 < 0xff) *writer->ptr++ = len - 7 - 15;
+                else
+                {
+                    *writer->ptr++ = 0xff;
+                    *(WORD *)writer->ptr = len;
+                    writer->ptr += sizeof(WORD);
+                }
+            }
+        }
+        if (!xpress_put_flag(writer, 1)) return FALSE;
+    }
+    return TRUE;
+}
+
+/* compress data using XPRESS or XPRESS_HUFF
+ *
+ * The input is parsed in blocks of 64K, each starting with hash chains primed
+ * from the preceding window, so that the blocks of a batch can be parsed (and
+ * for XPRESS_HUFF, encoded) on the thread pool and then written out in order.
+ */
+static NTSTATUS xpress_compress(USHORT format, UCHAR *src, ULONG src_size, UCHAR *dst, ULONG dst_size,
+                                ULONG *final_size)
+{
+    struct xpress_compressor *comp;
+    struct xpress_writer writer;
+    ULONG i, block_size, slot_size, workers = 0;
+    LONG *workspace, pending;
+    NTSTATUS status = STATUS_SUCCESS;
+    UCHAR *data;
+
+    block_size = min(src_size, XPRESS_BLOCK_SIZE);
+
+    if (!(comp = RtlAllocateHeap(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*comp))))
+        return STATUS_NO_MEMORY;
+    comp->src         = src;
+    comp->src_size    = src_size;
+    /* when the last block is full, the end of stream symbol of XPRESS_HUFF needs a block of its own */
+    comp->block_count = src_size / XPRESS_BLOCK_SIZE + 1;
+    comp->huffman     = (format & ~COMPRESSION_ENGINE_MAXIMUM) == COMPRESSION_FORMAT_XPRESS_HUFF;
+    comp->maximum     = (format & COMPRESSION_ENGINE_MAXIMUM) != 0;
+    comp->workspace_size = (1 << XPRESS_HASH_BITS) * sizeof(LONG) +
+        (min(src_size, (comp->huffman ? XPRESS_HUFF_MAX_OFFSET : XPRESS_MAX_OFFSET) + block_size)) * sizeof(LONG);
+
+    /* tokens and encoded blocks of each slot of the batch */
+    i = min(comp->block_count, XPRESS_BATCH_BLOCKS);
+    slot_size = block_size * sizeof(ULONG) + (comp->huffman ? XPRESS_HUFF_SYMBOLS / 2 + 2 * block_size + 16 : 0);
+    if (!(data = RtlAllocateHeap(GetProcessHeap(), 0, i * slot_size)))
+    {
+        RtlFreeHeap(GetProcessHeap(), 0, comp);
+        return STATUS_NO_MEMORY;
+    }
+    while (i--)
+    {
+        comp->blocks[i].tokens = (ULONG *)(data + i * slot_size);
+        comp->blocks[i].out = data + i * slot_size + block_size * sizeof(ULONG);
+    }
+
+    if (!(workspace = RtlAllocateHeap(GetProcessHeap(), 0, comp->workspace_size)))
+    {
+        RtlFreeHeap(GetProcessHeap(), 0, data);
+        RtlFreeHeap(GetProcessHeap(), 0, comp);
+        return STATUS_NO_MEMORY;
+    }
+
+    if (NtCurrentTeb()->Peb->NumberOfProcessors > 1)
+        workers = min(NtCurrentTeb()->Peb->NumberOfProcessors, XPRESS_BATCH_BLOCKS) - 1;
+
+    writer.ptr        = dst;
+    writer.end        = dst + dst_size;
+    writer.flags_ptr  = dst;
+    writer.nibble     = NULL;
+    writer.flags      = 0;
+    writer.flag_count = 0;
+    if (!comp->huffman)
+    {
+        if (dst_size < sizeof(ULONG)) status = STATUS_BUFFER_TOO_SMALL;
+        writer.ptr += sizeof(ULONG);
+    }
+
+    for (comp->first = 0; !status && comp->first < comp->block_count; comp->first += comp->count)
+    {
+        comp->count = min(comp->block_count - comp->first, XPRESS_BATCH_BLOCKS);
+        comp->next = 0;
+        comp->pending = 0;
+
+        /* the calling thread parses blocks too, so a failure to post a worker is harmless */
+        for (i = 0; i < min(workers, comp->count - 1); i++)
+        {
+            InterlockedIncrement(&comp->pending);
+            if (TpSimpleTryPost(xpress_worker, comp, NULL)) InterlockedDecrement(&comp->pending);
+        }
+        xpress_parse_blocks(comp, workspace);
+        while ((pending = comp->pending))
+            RtlWaitOnAddress(&comp->pending, &pending, sizeof(pending), NULL);
+
+        for (i = 0; i < comp->count; i++)
+        {
+            if (comp->huffman)
+            {
+                if (writer.end - writer.ptr < comp->blocks[i].out_size)
+                {
+                    status = STATUS_BUFFER_TOO_SMALL;
+                    break;
+                }
+                memcpy(writer.ptr, comp->blocks[i].out, comp->blocks[i].out_size);
+                writer.ptr += comp->blocks[i].out_size;
+            }
+            else if (!xpress_encode_block(&writer, &comp->blocks[i]))
+            {
+                status = STATUS_BUFFER_TOO_SMALL;
+                break;
+            }
+        }
+    }
+
+    if (!status && !comp->huffman)
+    {
+        /* terminate the stream with a flag word padded with matches */
+        if (writer.flag_count)
+            *(ULONG *)writer.flags_ptr = (writer.flags << (32 - writer.flag_count)) |
+                                         ((1u << (32 - writer.flag_count)) - 1);
+        else
+            *(ULONG *)writer.flags_ptr = ~0u;
+    }
+
+    if (!status && final_size)
+        *final_size = writer.ptr - dst;
+
+    RtlFreeHeap(GetProcessHeap(), 0, workspace);
+    RtlFreeHeap(GetProcessHeap(), 0, data);
+    RtlFreeHeap(GetProcessHeap(), 0, comp);
+    return status;
+}
+
 /******************************************************************************
  *  RtlCompressBuffer		[NTDLL.@]
  */
@@ -1872,6 +2419,11 @@ NTSTATUS WINAPI RtlCompressBuffer(USHORT format, PUCHAR uncompressed, ULONG unco
             return lznt1_compress(uncompressed, uncompressed_size, compressed,
                                   compressed_size, chunk_size, final_size, workspace);
 
+        case COMPRESSION_FORMAT_XPRESS:
+        case COMPRESSION_FORMAT_XPRESS_HUFF:
+            return xpress_compress(format, uncompressed, uncompressed_size, compressed,
+                                   compressed_size, final_size);
+
         case COMPRESSION_FORMAT_NONE:
         case COMPRESSION_FORMAT_DEFAULT:
             return STATUS_INVALID_PARAMETER;
@@ -2059,6 +2611,224 @@ out:
 
 }
 
+/* decompress plain LZ77 XPRESS data */
+static NTSTATUS xpress_decompress(UCHAR *dst, ULONG dst_size, UCHAR *src, ULONG src_size,
+                                  ULONG *final_size)
+{
+    UCHAR *src_cur = src, *src_end = src + src_size, *nibble = NULL;
+    UCHAR *dst_cur = dst, *dst_end = dst + dst_size;
+    ULONG flags = 0, flag_count = 0, len, offset;
+
+    while (dst_cur < dst_end)
+    {
+        if (!flag_count)
+        {
+            if (src_end - src_cur < sizeof(ULONG)) break;
+            flags = *(ULONG *)src_cur;
+            src_cur += sizeof(ULONG);
+            flag_count = 32;
+        }
+        flag_count--;
+
+        if (src_cur >= src_end) break;
+        if (!(flags & (1u << flag_count)))
+        {
+            *dst_cur++ = *src_cur++;
+            continue;
+        }
+
+        if (src_end - src_cur < sizeof(WORD)) return STATUS_BAD_COMPRESSION_BUFFER;
+        len = *(WORD *)src_cur;
+        src_cur += sizeof(WORD);
+        offset = (len >> 3) + 1;
+        len &= 7;
+        if (len == 7)
+        {
+            if (!nibble)
+            {
+                if (src_cur >= src_end) return STATUS_BAD_COMPRESSION_BUFFER;
+                nibble = src_cur++;
+                len = *nibble & 15;
+            }
+            else
+            {
+                len = *nibble >> 4;
+                nibble = NULL;
+            }
+            if (len == 15)
+            {
+                if (src_cur >= src_end) return STATUS_BAD_COMPRESSION_BUFFER;
+                len = *src_cur++;
+                if (len == 0xff)
+                {
+                    if (src_end - src_cur < sizeof(WORD)) return STATUS_BAD_COMPRESSION_BUFFER;
+                    len = *(WORD *)src_cur;
+                    src_cur += sizeof(WORD);
+                    if (!len)
+                    {
+                        if (src_end - src_cur < sizeof(ULONG)) return STATUS_BAD_COMPRESSION_BUFFER;
+                        len = *(ULONG *)src_cur;
+                        src_cur += sizeof(ULONG);
+                    }
+                    if (len < 15 + 7) return STATUS_BAD_COMPRESSION_BUFFER;
+                    len -= 15 + 7;
+                }
+                len += 15;
+            }
+            len += 7;
+        }
+        len += 3;
+
+        if (offset > dst_cur - dst) return STATUS_BAD_COMPRESSION_BUFFER;
+        len = min(len, dst_end - dst_cur);
+        for (; len; len--, dst_cur++) *dst_cur = dst_cur[-(LONG_PTR)offset];
+    }
+
+    if (final_size)
+        *final_size = dst_cur - dst;
+
+    return STATUS_SUCCESS;
+}
+
+/* build the decoding table of an XPRESS_HUFF block, indexed by the next 15 bits of input */
+static BOOL xpress_huff_make_table(const UCHAR *src, UCHAR *lengths, USHORT *table)
+{
+    ULONG i, len, symbol, pos = 0, count;
+
+    for (i = 0; i < XPRESS_HUFF_SYMBOLS / 2; i++)
+    {
+        lengths[2 * i] = src[i] & 15;
+        lengths[2 * i + 1] = src[i] >> 4;
+    }
+
+    for (len = 1; len <= XPRESS_HUFF_MAX_BITS; len++)
+    {
+        for (symbol = 0; symbol < XPRESS_HUFF_SYMBOLS; symbol++)
+        {
+            if (lengths[symbol] != len) continue;
+            count = 1 << (XPRESS_HUFF_MAX_BITS - len);
+            if (pos + count > 1 << XPRESS_HUFF_MAX_BITS) return FALSE;
+            for (; count; count--) table[pos++] = symbol;
+        }
+    }
+    /* incomplete codes are valid as long as the unused codes don't appear */
+    while (pos < 1 << XPRESS_HUFF_MAX_BITS) table[pos++] = 0xffff;
+    return TRUE;
+}
+
+/* decompress XPRESS_HUFF data, made of 64K blocks of Huffman coded LZ77 */
+static NTSTATUS xpress_huff_decompress(UCHAR *dst, ULONG dst_size, UCHAR *src, ULONG src_size,
+                                       ULONG *final_size)
+{
+    UCHAR *src_cur = src, *src_end = src + src_size;
+    UCHAR *dst_cur = dst, *dst_end = dst + dst_size, *block_end;
+    UCHAR lengths[XPRESS_HUFF_SYMBOLS];
+    ULONG bits, symbol, len, offset, offset_bits;
+    NTSTATUS status = STATUS_SUCCESS;
+    USHORT *table;
+    int extra;
+
+    if (!(table = RtlAllocateHeap(GetProcessHeap(), 0, sizeof(USHORT) << XPRESS_HUFF_MAX_BITS)))
+        return STATUS_NO_MEMORY;
+
+    while (dst_cur < dst_end && src_cur < src_end)
+    {
+        if (src_end - src_cur < XPRESS_HUFF_SYMBOLS / 2 + 2 * sizeof(WORD) ||
+            !xpress_huff_make_table(src_cur, lengths, table))
+        {
+            status = STATUS_BAD_COMPRESSION_BUFFER;
+            break;
+        }
+        src_cur += XPRESS_HUFF_SYMBOLS / 2;
+
+        bits = ((ULONG)*(WORD *)src_cur << 16) | *(WORD *)(src_cur + 2);
+        src_cur += 2 * sizeof(WORD);
+        extra = 16;
+
+        block_end = dst_cur + min(dst_end - dst_cur, XPRESS_BLOCK_SIZE);
+        while (dst_cur < block_end)
+        {
+            symbol = table[bits >> (32 - XPRESS_HUFF_MAX_BITS)];
+            if (symbol == 0xffff)
+            {
+                status = STATUS_BAD_COMPRESSION_BUFFER;
+                goto done;
+            }
+            bits <<= lengths[symbol];
+            if ((extra -= lengths[symbol]) < 0)
+            {
+                if (src_end - src_cur >= sizeof(WORD))
+                {
+                    bits |= *(WORD *)src_cur << -extra;
+                    src_cur += sizeof(WORD);
+                }
+                extra += 16;
+            }
+
+            if (symbol < 256)
+            {
+                *dst_cur++ = symbol;
+                continue;
+            }
+            if (symbol == 256 && src_cur >= src_end) goto done;
+
+            len = symbol & 15;
+            offset_bits = (symbol - 256) >> 4;
+            if (len == 15)
+            {
+                if (src_cur >= src_end)
+                {
+                    status = STATUS_BAD_COMPRESSION_BUFFER;
+                    goto done;
+                }
+                len = *src_cur++;
+                if (len == 0xff)
+                {
+                    if (src_end - src_cur < sizeof(WORD) || *(WORD *)src_cur < 15)
+                    {
+                        status = STATUS_BAD_COMPRESSION_BUFFER;
+                        goto done;
+                    }
+                    len = *(WORD *)src_cur - 15;
+                    src_cur += sizeof(WORD);
+                }
+                len += 15;
+            }
+            len += 3;
+
+            offset = 1 << offset_bits;
+            if (offset_bits)
+            {
+                offset |= bits >> (32 - offset_bits);
+                bits <<= offset_bits;
+                if ((extra -= offset_bits) < 0)
+                {
+                    if (src_end - src_cur >= sizeof(WORD))
+                    {
+                        bits |= *(WORD *)src_cur << -extra;
+                        src_cur += sizeof(WORD);
+                    }
+                    extra += 16;
+                }
+            }
+
+            if (offset > dst_cur - dst)
+            {
+                status = STATUS_BAD_COMPRESSION_BUFFER;
+                goto done;
+            }
+            len = min(len, dst_end - dst_cur);
+            for (; len; len--, dst_cur++) *dst_cur = dst_cur[-(LONG_PTR)offset];
+        }
+    }
+
+done:
+    RtlFreeHeap(GetProcessHeap(), 0, table);
+    if (!status && final_size)
+        *final_size = dst_cur - dst;
+    return status;
+}
+
 /******************************************************************************
  *  RtlDecompressFragment	[NTDLL.@]
  */
@@ -2095,6 +2865,17 @@ NTSTATUS WINAPI RtlDecompressBuffer(USHORT format, PUCHAR uncompressed, ULONG un
     TRACE("0x%04x, %p, %u, %p, %u, %p\n", format, uncompressed,
         uncompressed_size, compressed, compressed_size, final_size);
 
+    switch (format & ~COMPRESSION_ENGINE_MAXIMUM)
+    {
+        case COMPRESSION_FORMAT_XPRESS:
+            return xpress_decompress(uncompressed, uncompressed_size, compressed,
+                                     compressed_size, final_size);
+
+        case COMPRESSION_FORMAT_XPRESS_HUFF:
+            return xpress_huff_decompress(uncompressed, uncompressed_size, compressed,
+                                          compressed_size, final_size);
+    }
+
     return RtlDecompressFragment(format, uncompressed, uncompressed_size,
                                  compressed, compressed_size, 0, final_size, NULL);
 }
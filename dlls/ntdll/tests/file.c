@@ -5042,6 +5042,65 @@ static void test_ioctl(void)
     CloseHandle(file);
 }
 
+static void test_duplicate_extents(void)
+{
+    static const ULONG size = 0x10000;
+    FILE_END_OF_FILE_INFORMATION eof;
+    DUPLICATE_EXTENTS_DATA extents;
+    IO_STATUS_BLOCK iosb;
+    UCHAR *buffer, *buffer2;
+    HANDLE src, dst;
+    NTSTATUS status;
+    DWORD count;
+    ULONG i;
+    BOOL ret;
+
+    buffer = HeapAlloc(GetProcessHeap(), 0, size);
+    buffer2 = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, size);
+    for (i = 0; i < size; i++) buffer[i] = i * 7;
+
+    src = create_temp_file(0);
+    dst = create_temp_file(0);
+    ret = WriteFile(src, buffer, size, &count, NULL);
+    ok(ret && count == size, "WriteFile failed, error %u\n", GetLastError());
+    eof.EndOfFile.QuadPart = size;
+    status = pNtSetInformationFile(dst, &iosb, &eof, sizeof(eof), FileEndOfFileInformation);
+    ok(status == STATUS_SUCCESS, "NtSetInformationFile failed: %x\n", status);
+
+    /* only block cloning file systems support it, with cluster aligned ranges */
+    extents.FileHandle = src;
+    extents.SourceFileOffset.QuadPart = 1;
+    extents.TargetFileOffset.QuadPart = 0;
+    extents.ByteCount.QuadPart = 0x1000;
+    status = pNtFsControlFile(dst, NULL, NULL, NULL, &iosb, FSCTL_DUPLICATE_EXTENTS_TO_FILE,
+                              &extents, sizeof(extents), NULL, 0);
+    ok(status == STATUS_INVALID_PARAMETER || status == STATUS_INVALID_DEVICE_REQUEST,
+       "NtFsControlFile returned %x\n", status);
+
+    extents.SourceFileOffset.QuadPart = 0;
+    extents.ByteCount.QuadPart = size;
+    status = pNtFsControlFile(dst, NULL, NULL, NULL, &iosb, FSCTL_DUPLICATE_EXTENTS_TO_FILE,
+                              &extents, sizeof(extents), NULL, 0);
+    ok(status == STATUS_SUCCESS || status == STATUS_INVALID_DEVICE_REQUEST,
+       "NtFsControlFile returned %x\n", status);
+
+    /* the data is never copied byte by byte instead */
+    SetFilePointer(dst, 0, NULL, FILE_BEGIN);
+    ret = ReadFile(dst, buffer2, size, &count, NULL);
+    ok(ret && count == size, "ReadFile failed, error %u\n", GetLastError());
+    if (status)
+    {
+        for (i = 0; i < size; i++) if (buffer2[i]) break;
+        ok(i == size, "data was copied at %x\n", i);
+    }
+    else ok(!memcmp(buffer, buffer2, size), "got wrong data\n");
+
+    CloseHandle(src);
+    CloseHandle(dst);
+    HeapFree(GetProcessHeap(), 0, buffer2);
+    HeapFree(GetProcessHeap(), 0, buffer);
+}
+
 static void test_flush_buffers_file(void)
 {
     char path[MAX_PATH], buffer[MAX_PATH];
@@ -5310,6 +5369,7 @@ START_TEST(file)
     test_query_volume_information_file();
     test_query_attribute_information_file();
     test_ioctl();
+    test_duplicate_extents();
     test_flush_buffers_file();
     test_mailslot_name();
 }
@@ -0,0 +1,222 @@
+/*
+ * Unit test suite for ntdll heap functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "ntdll_test.h"
+
+static NTSTATUS (WINAPI *pRtlQueryHeapInformation)(HANDLE,HEAP_INFORMATION_CLASS,void *,SIZE_T,SIZE_T *);
+static NTSTATUS (WINAPI *pRtlSetHeapInformation)(HANDLE,HEAP_INFORMATION_CLASS,void *,SIZE_T);
+
+#define HEAP_STD 0
+#define HEAP_LFH 2
+
+static void test_heap_compat_info(void)
+{
+    NTSTATUS status;
+    ULONG info;
+    SIZE_T size;
+    PROCESS_HEAP_ENTRY walk;
+    HANDLE heap;
+    BYTE *ptr[64];
+    unsigned int i;
+
+    heap = RtlCreateHeap( HEAP_GROWABLE, NULL, 0, 0, NULL, NULL );
+    ok( heap != NULL, "RtlCreateHeap failed\n" );
+
+    info = 0xdeadbeef;
+    size = 0;
+    status = pRtlQueryHeapInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), &size );
+    ok( !status, "RtlQueryHeapInformation failed %08x\n", status );
+    ok( size == sizeof(ULONG), "got size %Iu\n", size );
+    ok( info == HEAP_STD, "got compat info %u\n", info );
+
+    for (i = 0; i < 2; i++)
+    {
+        info = i;
+        status = pRtlSetHeapInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+        ok( !status, "%u: RtlSetHeapInformation failed %08x\n", i, status );
+    }
+
+    info = HEAP_LFH;
+    status = pRtlSetHeapInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) - 1 );
+    ok( status == STATUS_BUFFER_TOO_SMALL, "got status %08x\n", status );
+    status = pRtlSetHeapInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !status, "RtlSetHeapInformation failed %08x\n", status );
+
+    info = 0xdeadbeef;
+    status = pRtlQueryHeapInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( !status, "RtlQueryHeapInformation failed %08x\n", status );
+    ok( info == HEAP_LFH, "got compat info %u\n", info );
+
+    /* blocks going through the LFH caches must still behave like normal blocks */
+    for (i = 0; i < ARRAY_SIZE(ptr); i++)
+    {
+        ptr[i] = RtlAllocateHeap( heap, HEAP_ZERO_MEMORY, i * 7 + 1 );
+        ok( ptr[i] != NULL, "%u: RtlAllocateHeap failed\n", i );
+        ok( !ptr[i][i * 7], "%u: block not zeroed\n", i );
+        memset( ptr[i], i, i * 7 + 1 );
+    }
+    for (i = 0; i < ARRAY_SIZE(ptr); i += 2) ok( RtlFreeHeap( heap, 0, ptr[i] ), "%u: RtlFreeHeap failed\n", i );
+    for (i = 0; i < ARRAY_SIZE(ptr); i += 2)
+    {
+        ptr[i] = RtlAllocateHeap( heap, 0, i * 7 + 1 );
+        ok( ptr[i] != NULL, "%u: RtlAllocateHeap failed\n", i );
+        memset( ptr[i], i, i * 7 + 1 );
+    }
+    for (i = 0; i < ARRAY_SIZE(ptr); i++)
+    {
+        size = RtlSizeHeap( heap, 0, ptr[i] );
+        ok( size == i * 7 + 1, "%u: got size %Iu\n", i, size );
+        ok( ptr[i][i * 7] == (BYTE)i, "%u: got data %x\n", i, ptr[i][i * 7] );
+    }
+    ok( RtlValidateHeap( heap, 0, NULL ), "RtlValidateHeap failed\n" );
+    for (i = 0; i < ARRAY_SIZE(ptr); i++) ok( RtlFreeHeap( heap, 0, ptr[i] ), "%u: RtlFreeHeap failed\n", i );
+    ok( RtlValidateHeap( heap, 0, NULL ), "RtlValidateHeap failed\n" );
+
+    /* freed blocks kept by the LFH must not be reported as uncommitted ranges */
+    memset( &walk, 0, sizeof(walk) );
+    while (HeapWalk( heap, &walk ))
+    {
+        if (!(walk.wFlags & PROCESS_HEAP_UNCOMMITTED_RANGE)) continue;
+        for (i = 0; i < ARRAY_SIZE(ptr); i++)
+            ok( walk.lpData != ptr[i], "%u: block %p reported as uncommitted\n", i, ptr[i] );
+    }
+    ok( GetLastError() == ERROR_NO_MORE_ITEMS, "HeapWalk failed %u\n", GetLastError() );
+
+    info = HEAP_STD;
+    status = pRtlSetHeapInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !status, "RtlSetHeapInformation failed %08x\n", status );
+
+    RtlDestroyHeap( heap );
+
+    heap = RtlCreateHeap( HEAP_GROWABLE | HEAP_NO_SERIALIZE, NULL, 0, 0, NULL, NULL );
+    ok( heap != NULL, "RtlCreateHeap failed\n" );
+    info = HEAP_LFH;
+    status = pRtlSetHeapInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( status == STATUS_INVALID_PARAMETER, "got status %08x\n", status );
+    info = 0xdeadbeef;
+    status = pRtlQueryHeapInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( !status, "RtlQueryHeapInformation failed %08x\n", status );
+    ok( info == HEAP_STD, "got compat info %u\n", info );
+    RtlDestroyHeap( heap );
+}
+
+struct heap_thread_params
+{
+    HANDLE heap;
+    HANDLE start;
+    unsigned int count;
+    LONG failures;
+};
+
+static DWORD WINAPI heap_thread( void *arg )
+{
+    struct heap_thread_params *params = arg;
+    BYTE *ptr[256] = {0};
+    unsigned int i, seed = GetCurrentThreadId();
+
+    WaitForSingleObject( params->start, INFINITE );
+
+    for (i = 0; i < params->count; i++)
+    {
+        unsigned int idx = (seed = seed * 1103515245 + 12345) % ARRAY_SIZE(ptr);
+        SIZE_T size = 1 + (seed >> 16) % 512;
+
+        if (ptr[idx])
+        {
+            if (ptr[idx][0] != (BYTE)idx) InterlockedIncrement( &params->failures );
+            if (!RtlFreeHeap( params->heap, 0, ptr[idx] )) InterlockedIncrement( &params->failures );
+            ptr[idx] = NULL;
+        }
+        else if ((ptr[idx] = RtlAllocateHeap( params->heap, 0, size ))) ptr[idx][0] = idx;
+        else InterlockedIncrement( &params->failures );
+    }
+
+    for (i = 0; i < ARRAY_SIZE(ptr); i++) RtlFreeHeap( params->heap, 0, ptr[i] );
+    return 0;
+}
+
+static void run_heap_threads( ULONG compat_info, unsigned int nb_threads, unsigned int count )
+{
+    struct heap_thread_params params;
+    LARGE_INTEGER freq, start, end;
+    HANDLE threads[16];
+    NTSTATUS status;
+    unsigned int i;
+
+    params.heap = RtlCreateHeap( HEAP_GROWABLE, NULL, 0, 0, NULL, NULL );
+    ok( params.heap != NULL, "RtlCreateHeap failed\n" );
+    if (compat_info != HEAP_STD)
+    {
+        status = pRtlSetHeapInformation( params.heap, HeapCompatibilityInformation,
+                                         &compat_info, sizeof(compat_info) );
+        ok( !status, "RtlSetHeapInformation failed %08x\n", status );
+    }
+    params.start = CreateEventW( NULL, TRUE, FALSE, NULL );
+    params.count = count;
+    params.failures = 0;
+
+    for (i = 0; i < nb_threads; i++)
+        threads[i] = CreateThread( NULL, 0, heap_thread, &params, 0, NULL );
+
+    QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &start );
+    SetEvent( params.start );
+    WaitForMultipleObjects( nb_threads, threads, TRUE, INFINITE );
+    QueryPerformanceCounter( &end );
+
+    ok( !params.failures, "got %u failures\n", params.failures );
+    ok( RtlValidateHeap( params.heap, 0, NULL ), "RtlValidateHeap failed\n" );
+
+    trace( "compat %u, %u threads: %.0f alloc/free per second\n", compat_info, nb_threads,
+           (double)nb_threads * count * freq.QuadPart / max( end.QuadPart - start.QuadPart, 1 ) );
+
+    for (i = 0; i < nb_threads; i++) CloseHandle( threads[i] );
+    CloseHandle( params.start );
+    RtlDestroyHeap( params.heap );
+}
+
+static void test_heap_threads(void)
+{
+    unsigned int count = winetest_interactive ? 1000000 : 20000;
+    unsigned int nb_threads;
+    SYSTEM_INFO si;
+
+    GetSystemInfo( &si );
+
+    for (nb_threads = 1; nb_threads <= min( si.dwNumberOfProcessors, 16 ); nb_threads *= 2)
+    {
+        run_heap_threads( HEAP_STD, nb_threads, count );
+        run_heap_threads( HEAP_LFH, nb_threads, count );
+    }
+}
+
+START_TEST(heap)
+{
+    HMODULE ntdll = GetModuleHandleA( "ntdll.dll" );
+
+    pRtlQueryHeapInformation = (void *)GetProcAddress( ntdll, "RtlQueryHeapInformation" );
+    pRtlSetHeapInformation = (void *)GetProcAddress( ntdll, "RtlSetHeapInformation" );
+    if (!pRtlQueryHeapInformation || !pRtlSetHeapInformation)
+    {
+        win_skip( "RtlQueryHeapInformation or RtlSetHeapInformation not available\n" );
+        return;
+    }
+
+    test_heap_compat_info();
+    test_heap_threads();
+}
@@ -3277,6 +3277,68 @@ static void test_query_data_alignment(void)
 #endif
 }
 
+struct call_rate_params
+{
+    HANDLE start;
+    unsigned int count;
+    LONG failures;
+};
+
+static DWORD WINAPI call_rate_thread( void *arg )
+{
+    struct call_rate_params *params = arg;
+    PROCESS_BASIC_INFORMATION pbi;
+    KERNEL_USER_TIMES times;
+    unsigned int i;
+
+    WaitForSingleObject( params->start, INFINITE );
+
+    for (i = 0; i < params->count; i++)
+    {
+        if (pNtQueryInformationProcess( GetCurrentProcess(), ProcessBasicInformation, &pbi, sizeof(pbi), NULL ))
+            InterlockedIncrement( &params->failures );
+        if (pNtQueryInformationThread( GetCurrentThread(), ThreadTimes, &times, sizeof(times), NULL ))
+            InterlockedIncrement( &params->failures );
+    }
+    return 0;
+}
+
+static void test_server_call_rate(void)
+{
+    unsigned int count = winetest_interactive ? 100000 : 2000;
+    struct call_rate_params params;
+    LARGE_INTEGER freq, start, end;
+    unsigned int i, nb_threads;
+    HANDLE threads[8];
+    SYSTEM_INFO si;
+
+    GetSystemInfo( &si );
+    QueryPerformanceFrequency( &freq );
+    params.count = count;
+
+    /* these are cheap requests, so this mostly measures the cost of a server round trip */
+    for (nb_threads = 1; nb_threads <= min( si.dwNumberOfProcessors, ARRAY_SIZE(threads) ); nb_threads *= 2)
+    {
+        params.start = CreateEventW( NULL, TRUE, FALSE, NULL );
+        params.failures = 0;
+
+        for (i = 0; i < nb_threads; i++)
+            threads[i] = CreateThread( NULL, 0, call_rate_thread, &params, 0, NULL );
+
+        QueryPerformanceCounter( &start );
+        SetEvent( params.start );
+        WaitForMultipleObjects( nb_threads, threads, TRUE, INFINITE );
+        QueryPerformanceCounter( &end );
+
+        ok( !params.failures, "got %u failures\n", params.failures );
+        trace( "%u threads: %.0f calls per second\n", nb_threads,
+               2.0 * nb_threads * count * freq.QuadPart / max( end.QuadPart - start.QuadPart, 1 ) );
+
+        for (i = 0; i < nb_threads; i++) CloseHandle( threads[i] );
+        CloseHandle( params.start );
+    }
+}
+
 static void test_thread_lookup(void)
 {
     OBJECT_BASIC_INFORMATION obj_info;
@@ -3596,6 +3658,7 @@ START_TEST(info)
     test_HideFromDebugger();
     test_thread_start_address();
     test_thread_lookup();
+    test_server_call_rate();
 
     test_affinity();
     test_debug_object();
@@ -2500,6 +2500,106 @@ static void test_object_identity(void)
     pNtClose( h1 );
 }
 
+static void test_handle_churn(void)
+{
+    unsigned int count = winetest_interactive ? 1000000 : 20000;
+    LARGE_INTEGER freq, start, end;
+    OBJECT_DATA_INFORMATION info;
+    HANDLE handles[256], closed[256];
+    unsigned int i, j, seed = 1;
+    NTSTATUS status;
+    ULONG len;
+
+    for (i = 0; i < ARRAY_SIZE(handles); i++)
+    {
+        status = pNtCreateEvent( &handles[i], EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE );
+        ok( !status, "%u: NtCreateEvent failed %08x\n", i, status );
+    }
+
+    /* close half of the handles in random order, and check that the other half is unaffected */
+    for (i = 0; i < ARRAY_SIZE(handles); i++)
+    {
+        HANDLE tmp = handles[i];
+        j = (seed = seed * 1103515245 + 12345) % ARRAY_SIZE(handles);
+        handles[i] = handles[j];
+        handles[j] = tmp;
+    }
+    for (i = 0; i < ARRAY_SIZE(handles) / 2; i++)
+    {
+        closed[i] = handles[i];
+        status = pNtClose( closed[i] );
+        ok( !status, "%u: NtClose failed %08x\n", i, status );
+    }
+    for (i = 0; i < ARRAY_SIZE(handles) / 2; i++)
+    {
+        status = pNtClose( closed[i] );
+        ok( status == STATUS_INVALID_HANDLE, "%u: NtClose returned %08x\n", i, status );
+        status = pNtQueryObject( closed[i], ObjectDataInformation, &info, sizeof(info), &len );
+        ok( status == STATUS_INVALID_HANDLE, "%u: NtQueryObject returned %08x\n", i, status );
+    }
+    for (i = ARRAY_SIZE(handles) / 2; i < ARRAY_SIZE(handles); i++)
+    {
+        len = 0;
+        status = pNtQueryObject( handles[i], ObjectDataInformation, &info, sizeof(info), &len );
+        ok( !status, "%u: NtQueryObject failed %08x\n", i, status );
+        ok( len == sizeof(info), "%u: got len %u\n", i, len );
+        ok( !info.InheritHandle && !info.ProtectFromClose, "%u: got flags %u %u\n",
+            i, info.InheritHandle, info.ProtectFromClose );
+    }
+
+    /* the freed entries get reused */
+    for (i = 0; i < ARRAY_SIZE(handles) / 2; i++)
+    {
+        status = pNtCreateEvent( &handles[i], EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE );
+        ok( !status, "%u: NtCreateEvent failed %08x\n", i, status );
+    }
+    for (i = 0; i < ARRAY_SIZE(handles); i++)
+        for (j = i + 1; j < ARRAY_SIZE(handles); j++)
+            ok( handles[i] != handles[j], "%u,%u: got the same handle %p\n", i, j, handles[i] );
+
+    /* handle flags */
+    SetHandleInformation( handles[0], HANDLE_FLAG_INHERIT | HANDLE_FLAG_PROTECT_FROM_CLOSE,
+                          HANDLE_FLAG_INHERIT | HANDLE_FLAG_PROTECT_FROM_CLOSE );
+    status = pNtQueryObject( handles[0], ObjectDataInformation, &info, sizeof(info), NULL );
+    ok( !status, "NtQueryObject failed %08x\n", status );
+    ok( info.InheritHandle && info.ProtectFromClose, "got flags %u %u\n", info.InheritHandle, info.ProtectFromClose );
+    status = pNtClose( handles[0] );
+    ok( status == STATUS_HANDLE_NOT_CLOSABLE, "NtClose returned %08x\n", status );
+    SetHandleInformation( handles[0], HANDLE_FLAG_INHERIT | HANDLE_FLAG_PROTECT_FROM_CLOSE, 0 );
+    status = pNtQueryObject( handles[0], ObjectDataInformation, &info, sizeof(info), NULL );
+    ok( !status, "NtQueryObject failed %08x\n", status );
+    ok( !info.InheritHandle && !info.ProtectFromClose, "got flags %u %u\n", info.InheritHandle, info.ProtectFromClose );
+
+    for (i = 0; i < ARRAY_SIZE(handles); i++)
+    {
+        status = pNtClose( handles[i] );
+        ok( !status, "%u: NtClose failed %08x\n", i, status );
+    }
+    memset( handles, 0, sizeof(handles) );
+
+    QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < count; i++)
+    {
+        j = i % ARRAY_SIZE(handles);
+        if (handles[j]) pNtClose( handles[j] );
+        pNtCreateEvent( &handles[j], EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE );
+    }
+    QueryPerformanceCounter( &end );
+    trace( "%.0f handle create/close per second\n",
+           (double)count * freq.QuadPart / max( end.QuadPart - start.QuadPart, 1 ) );
+
+    for (i = 0; i < ARRAY_SIZE(handles); i++) pNtClose( handles[i] );
+
+    if (!winetest_interactive) return;
+
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < count; i++) pNtClose( handles[i % ARRAY_SIZE(handles)] );
+    QueryPerformanceCounter( &end );
+    trace( "%.0f invalid handle close per second\n",
+           (double)count * freq.QuadPart / max( end.QuadPart - start.QuadPart, 1 ) );
+}
+
 START_TEST(om)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
@@ -2561,4 +2661,5 @@ START_TEST(om)
     test_get_next_thread();
     test_globalroot();
     test_object_identity();
+    test_handle_churn();
 }
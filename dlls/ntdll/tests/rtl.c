@@ -2968,6 +2968,176 @@ static void test_RtlDecompressBuffer(void)
 #undef DECOMPRESS_BROKEN_FRAGMENT
 #undef DECOMPRESS_BROKEN_TRUNCATED
 
+static void fill_compress_buffer(UCHAR *buf, ULONG size)
+{
+    static const char *words[] = {"Wine ", "is ", "not ", "an ", "emulator ", "compression ", "buffer ", "\r\n"};
+    ULONG i, seed = 0x1234;
+    const char *word;
+
+    for (i = 0; i < size;)
+    {
+        word = words[RtlRandom(&seed) % ARRAY_SIZE(words)];
+        while (*word && i < size) buf[i++] = *word++;
+        /* some noise to keep the matches short */
+        if (i < size && !(RtlRandom(&seed) % 16)) buf[i++] = RtlRandom(&seed);
+    }
+}
+
+static void test_RtlCompressBuffer_xpress(void)
+{
+    static const USHORT formats[] =
+    {
+        COMPRESSION_FORMAT_XPRESS, COMPRESSION_FORMAT_XPRESS | COMPRESSION_ENGINE_MAXIMUM,
+        COMPRESSION_FORMAT_XPRESS_HUFF, COMPRESSION_FORMAT_XPRESS_HUFF | COMPRESSION_ENGINE_MAXIMUM,
+    };
+    static const ULONG sizes[] = {0, 1, 3, 4, 100, 0x10000, 0x10001, 0x31234};
+    /* examples from the MS-XCA specification */
+    static const UCHAR alphabet[] =
+    {
+        0x3f, 0x00, 0x00, 0x00, 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm',
+        'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z'
+    };
+    static const UCHAR abc[] = {0xff, 0xff, 0xff, 0x1f, 'a', 'b', 'c', 0x17, 0x00, 0x0f, 0xff, 0x26, 0x01};
+    static const UCHAR alphabet_huff[] =
+    {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x50, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x45, 0x44, 0x04, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0xd8, 0x52, 0x3e, 0xd7, 0x94, 0x11, 0x5b, 0xe9, 0x19, 0x5f, 0xf9, 0xd6, 0x7c, 0xdf, 0x8d, 0x04,
+        0x00, 0x00, 0x00, 0x00
+    };
+    ULONG compress_workspace, decompress_workspace, final_size, size, i, j;
+    UCHAR *src, *compressed, *uncompressed, *workspace;
+    UCHAR buf[300];
+    NTSTATUS status;
+
+    status = RtlDecompressBuffer(COMPRESSION_FORMAT_XPRESS, buf, sizeof(buf), (UCHAR *)alphabet,
+                                 sizeof(alphabet), &final_size);
+    if (status == STATUS_UNSUPPORTED_COMPRESSION)
+    {
+        win_skip("XPRESS compression not supported\n");
+        return;
+    }
+    ok(status == STATUS_SUCCESS, "got wrong status 0x%08x\n", status);
+    ok(final_size == 26, "got wrong final_size %u\n", final_size);
+    ok(!memcmp(buf, "abcdefghijklmnopqrstuvwxyz", 26), "got wrong data\n");
+
+    status = RtlDecompressBuffer(COMPRESSION_FORMAT_XPRESS, buf, sizeof(buf), (UCHAR *)abc,
+                                 sizeof(abc), &final_size);
+    ok(status == STATUS_SUCCESS, "got wrong status 0x%08x\n", status);
+    ok(final_size == 300, "got wrong final_size %u\n", final_size);
+    for (i = 0; i < 300; i++) if (buf[i] != "abc"[i % 3]) break;
+    ok(i == 300, "got wrong data at %u\n", i);
+
+    status = RtlDecompressBuffer(COMPRESSION_FORMAT_XPRESS_HUFF, buf, sizeof(buf), (UCHAR *)alphabet_huff,
+                                 sizeof(alphabet_huff), &final_size);
+    ok(status == STATUS_SUCCESS, "got wrong status 0x%08x\n", status);
+    ok(final_size == 26, "got wrong final_size %u\n", final_size);
+    ok(!memcmp(buf, "abcdefghijklmnopqrstuvwxyz", 26), "got wrong data\n");
+
+    size = 0x31234;
+    src = HeapAlloc(GetProcessHeap(), 0, size);
+    compressed = HeapAlloc(GetProcessHeap(), 0, 2 * size);
+    uncompressed = HeapAlloc(GetProcessHeap(), 0, size + 0x100);
+    fill_compress_buffer(src, size);
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+    {
+        compress_workspace = decompress_workspace = 0xdeadbeef;
+        status = RtlGetCompressionWorkSpaceSize(formats[i], &compress_workspace, &decompress_workspace);
+        ok(status == STATUS_SUCCESS, "%04x: got wrong status 0x%08x\n", formats[i], status);
+        ok(compress_workspace != 0, "%04x: got wrong compress_workspace %u\n", formats[i], compress_workspace);
+        workspace = HeapAlloc(GetProcessHeap(), 0, compress_workspace);
+
+        for (j = 0; j < ARRAY_SIZE(sizes); j++)
+        {
+            final_size = 0xdeadbeef;
+            status = RtlCompressBuffer(formats[i], src, sizes[j], compressed, 2 * size, 4096,
+                                       &final_size, workspace);
+            ok(status == STATUS_SUCCESS, "%04x/%u: got wrong status 0x%08x\n", formats[i], sizes[j], status);
+            if (status) continue;
+            if (sizes[j] >= 0x10000)
+                ok(final_size < sizes[j] / 2, "%04x/%u: got wrong final_size %u\n", formats[i], sizes[j], final_size);
+
+            memset(uncompressed, 0x11, size + 0x100);
+            status = RtlDecompressBuffer(formats[i], uncompressed, size + 0x100, compressed, final_size, &final_size);
+            ok(status == STATUS_SUCCESS, "%04x/%u: got wrong status 0x%08x\n", formats[i], sizes[j], status);
+            ok(final_size == sizes[j], "%04x/%u: got wrong final_size %u\n", formats[i], sizes[j], final_size);
+            ok(!memcmp(uncompressed, src, sizes[j]), "%04x/%u: got wrong data\n", formats[i], sizes[j]);
+        }
+
+        status = RtlCompressBuffer(formats[i], src, size, compressed, 16, 4096, &final_size, workspace);
+        ok(status == STATUS_BUFFER_TOO_SMALL, "%04x: got wrong status 0x%08x\n", formats[i], status);
+
+        HeapFree(GetProcessHeap(), 0, workspace);
+    }
+
+    HeapFree(GetProcessHeap(), 0, uncompressed);
+    HeapFree(GetProcessHeap(), 0, compressed);
+    HeapFree(GetProcessHeap(), 0, src);
+}
+
+static void test_compression_speed(void)
+{
+    static const USHORT formats[] =
+    {
+        COMPRESSION_FORMAT_LZNT1, COMPRESSION_FORMAT_XPRESS, COMPRESSION_FORMAT_XPRESS_HUFF,
+        COMPRESSION_FORMAT_XPRESS | COMPRESSION_ENGINE_MAXIMUM,
+        COMPRESSION_FORMAT_XPRESS_HUFF | COMPRESSION_ENGINE_MAXIMUM,
+    };
+    ULONG size = winetest_interactive ? 64 << 20 : 4 << 20;
+    ULONG compress_workspace, decompress_workspace, compressed_size, final_size, i;
+    LARGE_INTEGER freq, start, compressed_time, end;
+    UCHAR *src, *compressed, *uncompressed, *workspace;
+    NTSTATUS status;
+
+    src = HeapAlloc(GetProcessHeap(), 0, size);
+    compressed = HeapAlloc(GetProcessHeap(), 0, size + size / 8);
+    uncompressed = HeapAlloc(GetProcessHeap(), 0, size);
+    fill_compress_buffer(src, size);
+    QueryPerformanceFrequency(&freq);
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+    {
+        if (RtlGetCompressionWorkSpaceSize(formats[i], &compress_workspace, &decompress_workspace))
+            continue;
+        workspace = HeapAlloc(GetProcessHeap(), 0, compress_workspace);
+
+        QueryPerformanceCounter(&start);
+        status = RtlCompressBuffer(formats[i], src, size, compressed, size + size / 8, 4096,
+                                   &compressed_size, workspace);
+        QueryPerformanceCounter(&compressed_time);
+        ok(status == STATUS_SUCCESS, "%04x: got wrong status 0x%08x\n", formats[i], status);
+        status = RtlDecompressBuffer(formats[i], uncompressed, size, compressed, compressed_size, &final_size);
+        QueryPerformanceCounter(&end);
+        ok(status == STATUS_SUCCESS, "%04x: got wrong status 0x%08x\n", formats[i], status);
+        ok(final_size == size && !memcmp(uncompressed, src, size), "%04x: got wrong data\n", formats[i]);
+
+        trace("format %04x: compress %.1f MB/s, decompress %.1f MB/s, ratio %.1f%%\n", formats[i],
+              size * (double)freq.QuadPart / (compressed_time.QuadPart - start.QuadPart) / 1e6,
+              size * (double)freq.QuadPart / max(end.QuadPart - compressed_time.QuadPart, 1) / 1e6,
+              compressed_size * 100.0 / size);
+        HeapFree(GetProcessHeap(), 0, workspace);
+    }
+
+    HeapFree(GetProcessHeap(), 0, uncompressed);
+    HeapFree(GetProcessHeap(), 0, compressed);
+    HeapFree(GetProcessHeap(), 0, src);
+}
+
 struct critsect_locked_info
 {
     CRITICAL_SECTION crit;
@@ -3717,6 +3887,8 @@ START_TEST(rtl)
     test_RtlCompressBuffer();
     test_RtlGetCompressionWorkSpaceSize();
     test_RtlDecompressBuffer();
+    test_RtlCompressBuffer_xpress();
+    test_compression_speed();
     test_RtlIsCriticalSectionLocked();
     test_RtlInitializeCriticalSectionEx();
     test_RtlLeaveCriticalSection();
@@ -27,11 +27,13 @@
 #include "wine/test.h"
 
 static NTSTATUS (WINAPI *pNtAlertThreadByThreadId)( HANDLE );
+static NTSTATUS (WINAPI *pNtCancelTimer)( HANDLE, BOOLEAN * );
 static NTSTATUS (WINAPI *pNtClose)( HANDLE );
 static NTSTATUS (WINAPI *pNtCreateEvent) ( PHANDLE, ACCESS_MASK, const OBJECT_ATTRIBUTES *, EVENT_TYPE, BOOLEAN);
 static NTSTATUS (WINAPI *pNtCreateKeyedEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, ULONG );
 static NTSTATUS (WINAPI *pNtCreateMutant)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, BOOLEAN );
 static NTSTATUS (WINAPI *pNtCreateSemaphore)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, LONG, LONG );
+static NTSTATUS (WINAPI *pNtCreateTimer)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES *, TIMER_TYPE );
 static NTSTATUS (WINAPI *pNtOpenEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES * );
 static NTSTATUS (WINAPI *pNtOpenKeyedEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES * );
 static NTSTATUS (WINAPI *pNtPulseEvent)( HANDLE, LONG * );
@@ -44,6 +46,9 @@ static NTSTATUS (WINAPI *pNtReleaseMutant)( HANDLE, LONG * );
 static NTSTATUS (WINAPI *pNtReleaseSemaphore)( HANDLE, ULONG, ULONG * );
 static NTSTATUS (WINAPI *pNtResetEvent)( HANDLE, LONG * );
 static NTSTATUS (WINAPI *pNtSetEvent)( HANDLE, LONG * );
+static NTSTATUS (WINAPI *pNtSetTimer)( HANDLE, const LARGE_INTEGER *, PTIMER_APC_ROUTINE, void *, BOOLEAN, LONG, BOOLEAN * );
+static NTSTATUS (WINAPI *pNtWaitForMultipleObjects)( ULONG, const HANDLE *, BOOLEAN, BOOLEAN, const LARGE_INTEGER * );
+static NTSTATUS (WINAPI *pNtWaitForSingleObject)( HANDLE, BOOLEAN, const LARGE_INTEGER * );
 static NTSTATUS (WINAPI *pNtWaitForAlertByThreadId)( void *, const LARGE_INTEGER * );
 static NTSTATUS (WINAPI *pNtWaitForKeyedEvent)( HANDLE, const void *, BOOLEAN, const LARGE_INTEGER * );
 static BOOLEAN  (WINAPI *pRtlAcquireResourceExclusive)( RTL_RWLOCK *, BOOLEAN );
@@ -837,6 +842,90 @@ static void test_tid_alert( char **argv )
     CloseHandle( pi.hThread );
 }
 
+static void test_timer_scaling(void)
+{
+    unsigned int i, count = winetest_interactive ? 50000 : 10000;
+    LARGE_INTEGER due, timeout, freq, start, end;
+    HANDLE *timers, event, short_timers[2];
+    NTSTATUS status;
+    BOOLEAN state;
+
+    timers = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*timers) );
+
+    QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < count; i++)
+    {
+        status = pNtCreateTimer( &timers[i], TIMER_ALL_ACCESS, NULL, NotificationTimer );
+        if (status) break;
+        /* spread the expiry times, alternating relative and absolute timeouts */
+        if (i % 2) due.QuadPart = -(LONGLONG)(3600 + i % 1000) * 10000000;
+        else
+        {
+            pNtQuerySystemTime( &due );
+            due.QuadPart += (LONGLONG)(3600 + (count - i) % 1000) * 10000000;
+        }
+        status = pNtSetTimer( timers[i], &due, NULL, NULL, FALSE, 0, NULL );
+        ok( !status, "%u: NtSetTimer failed %08x\n", i, status );
+    }
+    QueryPerformanceCounter( &end );
+    ok( i == count, "NtCreateTimer failed at %u: %08x\n", i, status );
+    count = i;
+    trace( "set %u timers in %.1f ms\n", count, (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart );
+
+    /* short timers must still fire with many longer timers pending */
+    for (i = 0; i < ARRAY_SIZE(short_timers); i++)
+    {
+        status = pNtCreateTimer( &short_timers[i], TIMER_ALL_ACCESS, NULL, NotificationTimer );
+        ok( !status, "NtCreateTimer failed %08x\n", status );
+    }
+    due.QuadPart = -200000;
+    status = pNtSetTimer( short_timers[0], &due, NULL, NULL, FALSE, 0, NULL );
+    ok( !status, "NtSetTimer failed %08x\n", status );
+    pNtQuerySystemTime( &due );
+    due.QuadPart += 400000;
+    status = pNtSetTimer( short_timers[1], &due, NULL, NULL, FALSE, 0, NULL );
+    ok( !status, "NtSetTimer failed %08x\n", status );
+    timeout.QuadPart = -50000000;
+    status = pNtWaitForMultipleObjects( ARRAY_SIZE(short_timers), short_timers, FALSE, FALSE, &timeout );
+    ok( status == STATUS_WAIT_0, "got %08x\n", status );
+    status = pNtWaitForMultipleObjects( ARRAY_SIZE(short_timers), short_timers, TRUE, FALSE, &timeout );
+    ok( !status, "got %08x\n", status );
+    for (i = 0; i < ARRAY_SIZE(short_timers); i++) pNtClose( short_timers[i] );
+
+    /* timed waits are timeouts too */
+    status = pNtCreateEvent( &event, EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE );
+    ok( !status, "NtCreateEvent failed %08x\n", status );
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < 1000; i++)
+    {
+        timeout.QuadPart = -1;
+        status = pNtWaitForSingleObject( event, FALSE, &timeout );
+        if (status != STATUS_TIMEOUT) break;
+    }
+    QueryPerformanceCounter( &end );
+    ok( status == STATUS_TIMEOUT, "got %08x\n", status );
+    trace( "%u timed waits with %u pending timers in %.1f ms\n", i, count,
+           (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart );
+    pNtClose( event );
+
+    /* cancel half of the timers out of order, then close everything */
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < count; i += 2)
+    {
+        state = 0xcc;
+        status = pNtCancelTimer( timers[(i * 7) % count], &state );
+        ok( !status, "%u: NtCancelTimer failed %08x\n", i, status );
+        ok( !state, "%u: timer signaled\n", i );
+    }
+    for (i = 0; i < count; i++) pNtClose( timers[i] );
+    QueryPerformanceCounter( &end );
+    trace( "cancelled and closed %u timers in %.1f ms\n", count,
+           (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart );
+
+    HeapFree( GetProcessHeap(), 0, timers );
+}
+
 START_TEST(sync)
 {
     HMODULE module = GetModuleHandleA("ntdll.dll");
@@ -848,11 +937,13 @@ START_TEST(sync)
     if (argc > 2) return;
 
     pNtAlertThreadByThreadId        = (void *)GetProcAddress(module, "NtAlertThreadByThreadId");
+    pNtCancelTimer                  = (void *)GetProcAddress(module, "NtCancelTimer");
     pNtClose                        = (void *)GetProcAddress(module, "NtClose");
     pNtCreateEvent                  = (void *)GetProcAddress(module, "NtCreateEvent");
     pNtCreateKeyedEvent             = (void *)GetProcAddress(module, "NtCreateKeyedEvent");
     pNtCreateMutant                 = (void *)GetProcAddress(module, "NtCreateMutant");
     pNtCreateSemaphore              = (void *)GetProcAddress(module, "NtCreateSemaphore");
+    pNtCreateTimer                  = (void *)GetProcAddress(module, "NtCreateTimer");
     pNtOpenEvent                    = (void *)GetProcAddress(module, "NtOpenEvent");
     pNtOpenKeyedEvent               = (void *)GetProcAddress(module, "NtOpenKeyedEvent");
     pNtPulseEvent                   = (void *)GetProcAddress(module, "NtPulseEvent");
@@ -865,6 +956,9 @@ START_TEST(sync)
     pNtReleaseSemaphore             = (void *)GetProcAddress(module, "NtReleaseSemaphore");
     pNtResetEvent                   = (void *)GetProcAddress(module, "NtResetEvent");
     pNtSetEvent                     = (void *)GetProcAddress(module, "NtSetEvent");
+    pNtSetTimer                     = (void *)GetProcAddress(module, "NtSetTimer");
+    pNtWaitForMultipleObjects       = (void *)GetProcAddress(module, "NtWaitForMultipleObjects");
+    pNtWaitForSingleObject          = (void *)GetProcAddress(module, "NtWaitForSingleObject");
     pNtWaitForAlertByThreadId       = (void *)GetProcAddress(module, "NtWaitForAlertByThreadId");
     pNtWaitForKeyedEvent            = (void *)GetProcAddress(module, "NtWaitForKeyedEvent");
     pRtlAcquireResourceExclusive    = (void *)GetProcAddress(module, "RtlAcquireResourceExclusive");
@@ -884,4 +978,5 @@ START_TEST(sync)
     test_keyed_events();
     test_resource();
     test_tid_alert( argv );
+    test_timer_scaling();
 }
@@ -811,6 +811,75 @@ static void test_tp_work_scheduler(void)
     pTpReleasePool(pool);
 }
 
+struct work_throughput_params
+{
+    TP_WORK *child;
+    unsigned int fanout;
+    LONG count;
+};
+
+static void CALLBACK work_throughput_child_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    struct work_throughput_params *params = userdata;
+    InterlockedIncrement(&params->count);
+}
+
+static void CALLBACK work_throughput_parent_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    struct work_throughput_params *params = userdata;
+    unsigned int i;
+
+    /* items posted from a callback go to the queue of the current worker */
+    for (i = 0; i < params->fanout; i++)
+        pTpPostWork(params->child);
+}
+
+static void test_tp_work_throughput(void)
+{
+    unsigned int count = winetest_interactive ? 1000000 : 20000;
+    static const unsigned int fanouts[] = {1, 16, 256};
+    struct work_throughput_params params;
+    TP_CALLBACK_ENVIRON environment;
+    LARGE_INTEGER freq, start, end;
+    TP_WORK *parent;
+    TP_POOL *pool;
+    NTSTATUS status;
+    unsigned int i, j;
+
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+    status = pTpAllocWork(&params.child, work_throughput_child_cb, &params, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+    status = pTpAllocWork(&parent, work_throughput_parent_cb, &params, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+
+    QueryPerformanceFrequency(&freq);
+    for (i = 0; i < ARRAY_SIZE(fanouts); i++)
+    {
+        params.fanout = fanouts[i];
+        params.count = 0;
+
+        QueryPerformanceCounter(&start);
+        for (j = 0; j < count / params.fanout; j++)
+            pTpPostWork(parent);
+        pTpWaitForWork(parent, FALSE);
+        pTpWaitForWork(params.child, FALSE);
+        QueryPerformanceCounter(&end);
+
+        ok(params.count == count / params.fanout * params.fanout, "got count %u\n", params.count);
+        trace("fan-out %u: %.0f work items per second\n", params.fanout,
+              (double)params.count * freq.QuadPart / max(end.QuadPart - start.QuadPart, 1));
+    }
+
+    pTpReleaseWork(parent);
+    pTpReleaseWork(params.child);
+    pTpReleasePool(pool);
+}
+
 static void CALLBACK simple_release_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
 {
     HANDLE *semaphores = userdata;
@@ -2370,6 +2439,7 @@ START_TEST(threadpool)
     test_tp_simple();
     test_tp_work();
     test_tp_work_scheduler();
+    test_tp_work_throughput();
     test_tp_group_wait();
     test_tp_group_cancel();
     test_tp_instance();
@@ -109,8 +109,9 @@ struct threadpool
     CRITICAL_SECTION        cs;
     /* Pools of work items, locked via .cs, order matches TP_CALLBACK_PRIORITY - high, normal, low. */
     struct list             pools[3];
-    RTL_CONDITION_VARIABLE  update_event;
     /* information about worker threads, locked via .cs */
+    struct list             workers;
+    struct list             idle_workers;
     int                     max_workers;
     int                     min_workers;
     int                     num_workers;
@@ -208,6 +209,21 @@ struct threadpool_object
     } u;
 };
 
+/* internal worker thread representation, stored on the stack of the worker */
+struct threadpool_worker
+{
+    /* information about the worker, locked via .pool->cs */
+    struct threadpool      *pool;
+    struct list             entry;
+    struct list             idle_entry;
+    BOOL                    idle;
+    RTL_CONDITION_VARIABLE  update_event;
+    /* Work items submitted by callbacks running on this worker. They are run
+     * by this worker first, idle workers can steal them. Order matches
+     * TP_CALLBACK_PRIORITY. */
+    struct list             pools[3];
+};
+
 /* internal threadpool instance representation */
 struct threadpool_instance
 {
@@ -1132,6 +1148,43 @@ static void CALLBACK timerqueue_thread_proc( void *param )
     RtlExitUserThread( 0 );
 }
 
+/***********************************************************************
+ *           tp_wake_idle_worker    (internal)
+ *
+ * Wakes up an idle worker thread of the pool, pool->cs has to be held.
+ * The worker is no longer considered idle afterwards, so that the next
+ * submission starts another thread instead of relying on the same one.
+ */
+static BOOL tp_wake_idle_worker( struct threadpool *pool )
+{
+    struct threadpool_worker *worker;
+    struct list *ptr;
+
+    if (!(ptr = list_head( &pool->idle_workers )))
+        return FALSE;
+
+    worker = LIST_ENTRY( ptr, struct threadpool_worker, idle_entry );
+    list_remove( &worker->idle_entry );
+    worker->idle = FALSE;
+    RtlWakeConditionVariable( &worker->update_event );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           tp_get_current_worker    (internal)
+ *
+ * Returns the worker structure if the current thread is a worker of the
+ * pool, pool->cs has to be held. Worker threads keep it in the
+ * ThreadPoolData field of the TEB.
+ */
+static struct threadpool_worker *tp_get_current_worker( struct threadpool *pool )
+{
+    struct threadpool_worker *worker = NtCurrentTeb()->Reserved5[2];
+
+    if (worker && worker->pool == pool) return worker;
+    return NULL;
+}
+
 /***********************************************************************
  *           tp_new_worker_thread    (internal)
  *
@@ -1668,7 +1721,8 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
 
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
         list_init( &pool->pools[i] );
-    RtlInitializeConditionVariable( &pool->update_event );
+    list_init( &pool->workers );
+    list_init( &pool->idle_workers );
 
     pool->max_workers             = 500;
     pool->min_workers             = 0;
@@ -1694,8 +1748,10 @@ static void tp_threadpool_shutdown( struct threadpool *pool )
 {
     assert( pool != default_threadpool );
 
+    RtlEnterCriticalSection( &pool->cs );
     pool->shutdown = TRUE;
-    RtlWakeAllConditionVariable( &pool->update_event );
+    while (tp_wake_idle_worker( pool ));
+    RtlLeaveCriticalSection( &pool->cs );
 }
 
 /***********************************************************************
@@ -1955,10 +2011,12 @@ static void tp_object_initialize( struct threadpool_object *object, struct threa
         tp_object_release( object );
 }
 
-static void tp_object_prio_queue( struct threadpool_object *object )
+static void tp_object_prio_queue( struct threadpool_object *object, struct threadpool_worker *worker )
 {
+    struct list *pools = worker ? worker->pools : object->pool->pools;
+
     ++object->pool->num_busy_workers;
-    list_add_tail( &object->pool->pools[object->priority], &object->pool_entry );
+    list_add_tail( &pools[object->priority], &object->pool_entry );
 }
 
 /***********************************************************************
@@ -1977,25 +2035,28 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 
     RtlEnterCriticalSection( &pool->cs );
 
-    /* Start new worker threads if required. */
-    if (pool->num_busy_workers >= pool->num_workers &&
+    /* Start new worker threads if required, unless an idle one can take the item. */
+    if (list_empty( &pool->idle_workers ) &&
+        pool->num_busy_workers >= pool->num_workers &&
         pool->num_workers < pool->max_workers)
         status = tp_new_worker_thread( pool );
 
-    /* Queue work item and increment refcount. */
+    /* Queue work item and increment refcount. Items submitted from a callback
+     * go to the queue of the current worker, which will usually run them next. */
     InterlockedIncrement( &object->refcount );
     if (!object->num_pending_callbacks++)
-        tp_object_prio_queue( object );
+        tp_object_prio_queue( object, tp_get_current_worker( pool ) );
 
     /* Count how often the object was signaled. */
     if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
         object->u.wait.signaled++;
 
-    /* No new thread started - wake up one existing thread. */
+    /* No new thread started - wake up an idle thread. If there is none, the
+     * busy threads will pick up the item when they are done. */
     if (status != STATUS_SUCCESS)
     {
         assert( pool->num_workers > 0 );
-        RtlWakeConditionVariable( &pool->update_event );
+        tp_wake_idle_worker( pool );
     }
 
     RtlLeaveCriticalSection( &pool->cs );
@@ -2140,18 +2201,30 @@ static BOOL tp_object_release( struct threadpool_object *object )
     return TRUE;
 }
 
-static struct list *threadpool_get_next_item( const struct threadpool *pool )
+static struct list *threadpool_get_next_item( const struct threadpool *pool,
+                                              const struct threadpool_worker *worker )
 {
+    const struct threadpool_worker *other;
     struct list *ptr;
     unsigned int i;
 
+    /* Priorities apply across all queues. For a given priority, take the items
+     * of the current worker first, then the shared ones, and then steal the
+     * oldest item of another (busy) worker. */
     for (i = 0; i < ARRAY_SIZE(pool->pools); ++i)
     {
+        if ((ptr = list_head( &worker->pools[i] )))
+            return ptr;
         if ((ptr = list_head( &pool->pools[i] )))
-            break;
+            return ptr;
+        LIST_FOR_EACH_ENTRY( other, &pool->workers, struct threadpool_worker, entry )
+        {
+            if ((ptr = list_head( &other->pools[i] )))
+                return ptr;
+        }
     }
 
-    return ptr;
+    return NULL;
 }
 
 /***********************************************************************
@@ -2319,24 +2392,37 @@ skip_cleanup:
 static void CALLBACK threadpool_worker_proc( void *param )
 {
     struct threadpool *pool = param;
+    struct threadpool_worker worker;
     LARGE_INTEGER timeout;
     struct list *ptr;
+    NTSTATUS status;
+    unsigned int i;
 
     TRACE( "starting worker thread for pool %p\n", pool );
 
+    worker.pool = pool;
+    worker.idle = FALSE;
+    RtlInitializeConditionVariable( &worker.update_event );
+    for (i = 0; i < ARRAY_SIZE(worker.pools); ++i)
+        list_init( &worker.pools[i] );
+
+    NtCurrentTeb()->Reserved5[2] = &worker;
+
     RtlEnterCriticalSection( &pool->cs );
+    list_add_tail( &pool->workers, &worker.entry );
     for (;;)
     {
-        while ((ptr = threadpool_get_next_item( pool )))
+        while ((ptr = threadpool_get_next_item( pool, &worker )))
         {
             struct threadpool_object *object = LIST_ENTRY( ptr, struct threadpool_object, pool_entry );
             assert( object->num_pending_callbacks > 0 );
 
             /* If further pending callbacks are queued, move the work item to
-             * the end of the pool list. Otherwise remove it from the pool. */
+             * the end of our list, where idle workers can steal it. Otherwise
+             * remove it from the pool. */
             list_remove( &object->pool_entry );
             if (object->num_pending_callbacks > 1)
-                tp_object_prio_queue( object );
+                tp_object_prio_queue( object, &worker );
 
             tp_object_execute( object, FALSE );
 
@@ -2356,15 +2442,24 @@ static void CALLBACK threadpool_worker_proc( void *param )
          * min_workers == 0, then objcount is used to detect if the last thread
          * can be terminated. */
         timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
-        if (RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout ) == STATUS_TIMEOUT &&
-            !threadpool_get_next_item( pool ) && (pool->num_workers > max( pool->min_workers, 1 ) ||
-            (!pool->min_workers && !pool->objcount)))
+        worker.idle = TRUE;
+        list_add_tail( &pool->idle_workers, &worker.idle_entry );
+        status = RtlSleepConditionVariableCS( &worker.update_event, &pool->cs, &timeout );
+        if (worker.idle)
+        {
+            list_remove( &worker.idle_entry );
+            worker.idle = FALSE;
+        }
+        if (status == STATUS_TIMEOUT && !threadpool_get_next_item( pool, &worker ) &&
+            (pool->num_workers > max( pool->min_workers, 1 ) || (!pool->min_workers && !pool->objcount)))
         {
             break;
         }
     }
+    list_remove( &worker.entry );
     pool->num_workers--;
     RtlLeaveCriticalSection( &pool->cs );
+    NtCurrentTeb()->Reserved5[2] = NULL;
 
     TRACE( "terminating worker thread for pool %p\n", pool );
     tp_threadpool_release( pool );
@@ -127,6 +127,7 @@ WINE_DECLARE_DEBUG_CHANNEL(winediag);
 #undef VFAT_IOCTL_READDIR_BOTH
 #undef EXT2_IOC_GETFLAGS
 #undef EXT4_CASEFOLD_FL
+#undef FICLONERANGE
 
 #ifdef linux
 
@@ -148,6 +149,16 @@ typedef struct
 /* Case-insensitivity attribute */
 #define EXT4_CASEFOLD_FL 0x40000000
 
+/* Define the ioctl sharing the blocks of a file range with another file */
+struct file_clone_range
+{
+    LONGLONG  src_fd;
+    ULONGLONG src_offset;
+    ULONGLONG src_length;
+    ULONGLONG dest_offset;
+};
+#define FICLONERANGE _IOW(0x94, 13, struct file_clone_range)
+
 #ifndef O_DIRECTORY
 # define O_DIRECTORY 0200000 /* must be directory */
 #endif
@@ -5765,6 +5776,98 @@ static void ignore_server_ioctl_struct_holes( ULONG code, const void *in_buffer,
 }
 
 
+/* share the blocks of a file range with another file, the file system must support it */
+static NTSTATUS clone_extents( int src_fd, ULONGLONG src_offset, int dst_fd, ULONGLONG dst_offset,
+                               ULONGLONG count )
+{
+#ifdef linux
+    struct file_clone_range range;
+    struct stat st;
+
+    if (fstat( src_fd, &st ) == -1) return errno_to_status( errno );
+    /* the ranges must be cluster aligned, except at the end of the source file */
+    if ((src_offset | dst_offset) % st.st_blksize ||
+        (count % st.st_blksize && src_offset + count != st.st_size))
+        return STATUS_INVALID_PARAMETER;
+    if (!count) return STATUS_SUCCESS;
+
+    range.src_fd      = src_fd;
+    range.src_offset  = src_offset;
+    range.src_length  = count;
+    range.dest_offset = dst_offset;
+    if (!ioctl( dst_fd, FICLONERANGE, &range )) return STATUS_SUCCESS;
+    TRACE( "FICLONERANGE failed: %s\n", strerror( errno ));
+    if (errno != ENOSYS && errno != ENOTTY && errno != EXDEV && errno != EINVAL && errno != EOPNOTSUPP)
+        return errno_to_status( errno );
+#endif  /* linux */
+
+    return STATUS_INVALID_DEVICE_REQUEST;
+}
+
+
+/***********************************************************************
+ *           __wine_copy_file_range
+ *
+ * Copy a file range without going through user space, sharing the blocks
+ * if the file system can. Used by CopyFileExW.
+ */
+NTSTATUS WINAPI __wine_copy_file_range( HANDLE source, HANDLE dest, ULONGLONG offset, ULONGLONG count )
+{
+    enum server_fd_type src_type, dst_type;
+    int src_fd, dst_fd, src_needs_close, dst_needs_close;
+    NTSTATUS status;
+
+    if ((status = server_get_unix_fd( dest, FILE_WRITE_DATA, &dst_fd, &dst_needs_close, &dst_type, NULL )))
+        return status;
+    if ((status = server_get_unix_fd( source, FILE_READ_DATA, &src_fd, &src_needs_close, &src_type, NULL )))
+    {
+        if (dst_needs_close) close( dst_fd );
+        return status;
+    }
+
+    status = STATUS_NOT_SUPPORTED;
+    if (src_type == FD_TYPE_FILE && dst_type == FD_TYPE_FILE)
+    {
+#ifdef linux
+        static const ULONGLONG max_chunk = 0x40000000;
+        struct file_clone_range range;
+        LONGLONG src, dst;
+        ssize_t ret = -1;
+
+        range.src_fd      = src_fd;
+        range.src_offset  = offset;
+        range.src_length  = count;
+        range.dest_offset = offset;
+        if (!count || !ioctl( dst_fd, FICLONERANGE, &range )) status = STATUS_SUCCESS;
+#ifdef __NR_copy_file_range
+        else
+        {
+            /* explicit offsets, the file positions are shared with other users of the handles */
+            while (count)
+            {
+                src = dst = offset;
+                if ((ret = syscall( __NR_copy_file_range, src_fd, &src, dst_fd, &dst,
+                                    min( count, max_chunk ), 0 )) <= 0)
+                    break;
+                offset += ret;
+                count -= ret;
+            }
+            if (!count) status = STATUS_SUCCESS;
+            else if (!ret) status = STATUS_END_OF_FILE;
+            else if (errno != ENOSYS && errno != EXDEV && errno != EINVAL && errno != EOPNOTSUPP)
+                status = errno_to_status( errno );
+            else TRACE( "copy_file_range failed: %s\n", strerror( errno ));
+        }
+#endif
+#endif  /* linux */
+    }
+
+    if (src_needs_close) close( src_fd );
+    if (dst_needs_close) close( dst_fd );
+    return status;
+}
+
+
 /******************************************************************************
  *              NtFsControlFile   (NTDLL.@)
  */
@@ -5852,6 +5955,34 @@ NTSTATUS WINAPI NtFsControlFile( HANDLE handle, HANDLE event, PIO_APC_ROUTINE ap
         io->Information = 0;
         status = STATUS_SUCCESS;
         break;
+
+    case FSCTL_DUPLICATE_EXTENTS_TO_FILE:
+    {
+        DUPLICATE_EXTENTS_DATA *data = in_buffer;
+        enum server_fd_type src_type, dst_type;
+        int src_fd, dst_fd, src_needs_close, dst_needs_close;
+
+        io->Information = 0;
+        if (in_size < sizeof(*data))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+        if ((status = server_get_unix_fd( handle, FILE_WRITE_DATA, &dst_fd, &dst_needs_close, &dst_type, NULL )))
+            break;
+        if (!(status = server_get_unix_fd( data->FileHandle, FILE_READ_DATA, &src_fd, &src_needs_close, &src_type, NULL )))
+        {
+            if (src_type != FD_TYPE_FILE || dst_type != FD_TYPE_FILE)
+                status = STATUS_INVALID_DEVICE_REQUEST;
+            else
+                status = clone_extents( src_fd, data->SourceFileOffset.QuadPart,
+                                        dst_fd, data->TargetFileOffset.QuadPart, data->ByteCount.QuadPart );
+            if (src_needs_close) close( src_fd );
+        }
+        if (dst_needs_close) close( dst_fd );
+        break;
+    }
+
     default:
         return server_ioctl_file( handle, event, apc, apc_context, io, code,
                                   in_buffer, in_size, out_buffer, out_size );
@@ -6881,9 +7012,20 @@ NTSTATUS WINAPI NtQueryObject( HANDLE handle, OBJECT_INFORMATION_CLASS info_clas
     case ObjectDataInformation:
     {
         OBJECT_DATA_INFORMATION* p = ptr;
+        struct handle_mirror_entry mirror;
 
         if (len < sizeof(*p)) return STATUS_INVALID_BUFFER_SIZE;
 
+        if (server_get_handle_mirror( handle, &mirror ))
+        {
+            if (!(mirror.flags & HANDLE_MIRROR_USED)) return STATUS_INVALID_HANDLE;
+            p->InheritHandle = (mirror.flags & HANDLE_MIRROR_INHERIT) != 0;
+            p->ProtectFromClose = (mirror.flags & HANDLE_MIRROR_PROTECT) != 0;
+            if (used_len) *used_len = sizeof(*p);
+            status = STATUS_SUCCESS;
+            break;
+        }
+
         SERVER_START_REQ( set_handle_info )
         {
             req->handle = wine_server_obj_handle( handle );
@@ -28,6 +28,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #ifdef HAVE_LWP_H
 #include <lwp.h>
 #endif
@@ -107,6 +108,11 @@ static int fd_socket = -1;  /* socket to exchange file descriptors with the serv
 static int initial_cwd = -1;
 static pid_t server_pid;
 static pthread_mutex_t fd_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static const struct handle_mirror_entry *handle_mirror;  /* read-only mirror of the server handle table */
+#ifdef __linux__
+static int use_request_shm;  /* receive replies through a shared memory area (WINESERVERSHM) */
+static unsigned int request_shm_spin;  /* number of spins before sleeping on the reply futex */
+#endif
 
 /* atomically exchange a 64-bit value */
 static inline LONG64 interlocked_xchg64( LONG64 *dest, LONG64 val )
@@ -256,6 +262,62 @@ static inline unsigned int wait_reply( struct __server_request_info *req )
 }
 
 
+#ifdef __linux__
+
+/***********************************************************************
+ *           wait_shm_futex
+ *
+ * Sleep until the server stores the reply in the shared area; helper for wait_shm_reply.
+ */
+static void wait_shm_futex( struct request_shm *shm )
+{
+    struct timespec timeout = { 0, 100000000 };  /* 100 ms */
+    struct pollfd pfd;
+
+    /* the area is shared with the server process, so we can't use a private futex */
+    __atomic_store_n( &shm->waiting, 1, __ATOMIC_SEQ_CST );
+    if (__atomic_load_n( &shm->state, __ATOMIC_SEQ_CST ) == REQUEST_SHM_REQUEST)
+        syscall( __NR_futex, &shm->state, 0 /* FUTEX_WAIT */, REQUEST_SHM_REQUEST, &timeout, 0, 0 );
+    __atomic_store_n( &shm->waiting, 0, __ATOMIC_SEQ_CST );
+    if (__atomic_load_n( &shm->state, __ATOMIC_ACQUIRE ) == REQUEST_SHM_REPLY) return;
+
+    /* nothing is ever written to the reply pipe while we wait here, */
+    /* so if it becomes readable the server closed the connection; time to die... */
+    pfd.fd = ntdll_get_thread_data()->reply_fd;
+    pfd.events = POLLIN;
+    if (poll( &pfd, 1, 0 ) > 0) abort_thread(0);
+}
+
+
+/***********************************************************************
+ *           wait_shm_reply
+ *
+ * Wait for a reply from the server in the shared request area.
+ */
+static unsigned int wait_shm_reply( struct request_shm *shm, struct __server_request_info *req )
+{
+    data_size_t max_size = req->u.req.request_header.reply_size;
+    unsigned int spin = 0;
+
+    while (__atomic_load_n( &shm->state, __ATOMIC_ACQUIRE ) != REQUEST_SHM_REPLY)
+    {
+        if (spin++ < request_shm_spin) YieldProcessor();
+        else wait_shm_futex( shm );
+    }
+    memcpy( &req->u.reply, &shm->reply, sizeof(req->u.reply) );
+    if (req->u.reply.reply_header.reply_size)
+    {
+        if (req->u.reply.reply_header.reply_size > max_size)
+            server_protocol_error( "reply too large %u/%u\n", req->u.reply.reply_header.reply_size, max_size );
+        memcpy( req->reply_data, shm->data, req->u.reply.reply_header.reply_size );
+    }
+    shm->state = REQUEST_SHM_IDLE;
+    return req->u.reply.reply_header.error;
+}
+
+#endif  /* __linux__ */
+
+
 /***********************************************************************
  *           server_call_unlocked
  */
@@ -264,6 +326,20 @@ unsigned int server_call_unlocked( void *req_ptr )
     struct __server_request_info * const req = req_ptr;
     unsigned int ret;
 
+#ifdef __linux__
+    struct request_shm *shm = ntdll_get_thread_data()->request_shm;
+
+    if (shm && req->u.req.request_header.reply_size <= REQUEST_SHM_DATA_SIZE)
+    {
+        shm->state = REQUEST_SHM_REQUEST;
+        if ((ret = send_request( req )))
+        {
+            shm->state = REQUEST_SHM_IDLE;
+            return ret;
+        }
+        return wait_shm_reply( shm, req );
+    }
+#endif
     if ((ret = send_request( req ))) return ret;
     return wait_reply( req );
 }
@@ -977,6 +1053,26 @@ static int remove_fd_from_cache( HANDLE handle )
 }
 
 
+/***********************************************************************
+ *           server_get_handle_mirror
+ *
+ * Retrieve the mirrored server state of a handle.
+ * Return FALSE if the handle isn't mirrored and the server needs to be asked instead.
+ */
+BOOL server_get_handle_mirror( HANDLE handle, struct handle_mirror_entry *entry )
+{
+    const volatile struct handle_mirror_entry *mirror;
+    unsigned int idx = (wine_server_obj_handle( handle ) >> 2) - 1;
+
+    if (!handle_mirror || idx >= HANDLE_MIRROR_ENTRIES) return FALSE;
+    mirror = handle_mirror + idx;
+    entry->flags  = mirror->flags;
+    entry->type   = mirror->type;
+    entry->access = mirror->access;
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -987,6 +1083,7 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
 {
     sigset_t sigset;
     obj_handle_t fd_handle;
+    struct handle_mirror_entry mirror;
     int ret, fd = -1;
     unsigned int access = 0;
 
@@ -996,6 +1093,7 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
 
     ret = get_cached_fd( handle, &fd, type, &access, options );
     if (ret != STATUS_INVALID_HANDLE) goto done;
+    if (server_get_handle_mirror( handle, &mirror ) && !(mirror.flags & HANDLE_MIRROR_USED)) goto done;
 
     server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
     ret = get_cached_fd( handle, &fd, type, &access, options );
@@ -1396,6 +1494,91 @@ static int init_thread_pipe(void)
 }
 
 
+/***********************************************************************
+ *           init_request_shm
+ *
+ * Set up the shared area used to receive the server replies, if enabled.
+ */
+static void init_request_shm(void)
+{
+#if defined(__linux__) && defined(__NR_memfd_create)
+    struct request_shm *shm;
+    unsigned int ret;
+    int fd;
+
+    if (!use_request_shm) return;
+
+    if ((fd = syscall( __NR_memfd_create, "wine-request", 1 /* MFD_CLOEXEC */ )) == -1)
+    {
+        use_request_shm = 0;
+        return;
+    }
+    if (ftruncate( fd, REQUEST_SHM_SIZE ) == -1 ||
+        (shm = mmap( NULL, REQUEST_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return;
+    }
+    wine_server_send_fd( fd );
+    SERVER_START_REQ( set_request_shm )
+    {
+        req->shm_fd = fd;
+        ret = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+    close( fd );
+
+    if (ret)
+    {
+        WARN( "shared request area not supported by the server, status %x\n", ret );
+        munmap( shm, REQUEST_SHM_SIZE );
+        use_request_shm = 0;
+        return;
+    }
+    ntdll_get_thread_data()->request_shm = shm;
+#endif
+}
+
+
+/***********************************************************************
+ *           init_handle_mirror
+ *
+ * Set up the shared area mirroring the server handle table of the process.
+ */
+static void init_handle_mirror(void)
+{
+#if defined(__linux__) && defined(__NR_memfd_create)
+    void *ptr;
+    unsigned int ret;
+    int fd;
+
+    if ((fd = syscall( __NR_memfd_create, "wine-handles", 1 /* MFD_CLOEXEC */ )) == -1) return;
+    if (ftruncate( fd, HANDLE_MIRROR_SIZE ) == -1 ||
+        (ptr = mmap( NULL, HANDLE_MIRROR_SIZE, PROT_READ, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return;
+    }
+    wine_server_send_fd( fd );
+    SERVER_START_REQ( set_handle_mirror )
+    {
+        req->mirror_fd = fd;
+        ret = wine_server_call( req );
+    }
+    SERVER_END_REQ;
+    close( fd );
+
+    if (ret)
+    {
+        WARN( "handle table mirror not supported by the server, status %x\n", ret );
+        munmap( ptr, HANDLE_MIRROR_SIZE );
+        return;
+    }
+    handle_mirror = ptr;
+#endif
+}
+
+
 /***********************************************************************
  *           process_exit_wrapper
  *
@@ -1417,6 +1600,9 @@ size_t server_init_process(void)
 {
     const char *arch = getenv( "WINEARCH" );
     const char *env_socket = getenv( "WINESERVERSOCKET" );
+#ifdef __linux__
+    const char *env_shm;
+#endif
     obj_handle_t version;
     unsigned int i;
     int ret, reply_pipe;
@@ -1442,6 +1628,15 @@ size_t server_init_process(void)
         fd_socket = server_connect();
     }
 
+#ifdef __linux__
+    if ((env_shm = getenv( "WINESERVERSHM" )) && atoi( env_shm ))
+    {
+        use_request_shm = 1;
+        /* spinning only makes sense if the server can run at the same time */
+        if (sysconf( _SC_NPROCESSORS_ONLN ) > 1) request_shm_spin = 4000;
+    }
+#endif
+
     /* setup the signal mask */
     sigemptyset( &server_block_set );
     sigaddset( &server_block_set, SIGALRM );
@@ -1505,6 +1700,9 @@ size_t server_init_process(void)
 
     if (ret) server_protocol_error( "init_first_thread failed with status %x\n", ret );
 
+    init_request_shm();
+    init_handle_mirror();
+
     if (!supported_machines_count)
         fatal_error( "'%s' is a 64-bit installation, it cannot be used with a 32-bit wineserver.\n",
                      config_dir );
@@ -1610,6 +1808,8 @@ void server_init_thread( void *entry_point, BOOL *suspend )
     }
     SERVER_END_REQ;
     close( reply_pipe );
+
+    init_request_shm();
 }
 
 
@@ -1700,6 +1900,7 @@ NTSTATUS WINAPI NtCompareObjects( HANDLE first, HANDLE second )
 NTSTATUS WINAPI NtClose( HANDLE handle )
 {
     sigset_t sigset;
+    struct handle_mirror_entry mirror;
     HANDLE port;
     NTSTATUS ret;
     int fd;
@@ -1710,12 +1911,19 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
      * retrieve it again */
     fd = remove_fd_from_cache( handle );
 
-    SERVER_START_REQ( close_handle )
+    /* invalid and protected handles don't need a server round trip */
+    if (!server_get_handle_mirror( handle, &mirror )) mirror.flags = HANDLE_MIRROR_USED;
+    if (!(mirror.flags & HANDLE_MIRROR_USED)) ret = STATUS_INVALID_HANDLE;
+    else if (mirror.flags & HANDLE_MIRROR_PROTECT) ret = STATUS_HANDLE_NOT_CLOSABLE;
+    else
     {
-        req->handle = wine_server_obj_handle( handle );
-        ret = wine_server_call( req );
+        SERVER_START_REQ( close_handle )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            ret = wine_server_call( req );
+        }
+        SERVER_END_REQ;
     }
-    SERVER_END_REQ;
 
     server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
 
@@ -2416,6 +2416,135 @@ static NTSTATUS get_mapping_info( HANDLE handle, ACCESS_MASK access, unsigned in
 }
 
 
+/***********************************************************************
+ *             relocate_image_file
+ *
+ * Fill a relocated image file from the contents of a freshly mapped view.
+ * virtual_mutex must be held by caller.
+ */
+static BOOL relocate_image_file( struct file_view *view, int fd, const pe_image_info_t *image_info )
+{
+    const IMAGE_BASE_RELOCATION *rel, *end;
+    IMAGE_DATA_DIRECTORY *dir;
+    IMAGE_NT_HEADERS *nt;
+    INT_PTR delta = (ULONG_PTR)view->base - (ULONG_PTR)image_info->base;
+    SIZE_T i, size = view->size;
+    BOOL ret = FALSE;
+    char *ptr;
+
+    /* all the pages need to be readable to be copied */
+    for (i = 0; i < size; i += page_size)
+        if (!(get_unix_prot( get_page_vprot( (char *)view->base + i )) & PROT_READ)) return FALSE;
+
+    if ((ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED) return FALSE;
+    memcpy( ptr, view->base, size );
+
+    nt = (IMAGE_NT_HEADERS *)(ptr + ((IMAGE_DOS_HEADER *)ptr)->e_lfanew);
+    if (nt->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+    {
+        IMAGE_NT_HEADERS64 *nt64 = (IMAGE_NT_HEADERS64 *)nt;
+        if (nt64->OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) goto done;
+        dir = &nt64->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+        nt64->OptionalHeader.ImageBase = (ULONG_PTR)view->base;
+    }
+    else
+    {
+        IMAGE_NT_HEADERS32 *nt32 = (IMAGE_NT_HEADERS32 *)nt;
+        if (nt32->OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) goto done;
+        dir = &nt32->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+        nt32->OptionalHeader.ImageBase = PtrToUlong( view->base );
+    }
+    if (!dir->VirtualAddress || !dir->Size || dir->VirtualAddress >= size ||
+        dir->Size > size - dir->VirtualAddress) goto done;
+
+    rel = (const IMAGE_BASE_RELOCATION *)(ptr + dir->VirtualAddress);
+    end = (const IMAGE_BASE_RELOCATION *)(ptr + dir->VirtualAddress + dir->Size);
+    while (rel < end - 1 && rel->SizeOfBlock)
+    {
+        const USHORT *relocs = (const USHORT *)(rel + 1);
+        UINT count;
+
+        if (rel->SizeOfBlock < sizeof(*rel) || rel->SizeOfBlock > (char *)end - (char *)rel) goto done;
+        count = (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT);
+        for (i = 0; i < count; i++)
+            if ((SIZE_T)rel->VirtualAddress + (relocs[i] & 0xfff) + sizeof(INT64) > size) goto done;
+        if (!(rel = process_relocation_block( ptr, rel, delta ))) goto done;
+    }
+    ret = TRUE;
+
+done:
+    munmap( ptr, size );
+    return ret;
+}
+
+
+/***********************************************************************
+ *             map_relocated_image
+ *
+ * Replace the pages of a dll mapped at a non-preferred base by a copy that is
+ * already relocated, shared with the other processes using the same base.
+ * virtual_mutex must be held by caller.
+ */
+static NTSTATUS map_relocated_image( HANDLE mapping, struct file_view *view, const pe_image_info_t *image_info )
+{
+    HANDLE file = 0;
+    int fd = -1, needs_close = 0, ready = 0;
+    NTSTATUS status;
+
+    SERVER_START_REQ( get_relocated_image )
+    {
+        req->mapping = wine_server_obj_handle( mapping );
+        req->base    = wine_server_client_ptr( view->base );
+        if (!wine_server_call( req ))
+        {
+            file  = wine_server_ptr_handle( reply->file );
+            ready = reply->ready;
+        }
+    }
+    SERVER_END_REQ;
+    if (!file) return STATUS_SUCCESS;  /* use the normal relocation path */
+
+    status = server_get_unix_fd( file, ready ? FILE_READ_DATA : FILE_READ_DATA | FILE_WRITE_DATA,
+                                 &fd, &needs_close, NULL, NULL );
+    if (!ready)
+    {
+        BOOL success = !status && relocate_image_file( view, fd, image_info );
+
+        SERVER_START_REQ( set_relocated_image_ready )
+        {
+            req->mapping = wine_server_obj_handle( mapping );
+            req->base    = wine_server_client_ptr( view->base );
+            req->success = success;
+            wine_server_call( req );
+        }
+        SERVER_END_REQ;
+        if (!success)
+        {
+            status = STATUS_SUCCESS;
+            goto done;
+        }
+    }
+    else if (status)
+    {
+        status = STATUS_SUCCESS;
+        goto done;
+    }
+
+    /* the pages remain shared with the other processes until they get written to */
+    if (mmap( view->base, view->size, PROT_READ, MAP_FIXED | MAP_PRIVATE, fd, 0 ) != MAP_FAILED)
+    {
+        TRACE_(module)( "using relocated image at %p-%p\n", view->base, (char *)view->base + view->size );
+        mprotect_range( view->base, view->size, 0, 0 );
+    }
+    else status = STATUS_NO_MEMORY;
+
+done:
+    if (needs_close) close( fd );
+    NtClose( file );
+    return status;
+}
+
+
 /***********************************************************************
  *             virtual_map_image
  *
@@ -2458,6 +2587,10 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
 
     status = map_image_into_view( view, filename, unix_fd, base, image_info->header_size,
                                   image_info->image_flags, shared_fd, needs_close );
+    if (status == STATUS_SUCCESS && view->base != base && !shared_file &&
+        (image_info->image_charact & IMAGE_FILE_DLL) &&
+        (image_info->image_flags & IMAGE_FLAGS_ImageDynamicallyRelocated))
+        status = map_relocated_image( mapping, view, image_info );
     if (status == STATUS_SUCCESS)
     {
         SERVER_START_REQ( map_view )
@@ -2918,6 +3051,7 @@ static TEB *init_teb( void *ptr, BOOL is_wow )
     thread_data->reply_fd   = -1;
     thread_data->wait_fd[0] = -1;
     thread_data->wait_fd[1] = -1;
+    thread_data->request_shm = NULL;
     list_add_head( &teb_list, &thread_data->entry );
     return teb;
 }
@@ -277,6 +277,16 @@ struct send_message_info
     enum wm_char_mapping wm_char;
 };
 
+#define MAX_PREFETCHED_MESSAGES 32
+
+/* posted messages that the server returned along with a previous one */
+struct prefetched_messages
+{
+    unsigned int          pos;    /* index of the first message still queued */
+    unsigned int          count;  /* index past the last message */
+    struct posted_message msgs[MAX_PREFETCHED_MESSAGES];
+};
+
 static const INPUT_MESSAGE_SOURCE msg_source_unavailable = { IMDT_UNAVAILABLE, IMO_UNAVAILABLE };
 
 
@@ -2622,6 +2632,125 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/***********************************************************************
+ *           has_prefetched_messages
+ */
+static inline BOOL has_prefetched_messages(void)
+{
+    struct prefetched_messages *prefetch = get_user_thread_info()->prefetch;
+    return prefetch && prefetch->pos < prefetch->count;
+}
+
+
+/***********************************************************************
+ *           store_prefetched_messages
+ *
+ * Store the posted messages returned by the server after the current one.
+ */
+static void store_prefetched_messages( const struct posted_message *msgs, unsigned int count )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    struct prefetched_messages *prefetch = thread_info->prefetch;
+
+    if (!prefetch && !(prefetch = thread_info->prefetch = HeapAlloc( GetProcessHeap(), 0, sizeof(*prefetch) )))
+    {
+        ERR( "dropping %u prefetched messages\n", count );
+        return;
+    }
+    /* we only ask for more messages once the previous ones have been retrieved */
+    assert( prefetch->pos == prefetch->count || !prefetch->count );
+    count = min( count, ARRAY_SIZE(prefetch->msgs) );
+    memcpy( prefetch->msgs, msgs, count * sizeof(*msgs) );
+    prefetch->pos = 0;
+    prefetch->count = count;
+}
+
+
+/***********************************************************************
+ *           match_prefetched_window
+ *
+ * Client-side equivalent of the window filter of the server get_message request.
+ */
+static BOOL match_prefetched_window( HWND hwnd, HWND msg_hwnd )
+{
+    if (!hwnd) return TRUE;
+    if (hwnd == (HWND)-1 || hwnd == (HWND)1) return !msg_hwnd;
+    if (!msg_hwnd) return FALSE;
+    hwnd = WIN_GetFullHandle( hwnd );
+    while (msg_hwnd && msg_hwnd != hwnd) msg_hwnd = GetAncestor( msg_hwnd, GA_PARENT );
+    return msg_hwnd != 0;
+}
+
+
+/***********************************************************************
+ *           get_prefetched_message
+ *
+ * Retrieve a posted message that has already been returned by the server.
+ * The prefetched messages precede everything still in the server posted
+ * messages list, so once the pending sent messages have been processed the
+ * first match is what the server would have returned.
+ */
+static BOOL get_prefetched_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags )
+{
+    struct prefetched_messages *prefetch = get_user_thread_info()->prefetch;
+    UINT filter = HIWORD( flags );
+    unsigned int i;
+
+    if (!prefetch || prefetch->pos == prefetch->count) return FALSE;
+    if (filter && !(filter & QS_POSTMESSAGE)) return FALSE;
+
+    for (i = prefetch->pos; i < prefetch->count; i++)
+    {
+        const struct posted_message *posted = &prefetch->msgs[i];
+
+        if (posted->msg < first || posted->msg > last) continue;
+        if (!match_prefetched_window( hwnd, wine_server_ptr_handle( posted->win ))) continue;
+
+        msg->hwnd    = wine_server_ptr_handle( posted->win );
+        msg->message = posted->msg;
+        msg->wParam  = posted->wparam;
+        msg->lParam  = posted->lparam;
+        msg->time    = posted->time;
+        msg->pt.x    = posted->x;
+        msg->pt.y    = posted->y;
+
+        if (flags & PM_REMOVE)
+        {
+            if (i == prefetch->pos) prefetch->pos++;
+            else
+            {
+                memmove( &prefetch->msgs[i], &prefetch->msgs[i + 1],
+                         (prefetch->count - i - 1) * sizeof(*posted) );
+                prefetch->count--;
+            }
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
+/***********************************************************************
+ *           purge_prefetched_messages
+ *
+ * Remove the prefetched messages of a window that is being destroyed,
+ * like the server does for the messages that are still in its queue.
+ */
+void purge_prefetched_messages( HWND hwnd )
+{
+    struct prefetched_messages *prefetch = get_user_thread_info()->prefetch;
+    unsigned int i, j;
+
+    if (!prefetch) return;
+    for (i = j = prefetch->pos; i < prefetch->count; i++)
+    {
+        if (wine_server_ptr_handle( prefetch->msgs[i].win ) == hwnd) continue;
+        prefetch->msgs[j++] = prefetch->msgs[i];
+    }
+    prefetch->count = j;
+}
+
+
 /***********************************************************************
  *           peek_message
  *
@@ -2636,6 +2765,7 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
     INPUT_MESSAGE_SOURCE prev_source = thread_info->msg_source;
     struct received_message_info info, *old_info;
     unsigned int hw_id = 0;  /* id of previous hardware message */
+    BOOL use_prefetched = TRUE;
     void *buffer;
     size_t buffer_size = 1024;
 
@@ -2649,18 +2779,25 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
         NTSTATUS res;
         size_t size = 0;
         const message_data_t *msg_data = buffer;
+        /* sent messages may have arrived after the prefetched messages, and
+         * they have to be processed first, so only ask the server for those */
+        BOOL sent_only = !hw_id && use_prefetched && has_prefetched_messages();
 
         thread_info->msg_source = prev_source;
+        use_prefetched = TRUE;
 
         SERVER_START_REQ( get_message )
         {
-            req->flags     = flags;
+            req->flags     = sent_only ? LOWORD( flags ) | PM_QS_SENDMESSAGE : flags;
             req->get_win   = wine_server_user_handle( hwnd );
             req->get_first = first;
             req->get_last  = last;
             req->hw_id     = hw_id;
             req->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
             req->changed_mask = changed_mask;
+            /* let the server return the following posted messages in the same call */
+            if ((flags & PM_REMOVE) && !has_prefetched_messages())
+                req->prefetch = min( buffer_size / sizeof(struct posted_message), MAX_PREFETCHED_MESSAGES );
             wine_server_set_reply( req, buffer, buffer_size );
             if (!(res = wine_server_call( req )))
             {
@@ -2675,11 +2812,28 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
                 info.msg.pt.y    = reply->y;
                 hw_id            = 0;
                 thread_info->active_hooks = reply->active_hooks;
+                if (reply->prefetched)
+                {
+                    store_prefetched_messages( buffer, reply->prefetched );
+                    size = 0;
+                }
             }
             else buffer_size = reply->total;
         }
         SERVER_END_REQ;
 
+        if (sent_only && res == STATUS_PENDING)
+        {
+            if (!get_prefetched_message( &info.msg, hwnd, first, last, flags ))
+            {
+                /* no match in the prefetched messages, ask the server for everything else */
+                use_prefetched = FALSE;
+                continue;
+            }
+            info.type = MSG_POSTED;
+            res = STATUS_SUCCESS;
+        }
+
         if (res)
         {
             HeapFree( GetProcessHeap(), 0, buffer );
@@ -4119,6 +4273,11 @@ DWORD WINAPI MsgWaitForMultipleObjectsEx( DWORD count, const HANDLE *pHandles,
         return WAIT_FAILED;
     }
 
+    /* the server doesn't know about the prefetched messages, they are still available input */
+    if ((flags & MWMO_INPUTAVAILABLE) && !(flags & MWMO_WAITALL) &&
+        (mask & (QS_POSTMESSAGE | QS_ALLPOSTMESSAGE)) && has_prefetched_messages())
+        return WAIT_OBJECT_0 + count;
+
     /* add the queue to the handle list */
     for (i = 0; i < count; i++) handles[i] = pHandles[i];
     handles[count] = get_server_queue_handle();
@@ -4128,6 +4287,20 @@ DWORD WINAPI MsgWaitForMultipleObjectsEx( DWORD count, const HANDLE *pHandles,
 }
 
 
+/***********************************************************************
+ *		GetQueueStatus (USER32.@)
+ */
+DWORD WINAPI GetQueueStatus( UINT flags )
+{
+    DWORD ret = NtUserGetQueueStatus( flags );
+
+    /* prefetched messages are no longer in the server queue, but they are still pending */
+    if (!(flags & ~(QS_ALLINPUT | QS_ALLPOSTMESSAGE | QS_SMRESULT)) && has_prefetched_messages())
+        ret |= MAKELONG( 0, flags & (QS_POSTMESSAGE | QS_ALLPOSTMESSAGE) );
+    return ret;
+}
+
+
 /***********************************************************************
  *		MsgWaitForMultipleObjects (USER32.@)
  */
@@ -13096,6 +13096,143 @@ static void test_quit_message(void)
     ok_sequence(WmStopQuitSeq, "WmStopQuitSeq", FALSE);
 }
 
+struct post_thread_params
+{
+    DWORD        tid;
+    unsigned int count;
+    HANDLE       ready;
+};
+
+static DWORD WINAPI post_message_thread( void *arg )
+{
+    struct post_thread_params *params = arg;
+    unsigned int i;
+
+    WaitForSingleObject( params->ready, INFINITE );
+    for (i = 0; i < params->count; i++)
+        while (!PostThreadMessageA( params->tid, WM_USER, i, 0 )) Sleep( 1 );  /* queue may be full */
+    while (!PostThreadMessageA( params->tid, WM_USER + 1, 0, 0 )) Sleep( 1 );
+    return 0;
+}
+
+static WNDPROC batch_old_proc;
+static unsigned int batch_sent_count;
+
+static LRESULT WINAPI batch_wnd_proc( HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam )
+{
+    if (msg == WM_USER + 2) batch_sent_count++;
+    return CallWindowProcA( batch_old_proc, hwnd, msg, wparam, lparam );
+}
+
+static DWORD WINAPI send_notify_thread( void *arg )
+{
+    SendNotifyMessageA( arg, WM_USER + 2, 0, 0 );
+    return 0;
+}
+
+static void test_posted_message_batch(void)
+{
+    struct post_thread_params params;
+    LARGE_INTEGER freq, start, end;
+    unsigned int i, received, errors;
+    HWND hwnd1, hwnd2;
+    HANDLE thread;
+    DWORD status;
+    MSG msg;
+    BOOL ret;
+
+    hwnd1 = CreateWindowExA( 0, "static", NULL, WS_POPUP, 0, 0, 10, 10, 0, 0, 0, NULL );
+    ok( hwnd1 != 0, "CreateWindow failed\n" );
+    hwnd2 = CreateWindowExA( 0, "static", NULL, WS_POPUP, 0, 0, 10, 10, 0, 0, 0, NULL );
+    ok( hwnd2 != 0, "CreateWindow failed\n" );
+    flush_events();
+
+    /* messages retrieved in a batch still honor the filters and the ordering */
+    PostMessageA( hwnd1, WM_USER, 1, 0 );
+    PostMessageA( hwnd1, WM_USER, 2, 0 );
+    PostMessageA( hwnd2, WM_USER, 3, 0 );
+    PostMessageA( hwnd1, WM_USER + 1, 4, 0 );
+    PostThreadMessageA( GetCurrentThreadId(), WM_USER, 5, 0 );
+
+    ret = PeekMessageA( &msg, 0, WM_USER, WM_USER + 1, PM_REMOVE );
+    ok( ret && msg.hwnd == hwnd1 && msg.wParam == 1, "got hwnd %p msg %04x wp %Ix\n", msg.hwnd, msg.message, msg.wParam );
+    status = GetQueueStatus( QS_POSTMESSAGE );
+    ok( HIWORD(status) & QS_POSTMESSAGE, "got status %08lx\n", status );
+    ret = PeekMessageA( &msg, hwnd2, WM_USER, WM_USER + 1, PM_REMOVE );
+    ok( ret && msg.hwnd == hwnd2 && msg.wParam == 3, "got hwnd %p msg %04x wp %Ix\n", msg.hwnd, msg.message, msg.wParam );
+    ret = PeekMessageA( &msg, 0, WM_USER + 1, WM_USER + 1, PM_NOREMOVE );
+    ok( ret && msg.hwnd == hwnd1 && msg.wParam == 4, "got hwnd %p msg %04x wp %Ix\n", msg.hwnd, msg.message, msg.wParam );
+    ret = PeekMessageA( &msg, (HWND)-1, WM_USER, WM_USER + 1, PM_REMOVE );
+    ok( ret && !msg.hwnd && msg.wParam == 5, "got hwnd %p msg %04x wp %Ix\n", msg.hwnd, msg.message, msg.wParam );
+    PostMessageA( hwnd1, WM_USER, 6, 0 );
+    for (i = 2; i <= 6; i++)
+    {
+        if (i == 3 || i == 5) continue;
+        ret = PeekMessageA( &msg, 0, WM_USER, WM_USER + 1, PM_REMOVE );
+        ok( ret && msg.hwnd == hwnd1 && msg.wParam == i, "%u: got hwnd %p msg %04x wp %Ix\n",
+            i, msg.hwnd, msg.message, msg.wParam );
+    }
+    ret = PeekMessageA( &msg, 0, WM_USER, WM_USER + 1, PM_REMOVE );
+    ok( !ret, "got hwnd %p msg %04x wp %Ix\n", msg.hwnd, msg.message, msg.wParam );
+
+    /* messages of destroyed windows are dropped */
+    PostMessageA( hwnd1, WM_USER, 1, 0 );
+    PostMessageA( hwnd2, WM_USER, 2, 0 );
+    PostMessageA( hwnd1, WM_USER, 3, 0 );
+    ret = PeekMessageA( &msg, 0, WM_USER, WM_USER + 1, PM_REMOVE );
+    ok( ret && msg.hwnd == hwnd1 && msg.wParam == 1, "got hwnd %p msg %04x wp %Ix\n", msg.hwnd, msg.message, msg.wParam );
+    DestroyWindow( hwnd2 );
+    ret = PeekMessageA( &msg, 0, WM_USER, WM_USER + 1, PM_REMOVE );
+    ok( ret && msg.hwnd == hwnd1 && msg.wParam == 3, "got hwnd %p msg %04x wp %Ix\n", msg.hwnd, msg.message, msg.wParam );
+    ret = PeekMessageA( &msg, 0, WM_USER, WM_USER + 1, PM_REMOVE );
+    ok( !ret, "got hwnd %p msg %04x wp %Ix\n", msg.hwnd, msg.message, msg.wParam );
+
+    /* a message sent between two posted ones is processed before the second one */
+    batch_old_proc = (WNDPROC)SetWindowLongPtrA( hwnd1, GWLP_WNDPROC, (LONG_PTR)batch_wnd_proc );
+    batch_sent_count = 0;
+    PostMessageA( hwnd1, WM_USER, 1, 0 );
+    PostMessageA( hwnd1, WM_USER, 2, 0 );
+    ret = PeekMessageA( &msg, 0, WM_USER, WM_USER + 1, PM_REMOVE );
+    ok( ret && msg.hwnd == hwnd1 && msg.wParam == 1, "got hwnd %p msg %04x wp %Ix\n", msg.hwnd, msg.message, msg.wParam );
+    thread = CreateThread( NULL, 0, send_notify_thread, hwnd1, 0, NULL );
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+    ok( !batch_sent_count, "sent message processed too early\n" );
+    ret = PeekMessageA( &msg, 0, WM_USER, WM_USER + 1, PM_REMOVE );
+    ok( ret && msg.hwnd == hwnd1 && msg.wParam == 2, "got hwnd %p msg %04x wp %Ix\n", msg.hwnd, msg.message, msg.wParam );
+    ok( batch_sent_count == 1, "sent message processed %u times\n", batch_sent_count );
+    SetWindowLongPtrA( hwnd1, GWLP_WNDPROC, (LONG_PTR)batch_old_proc );
+    DestroyWindow( hwnd1 );
+
+    /* throughput of messages posted from another thread */
+    params.tid   = GetCurrentThreadId();
+    params.count = winetest_interactive ? 1000000 : 20000;
+    params.ready = CreateEventA( NULL, FALSE, FALSE, NULL );
+    thread = CreateThread( NULL, 0, post_message_thread, &params, 0, NULL );
+    PeekMessageA( &msg, 0, 0, 0, PM_NOREMOVE );  /* make sure the queue exists */
+
+    received = errors = 0;
+    QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &start );
+    SetEvent( params.ready );
+    while (GetMessageA( &msg, 0, 0, 0 ) > 0)
+    {
+        if (msg.message == WM_USER + 1) break;
+        if (msg.message != WM_USER) continue;
+        if (msg.wParam != received) errors++;
+        received++;
+    }
+    QueryPerformanceCounter( &end );
+    ok( received == params.count, "received %u messages\n", received );
+    ok( !errors, "got %u out of order messages\n", errors );
+    trace( "%.0f posted messages per second\n",
+           (double)received * freq.QuadPart / max( end.QuadPart - start.QuadPart, 1 ) );
+
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+    CloseHandle( params.ready );
+}
+
 static const struct message WmNotifySeq[] = {
     { WM_NOTIFY, sent|wparam|lparam, 0x1234, 0xdeadbeef },
     { 0 }
@@ -18800,6 +18937,7 @@ START_TEST(msg)
     test_PeekMessage();
     test_PeekMessage2();
     test_PeekMessage3();
+    test_posted_message_batch();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
@@ -365,7 +365,7 @@
 @ stdcall GetProgmanWindow ()
 @ stdcall GetPropA(long str)
 @ stdcall GetPropW(long wstr)
-@ stdcall GetQueueStatus(long) NtUserGetQueueStatus
+@ stdcall GetQueueStatus(long)
 @ stdcall GetRawInputBuffer(ptr ptr long)
 @ stdcall GetRawInputData(ptr long ptr ptr long)
 @ stdcall GetRawInputDeviceInfoA(ptr long ptr ptr)
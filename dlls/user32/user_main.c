@@ -226,6 +226,7 @@ static void thread_detach(void)
     CloseHandle( thread_info->server_queue );
     HeapFree( GetProcessHeap(), 0, thread_info->wmchar_data );
     HeapFree( GetProcessHeap(), 0, thread_info->rawinput );
+    HeapFree( GetProcessHeap(), 0, thread_info->prefetch );
 
     exiting_thread_id = 0;
 }
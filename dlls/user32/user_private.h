@@ -119,6 +119,7 @@ extern NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, const RAWI
 extern LRESULT WINAPI MSG_SendInternalMessageTimeout( DWORD dest_pid, DWORD dest_tid,
                                                       UINT msg, WPARAM wparam, LPARAM lparam,
                                                       UINT flags, UINT timeout, PDWORD_PTR res_ptr ) DECLSPEC_HIDDEN;
+extern void purge_prefetched_messages( HWND hwnd ) DECLSPEC_HIDDEN;
 extern HPEN SYSCOLOR_GetPen( INT index ) DECLSPEC_HIDDEN;
 extern HBRUSH SYSCOLOR_Get55AABrush(void) DECLSPEC_HIDDEN;
 extern void SYSPARAMS_Init(void) DECLSPEC_HIDDEN;
@@ -815,6 +815,7 @@ LRESULT WIN_DestroyWindow( HWND hwnd )
 
     USER_Driver->pDestroyWindow( hwnd );
 
+    purge_prefetched_messages( hwnd );
     free_window_handle( hwnd );
     return 0;
 }
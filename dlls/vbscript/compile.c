@@ -63,6 +63,7 @@ typedef struct {
 
     function_t *func;
     function_decl_t *func_decls;
+    class_decl_t *class_decl;
 } compile_ctx_t;
 
 static HRESULT compile_expression(compile_ctx_t*,expression_t*);
@@ -1484,6 +1485,92 @@ static HRESULT fill_array_desc(compile_ctx_t *ctx, dim_decl_t *dim_decl, array_d
     return S_OK;
 }
 
+static BOOL lookup_local(compile_ctx_t *ctx, function_t *func, const WCHAR *name, LONG *ret)
+{
+    dim_decl_t *prop_decl;
+    unsigned i;
+
+    /* the function name may refer to its return value, leave it to run time lookup */
+    if(!wcsicmp(name, func->name))
+        return FALSE;
+
+    for(i = 0; i < func->var_cnt; i++) {
+        if(!wcsicmp(func->vars[i].name, name)) {
+            *ret = i;
+            return TRUE;
+        }
+    }
+
+    for(i = 0; i < func->arg_cnt; i++) {
+        if(!wcsicmp(func->args[i].name, name)) {
+            *ret = -(LONG)i - 1;
+            return TRUE;
+        }
+    }
+
+    if(ctx->class_decl) {
+        for(prop_decl = ctx->class_decl->props, i = 0; prop_decl; prop_decl = prop_decl->next, i++) {
+            if(!wcsicmp(prop_decl->name, name)) {
+                *ret = func->var_cnt + i;
+                return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+/* Replace by name lookups of function variables, arguments and class properties with slot indices. */
+static void bind_locals(compile_ctx_t *ctx, function_t *func)
+{
+    instr_t *instr, *end = ctx->code->instrs + ctx->instr_cnt;
+    LONG ref;
+
+    for(instr = ctx->code->instrs + func->code_off; instr < end; instr++) {
+        switch(instr->op) {
+        case OP_ident:
+            if(lookup_local(ctx, func, instr->arg1.bstr, &ref)) {
+                instr->op = OP_local;
+                instr->arg1.lng = ref;
+                instr->arg2.uint = 0;
+            }
+            break;
+        case OP_icall:
+            if(lookup_local(ctx, func, instr->arg1.bstr, &ref)) {
+                instr->op = OP_local;
+                instr->arg1.lng = ref;
+            }
+            break;
+        case OP_assign_ident:
+            if(lookup_local(ctx, func, instr->arg1.bstr, &ref)) {
+                instr->op = OP_assign_local;
+                instr->arg1.lng = ref;
+            }
+            break;
+        case OP_set_ident:
+            if(lookup_local(ctx, func, instr->arg1.bstr, &ref)) {
+                instr->op = OP_set_local;
+                instr->arg1.lng = ref;
+            }
+            break;
+        case OP_incc:
+            if(lookup_local(ctx, func, instr->arg1.bstr, &ref)) {
+                instr->op = OP_incc_local;
+                instr->arg1.lng = ref;
+            }
+            break;
+        case OP_step:
+            if(lookup_local(ctx, func, instr->arg2.bstr, &ref)) {
+                instr->op = OP_step_local;
+                instr->arg2.lng = ref;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *func)
 {
     HRESULT hres;
@@ -1572,6 +1659,9 @@ static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *f
         assert(array_id == func->array_cnt);
     }
 
+    if(func->type != FUNC_GLOBAL)
+        bind_locals(ctx, func);
+
     return S_OK;
 }
 
@@ -1751,6 +1841,8 @@ static HRESULT compile_class(compile_ctx_t *ctx, class_decl_t *class_decl)
         return E_OUTOFMEMORY;
     memset(class_desc->funcs, 0, class_desc->func_cnt*sizeof(*class_desc->funcs));
 
+    ctx->class_decl = class_decl;
+
     for(func_decl = class_decl->funcs, i=1; func_decl; func_decl = func_decl->next, i++) {
         for(func_prop_decl = func_decl; func_prop_decl; func_prop_decl = func_prop_decl->next_prop_func) {
             if(func_prop_decl->is_default) {
@@ -1780,6 +1872,8 @@ static HRESULT compile_class(compile_ctx_t *ctx, class_decl_t *class_decl)
             return hres;
     }
 
+    ctx->class_decl = NULL;
+
     for(prop_decl = class_decl->props; prop_decl; prop_decl = prop_decl->next)
         class_desc->prop_cnt++;
 
@@ -1836,15 +1930,9 @@ static BOOL lookup_script_identifier(compile_ctx_t *ctx, script_ctx_t *script, c
     for(c = 0; c < ARRAY_SIZE(contexts); c++) {
         if(!contexts[c]) continue;
 
-        for(i = 0; i < contexts[c]->global_vars_cnt; i++) {
-            if(!wcsicmp(contexts[c]->global_vars[i]->name, identifier))
-                return TRUE;
-        }
-
-        for(i = 0; i < contexts[c]->global_funcs_cnt; i++) {
-            if(!wcsicmp(contexts[c]->global_funcs[i]->name, identifier))
-                return TRUE;
-        }
+        if(lookup_global_var(contexts[c], identifier) != -1
+           || lookup_global_func(contexts[c], identifier) != -1)
+            return TRUE;
 
         for(class = contexts[c]->classes; class; class = class->next) {
             if(!wcsicmp(class->name, identifier))
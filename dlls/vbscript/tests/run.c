@@ -2906,16 +2906,12 @@ static void run_from_file(const char *filename)
     ok(hres == S_OK, "parse_script failed: %08lx\n", hres);
 }
 
-static void run_from_res(const char *name)
+static BSTR load_res(const char *name)
 {
     const char *data;
     DWORD size, len;
     BSTR str;
     HRSRC src;
-    HRESULT hres;
-
-    strict_dispid_check = FALSE;
-    test_name = name;
 
     src = FindResourceA(NULL, name, (LPCSTR)40);
     ok(src != NULL, "Could not find resource %s\n", name);
@@ -2927,6 +2923,19 @@ static void run_from_res(const char *name)
     str = SysAllocStringLen(NULL, len);
     MultiByteToWideChar(CP_ACP, 0, data, size, str, len);
 
+    return str;
+}
+
+static void run_from_res(const char *name)
+{
+    BSTR str;
+    HRESULT hres;
+
+    strict_dispid_check = FALSE;
+    test_name = name;
+
+    str = load_res(name);
+
     SET_EXPECT(global_success_d);
     SET_EXPECT(global_success_i);
     hres = parse_script(SCRIPTITEM_GLOBALMEMBERS, str, NULL);
@@ -3209,6 +3218,67 @@ static void run_tests(void)
     test_multiple_parse();
 }
 
+static void run_benchmark_script(const char *name, BSTR src)
+{
+    DWORD start, end;
+    HRESULT hres;
+
+    strict_dispid_check = FALSE;
+    test_name = name;
+
+    start = GetTickCount();
+    hres = parse_script(SCRIPTITEM_GLOBALMEMBERS, src, NULL);
+    end = GetTickCount();
+    ok(hres == S_OK, "%s: parse_script failed: %08lx\n", name, hres);
+
+    trace("%s ran in %lu ms\n", name, end-start);
+    test_name = "";
+}
+
+static void run_benchmark(const char *name)
+{
+    BSTR src;
+
+    src = load_res(name);
+    run_benchmark_script(name, src);
+    SysFreeString(src);
+}
+
+/* many global variables, accessed by name from global code */
+static void run_global_lookup_benchmark(void)
+{
+    char *src, *ptr;
+    unsigned i;
+    BSTR str;
+
+    src = ptr = HeapAlloc(GetProcessHeap(), 0, 64 * 1024);
+    for(i = 0; i < 2000; i++)
+        ptr += sprintf(ptr, "Dim gv%u\n", i);
+    strcpy(ptr, "Dim i\n"
+                "For i = 1 To 100000\n"
+                "    gv0 = gv0 + 1\n"
+                "    gv1000 = gv1000 + 1\n"
+                "    gv1999 = gv1999 + 1\n"
+                "Next\n"
+                "Call ok(gv0 = 100000, \"gv0 = \" & gv0)\n"
+                "Call ok(gv1999 = 100000, \"gv1999 = \" & gv1999)\n");
+
+    str = a2bstr(src);
+    HeapFree(GetProcessHeap(), 0, src);
+    run_benchmark_script("globallookup", str);
+    SysFreeString(str);
+}
+
+static void run_benchmarks(void)
+{
+    trace("Running benchmarks...\n");
+
+    run_benchmark("localloop.vbs");
+    run_benchmark("funccall.vbs");
+    run_benchmark("classmember.vbs");
+    run_global_lookup_benchmark();
+}
+
 static BOOL check_vbscript(void)
 {
     IRegExp2 *regexp;
@@ -3251,6 +3321,9 @@ START_TEST(run)
         run_from_file(argv[2]);
     }else {
         run_tests();
+
+        if(winetest_interactive)
+            run_benchmarks();
     }
 
     CoUninitialize();
@@ -1269,6 +1269,8 @@ static ULONG WINAPI ScriptDisp_Release(IDispatchEx *iface)
         heap_pool_free(&This->heap);
         heap_free(This->global_vars);
         heap_free(This->global_funcs);
+        heap_free(This->global_vars_map.buckets);
+        heap_free(This->global_funcs_map.buckets);
         heap_free(This);
     }
 
@@ -1376,25 +1378,21 @@ static HRESULT WINAPI ScriptDisp_Invoke(IDispatchEx *iface, DISPID dispIdMember,
 static HRESULT WINAPI ScriptDisp_GetDispID(IDispatchEx *iface, BSTR bstrName, DWORD grfdex, DISPID *pid)
 {
     ScriptDisp *This = ScriptDisp_from_IDispatchEx(iface);
-    unsigned i;
+    int i;
 
     TRACE("(%p)->(%s %lx %p)\n", This, debugstr_w(bstrName), grfdex, pid);
 
     if(!This->ctx)
         return E_UNEXPECTED;
 
-    for(i = 0; i < This->global_vars_cnt; i++) {
-        if(!wcsicmp(This->global_vars[i]->name, bstrName)) {
-            *pid = i + 1;
-            return S_OK;
-        }
+    if((i = lookup_global_var(This, bstrName)) != -1) {
+        *pid = i + 1;
+        return S_OK;
     }
 
-    for(i = 0; i < This->global_funcs_cnt; i++) {
-        if(!wcsicmp(This->global_funcs[i]->name, bstrName)) {
-            *pid = i + 1 + DISPID_FUNCTION_MASK;
-            return S_OK;
-        }
+    if((i = lookup_global_func(This, bstrName)) != -1) {
+        *pid = i + 1 + DISPID_FUNCTION_MASK;
+        return S_OK;
     }
 
     *pid = -1;
@@ -1521,6 +1519,90 @@ HRESULT create_script_disp(script_ctx_t *ctx, ScriptDisp **ret)
     return S_OK;
 }
 
+static const WCHAR *global_var_name(ScriptDisp *script_disp, unsigned i)
+{
+    return script_disp->global_vars[i]->name;
+}
+
+static const WCHAR *global_func_name(ScriptDisp *script_disp, unsigned i)
+{
+    return script_disp->global_funcs[i]->name;
+}
+
+/* add the entries appended to the array since the last lookup to the map */
+static BOOL update_name_map(ScriptDisp *script_disp, name_map_t *map, unsigned cnt,
+                            const WCHAR *(*get_name)(ScriptDisp*,unsigned))
+{
+    const WCHAR *name;
+    unsigned i;
+
+    if(cnt * 2 > map->size) {
+        unsigned *buckets, size = max(map->size, 16);
+
+        while(cnt * 2 > size)
+            size *= 2;
+
+        buckets = heap_alloc_zero(size * sizeof(*buckets));
+        if(!buckets)
+            return FALSE;
+
+        heap_free(map->buckets);
+        map->buckets = buckets;
+        map->size = size;
+        map->cnt = 0;
+    }
+
+    for(; map->cnt < cnt; map->cnt++) {
+        name = get_name(script_disp, map->cnt);
+
+        /* keep the first entry of duplicated names */
+        for(i = hash_name(name) & (map->size-1); map->buckets[i]; i = (i+1) & (map->size-1)) {
+            if(!wcsicmp(get_name(script_disp, map->buckets[i]-1), name))
+                break;
+        }
+        if(!map->buckets[i])
+            map->buckets[i] = map->cnt+1;
+    }
+
+    return TRUE;
+}
+
+static int lookup_name_map(ScriptDisp *script_disp, name_map_t *map, unsigned cnt,
+                           const WCHAR *(*get_name)(ScriptDisp*,unsigned), const WCHAR *name)
+{
+    unsigned i;
+
+    if(!cnt)
+        return -1;
+
+    if(map->cnt < cnt && !update_name_map(script_disp, map, cnt, get_name)) {
+        for(i = 0; i < cnt; i++) {
+            if(!wcsicmp(get_name(script_disp, i), name))
+                return i;
+        }
+        return -1;
+    }
+
+    for(i = hash_name(name) & (map->size-1); map->buckets[i]; i = (i+1) & (map->size-1)) {
+        if(!wcsicmp(get_name(script_disp, map->buckets[i]-1), name))
+            return map->buckets[i]-1;
+    }
+
+    return -1;
+}
+
+int lookup_global_var(ScriptDisp *script_disp, const WCHAR *name)
+{
+    return lookup_name_map(script_disp, &script_disp->global_vars_map, script_disp->global_vars_cnt,
+                           global_var_name, name);
+}
+
+int lookup_global_func(ScriptDisp *script_disp, const WCHAR *name)
+{
+    return lookup_name_map(script_disp, &script_disp->global_funcs_map, script_disp->global_funcs_cnt,
+                           global_func_name, name);
+}
+
 void collect_objects(script_ctx_t *ctx)
 {
     vbdisp_t *iter, *iter2;
@@ -143,6 +143,7 @@ static HRESULT exec_global_code(script_ctx_t *ctx, vbscode_t *code, VARIANT *res
         var->name = heap_pool_strdup(&obj->heap, code->main_code.vars[i].name);
         if (!var->name)
             return E_OUTOFMEMORY;
+        var->hash = hash_name(var->name);
         V_VT(&var->v) = VT_EMPTY;
         var->is_const = FALSE;
         var->array = NULL;
@@ -154,16 +155,12 @@ static HRESULT exec_global_code(script_ctx_t *ctx, vbscode_t *code, VARIANT *res
 
     for (func_iter = code->funcs; func_iter; func_iter = func_iter->next)
     {
-        for (i = 0; i < obj->global_funcs_cnt; i++)
-        {
-            if (!wcsicmp(obj->global_funcs[i]->name, func_iter->name))
-            {
-                /* global function already exists, replace it */
-                obj->global_funcs[i] = func_iter;
-                break;
-            }
-        }
-        if (i == obj->global_funcs_cnt)
+        int idx = lookup_global_func(obj, func_iter->name);
+
+        /* replace the global function if it already exists */
+        if (idx != -1)
+            obj->global_funcs[idx] = func_iter;
+        else
             obj->global_funcs[obj->global_funcs_cnt++] = func_iter;
     }
 
@@ -116,10 +116,18 @@ typedef struct _dynamic_var_t {
     struct _dynamic_var_t *next;
     VARIANT v;
     const WCHAR *name;
+    unsigned hash;
     BOOL is_const;
     SAFEARRAY *array;
 } dynamic_var_t;
 
+/* open addressing hash of the names of a global array, buckets hold index + 1 */
+typedef struct {
+    unsigned *buckets;
+    unsigned size;
+    unsigned cnt;
+} name_map_t;
+
 typedef struct {
     IDispatchEx IDispatchEx_iface;
     LONG ref;
@@ -127,10 +135,12 @@ typedef struct {
     dynamic_var_t **global_vars;
     size_t global_vars_cnt;
     size_t global_vars_size;
+    name_map_t global_vars_map;
 
     function_t **global_funcs;
     size_t global_funcs_cnt;
     size_t global_funcs_size;
+    name_map_t global_funcs_map;
 
     class_desc_t *classes;
 
@@ -166,6 +176,8 @@ HRESULT disp_propput(script_ctx_t*,IDispatch*,DISPID,WORD,DISPPARAMS*) DECLSPEC_
 HRESULT get_disp_value(script_ctx_t*,IDispatch*,VARIANT*) DECLSPEC_HIDDEN;
 void collect_objects(script_ctx_t*) DECLSPEC_HIDDEN;
 HRESULT create_script_disp(script_ctx_t*,ScriptDisp**) DECLSPEC_HIDDEN;
+int lookup_global_var(ScriptDisp*,const WCHAR*) DECLSPEC_HIDDEN;
+int lookup_global_func(ScriptDisp*,const WCHAR*) DECLSPEC_HIDDEN;
 
 HRESULT to_int(VARIANT*,int*) DECLSPEC_HIDDEN;
 
@@ -220,6 +232,7 @@ typedef enum {
     X(add,            1, 0,           0)          \
     X(and,            1, 0,           0)          \
     X(assign_ident,   1, ARG_BSTR,    ARG_UINT)   \
+    X(assign_local,   1, ARG_INT,     ARG_UINT)   \
     X(assign_member,  1, ARG_BSTR,    ARG_UINT)   \
     X(bool,           1, ARG_INT,     0)          \
     X(catch,          1, ARG_ADDR,    ARG_UINT)   \
@@ -246,11 +259,13 @@ typedef enum {
     X(idiv,           1, 0,           0)          \
     X(imp,            1, 0,           0)          \
     X(incc,           1, ARG_BSTR,    0)          \
+    X(incc_local,     1, ARG_INT,     0)          \
     X(int,            1, ARG_INT,     0)          \
     X(is,             1, 0,           0)          \
     X(jmp,            0, ARG_ADDR,    0)          \
     X(jmp_false,      0, ARG_ADDR,    0)          \
     X(jmp_true,       0, ARG_ADDR,    0)          \
+    X(local,          1, ARG_INT,     ARG_UINT)   \
     X(lt,             1, 0,           0)          \
     X(lteq,           1, 0,           0)          \
     X(mcall,          1, ARG_BSTR,    ARG_UINT)   \
@@ -272,9 +287,11 @@ typedef enum {
     X(ret,            0, 0,           0)          \
     X(retval,         1, 0,           0)          \
     X(set_ident,      1, ARG_BSTR,    ARG_UINT)   \
+    X(set_local,      1, ARG_INT,     ARG_UINT)   \
     X(set_member,     1, ARG_BSTR,    ARG_UINT)   \
     X(stack,          1, ARG_UINT,    0)          \
     X(step,           0, ARG_ADDR,    ARG_BSTR)   \
+    X(step_local,     0, ARG_ADDR,    ARG_INT)    \
     X(stop,           1, 0,           0)          \
     X(string,         1, ARG_STR,     0)          \
     X(sub,            1, 0,           0)          \
@@ -396,6 +413,16 @@ static inline BOOL is_digit(WCHAR c)
     return '0' <= c && c <= '9';
 }
 
+/* case insensitive, to match the wcsicmp comparisons of identifiers */
+static inline unsigned hash_name(const WCHAR *name)
+{
+    unsigned h = 0;
+
+    for(; *name; name++)
+        h = (h>>(sizeof(h)*8-4)) ^ (h<<4) ^ towlower(*name);
+    return h;
+}
+
 HRESULT create_regexp(IDispatch**) DECLSPEC_HIDDEN;
 BSTR string_replace(BSTR,BSTR,BSTR,int,int,int) DECLSPEC_HIDDEN;
 
@@ -44,6 +44,7 @@ static HMODULE vcomp_module;
 static int     vcomp_max_threads;
 static int     vcomp_num_threads;
 static int     vcomp_num_procs;
+static int     vcomp_spin_count;
 static BOOL    vcomp_nested_fork = FALSE;
 
 static RTL_CRITICAL_SECTION vcomp_section;
@@ -70,7 +71,6 @@ struct vcomp_thread_data
 
     /* only used for concurrent tasks */
     struct list             entry;
-    CONDITION_VARIABLE      cond;
 
     /* single */
     unsigned int            single;
@@ -87,9 +87,8 @@ struct vcomp_thread_data
 
 struct vcomp_team_data
 {
-    CONDITION_VARIABLE      cond;
     int                     num_threads;
-    int                     finished_threads;
+    LONG                    finished_threads;
 
     /* callback arguments */
     int                     nargs;
@@ -97,8 +96,8 @@ struct vcomp_team_data
     va_list                 valist;
 
     /* barrier */
-    unsigned int            barrier;
-    int                     barrier_count;
+    LONG                    barrier;
+    LONG                    barrier_count;
 };
 
 struct vcomp_task_data
@@ -118,6 +117,7 @@ struct vcomp_task_data
     unsigned int            dynamic_iterations;
     int                     dynamic_step;
     unsigned int            dynamic_chunksize;
+    LONG64                  dynamic_next; /* generation in the high part, dispensed iterations in the low part */
 };
 
 static void **ptr_from_va_list(va_list valist)
@@ -411,6 +411,7 @@ static struct vcomp_thread_data *vcomp_init_thread_data(void)
     data->task.single           = 0;
     data->task.section          = 0;
     data->task.dynamic          = 0;
+    data->task.dynamic_next     = 0;
 
     thread_data = &data->thread;
     thread_data->team           = NULL;
@@ -436,6 +437,22 @@ static void vcomp_free_thread_data(void)
     vcomp_set_thread_data(NULL);
 }
 
+/* wait until *addr no longer contains value; the other team members usually
+ * arrive within a few microseconds, so spin for a while before sleeping */
+static void vcomp_wait_changed(LONG volatile *addr, LONG value)
+{
+    int i;
+
+    for (i = 0; i < vcomp_spin_count; i++)
+    {
+        if (*addr != value) return;
+        YieldProcessor();
+    }
+
+    while (*addr == value)
+        RtlWaitOnAddress((const void *)addr, &value, sizeof(value), NULL);
+}
+
 void CDECL _vcomp_atomic_add_i1(char *dest, char val)
 {
     interlocked_xchg_add8(dest, val);
@@ -1057,26 +1074,23 @@ void CDECL _vcomp_flush(void)
 void CDECL _vcomp_barrier(void)
 {
     struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    LONG barrier;
 
     TRACE("()\n");
 
     if (!team_data)
         return;
 
-    EnterCriticalSection(&vcomp_section);
-    if (++team_data->barrier_count >= team_data->num_threads)
+    /* the generation can't change before this thread has arrived */
+    barrier = team_data->barrier;
+    if (InterlockedIncrement(&team_data->barrier_count) >= team_data->num_threads)
     {
-        team_data->barrier++;
         team_data->barrier_count = 0;
-        WakeAllConditionVariable(&team_data->cond);
+        InterlockedIncrement(&team_data->barrier);
+        RtlWakeAddressAll((const void *)&team_data->barrier);
     }
     else
-    {
-        unsigned int barrier = team_data->barrier;
-        while (team_data->barrier == barrier)
-            SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
-    }
-    LeaveCriticalSection(&vcomp_section);
+        vcomp_wait_changed(&team_data->barrier, barrier);
 }
 
 void CDECL _vcomp_set_num_threads(int num_threads)
@@ -1422,6 +1436,7 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
     int num_threads = team_data ? team_data->num_threads : 1;
     int thread_num = thread_data->thread_num;
     unsigned int type = flags & ~VCOMP_DYNAMIC_FLAGS_INCREMENT;
+    LONG64 state;
 
     TRACE("(%u, %u, %u, %d, %u)\n", flags, first, last, step, chunksize);
 
@@ -1467,19 +1482,28 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
             type = VCOMP_DYNAMIC_FLAGS_GUIDED;
         }
 
-        EnterCriticalSection(&vcomp_section);
         thread_data->dynamic++;
         thread_data->dynamic_type = type;
-        if ((int)(thread_data->dynamic - task_data->dynamic) > 0)
+
+        /* the first thread reaching this loop claims the generation and publishes the bounds */
+        state = task_data->dynamic_next;
+        while ((int)(thread_data->dynamic - (unsigned int)(state >> 32)) > 0)
         {
-            task_data->dynamic              = thread_data->dynamic;
-            task_data->dynamic_first        = first;
-            task_data->dynamic_last         = last;
-            task_data->dynamic_iterations   = iterations;
-            task_data->dynamic_step         = step;
-            task_data->dynamic_chunksize    = chunksize;
+            LONG64 prev = InterlockedCompareExchange64(&task_data->dynamic_next,
+                                                       (LONG64)thread_data->dynamic << 32, state);
+            if (prev == state)
+            {
+                task_data->dynamic_first        = first;
+                task_data->dynamic_last         = last;
+                task_data->dynamic_iterations   = iterations;
+                task_data->dynamic_step         = step;
+                task_data->dynamic_chunksize    = chunksize;
+                InterlockedExchange((LONG *)&task_data->dynamic, thread_data->dynamic);
+                RtlWakeAddressAll((const void *)&task_data->dynamic);
+                break;
+            }
+            state = prev;
         }
-        LeaveCriticalSection(&vcomp_section);
     }
 }
 
@@ -1502,26 +1526,53 @@ int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
     else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED ||
              thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
     {
-        unsigned int iterations = 0;
-        EnterCriticalSection(&vcomp_section);
-        if (thread_data->dynamic == task_data->dynamic &&
-            task_data->dynamic_iterations != 0)
+        unsigned int dynamic = thread_data->dynamic;
+        unsigned int ready, first, last, total, chunksize, done, iterations;
+        LONG64 state, prev;
+        int step;
+
+        /* wait for the thread which claimed this loop to publish the bounds */
+        while ((int)(dynamic - (ready = task_data->dynamic)) > 0)
+            vcomp_wait_changed((LONG *)&task_data->dynamic, ready);
+        if (ready != dynamic)
+            return 0;
+
+        /* the bounds may be replaced by the next loop once everything is dispensed */
+        first     = task_data->dynamic_first;
+        last      = task_data->dynamic_last;
+        total     = task_data->dynamic_iterations;
+        step      = task_data->dynamic_step;
+        chunksize = task_data->dynamic_chunksize;
+
+        state = task_data->dynamic_next;
+        for (;;)
         {
-            iterations = min(task_data->dynamic_iterations, task_data->dynamic_chunksize);
+            if ((unsigned int)(state >> 32) != dynamic)
+                return 0;
+            done = (unsigned int)state;
+            if (done >= total)
+                return 0;
+
+            iterations = min(total - done, chunksize);
             if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED &&
-                task_data->dynamic_iterations > num_threads * task_data->dynamic_chunksize)
+                total - done > num_threads * chunksize)
             {
-                iterations = (task_data->dynamic_iterations + num_threads - 1) / num_threads;
+                iterations = (total - done + num_threads - 1) / num_threads;
             }
-            *begin = task_data->dynamic_first;
-            *end   = task_data->dynamic_first + (iterations - 1) * task_data->dynamic_step;
-            task_data->dynamic_iterations -= iterations;
-            task_data->dynamic_first      += iterations * task_data->dynamic_step;
-            if (!task_data->dynamic_iterations)
-                *end = task_data->dynamic_last;
+            if (!iterations)
+                return 0;
+
+            prev = InterlockedCompareExchange64(&task_data->dynamic_next, state + iterations, state);
+            if (prev == state) break;
+            state = prev;
         }
-        LeaveCriticalSection(&vcomp_section);
-        return iterations != 0;
+
+        *begin = first + done * step;
+        if (done + iterations == total)
+            *end = last;
+        else
+            *end = *begin + (iterations - 1) * step;
+        return 1;
     }
 
     return 0;
@@ -1536,32 +1587,46 @@ int CDECL omp_in_parallel(void)
 static DWORD WINAPI _vcomp_fork_worker(void *param)
 {
     struct vcomp_thread_data *thread_data = param;
+    struct vcomp_team_data *no_team = NULL;
+    LARGE_INTEGER timeout;
     vcomp_set_thread_data(thread_data);
 
     TRACE("starting worker thread for %p\n", thread_data);
 
-    EnterCriticalSection(&vcomp_section);
+    timeout.QuadPart = (ULONGLONG)5000 * -10000;
     for (;;)
     {
         struct vcomp_team_data *team = thread_data->team;
+        int i, num_threads;
+
         if (team != NULL)
         {
-            LeaveCriticalSection(&vcomp_section);
             _vcomp_fork_call_wrapper(team->wrapper, team->nargs, ptr_from_va_list(team->valist));
-            EnterCriticalSection(&vcomp_section);
 
+            EnterCriticalSection(&vcomp_section);
             thread_data->team = NULL;
             list_remove(&thread_data->entry);
             list_add_tail(&vcomp_idle_threads, &thread_data->entry);
-            if (++team->finished_threads >= team->num_threads)
-                WakeAllConditionVariable(&team->cond);
-        }
+            LeaveCriticalSection(&vcomp_section);
 
-        if (!SleepConditionVariableCS(&thread_data->cond, &vcomp_section, 5000) &&
-            GetLastError() == ERROR_TIMEOUT && !thread_data->team)
-        {
-            break;
+            /* the team lives on the stack of the master thread, it may be gone after the increment */
+            num_threads = team->num_threads;
+            if (InterlockedIncrement(&team->finished_threads) >= num_threads)
+                RtlWakeAddressAll((const void *)&team->finished_threads);
         }
+
+        /* parallel regions are often forked back to back, stay hot for a while */
+        for (i = 0; i < vcomp_spin_count && !thread_data->team; i++)
+            YieldProcessor();
+        if (thread_data->team)
+            continue;
+
+        if (RtlWaitOnAddress((const void *)&thread_data->team, &no_team, sizeof(no_team), &timeout) != STATUS_TIMEOUT)
+            continue;
+
+        EnterCriticalSection(&vcomp_section);
+        if (!thread_data->team) break;
+        LeaveCriticalSection(&vcomp_section);
     }
     list_remove(&thread_data->entry);
     LeaveCriticalSection(&vcomp_section);
@@ -1594,7 +1659,6 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     else
         num_threads = vcomp_num_threads;
 
-    InitializeConditionVariable(&team_data.cond);
     team_data.num_threads       = 1;
     team_data.finished_threads  = 0;
     team_data.nargs             = nargs;
@@ -1606,6 +1670,7 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     task_data.single            = 0;
     task_data.section           = 0;
     task_data.dynamic           = 0;
+    task_data.dynamic_next      = 0;
 
     thread_data.team            = &team_data;
     thread_data.task            = &task_data;
@@ -1617,7 +1682,6 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     thread_data.dynamic         = 1;
     thread_data.dynamic_type    = 0;
     list_init(&thread_data.entry);
-    InitializeConditionVariable(&thread_data.cond);
 
     if (num_threads > 1)
     {
@@ -1628,7 +1692,6 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
         while (team_data.num_threads < num_threads && (ptr = list_head(&vcomp_idle_threads)))
         {
             struct vcomp_thread_data *data = LIST_ENTRY(ptr, struct vcomp_thread_data, entry);
-            data->team          = &team_data;
             data->task          = &task_data;
             data->thread_num    = team_data.num_threads++;
             data->parallel      = thread_data.parallel;
@@ -1639,7 +1702,6 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->dynamic_type  = 0;
             list_remove(&data->entry);
             list_add_tail(&thread_data.entry, &data->entry);
-            WakeAllConditionVariable(&data->cond);
         }
 
         /* spawn additional threads */
@@ -1652,7 +1714,7 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data = HeapAlloc(GetProcessHeap(), 0, sizeof(*data));
             if (!data) break;
 
-            data->team          = &team_data;
+            data->team          = NULL;
             data->task          = &task_data;
             data->thread_num    = team_data.num_threads;
             data->parallel      = thread_data.parallel;
@@ -1661,7 +1723,6 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             data->section       = 1;
             data->dynamic       = 1;
             data->dynamic_type  = 0;
-            InitializeConditionVariable(&data->cond);
 
             thread = CreateThread(NULL, 0, _vcomp_fork_worker, data, 0, NULL);
             if (!thread)
@@ -1677,6 +1738,14 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
             CloseHandle(thread);
         }
 
+        /* only start the workers once the team size is final */
+        LIST_FOR_EACH(ptr, &thread_data.entry)
+        {
+            struct vcomp_thread_data *data = LIST_ENTRY(ptr, struct vcomp_thread_data, entry);
+            InterlockedExchangePointer((void **)&data->team, &team_data);
+            RtlWakeAddressAll((const void *)&data->team);
+        }
+
         LeaveCriticalSection(&vcomp_section);
     }
 
@@ -1687,13 +1756,14 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
 
     if (team_data.num_threads > 1)
     {
-        EnterCriticalSection(&vcomp_section);
+        LONG finished = InterlockedIncrement(&team_data.finished_threads);
 
-        team_data.finished_threads++;
-        while (team_data.finished_threads < team_data.num_threads)
-            SleepConditionVariableCS(&team_data.cond, &vcomp_section, INFINITE);
+        while (finished < team_data.num_threads)
+        {
+            vcomp_wait_changed(&team_data.finished_threads, finished);
+            finished = team_data.finished_threads;
+        }
 
-        LeaveCriticalSection(&vcomp_section);
         assert(list_empty(&thread_data.entry));
     }
 
@@ -1970,6 +2040,7 @@ BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved)
             vcomp_max_threads = sysinfo.dwNumberOfProcessors;
             vcomp_num_threads = sysinfo.dwNumberOfProcessors;
             vcomp_num_procs   = sysinfo.dwNumberOfProcessors;
+            vcomp_spin_count  = vcomp_num_procs > 1 ? 4000 : 0;
             break;
         }
 
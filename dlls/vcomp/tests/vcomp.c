@@ -2631,6 +2631,103 @@ static void test_omp_get_num_procs(void)
     ok(num_procs == sysinfo.dwNumberOfProcessors, "got dwNumberOfProcessors %ld num_procs %d\n", sysinfo.dwNumberOfProcessors, num_procs);
 }
 
+static void CDECL overhead_parallel_cb(LONG *count)
+{
+    InterlockedIncrement(count);
+}
+
+static void CDECL overhead_for_cb(unsigned int flags, int reps, LONG *count)
+{
+    unsigned int begin, end;
+    int i;
+
+    for (i = 0; i < reps; i++)
+    {
+        p_vcomp_for_dynamic_init(VCOMP_DYNAMIC_FLAGS_INCREMENT | flags, 0, 1023, 1, 1);
+        while (p_vcomp_for_dynamic_next(&begin, &end))
+            InterlockedExchangeAdd(count, end - begin + 1);
+        p_vcomp_barrier();
+    }
+}
+
+static void CDECL overhead_barrier_cb(int reps, LONG *count)
+{
+    int i;
+
+    for (i = 0; i < reps; i++)
+    {
+        InterlockedIncrement(count);
+        p_vcomp_barrier();
+    }
+}
+
+static void CDECL overhead_reduction_cb(int *sum)
+{
+    p_vcomp_reduction_i4(VCOMP_REDUCTION_FLAGS_ADD, sum, 1);
+}
+
+static double overhead_time(LARGE_INTEGER *start, int reps)
+{
+    LARGE_INTEGER freq, end;
+
+    QueryPerformanceCounter(&end);
+    QueryPerformanceFrequency(&freq);
+    return (end.QuadPart - start->QuadPart) * 1000000.0 / freq.QuadPart / reps;
+}
+
+/* overhead of the OpenMP constructs, similar to the EPCC syncbench */
+static void test_overhead(void)
+{
+    int reps = winetest_interactive ? 10000 : 200;
+    int max_threads = pomp_get_max_threads();
+    double parallel, chunked, guided, barrier, reduction;
+    LARGE_INTEGER start;
+    LONG count;
+    int i, num_threads, sum;
+
+    for (num_threads = 1; num_threads <= 4; num_threads *= 2)
+    {
+        pomp_set_num_threads(num_threads);
+
+        count = 0;
+        QueryPerformanceCounter(&start);
+        for (i = 0; i < reps; i++)
+            p_vcomp_fork(TRUE, 1, overhead_parallel_cb, &count);
+        parallel = overhead_time(&start, reps);
+        ok(count == reps * num_threads, "expected count == %d, got %ld\n", reps * num_threads, count);
+
+        count = 0;
+        QueryPerformanceCounter(&start);
+        p_vcomp_fork(TRUE, 3, overhead_for_cb, VCOMP_DYNAMIC_FLAGS_CHUNKED, reps, &count);
+        chunked = overhead_time(&start, reps);
+        ok(count == reps * 1024, "expected count == %d, got %ld\n", reps * 1024, count);
+
+        count = 0;
+        QueryPerformanceCounter(&start);
+        p_vcomp_fork(TRUE, 3, overhead_for_cb, VCOMP_DYNAMIC_FLAGS_GUIDED, reps, &count);
+        guided = overhead_time(&start, reps);
+        ok(count == reps * 1024, "expected count == %d, got %ld\n", reps * 1024, count);
+
+        count = 0;
+        QueryPerformanceCounter(&start);
+        p_vcomp_fork(TRUE, 2, overhead_barrier_cb, reps, &count);
+        barrier = overhead_time(&start, reps);
+        ok(count == reps * num_threads, "expected count == %d, got %ld\n", reps * num_threads, count);
+
+        sum = 0;
+        QueryPerformanceCounter(&start);
+        for (i = 0; i < reps; i++)
+            p_vcomp_fork(TRUE, 1, overhead_reduction_cb, &sum);
+        reduction = overhead_time(&start, reps);
+        ok(sum == reps * num_threads, "expected sum == %d, got %d\n", reps * num_threads, sum);
+
+        trace("%d threads: parallel %.2f us, for (chunked) %.2f us, for (guided) %.2f us, "
+              "barrier %.2f us, reduction %.2f us\n", num_threads, parallel, chunked, guided, barrier, reduction);
+    }
+
+    pomp_set_num_threads(max_threads);
+}
+
 START_TEST(vcomp)
 {
     if (!init_vcomp())
@@ -2661,6 +2758,7 @@ START_TEST(vcomp)
     test_reduction_integer32();
     test_reduction_integer64();
     test_reduction_float_double();
+    test_overhead();
 
     release_vcomp();
 }
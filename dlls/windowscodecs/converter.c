@@ -132,6 +132,153 @@ static void to_sRGB(BYTE *bgr)
 }
 #endif
 
+static INIT_ONCE init_tables_once = INIT_ONCE_STATIC_INIT;
+
+/* srgb_thresholds[v] is the smallest linear value that converts to sRGB value v */
+static float srgb_thresholds[256];
+/* unpremultiply_factors[a] is 255 / a in 16.16 fixed point, rounded up */
+static DWORD unpremultiply_factors[256];
+
+static inline BYTE srgb_from_linear(float f)
+{
+    return floorf(to_sRGB_component(f) * 255.0f + 0.51f);
+}
+
+static BOOL WINAPI init_tables(INIT_ONCE *once, void *param, void **context)
+{
+    DWORD lo, hi, mid;
+    float f;
+    UINT i;
+
+    /* the conversion is monotonic, so search the float bit patterns between 0 and 1 */
+    for (i = 1; i < 256; i++)
+    {
+        lo = 0;
+        hi = 0x3f800001; /* 1.0f + 1 ulp */
+        while (lo < hi)
+        {
+            mid = lo + (hi - lo) / 2;
+            memcpy(&f, &mid, sizeof(f));
+            if (srgb_from_linear(f) >= i) hi = mid;
+            else lo = mid + 1;
+        }
+        memcpy(&srgb_thresholds[i], &lo, sizeof(f));
+    }
+
+    for (i = 1; i < 256; i++)
+        unpremultiply_factors[i] = (255 * 65536 + i - 1) / i;
+
+    return TRUE;
+}
+
+static inline void init_conversion_tables(void)
+{
+    InitOnceExecuteOnce(&init_tables_once, init_tables, NULL, NULL);
+}
+
+/* same result as srgb_from_linear(), using a binary search instead of powf */
+static inline BYTE to_sRGB_byte(float f)
+{
+    UINT i = 0;
+
+    if (!(f >= 0.0f && f <= 1.0f)) return srgb_from_linear(f);
+
+    if (f >= srgb_thresholds[i + 128]) i += 128;
+    if (f >= srgb_thresholds[i + 64]) i += 64;
+    if (f >= srgb_thresholds[i + 32]) i += 32;
+    if (f >= srgb_thresholds[i + 16]) i += 16;
+    if (f >= srgb_thresholds[i + 8]) i += 8;
+    if (f >= srgb_thresholds[i + 4]) i += 4;
+    if (f >= srgb_thresholds[i + 2]) i += 2;
+    if (f >= srgb_thresholds[i + 1]) i += 1;
+    return i;
+}
+
+static void convert_bgr24_to_bgra32(const BYTE *src, DWORD *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 3)
+        dst[x] = 0xff000000 | (src[2] << 16) | (src[1] << 8) | src[0];
+}
+
+static void convert_rgb24_to_bgra32(const BYTE *src, DWORD *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 3)
+        dst[x] = 0xff000000 | (src[0] << 16) | (src[1] << 8) | src[2];
+}
+
+static void convert_gray8_to_bgra32(const BYTE *src, DWORD *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++)
+        dst[x] = 0xff000000 | (src[x] << 16) | (src[x] << 8) | src[x];
+}
+
+static void convert_bgra32_to_bgr24(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 4, dst += 3)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+    }
+}
+
+static void convert_bgra32_to_rgb24(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, src += 4, dst += 3)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+    }
+}
+
+/* (c * a + 127) / 255 without a division, exact for all 8-bit inputs */
+static inline BYTE premultiply_component(BYTE c, BYTE a)
+{
+    return ((c * a + 127) * 0x8081) >> 23;
+}
+
+static void premultiply_row(BYTE *pixel, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, pixel += 4)
+    {
+        BYTE alpha = pixel[3];
+        pixel[0] = premultiply_component(pixel[0], alpha);
+        pixel[1] = premultiply_component(pixel[1], alpha);
+        pixel[2] = premultiply_component(pixel[2], alpha);
+    }
+}
+
+/* c * 255 / a, using the precomputed reciprocals of the alpha values */
+static void unpremultiply_row(BYTE *pixel, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, pixel += 4)
+    {
+        BYTE alpha = pixel[3];
+        if (alpha != 0 && alpha != 255)
+        {
+            DWORD factor = unpremultiply_factors[alpha];
+            pixel[0] = (pixel[0] * factor) >> 16;
+            pixel[1] = (pixel[1] * factor) >> 16;
+            pixel[2] = (pixel[2] * factor) >> 16;
+        }
+    }
+}
+
 static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter *iface)
 {
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
@@ -337,13 +484,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcbyte;
             BYTE *dstrow;
-            DWORD *dstpixel;
 
             srcstride = prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -358,13 +503,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                    {
-                        *dstpixel++ = 0xff000000|(*srcbyte<<16)|(*srcbyte<<8)|*srcbyte;
-                        srcbyte++;
-                    }
+                    convert_gray8_to_bgra32(srcrow, (DWORD *)dstrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -619,13 +758,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -640,14 +777,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
+                    convert_bgr24_to_bgra32(srcrow, (DWORD *)dstrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -662,14 +792,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -684,18 +811,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
+                    convert_rgb24_to_bgra32(srcrow, (DWORD *)dstrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -738,22 +854,13 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+                unpremultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
     case format_48bppRGB:
@@ -902,22 +1009,13 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppPRGBA:
         if (prc)
         {
-            INT x, y;
+            INT y;
 
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+                unpremultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
 
@@ -976,19 +1074,10 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
         {
-            INT x, y;
+            INT y;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = (pbBuffer[cbStride*y+4*x] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+1] = (pbBuffer[cbStride*y+4*x+1] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+2] = (pbBuffer[cbStride*y+4*x+2] * alpha + 127) / 255;
-                    }
-                }
+                premultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return hr;
     }
@@ -1009,19 +1098,10 @@ static HRESULT copypixels_to_32bppPRGBA(struct FormatConverter *This, const WICR
         hr = copypixels_to_32bppRGBA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
         {
-            INT x, y;
+            INT y;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = (pbBuffer[cbStride*y+4*x] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+1] = (pbBuffer[cbStride*y+4*x+1] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+2] = (pbBuffer[cbStride*y+4*x+2] * alpha + 127) / 255;
-                    }
-                }
+                premultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return hr;
     }
@@ -1051,13 +1131,11 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -1072,37 +1150,14 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
                 srcrow = srcdata;
                 dstrow = pbBuffer;
 
-                if (source_format == format_32bppRGBA)
-                {
-                    for (y = 0; y < prc->Height; y++)
-                    {
-                        srcpixel = srcrow;
-                        dstpixel = dstrow;
-                        for (x = 0; x < prc->Width; x++) {
-                            *dstpixel++ = srcpixel[2]; /* blue */
-                            *dstpixel++ = srcpixel[1]; /* green */
-                            *dstpixel++ = srcpixel[0]; /* red */
-                            srcpixel += 4;
-                        }
-                        srcrow += srcstride;
-                        dstrow += cbStride;
-                    }
-                }
-                else
+                for (y = 0; y < prc->Height; y++)
                 {
-                    for (y = 0; y < prc->Height; y++)
-                    {
-                        srcpixel = srcrow;
-                        dstpixel = dstrow;
-                        for (x = 0; x < prc->Width; x++) {
-                            *dstpixel++ = *srcpixel++; /* blue */
-                            *dstpixel++ = *srcpixel++; /* green */
-                            *dstpixel++ = *srcpixel++; /* red */
-                            srcpixel++; /* alpha */
-                        }
-                        srcrow += srcstride;
-                        dstrow += cbStride;
-                    }
+                    if (source_format == format_32bppRGBA)
+                        convert_bgra32_to_rgb24(srcrow, dstrow, prc->Width);
+                    else
+                        convert_bgra32_to_bgr24(srcrow, dstrow, prc->Width);
+                    srcrow += srcstride;
+                    dstrow += cbStride;
                 }
             }
 
@@ -1138,7 +1193,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
 
                     for (x = 0; x < prc->Width; x++)
                     {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
+                        BYTE gray = to_sRGB_byte(gray_float[x]);
                         *bgr++ = gray;
                         *bgr++ = gray;
                         *bgr++ = gray;
@@ -1225,14 +1280,11 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -1247,18 +1299,7 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* blue */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-
-                        *dstpixel++=tmppixel[2]; /* red */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* blue */
-                    }
+                    convert_bgra32_to_rgb24(srcrow, dstrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -1357,7 +1398,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
                     BYTE *dstpixel = dst;
 
                     for (x=0; x < prc->Width; x++)
-                        *dstpixel++ = (BYTE)floorf(to_sRGB_component(*srcpixel++) * 255.0f + 0.51f);
+                        *dstpixel++ = to_sRGB_byte(*srcpixel++);
 
                     src += srcstride;
                     dst += cbStride;
@@ -1393,8 +1434,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
             {
                 float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
 
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
+                dst[x] = to_sRGB_byte(gray);
                 bgr += 3;
             }
             src += srcstride;
@@ -1755,6 +1795,7 @@ static HRESULT WINAPI FormatConverter_Initialize(IWICFormatConverter *iface,
 
     if (dstinfo->copy_function)
     {
+        init_conversion_tables();
         IWICBitmapSource_AddRef(source);
         This->src_format = srcinfo;
         This->dst_format = dstinfo;
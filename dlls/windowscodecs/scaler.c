@@ -18,6 +18,7 @@
  */
 
 #include <stdarg.h>
+#include <math.h>
 
 #define COBJMACROS
 
@@ -31,6 +32,21 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* filter weights are fixed point numbers with FILTER_BITS fractional bits */
+#define FILTER_BITS 14
+/* extra precision kept between the vertical and the horizontal pass */
+#define FILTER_EXTRA_BITS 7
+
+/* maximum size of the source data buffer used by CopyPixels */
+#define MAX_SOURCE_BUFFER (4 * 1024 * 1024)
+
+struct scaler_filter
+{
+    UINT taps;     /* number of source pixels contributing to a destination pixel */
+    UINT *start;   /* first contributing source pixel, for each destination pixel */
+    INT *weights;  /* weights of the contributing source pixels, for each destination pixel */
+};
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -42,6 +58,9 @@ typedef struct BitmapScaler {
     UINT bpp;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    struct scaler_filter x_filter, y_filter;
+    INT *line; /* result of the vertical pass for one destination scanline */
+    BOOL premultiply; /* straight alpha, filtered as premultiplied alpha */
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
@@ -94,6 +113,14 @@ static ULONG WINAPI BitmapScaler_AddRef(IWICBitmapScaler *iface)
     return ref;
 }
 
+static void free_filter(struct scaler_filter *filter)
+{
+    HeapFree(GetProcessHeap(), 0, filter->start);
+    HeapFree(GetProcessHeap(), 0, filter->weights);
+    filter->start = NULL;
+    filter->weights = NULL;
+}
+
 static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
 {
     BitmapScaler *This = impl_from_IWICBitmapScaler(iface);
@@ -106,6 +133,9 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        free_filter(&This->x_filter);
+        free_filter(&This->y_filter);
+        HeapFree(GetProcessHeap(), 0, This->line);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -203,6 +233,238 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     }
 }
 
+/* Catmull-Rom spline, the cubic convolution kernel with a = -0.5 */
+static double cubic_kernel(double x)
+{
+    x = fabs(x);
+    if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+static double linear_kernel(double x)
+{
+    x = fabs(x);
+    return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+/* compute the contribution of source pixel src to destination pixel dst */
+static double filter_weight(WICBitmapInterpolationMode mode, double scale, UINT dst, int src)
+{
+    double center = (dst + 0.5) * scale - 0.5;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeFant:
+        if (scale > 1.0)
+        {
+            /* area average: overlap of the source pixel with the destination pixel */
+            double left = max(dst * scale, src), right = min((dst + 1) * scale, src + 1.0);
+            return right > left ? right - left : 0.0;
+        }
+        /* fall through */
+    case WICBitmapInterpolationModeLinear:
+        return linear_kernel(src - center);
+    case WICBitmapInterpolationModeHighQualityCubic:
+        /* stretch the kernel when downscaling to avoid aliasing */
+        if (scale > 1.0) return cubic_kernel((src - center) / scale);
+        /* fall through */
+    default:
+        return cubic_kernel(src - center);
+    }
+}
+
+/* return the range of source pixels that may contribute to destination pixel dst */
+static void filter_range(WICBitmapInterpolationMode mode, double scale, UINT dst, int *first, int *last)
+{
+    double center = (dst + 0.5) * scale - 0.5, support;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeFant:
+        if (scale > 1.0)
+        {
+            *first = floor(dst * scale);
+            *last = ceil((dst + 1) * scale) - 1;
+            return;
+        }
+        /* fall through */
+    case WICBitmapInterpolationModeLinear:
+        support = 1.0;
+        break;
+    case WICBitmapInterpolationModeHighQualityCubic:
+        support = 2.0 * max(scale, 1.0);
+        break;
+    default:
+        support = 2.0;
+        break;
+    }
+    *first = ceil(center - support);
+    *last = floor(center + support);
+}
+
+/* Precompute the fixed point weights used to resample src_size pixels into
+ * dst_size pixels. Every destination pixel uses the same number of taps, which
+ * keeps the inner loops simple; source pixels outside of the image are clamped
+ * to the edges. */
+static HRESULT init_filter(struct scaler_filter *filter, WICBitmapInterpolationMode mode,
+    UINT src_size, UINT dst_size)
+{
+    double scale = (double)src_size / dst_size, weights[64], *w = weights, sum;
+    int first, last, src;
+    UINT dst, i, taps = 1, start, largest;
+    INT total;
+
+    for (dst = 0; dst < dst_size; dst++)
+    {
+        filter_range(mode, scale, dst, &first, &last);
+        first = max(first, 0);
+        last = min(last, (int)src_size - 1);
+        if (last >= first) taps = max(taps, (UINT)(last - first + 1));
+    }
+
+    filter->taps = taps;
+    filter->start = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(*filter->start));
+    filter->weights = HeapAlloc(GetProcessHeap(), 0, dst_size * taps * sizeof(*filter->weights));
+    if (taps > ARRAY_SIZE(weights)) w = HeapAlloc(GetProcessHeap(), 0, taps * sizeof(*w));
+    if (!filter->start || !filter->weights || !w)
+    {
+        if (w != weights) HeapFree(GetProcessHeap(), 0, w);
+        free_filter(filter);
+        return E_OUTOFMEMORY;
+    }
+
+    for (dst = 0; dst < dst_size; dst++)
+    {
+        INT *out = filter->weights + dst * taps;
+
+        filter_range(mode, scale, dst, &first, &last);
+        start = min(max(first, 0), (int)(src_size - taps));
+        filter->start[dst] = start;
+
+        for (i = 0; i < taps; i++) w[i] = 0.0;
+        for (src = first, sum = 0.0; src <= last; src++)
+        {
+            double weight = filter_weight(mode, scale, dst, src);
+            w[min(max(src, 0), (int)src_size - 1) - start] += weight;
+            sum += weight;
+        }
+        if (sum == 0.0)  /* can only happen with degenerate sizes */
+        {
+            w[min(max((int)((dst + 0.5) * scale), 0), (int)src_size - 1) - start] = 1.0;
+            sum = 1.0;
+        }
+
+        /* normalize, and make sure the weights add up exactly to 1 */
+        for (i = 0, total = 0, largest = 0; i < taps; i++)
+        {
+            out[i] = floor(w[i] / sum * (1 << FILTER_BITS) + 0.5);
+            total += out[i];
+            if (out[i] > out[largest]) largest = i;
+        }
+        out[largest] += (1 << FILTER_BITS) - total;
+    }
+
+    if (w != weights) HeapFree(GetProcessHeap(), 0, w);
+    return S_OK;
+}
+
+static void Filter_GetRequiredSourceRect(BitmapScaler *This,
+    UINT x, UINT y, WICRect *src_rect)
+{
+    src_rect->X = This->x_filter.start[x];
+    src_rect->Y = This->y_filter.start[y];
+    src_rect->Width = This->x_filter.taps;
+    src_rect->Height = This->y_filter.taps;
+}
+
+static inline BYTE clamp_pixel(INT value)
+{
+    value = (value + (1 << (FILTER_BITS * 2 - FILTER_EXTRA_BITS - 1))) >> (FILTER_BITS * 2 - FILTER_EXTRA_BITS);
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+/* Separable resampling of formats with 8 bits per channel. The vertical pass
+ * produces a single intermediate line, and the loops work on contiguous
+ * arrays of channels so that the compiler can vectorize them. */
+static void Filter_CopyScanline(BitmapScaler *This,
+    UINT dst_x, UINT dst_y, UINT dst_width,
+    BYTE **src_data, UINT src_data_x, UINT src_data_y, BYTE *pbBuffer)
+{
+    UINT bytesperpixel = This->bpp / 8;
+    UINT taps_x = This->x_filter.taps, taps_y = This->y_filter.taps;
+    UINT first = This->x_filter.start[dst_x];
+    UINT count = (This->x_filter.start[dst_x + dst_width - 1] + taps_x - first) * bytesperpixel;
+    const INT *weights = This->y_filter.weights + dst_y * taps_y;
+    BYTE **rows = src_data + This->y_filter.start[dst_y] - src_data_y;
+    UINT offset = (first - src_data_x) * bytesperpixel;
+    INT *line = This->line;
+    UINT i, j, k;
+
+    memset(line, 0, count * sizeof(*line));
+    for (k = 0; k < taps_y; k++)
+    {
+        const BYTE *src = rows[k] + offset;
+        INT weight = weights[k];
+
+        if (!weight) continue;
+        for (i = 0; i < count; i++) line[i] += weight * src[i];
+    }
+    for (i = 0; i < count; i++)
+        line[i] = (line[i] + (1 << (FILTER_BITS - FILTER_EXTRA_BITS - 1))) >> (FILTER_BITS - FILTER_EXTRA_BITS);
+
+    for (i = 0; i < dst_width; i++)
+    {
+        const INT *src = line + (This->x_filter.start[dst_x + i] - first) * bytesperpixel;
+        BYTE *dst = pbBuffer + i * bytesperpixel;
+
+        weights = This->x_filter.weights + (dst_x + i) * taps_x;
+        for (j = 0; j < bytesperpixel; j++)
+        {
+            INT sum = 0;
+            for (k = 0; k < taps_x; k++) sum += weights[k] * src[k * bytesperpixel + j];
+            dst[j] = clamp_pixel(sum);
+        }
+        if (This->premultiply)
+        {
+            BYTE alpha = dst[3];
+            for (j = 0; j < 3; j++)
+                dst[j] = alpha ? (min(dst[j], alpha) * 255 + alpha / 2) / alpha : 0;
+        }
+    }
+}
+
+/* premultiply straight alpha source pixels before filtering them */
+static void premultiply_pixels(BYTE *pixel, UINT count)
+{
+    UINT i, j;
+
+    for (i = 0; i < count; i++, pixel += 4)
+        for (j = 0; j < 3; j++) pixel[j] = (pixel[j] * pixel[3] + 127) / 255;
+}
+
+/* formats that can be resampled by Filter_CopyScanline */
+static BOOL is_filter_format(const WICPixelFormatGUID *format)
+{
+    static const WICPixelFormatGUID *formats[] =
+    {
+        &GUID_WICPixelFormat8bppGray,
+        &GUID_WICPixelFormat24bppBGR,
+        &GUID_WICPixelFormat24bppRGB,
+        &GUID_WICPixelFormat32bppBGR,
+        &GUID_WICPixelFormat32bppBGRA,
+        &GUID_WICPixelFormat32bppPBGRA,
+        &GUID_WICPixelFormat32bppRGB,
+        &GUID_WICPixelFormat32bppRGBA,
+        &GUID_WICPixelFormat32bppPRGBA,
+    };
+    UINT i;
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+        if (IsEqualGUID(format, formats[i])) return TRUE;
+    return FALSE;
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -210,12 +472,12 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     HRESULT hr;
     WICRect dest_rect;
     WICRect src_rect_ul, src_rect_br, src_rect;
-    BYTE **src_rows;
-    BYTE *src_bits;
+    BYTE **src_rows = NULL;
+    BYTE *src_bits = NULL;
     ULONG bytesperrow;
     ULONG src_bytesperrow;
-    ULONG buffer_size;
-    UINT y;
+    ULONG buffer_size, bits_size = 0;
+    UINT y, i, strip, rows_size = 0;
 
     TRACE("(%p,%s,%u,%u,%p)\n", iface, debug_wic_rect(prc), cbStride, cbBufferSize, pbBuffer);
 
@@ -263,43 +525,68 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
      * once, by saving the data that will be useful for the next scanline after
      * the call returns. The GetRequiredSourceRect/CopyScanline functions are
      * designed to make it possible to do this in a generic way, but for now we
-     * just grab all the data we need in each call. */
+     * just grab all the data we need in each call. To keep memory use bounded
+     * for huge images, the destination is processed in strips of scanlines
+     * whose source data fits in MAX_SOURCE_BUFFER. */
 
-    This->fn_get_required_source_rect(This, dest_rect.X, dest_rect.Y, &src_rect_ul);
-    This->fn_get_required_source_rect(This, dest_rect.X+dest_rect.Width-1,
-        dest_rect.Y+dest_rect.Height-1, &src_rect_br);
+    hr = S_OK;
+    if (!dest_rect.Width) goto end;
 
-    src_rect.X = src_rect_ul.X;
-    src_rect.Y = src_rect_ul.Y;
-    src_rect.Width = src_rect_br.Width + src_rect_br.X - src_rect_ul.X;
-    src_rect.Height = src_rect_br.Height + src_rect_br.Y - src_rect_ul.Y;
+    for (y = 0; y < dest_rect.Height; y += strip)
+    {
+        strip = dest_rect.Height - y;
+        for (;;)
+        {
+            This->fn_get_required_source_rect(This, dest_rect.X, dest_rect.Y+y, &src_rect_ul);
+            This->fn_get_required_source_rect(This, dest_rect.X+dest_rect.Width-1,
+                dest_rect.Y+y+strip-1, &src_rect_br);
 
-    src_bytesperrow = (src_rect.Width * This->bpp + 7)/8;
-    buffer_size = src_bytesperrow * src_rect.Height;
+            src_rect.X = src_rect_ul.X;
+            src_rect.Y = src_rect_ul.Y;
+            src_rect.Width = src_rect_br.Width + src_rect_br.X - src_rect_ul.X;
+            src_rect.Height = src_rect_br.Height + src_rect_br.Y - src_rect_ul.Y;
 
-    src_rows = HeapAlloc(GetProcessHeap(), 0, sizeof(BYTE*) * src_rect.Height);
-    src_bits = HeapAlloc(GetProcessHeap(), 0, buffer_size);
+            src_bytesperrow = (src_rect.Width * This->bpp + 7)/8;
+            buffer_size = src_bytesperrow * src_rect.Height;
 
-    if (!src_rows || !src_bits)
-    {
-        HeapFree(GetProcessHeap(), 0, src_rows);
-        HeapFree(GetProcessHeap(), 0, src_bits);
-        hr = E_OUTOFMEMORY;
-        goto end;
-    }
+            if (strip == 1 || buffer_size <= MAX_SOURCE_BUFFER) break;
+            strip = max(1, min(strip - 1, (UINT)((ULONGLONG)strip * MAX_SOURCE_BUFFER / buffer_size)));
+        }
 
-    for (y=0; y<src_rect.Height; y++)
-        src_rows[y] = src_bits + y * src_bytesperrow;
+        if (src_rect.Height > rows_size)
+        {
+            HeapFree(GetProcessHeap(), 0, src_rows);
+            if (!(src_rows = HeapAlloc(GetProcessHeap(), 0, sizeof(BYTE*) * src_rect.Height)))
+            {
+                hr = E_OUTOFMEMORY;
+                break;
+            }
+            rows_size = src_rect.Height;
+        }
+        if (buffer_size > bits_size)
+        {
+            HeapFree(GetProcessHeap(), 0, src_bits);
+            if (!(src_bits = HeapAlloc(GetProcessHeap(), 0, buffer_size)))
+            {
+                hr = E_OUTOFMEMORY;
+                break;
+            }
+            bits_size = buffer_size;
+        }
 
-    hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_bytesperrow,
-        buffer_size, src_bits);
+        for (i=0; i<src_rect.Height; i++)
+            src_rows[i] = src_bits + i * src_bytesperrow;
 
-    if (SUCCEEDED(hr))
-    {
-        for (y=0; y < dest_rect.Height; y++)
+        hr = IWICBitmapSource_CopyPixels(This->source, &src_rect, src_bytesperrow,
+            buffer_size, src_bits);
+        if (FAILED(hr)) break;
+
+        if (This->premultiply) premultiply_pixels(src_bits, buffer_size / 4);
+
+        for (i=0; i < strip; i++)
         {
-            This->fn_copy_scanline(This, dest_rect.X, dest_rect.Y+y, dest_rect.Width,
-                src_rows, src_rect.X, src_rect.Y, pbBuffer + cbStride * y);
+            This->fn_copy_scanline(This, dest_rect.X, dest_rect.Y+y+i, dest_rect.Width,
+                src_rows, src_rect.X, src_rect.Y, pbBuffer + cbStride * (y+i));
         }
     }
 
@@ -351,10 +638,39 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+        case WICBitmapInterpolationModeHighQualityCubic:
+            if (is_filter_format(&src_pixelformat))
+            {
+                if (SUCCEEDED(hr = init_filter(&This->x_filter, mode, This->src_width, uiWidth)) &&
+                    SUCCEEDED(hr = init_filter(&This->y_filter, mode, This->src_height, uiHeight)) &&
+                    !(This->line = HeapAlloc(GetProcessHeap(), 0,
+                                             This->src_width * (This->bpp / 8) * sizeof(*This->line))))
+                    hr = E_OUTOFMEMORY;
+                if (FAILED(hr))
+                {
+                    free_filter(&This->x_filter);
+                    free_filter(&This->y_filter);
+                    break;
+                }
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+                This->premultiply = IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppBGRA) ||
+                                    IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppRGBA);
+                This->fn_get_required_source_rect = Filter_GetRequiredSourceRect;
+                This->fn_copy_scanline = Filter_CopyScanline;
+                break;
+            }
+            FIXME("mode %i not supported for format %s, using nearest neighbor\n",
+                  mode, debugstr_guid(&src_pixelformat));
+            goto nearest_neighbor;
         default:
             FIXME("unsupported mode %i\n", mode);
             /* fall-through */
         case WICBitmapInterpolationModeNearestNeighbor:
+        nearest_neighbor:
             if ((This->bpp % 8) == 0)
             {
                 IWICBitmapSource_AddRef(pISource);
@@ -527,6 +843,10 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    This->premultiply = FALSE;
+    This->x_filter.start = This->y_filter.start = NULL;
+    This->x_filter.weights = This->y_filter.weights = NULL;
+    This->line = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
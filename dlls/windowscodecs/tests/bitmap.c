@@ -19,6 +19,7 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <math.h>
 
@@ -1312,6 +1313,135 @@ static void test_bitmap_scaler(void)
     IWICBitmap_Release(bitmap);
 }
 
+static void test_bitmap_scaler_modes(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeNearestNeighbor,
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant,
+        WICBitmapInterpolationModeHighQualityCubic,
+    };
+    static const BYTE blocks[4 * 4 * 4] =
+    {
+        0x00,0x10,0x20,0xff, 0x40,0x50,0x60,0xff, 0x80,0x80,0x80,0xff, 0x80,0x80,0x80,0xff,
+        0x40,0x50,0x60,0xff, 0x00,0x10,0x20,0xff, 0x80,0x80,0x80,0xff, 0x80,0x80,0x80,0xff,
+        0xff,0xff,0xff,0xff, 0xff,0xff,0xff,0xff, 0x10,0x10,0x10,0xff, 0x30,0x30,0x30,0xff,
+        0xff,0xff,0xff,0xff, 0xff,0xff,0xff,0xff, 0x30,0x30,0x30,0xff, 0x10,0x10,0x10,0xff,
+    };
+    static const BYTE expect_fant[2 * 2 * 4] =
+    {
+        0x20,0x30,0x40,0xff, 0x80,0x80,0x80,0xff,
+        0xff,0xff,0xff,0xff, 0x20,0x20,0x20,0xff,
+    };
+    /* transparent pixels must not bleed their color into the result */
+    static const BYTE straight_alpha[2 * 2 * 4] =
+    {
+        0x00,0x00,0xff,0xff, 0xff,0xff,0xff,0x00,
+        0x00,0x00,0xff,0xff, 0xff,0xff,0xff,0x00,
+    };
+    static const BYTE expect_straight_alpha[4] = { 0x00,0x00,0xff,0x80 };
+    LARGE_INTEGER freq, start, end;
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    BYTE *bits, buf[256 * 4];
+    UINT i, j, y;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 4, &GUID_WICPixelFormat32bppBGRA,
+        16, sizeof(blocks), (BYTE *)blocks, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#lx.\n", hr);
+
+    /* an exact 2:1 reduction averages the blocks */
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "Failed to create bitmap scaler, hr %#lx.\n", hr);
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 2, 2, WICBitmapInterpolationModeFant);
+    ok(hr == S_OK, "Failed to initialize bitmap scaler, hr %#lx.\n", hr);
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 8, sizeof(buf), buf);
+    ok(hr == S_OK, "Failed to copy pixels, hr %#lx.\n", hr);
+    for (i = 0; i < sizeof(expect_fant); i++)
+        ok(abs(buf[i] - expect_fant[i]) <= 1, "%u: got %#x, expected %#x.\n", i, buf[i], expect_fant[i]);
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 2, 2, &GUID_WICPixelFormat32bppBGRA,
+        8, sizeof(straight_alpha), (BYTE *)straight_alpha, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#lx.\n", hr);
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "Failed to create bitmap scaler, hr %#lx.\n", hr);
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 1, 1, WICBitmapInterpolationModeFant);
+    ok(hr == S_OK, "Failed to initialize bitmap scaler, hr %#lx.\n", hr);
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 4, sizeof(buf), buf);
+    ok(hr == S_OK, "Failed to copy pixels, hr %#lx.\n", hr);
+    for (i = 0; i < sizeof(expect_straight_alpha); i++)
+        ok(abs(buf[i] - expect_straight_alpha[i]) <= 1, "%u: got %#x, expected %#x.\n",
+           i, buf[i], expect_straight_alpha[i]);
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+
+    /* a uniform image stays uniform whatever the filter */
+    memset(buf, 0x5a, sizeof(buf));
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 16, 16, &GUID_WICPixelFormat24bppBGR,
+        48, 48 * 16, buf, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#lx.\n", hr);
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+        ok(hr == S_OK, "Failed to create bitmap scaler, hr %#lx.\n", hr);
+        hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 5, 37, modes[i]);
+        ok(hr == S_OK || broken(hr == E_INVALIDARG && modes[i] == WICBitmapInterpolationModeHighQualityCubic),
+           "%u: Failed to initialize bitmap scaler, hr %#lx.\n", i, hr);
+        if (hr == S_OK)
+        {
+            memset(buf, 0, sizeof(buf));
+            hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 15, 15 * 37, buf);
+            ok(hr == S_OK, "%u: Failed to copy pixels, hr %#lx.\n", i, hr);
+            for (j = 0; j < 15 * 37; j++)
+                if (buf[j] != 0x5a) break;
+            ok(j == 15 * 37, "%u: got %#x at %u.\n", i, buf[j], j);
+        }
+        IWICBitmapScaler_Release(scaler);
+    }
+    IWICBitmap_Release(bitmap);
+
+    if (!winetest_interactive) return;
+
+    /* thumbnail of a 4K image, one scanline at a time */
+    bits = HeapAlloc(GetProcessHeap(), 0, 3840 * 2160 * 4);
+    ok(bits != NULL, "Failed to allocate the 4K image.\n");
+    if (!bits) return;
+    for (i = 0; i < 3840 * 2160 * 4; i++) bits[i] = i * 7 + i / 15360;
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 3840, 2160, &GUID_WICPixelFormat32bppBGRA,
+        3840 * 4, 3840 * 2160 * 4, bits, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#lx.\n", hr);
+    QueryPerformanceFrequency(&freq);
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        WICRect rect = {0, 0, 256, 1};
+
+        hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+        ok(hr == S_OK, "Failed to create bitmap scaler, hr %#lx.\n", hr);
+        hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 256, 144, modes[i]);
+        if (hr == S_OK)
+        {
+            QueryPerformanceCounter(&start);
+            for (y = 0; y < 144; y++)
+            {
+                rect.Y = y;
+                hr = IWICBitmapScaler_CopyPixels(scaler, &rect, 256 * 4, sizeof(buf), buf);
+                ok(hr == S_OK, "%u: Failed to copy pixels, hr %#lx.\n", i, hr);
+            }
+            QueryPerformanceCounter(&end);
+            trace("mode %u: 4K to 256px in %.2f ms\n", modes[i],
+                  (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart);
+        }
+        IWICBitmapScaler_Release(scaler);
+    }
+    IWICBitmap_Release(bitmap);
+    HeapFree(GetProcessHeap(), 0, bits);
+}
+
 static LONG obj_refcount(void *obj)
 {
     IUnknown_AddRef((IUnknown *)obj);
@@ -1482,6 +1612,7 @@ START_TEST(bitmap)
     test_CreateBitmapFromHBITMAP();
     test_clipper();
     test_bitmap_scaler();
+    test_bitmap_scaler_modes();
 
     IWICImagingFactory_Release(factory);
 
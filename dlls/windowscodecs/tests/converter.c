@@ -1999,6 +1999,240 @@ static void test_converter_8bppIndexed(void)
     DeleteTestBitmap(src_obj);
 }
 
+static BYTE premultiply_ref(BYTE c, BYTE a)
+{
+    return a == 255 ? c : (c * a + 127) / 255;
+}
+
+static BYTE unpremultiply_ref(BYTE c, BYTE a)
+{
+    return a == 0 || a == 255 ? c : c * 255 / a;
+}
+
+static BYTE srgb_ref(float f)
+{
+    if (f <= 0.0031308f) f = 12.92f * f;
+    else f = 1.055f * powf(f, 1.0f/2.4f) - 0.055f;
+    return floorf(f * 255.0f + 0.51f);
+}
+
+static void check_converted_pixels(const WICPixelFormatGUID *src_format, const WICPixelFormatGUID *dst_format,
+    UINT width, UINT height, UINT src_bpp, UINT dst_bpp, BYTE *src_bits, const BYTE *expected, const char *name)
+{
+    UINT i, size = width * height * dst_bpp / 8, mismatches = 0, first = 0, large = 0;
+    IWICBitmapSource *converted;
+    IWICBitmap *bitmap;
+    BYTE *dst_bits;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, width, height, src_format,
+        width * src_bpp / 8, width * height * src_bpp / 8, src_bits, &bitmap);
+    ok(hr == S_OK, "%s: CreateBitmapFromMemory error %#lx\n", name, hr);
+    if (hr != S_OK) return;
+
+    hr = WICConvertBitmapSource(dst_format, (IWICBitmapSource *)bitmap, &converted);
+    ok(hr == S_OK, "%s: WICConvertBitmapSource error %#lx\n", name, hr);
+    if (hr == S_OK)
+    {
+        dst_bits = HeapAlloc(GetProcessHeap(), 0, size);
+        hr = IWICBitmapSource_CopyPixels(converted, NULL, width * dst_bpp / 8, size, dst_bits);
+        ok(hr == S_OK, "%s: CopyPixels error %#lx\n", name, hr);
+        for (i = 0; i < size; i++)
+        {
+            if (dst_bits[i] == expected[i]) continue;
+            if (!mismatches++) first = i;
+            if (abs(dst_bits[i] - expected[i]) > 1) large++;
+        }
+        /* Windows may round differently */
+        ok(!mismatches || broken(!large), "%s: %u mismatches, first at byte %u: got %#x, expected %#x\n",
+           name, mismatches, first, dst_bits[first], expected[first]);
+        HeapFree(GetProcessHeap(), 0, dst_bits);
+        IWICBitmapSource_Release(converted);
+    }
+    IWICBitmap_Release(bitmap);
+}
+
+static void test_converter_exact(void)
+{
+    UINT i, j, x, y, count, bits, lo, hi, mid;
+    BYTE *src_bits, *expected;
+    float *gray, f;
+
+    src_bits = HeapAlloc(GetProcessHeap(), 0, 256 * 256 * 4);
+    expected = HeapAlloc(GetProcessHeap(), 0, 256 * 256 * 4);
+
+    /* every channel value with every alpha value, BGRA and RGBA only differ in the channel order */
+    for (y = 0; y < 256; y++)
+    {
+        for (x = 0; x < 256; x++)
+        {
+            BYTE *src = src_bits + (y * 256 + x) * 4, *dst = expected + (y * 256 + x) * 4;
+
+            src[0] = x;
+            src[1] = 255 - x;
+            src[2] = x ^ 0xaa;
+            src[3] = y;
+            for (i = 0; i < 3; i++) dst[i] = premultiply_ref(src[i], y);
+            dst[3] = y;
+        }
+    }
+    check_converted_pixels(&GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat32bppPBGRA, 256, 256, 32, 32,
+        src_bits, expected, "32bppBGRA -> 32bppPBGRA");
+    check_converted_pixels(&GUID_WICPixelFormat32bppRGBA, &GUID_WICPixelFormat32bppPRGBA, 256, 256, 32, 32,
+        src_bits, expected, "32bppRGBA -> 32bppPRGBA");
+
+    /* premultiplied channels can't exceed the alpha value */
+    for (y = 0; y < 256; y++)
+    {
+        for (x = 0; x < 256; x++)
+        {
+            BYTE *src = src_bits + (y * 256 + x) * 4, *dst = expected + (y * 256 + x) * 4;
+
+            src[0] = min(x, y);
+            src[1] = y - min(x, y);
+            src[2] = min(x ^ 0xaa, y);
+            src[3] = y;
+            for (i = 0; i < 3; i++) dst[i] = unpremultiply_ref(src[i], y);
+            dst[3] = y;
+        }
+    }
+    check_converted_pixels(&GUID_WICPixelFormat32bppPBGRA, &GUID_WICPixelFormat32bppBGRA, 256, 256, 32, 32,
+        src_bits, expected, "32bppPBGRA -> 32bppBGRA");
+    check_converted_pixels(&GUID_WICPixelFormat32bppPRGBA, &GUID_WICPixelFormat32bppRGBA, 256, 256, 32, 32,
+        src_bits, expected, "32bppPRGBA -> 32bppRGBA");
+
+    /* the exact channel values, then both sides of every sRGB step, then a regular grid */
+    gray = (float *)src_bits;
+    for (i = 0; i < 256; i++) gray[i] = i / 255.0f;
+    count = 256;
+    for (i = 1; i < 256; i++)
+    {
+        lo = 0;
+        hi = 0x3f800001; /* 1.0f + 1 ulp */
+        while (lo < hi)
+        {
+            mid = lo + (hi - lo) / 2;
+            memcpy(&f, &mid, sizeof(f));
+            if (srgb_ref(f) >= i) hi = mid;
+            else lo = mid + 1;
+        }
+        bits = lo - 1;
+        memcpy(&gray[count++], &bits, sizeof(f));
+        memcpy(&gray[count++], &lo, sizeof(f));
+    }
+    gray[count++] = 0.0031308f;
+    gray[count++] = 1.0f;
+    while (count < 4096)
+    {
+        gray[count] = (count - 768) / 3327.0f;
+        count++;
+    }
+    for (i = 0; i < 4096; i++)
+    {
+        expected[i] = srgb_ref(gray[i]);
+        for (j = 0; j < 3; j++) expected[4096 + 3 * i + j] = expected[i];
+    }
+    check_converted_pixels(&GUID_WICPixelFormat32bppGrayFloat, &GUID_WICPixelFormat8bppGray, 4096, 1, 32, 8,
+        src_bits, expected, "32bppGrayFloat -> 8bppGray");
+    check_converted_pixels(&GUID_WICPixelFormat32bppGrayFloat, &GUID_WICPixelFormat24bppBGR, 4096, 1, 32, 24,
+        src_bits, expected + 4096, "32bppGrayFloat -> 24bppBGR");
+
+    for (y = 0; y < 256; y++)
+    {
+        for (x = 0; x < 256; x++)
+        {
+            BYTE *src = src_bits + (y * 256 + x) * 3;
+
+            src[0] = x;
+            src[1] = y;
+            src[2] = x ^ y;
+            f = (src[2] * 0.2126f + src[1] * 0.7152f + src[0] * 0.0722f) / 255.0f;
+            expected[y * 256 + x] = srgb_ref(f);
+        }
+    }
+    check_converted_pixels(&GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat8bppGray, 256, 256, 24, 8,
+        src_bits, expected, "24bppBGR -> 8bppGray");
+
+    HeapFree(GetProcessHeap(), 0, src_bits);
+    HeapFree(GetProcessHeap(), 0, expected);
+}
+
+static void test_converter_throughput(void)
+{
+    static const struct
+    {
+        const WICPixelFormatGUID *src, *dst;
+        UINT src_bpp, dst_bpp;
+        const char *name;
+    }
+    tests[] =
+    {
+        { &GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat32bppBGRA, 24, 32, "24bppBGR -> 32bppBGRA" },
+        { &GUID_WICPixelFormat24bppRGB, &GUID_WICPixelFormat32bppBGRA, 24, 32, "24bppRGB -> 32bppBGRA" },
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat24bppBGR, 32, 24, "32bppBGRA -> 24bppBGR" },
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat24bppRGB, 32, 24, "32bppBGRA -> 24bppRGB" },
+        { &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat32bppPBGRA, 32, 32, "32bppBGRA -> 32bppPBGRA" },
+        { &GUID_WICPixelFormat32bppPBGRA, &GUID_WICPixelFormat32bppBGRA, 32, 32, "32bppPBGRA -> 32bppBGRA" },
+        { &GUID_WICPixelFormat8bppGray, &GUID_WICPixelFormat32bppBGRA, 8, 32, "8bppGray -> 32bppBGRA" },
+        { &GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat8bppGray, 24, 8, "24bppBGR -> 8bppGray" },
+        { &GUID_WICPixelFormat32bppBGR, &GUID_WICPixelFormat32bppGrayFloat, 32, 32, "32bppBGR -> 32bppGrayFloat" },
+        { &GUID_WICPixelFormat32bppGrayFloat, &GUID_WICPixelFormat8bppGray, 32, 8, "32bppGrayFloat -> 8bppGray" },
+    };
+    const UINT width = 1024, height = 1024;
+    LARGE_INTEGER freq, start, end;
+    IWICBitmapSource *converted;
+    BYTE *src_bits, *dst_bits;
+    IWICBitmap *bitmap;
+    UINT i, j, count;
+    HRESULT hr;
+
+    if (!winetest_interactive) return;
+
+    count = 20;
+    src_bits = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+    dst_bits = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+    QueryPerformanceFrequency(&freq);
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        if (tests[i].src == &GUID_WICPixelFormat32bppGrayFloat)
+        {
+            float *gray = (float *)src_bits;
+            for (j = 0; j < width * height; j++) gray[j] = (j % 4099) / 4098.0f;
+        }
+        else
+        {
+            for (j = 0; j < width * height * 4; j++) src_bits[j] = j * 7 + j / 4096;
+        }
+
+        hr = IWICImagingFactory_CreateBitmapFromMemory(factory, width, height, tests[i].src,
+            width * tests[i].src_bpp / 8, width * height * tests[i].src_bpp / 8, src_bits, &bitmap);
+        ok(hr == S_OK, "%s: CreateBitmapFromMemory error %#lx\n", tests[i].name, hr);
+        if (hr != S_OK) continue;
+
+        hr = WICConvertBitmapSource(tests[i].dst, (IWICBitmapSource *)bitmap, &converted);
+        ok(hr == S_OK, "%s: WICConvertBitmapSource error %#lx\n", tests[i].name, hr);
+        if (hr == S_OK)
+        {
+            QueryPerformanceCounter(&start);
+            for (j = 0; j < count; j++)
+            {
+                hr = IWICBitmapSource_CopyPixels(converted, NULL, width * tests[i].dst_bpp / 8,
+                    width * height * 4, dst_bits);
+                ok(hr == S_OK, "%s: CopyPixels error %#lx\n", tests[i].name, hr);
+            }
+            QueryPerformanceCounter(&end);
+            trace("%s: %.1f Mpixels/s\n", tests[i].name, (double)width * height * count * freq.QuadPart /
+                  max(end.QuadPart - start.QuadPart, 1) / 1000000.0);
+            IWICBitmapSource_Release(converted);
+        }
+        IWICBitmap_Release(bitmap);
+    }
+
+    HeapFree(GetProcessHeap(), 0, src_bits);
+    HeapFree(GetProcessHeap(), 0, dst_bits);
+}
+
 START_TEST(converter)
 {
     HRESULT hr;
@@ -2058,6 +2292,8 @@ START_TEST(converter)
     test_default_converter();
     test_converter_4bppGray();
     test_converter_8bppGray();
+    test_converter_exact();
+    test_converter_throughput();
     test_converter_8bppIndexed();
 
     test_encoder(&testdata_8bppIndexed, &CLSID_WICGifEncoder,
@@ -713,6 +713,7 @@ static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
     }
 
     InterlockedDecrement(&cs->pending_presents);
+    RtlWakeAddressAll(&cs->pending_presents);
 }
 
 void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *swapchain,
@@ -742,11 +743,22 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
 
     wined3d_device_context_submit(&cs->c, WINED3D_CS_QUEUE_DEFAULT);
 
+    if (TRACE_ON(d3d_perf))
+    {
+        LARGE_INTEGER freq;
+
+        QueryPerformanceFrequency(&freq);
+        TRACE_(d3d_perf)("%u packets, %lu bytes, %u coalesced, %u batches, %.3f ms waiting for the CS.\n",
+                cs->stats.packets, (unsigned long)cs->stats.bytes, cs->stats.coalesced, cs->stats.batches,
+                cs->stats.wait_time * 1000.0 / freq.QuadPart);
+    }
+    memset(&cs->stats, 0, sizeof(cs->stats));
+
     /* Limit input latency by limiting the number of presents that we can get
      * ahead of the worker thread. */
     while (pending >= swapchain->max_frame_latency)
     {
-        YieldProcessor();
+        RtlWaitOnAddress(&cs->pending_presents, &pending, sizeof(pending), NULL);
         pending = InterlockedCompareExchange(&cs->pending_presents, 0, 0);
     }
 }
@@ -3134,18 +3146,146 @@ static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs *cs, const struct
     return *(volatile ULONG *)&queue->head == queue->tail;
 }
 
+/* Packets that only update the CS state don't need to be made visible to the
+ * CS thread until something consumes that state, so they are batched until
+ * the next packet of another type. */
+static BOOL wined3d_cs_op_is_state_change(enum wined3d_cs_op opcode)
+{
+    return (opcode >= WINED3D_CS_OP_SET_PREDICATION && opcode <= WINED3D_CS_OP_SET_FEATURE_LEVEL)
+            || opcode == WINED3D_CS_OP_PUSH_CONSTANTS;
+}
+
+/* Returns a non-zero key for state changes that replace a single value, and
+ * that can therefore be merged with an earlier change of the same value. */
+static ULONG wined3d_cs_packet_coalesce_key(const void *data)
+{
+    enum wined3d_cs_op opcode = *(const enum wined3d_cs_op *)data;
+
+    switch (opcode)
+    {
+        case WINED3D_CS_OP_SET_RENDER_STATE:
+        {
+            const struct wined3d_cs_set_render_state *op = data;
+            return opcode << 24 | op->state;
+        }
+
+        case WINED3D_CS_OP_SET_TEXTURE_STATE:
+        {
+            const struct wined3d_cs_set_texture_state *op = data;
+            return opcode << 24 | op->stage << 12 | op->state;
+        }
+
+        case WINED3D_CS_OP_SET_SAMPLER_STATE:
+        {
+            const struct wined3d_cs_set_sampler_state *op = data;
+            return opcode << 24 | op->sampler_idx << 12 | op->state;
+        }
+
+        case WINED3D_CS_OP_SET_TRANSFORM:
+        {
+            const struct wined3d_cs_set_transform *op = data;
+            return opcode << 24 | op->state;
+        }
+
+        case WINED3D_CS_OP_SET_CLIP_PLANE:
+        {
+            const struct wined3d_cs_set_clip_plane *op = data;
+            return opcode << 24 | op->plane_idx;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+static BOOL wined3d_cs_queue_coalesce(struct wined3d_cs_queue *queue,
+        struct wined3d_cs *cs, struct wined3d_cs_packet *packet)
+{
+    struct wined3d_cs_coalesce_entry *entry;
+    struct wined3d_cs_packet *prev;
+    ULONG key;
+
+    if (queue != &cs->queue[WINED3D_CS_QUEUE_DEFAULT] || !(key = wined3d_cs_packet_coalesce_key(packet->data)))
+        return FALSE;
+
+    entry = &cs->coalesce[(key ^ (key >> 12) ^ (key >> 24)) % WINED3D_CS_COALESCE_SIZE];
+    /* The previous packet can only be replaced while the CS thread can't see it. */
+    if (entry->key == key && entry->offset - queue->head < queue->pending_head - queue->head)
+    {
+        prev = (struct wined3d_cs_packet *)&queue->data[entry->offset & WINED3D_CS_QUEUE_MASK];
+        if (prev->size == packet->size)
+        {
+            memcpy(prev->data, packet->data, packet->size);
+            ++cs->stats.coalesced;
+            return TRUE;
+        }
+    }
+
+    entry->key = key;
+    entry->offset = queue->pending_head;
+    return FALSE;
+}
+
+static void wined3d_cs_queue_flush(struct wined3d_cs_queue *queue, struct wined3d_cs *cs)
+{
+    if (queue->head == queue->pending_head)
+        return;
+
+    InterlockedExchange((LONG *)&queue->head, queue->pending_head);
+    ++cs->stats.batches;
+
+    if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
+        SetEvent(cs->event);
+}
+
 static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined3d_cs *cs)
 {
     struct wined3d_cs_packet *packet;
+    enum wined3d_cs_op opcode;
     size_t packet_size;
 
-    packet = (struct wined3d_cs_packet *)&queue->data[queue->head & WINED3D_CS_QUEUE_MASK];
-    TRACE("Queuing op %s at %p.\n", debug_cs_op(*(const enum wined3d_cs_op *)packet->data), packet);
+    packet = (struct wined3d_cs_packet *)&queue->data[queue->pending_head & WINED3D_CS_QUEUE_MASK];
+    opcode = *(const enum wined3d_cs_op *)packet->data;
+    TRACE("Queuing op %s at %p.\n", debug_cs_op(opcode), packet);
+
+    if (wined3d_cs_queue_coalesce(queue, cs, packet))
+        return;
+
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
-    InterlockedExchange((LONG *)&queue->head, queue->head + packet_size);
+    queue->pending_head += packet_size;
+    ++cs->stats.packets;
+    cs->stats.bytes += packet_size;
 
-    if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
-        SetEvent(cs->event);
+    if (queue != &cs->queue[WINED3D_CS_QUEUE_DEFAULT] || !wined3d_cs_op_is_state_change(opcode))
+        wined3d_cs_queue_flush(queue, cs);
+}
+
+/* Blocks until the CS thread moves the tail of the queue away from "tail". */
+static void wined3d_cs_queue_wait_tail(struct wined3d_cs_queue *queue, struct wined3d_cs *cs, ULONG tail)
+{
+    LARGE_INTEGER start, end;
+    unsigned int i;
+
+    if (TRACE_ON(d3d_perf))
+        QueryPerformanceCounter(&start);
+
+    for (i = 0; i < WINED3D_CS_WAIT_SPIN_COUNT; ++i)
+    {
+        if (*(volatile ULONG *)&queue->tail != tail)
+            goto done;
+        YieldProcessor();
+    }
+
+    InterlockedExchange(&queue->waiting_for_tail, TRUE);
+    RtlWaitOnAddress(&queue->tail, &tail, sizeof(tail), NULL);
+    InterlockedExchange(&queue->waiting_for_tail, FALSE);
+
+done:
+    if (TRACE_ON(d3d_perf))
+    {
+        QueryPerformanceCounter(&end);
+        cs->stats.wait_time += end.QuadPart - start.QuadPart;
+    }
 }
 
 static void wined3d_cs_mt_submit(struct wined3d_device_context *context, enum wined3d_cs_queue_id queue_id)
@@ -3163,7 +3303,7 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
     size_t queue_size = ARRAY_SIZE(queue->data);
     size_t header_size, packet_size, remaining;
     struct wined3d_cs_packet *packet;
-    ULONG head = queue->head & WINED3D_CS_QUEUE_MASK;
+    ULONG head = queue->pending_head & WINED3D_CS_QUEUE_MASK;
 
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
@@ -3190,13 +3330,14 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
             nop->opcode = WINED3D_CS_OP_NOP;
 
         wined3d_cs_queue_submit(queue, cs);
-        head = queue->head & WINED3D_CS_QUEUE_MASK;
+        head = queue->pending_head & WINED3D_CS_QUEUE_MASK;
         assert(!head);
     }
 
     for (;;)
     {
-        ULONG tail = (*(volatile ULONG *)&queue->tail) & WINED3D_CS_QUEUE_MASK;
+        ULONG queue_tail = *(volatile ULONG *)&queue->tail;
+        ULONG tail = queue_tail & WINED3D_CS_QUEUE_MASK;
         ULONG new_pos;
 
         /* Empty. */
@@ -3214,6 +3355,8 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
 
         TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
                 head, tail, (unsigned long)packet_size);
+        wined3d_cs_queue_flush(queue, cs);
+        wined3d_cs_queue_wait_tail(queue, cs, queue_tail);
     }
 
     packet = (struct wined3d_cs_packet *)&queue->data[head];
@@ -3235,12 +3378,15 @@ static void *wined3d_cs_mt_require_space(struct wined3d_device_context *context,
 static void wined3d_cs_mt_finish(struct wined3d_device_context *context, enum wined3d_cs_queue_id queue_id)
 {
     struct wined3d_cs *cs = wined3d_cs_from_context(context);
+    struct wined3d_cs_queue *queue = &cs->queue[queue_id];
+    ULONG tail;
 
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(context, queue_id);
 
-    while (cs->queue[queue_id].head != *(volatile ULONG *)&cs->queue[queue_id].tail)
-        YieldProcessor();
+    wined3d_cs_queue_flush(queue, cs);
+    while (queue->head != (tail = *(volatile ULONG *)&queue->tail))
+        wined3d_cs_queue_wait_tail(queue, cs, tail);
 }
 
 static const struct wined3d_device_context_ops wined3d_cs_mt_ops =
@@ -3366,6 +3512,8 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
         }
 
         InterlockedExchange((LONG *)&queue->tail, tail);
+        if (queue->waiting_for_tail)
+            RtlWakeAddressAll(&queue->tail);
     }
 
     cs->queue[WINED3D_CS_QUEUE_MAP].tail = cs->queue[WINED3D_CS_QUEUE_MAP].head;
@@ -4894,14 +4894,33 @@ enum wined3d_push_constants
 #define WINED3D_CS_QUERY_POLL_INTERVAL  10u
 #define WINED3D_CS_QUEUE_SIZE           0x100000u
 #define WINED3D_CS_SPIN_COUNT           10000000u
+#define WINED3D_CS_WAIT_SPIN_COUNT      4000u
 #define WINED3D_CS_QUEUE_MASK           (WINED3D_CS_QUEUE_SIZE - 1)
+#define WINED3D_CS_COALESCE_SIZE        64u
 
 struct wined3d_cs_queue
 {
     ULONG head, tail;
+    ULONG pending_head; /* end of the packets written but not yet made visible to the CS thread */
+    LONG waiting_for_tail;
     BYTE data[WINED3D_CS_QUEUE_SIZE];
 };
 
+struct wined3d_cs_coalesce_entry
+{
+    ULONG key;
+    ULONG offset;
+};
+
+struct wined3d_cs_stats
+{
+    unsigned int packets;
+    unsigned int coalesced;
+    unsigned int batches;
+    SIZE_T bytes;
+    LONGLONG wait_time;
+};
+
 struct wined3d_device_context_ops
 {
     void *(*require_space)(struct wined3d_device_context *context, size_t size, enum wined3d_cs_queue_id queue_id);
@@ -4946,6 +4965,9 @@ struct wined3d_cs
     HANDLE event;
     BOOL waiting_for_event;
     LONG pending_presents;
+
+    struct wined3d_cs_coalesce_entry coalesce[WINED3D_CS_COALESCE_SIZE];
+    struct wined3d_cs_stats stats;
 };
 
 static inline void wined3d_device_context_lock(struct wined3d_device_context *context)
@@ -5084,7 +5106,7 @@ HRESULT wined3d_device_context_emit_unmap(struct wined3d_device_context *context
 static inline void wined3d_resource_reference(struct wined3d_resource *resource)
 {
     const struct wined3d_cs *cs = resource->device->cs;
-    resource->access_time = cs->queue[WINED3D_CS_QUEUE_DEFAULT].head;
+    resource->access_time = cs->queue[WINED3D_CS_QUEUE_DEFAULT].pending_head;
 }
 
 static inline BOOL wined3d_ge_wrap(ULONG x, ULONG y)
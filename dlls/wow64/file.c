@@ -411,9 +411,27 @@ NTSTATUS WINAPI wow64_NtFsControlFile( UINT *args )
     void *out_buf = get_ptr( &args );
     ULONG out_len = get_ulong( &args );
 
+    DUPLICATE_EXTENTS_DATA extents;
     IO_STATUS_BLOCK io;
     NTSTATUS status;
 
+    switch (code)
+    {
+    case FSCTL_DUPLICATE_EXTENTS_TO_FILE:  /* DUPLICATE_EXTENTS_DATA */
+        if (in_len >= sizeof(DUPLICATE_EXTENTS_DATA32))
+        {
+            DUPLICATE_EXTENTS_DATA32 *extents32 = in_buf;
+
+            extents.FileHandle       = LongToHandle( extents32->FileHandle );
+            extents.SourceFileOffset = extents32->SourceFileOffset;
+            extents.TargetFileOffset = extents32->TargetFileOffset;
+            extents.ByteCount        = extents32->ByteCount;
+            in_buf = &extents;
+            in_len = sizeof(extents);
+        }
+        break;
+    }
+
     status = NtFsControlFile( handle, event, apc_32to64( apc ), apc_param_32to64( apc, apc_param ),
                               iosb_32to64( &io, io32 ), code, in_buf, in_len, out_buf, out_len );
     put_iosb( io32, &io );
@@ -971,3 +989,17 @@ NTSTATUS WINAPI wow64_wine_unix_to_nt_file_name( UINT *args )
 
     return wine_unix_to_nt_file_name( name, buffer, size );
 }
+
+
+/**********************************************************************
+ *           wow64___wine_copy_file_range
+ */
+NTSTATUS WINAPI wow64___wine_copy_file_range( UINT *args )
+{
+    HANDLE source = get_handle( &args );
+    HANDLE dest = get_handle( &args );
+    ULONGLONG offset = get_ulong64( &args );
+    ULONGLONG count = get_ulong64( &args );
+
+    return __wine_copy_file_range( source, dest, offset, count );
+}
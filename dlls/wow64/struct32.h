@@ -102,6 +102,14 @@ typedef struct
     WCHAR   FileName[1];
 } FILE_RENAME_INFORMATION32;
 
+typedef struct
+{
+    ULONG         FileHandle;
+    LARGE_INTEGER SourceFileOffset;
+    LARGE_INTEGER TargetFileOffset;
+    LARGE_INTEGER ByteCount;
+} DUPLICATE_EXTENTS_DATA32;
+
 typedef struct
 {
     ULONG Mask;
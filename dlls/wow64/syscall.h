@@ -248,6 +248,7 @@
     SYSCALL_ENTRY( NtWriteFileGather ) \
     SYSCALL_ENTRY( NtWriteVirtualMemory ) \
     SYSCALL_ENTRY( NtYieldExecution ) \
+    SYSCALL_ENTRY( __wine_copy_file_range ) \
     SYSCALL_ENTRY( __wine_dbg_write ) \
     SYSCALL_ENTRY( __wine_unix_call ) \
     SYSCALL_ENTRY( __wine_unix_spawnvp ) \
@@ -50,6 +50,39 @@ struct request_max_size
     int pad[16];
 };
 
+
+
+struct request_shm
+{
+    int                     state;
+    int                     waiting;
+    struct request_max_size reply;
+    char                    data[1];
+};
+
+#define REQUEST_SHM_IDLE     0
+#define REQUEST_SHM_REQUEST  1
+#define REQUEST_SHM_REPLY    2
+
+#define REQUEST_SHM_SIZE      0x10000
+#define REQUEST_SHM_DATA_SIZE (REQUEST_SHM_SIZE - 2 * sizeof(int) - sizeof(struct request_max_size))
+
+
+struct handle_mirror_entry
+{
+    unsigned int   access;
+    unsigned char  type;
+    unsigned char  flags;
+    unsigned short __pad;
+};
+
+#define HANDLE_MIRROR_USED     0x01
+#define HANDLE_MIRROR_INHERIT  0x02
+#define HANDLE_MIRROR_PROTECT  0x04
+
+#define HANDLE_MIRROR_ENTRIES  0x10000
+#define HANDLE_MIRROR_SIZE     (HANDLE_MIRROR_ENTRIES * sizeof(struct handle_mirror_entry))
+
 #define FIRST_USER_HANDLE 0x0020
 #define LAST_USER_HANDLE  0xffef
 
@@ -357,6 +390,19 @@ typedef union
 } message_data_t;
 
 
+struct posted_message
+{
+    lparam_t         wparam;
+    lparam_t         lparam;
+    user_handle_t    win;
+    unsigned int     msg;
+    int              x;
+    int              y;
+    unsigned int     time;
+    int              __pad;
+};
+
+
 struct filesystem_event
 {
     int         action;
@@ -974,6 +1020,30 @@ struct init_thread_reply
 
 
 
+struct set_request_shm_request
+{
+    struct request_header __header;
+    int          shm_fd;
+};
+struct set_request_shm_reply
+{
+    struct reply_header __header;
+};
+
+
+
+struct set_handle_mirror_request
+{
+    struct request_header __header;
+    int          mirror_fd;
+};
+struct set_handle_mirror_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct terminate_process_request
 {
     struct request_header __header;
@@ -1921,6 +1991,36 @@ struct map_view_reply
 
 
 
+struct get_relocated_image_request
+{
+    struct request_header __header;
+    obj_handle_t mapping;
+    client_ptr_t base;
+};
+struct get_relocated_image_reply
+{
+    struct reply_header __header;
+    obj_handle_t file;
+    int          ready;
+};
+
+
+
+struct set_relocated_image_ready_request
+{
+    struct request_header __header;
+    obj_handle_t mapping;
+    client_ptr_t base;
+    int          success;
+    char __pad_28[4];
+};
+struct set_relocated_image_ready_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct unmap_view_request
 {
     struct request_header __header;
@@ -2721,6 +2821,8 @@ struct get_message_request
     unsigned int    hw_id;
     unsigned int    wake_mask;
     unsigned int    changed_mask;
+    unsigned int    prefetch;
+    char __pad_44[4];
 };
 struct get_message_reply
 {
@@ -2735,7 +2837,9 @@ struct get_message_reply
     unsigned int    time;
     unsigned int    active_hooks;
     data_size_t     total;
+    unsigned int    prefetched;
     /* VARARG(data,message_data); */
+    char __pad_60[4];
 };
 
 
@@ -5450,6 +5554,8 @@ enum request
     REQ_init_process_done,
     REQ_init_first_thread,
     REQ_init_thread,
+    REQ_set_request_shm,
+    REQ_set_handle_mirror,
     REQ_terminate_process,
     REQ_terminate_thread,
     REQ_get_process_info,
@@ -5506,6 +5612,8 @@ enum request
     REQ_open_mapping,
     REQ_get_mapping_info,
     REQ_map_view,
+    REQ_get_relocated_image,
+    REQ_set_relocated_image_ready,
     REQ_unmap_view,
     REQ_get_mapping_committed_range,
     REQ_add_mapping_committed_range,
@@ -5732,6 +5840,8 @@ union generic_request
     struct init_process_done_request init_process_done_request;
     struct init_first_thread_request init_first_thread_request;
     struct init_thread_request init_thread_request;
+    struct set_request_shm_request set_request_shm_request;
+    struct set_handle_mirror_request set_handle_mirror_request;
     struct terminate_process_request terminate_process_request;
     struct terminate_thread_request terminate_thread_request;
     struct get_process_info_request get_process_info_request;
@@ -5788,6 +5898,8 @@ union generic_request
     struct open_mapping_request open_mapping_request;
     struct get_mapping_info_request get_mapping_info_request;
     struct map_view_request map_view_request;
+    struct get_relocated_image_request get_relocated_image_request;
+    struct set_relocated_image_ready_request set_relocated_image_ready_request;
     struct unmap_view_request unmap_view_request;
     struct get_mapping_committed_range_request get_mapping_committed_range_request;
     struct add_mapping_committed_range_request add_mapping_committed_range_request;
@@ -6012,6 +6124,8 @@ union generic_reply
     struct init_process_done_reply init_process_done_reply;
     struct init_first_thread_reply init_first_thread_reply;
     struct init_thread_reply init_thread_reply;
+    struct set_request_shm_reply set_request_shm_reply;
+    struct set_handle_mirror_reply set_handle_mirror_reply;
     struct terminate_process_reply terminate_process_reply;
     struct terminate_thread_reply terminate_thread_reply;
     struct get_process_info_reply get_process_info_reply;
@@ -6068,6 +6182,8 @@ union generic_reply
     struct open_mapping_reply open_mapping_reply;
     struct get_mapping_info_reply get_mapping_info_reply;
     struct map_view_reply map_view_reply;
+    struct get_relocated_image_reply get_relocated_image_reply;
+    struct set_relocated_image_ready_reply set_relocated_image_ready_reply;
     struct unmap_view_reply unmap_view_reply;
     struct get_mapping_committed_range_reply get_mapping_committed_range_reply;
     struct add_mapping_committed_range_reply add_mapping_committed_range_reply;
@@ -6284,7 +6400,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 746
+#define SERVER_PROTOCOL_VERSION 751
 
 /* ### protocol_version end ### */
 
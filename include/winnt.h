@@ -4999,6 +4999,8 @@ typedef struct _QUOTA_LIMITS_EX {
 #define COMPRESSION_FORMAT_NONE         0
 #define COMPRESSION_FORMAT_DEFAULT      1
 #define COMPRESSION_FORMAT_LZNT1        2
+#define COMPRESSION_FORMAT_XPRESS       3
+#define COMPRESSION_FORMAT_XPRESS_HUFF  4
 #define COMPRESSION_ENGINE_STANDARD     0
 #define COMPRESSION_ENGINE_MAXIMUM      256
 
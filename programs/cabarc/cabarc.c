@@ -575,7 +575,7 @@ static void usage( void )
         "  -d size  Set maximum disk size\n"
         "  -h       Display this help\n"
         "  -i id    Set cabinet id\n"
-        "  -m type  Set compression type (mszip|none)\n"
+        "  -m type  Set compression type (mszip|lzx[:15-21]|none)\n"
         "  -p       Preserve directory names\n"
         "  -r       Recurse into directories\n"
         "  -s size  Reserve space in the cabinet header\n"
@@ -614,6 +614,17 @@ int __cdecl wmain( int argc, WCHAR *argv[] )
             argv++; argc--;
             if (!wcscmp( argv[1], L"none" )) opt_compression = tcompTYPE_NONE;
             else if (!wcscmp( argv[1], L"mszip" )) opt_compression = tcompTYPE_MSZIP;
+            else if (!wcscmp( argv[1], L"lzx" )) opt_compression = TCOMPfromLZXWindow( 21 );
+            else if (!wcsncmp( argv[1], L"lzx:", 4 ))
+            {
+                int window = wcstol( argv[1] + 4, NULL, 10 );
+                if (window < 15 || window > 21)
+                {
+                    WINE_MESSAGE( "cabarc: LZX window must be between 15 and 21\n" );
+                    return 1;
+                }
+                opt_compression = TCOMPfromLZXWindow( window );
+            }
             else
             {
                 WINE_MESSAGE( "cabarc: Unknown compression type %s\n", debugstr_w(argv[1]));
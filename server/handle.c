@@ -26,7 +26,12 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -47,12 +52,16 @@ struct handle_entry
 
 struct handle_table
 {
-    struct object        obj;         /* object header */
-    struct process      *process;     /* process owning this table */
-    int                  count;       /* number of allocated entries */
-    int                  last;        /* last used entry */
-    int                  free;        /* first entry that may be free */
-    struct handle_entry *entries;     /* handle entries */
+    struct object               obj;      /* object header */
+    struct process             *process;  /* process owning this table */
+    int                         count;    /* number of allocated entries */
+    int                         last;     /* last used entry */
+    int                         next;     /* first entry that has never been used */
+    int                         used;     /* number of used entries */
+    int                         nb_free;  /* number of free entries below next */
+    int                        *free;     /* min-heap of the free entries below next */
+    struct handle_entry        *entries;  /* handle entries */
+    struct handle_mirror_entry *mirror;   /* client-side mirror of the entries, if any */
 };
 
 static struct handle_table *global_table;
@@ -151,8 +160,8 @@ static void handle_table_dump( struct object *obj, int verbose )
 
     assert( obj->ops == &handle_table_ops );
 
-    fprintf( stderr, "Handle table last=%d count=%d process=%p\n",
-             table->last, table->count, table->process );
+    fprintf( stderr, "Handle table last=%d used=%d count=%d process=%p\n",
+             table->last, table->used, table->count, table->process );
     if (!verbose) return;
     entry = table->entries;
     for (i = 0; i <= table->last; i++, entry++)
@@ -186,6 +195,82 @@ static void handle_table_destroy( struct object *obj )
         }
     }
     free( table->entries );
+    free( table->free );
+#ifdef HAVE_SYS_MMAN_H
+    if (table->mirror) munmap( table->mirror, HANDLE_MIRROR_SIZE );
+#endif
+}
+
+/* update the client-side mirror of a handle entry */
+static void update_handle_mirror( struct handle_table *table, int index )
+{
+    const struct handle_entry *entry = table->entries + index;
+    struct handle_mirror_entry mirror;
+
+    if (!table->mirror || index >= HANDLE_MIRROR_ENTRIES) return;
+
+    mirror.__pad = 0;
+    if (entry->ptr)
+    {
+        mirror.access = entry->access & ~RESERVED_ALL;
+        mirror.type   = entry->ptr->ops->type->index;
+        mirror.flags  = HANDLE_MIRROR_USED;
+        if (entry->access & RESERVED_INHERIT) mirror.flags |= HANDLE_MIRROR_INHERIT;
+        if (entry->access & RESERVED_CLOSE_PROTECT) mirror.flags |= HANDLE_MIRROR_PROTECT;
+    }
+    else
+    {
+        mirror.access = 0;
+        mirror.type   = 0;
+        mirror.flags  = 0;
+    }
+    table->mirror[index] = mirror;
+}
+
+/* add an entry to the heap of free entries */
+static void push_free_entry( struct handle_table *table, int index )
+{
+    int pos = table->nb_free++, parent;
+
+    while (pos && table->free[parent = (pos - 1) / 2] > index)
+    {
+        table->free[pos] = table->free[parent];
+        pos = parent;
+    }
+    table->free[pos] = index;
+}
+
+/* remove the lowest entry from the heap of free entries */
+static int pop_free_entry( struct handle_table *table )
+{
+    int ret = table->free[0], last = table->free[--table->nb_free], pos = 0, child;
+
+    while ((child = 2 * pos + 1) < table->nb_free)
+    {
+        if (child + 1 < table->nb_free && table->free[child + 1] < table->free[child]) child++;
+        if (last <= table->free[child]) break;
+        table->free[pos] = table->free[child];
+        pos = child;
+    }
+    table->free[pos] = last;
+    return ret;
+}
+
+/* rebuild the heap of free entries from scratch */
+static void rebuild_free_heap( struct handle_table *table )
+{
+    int i;
+
+    while (table->last >= 0 && !table->entries[table->last].ptr) table->last--;
+    table->next = table->last + 1;
+    table->nb_free = 0;
+    table->used = 0;
+    /* entries in ascending order are a valid heap */
+    for (i = 0; i <= table->last; i++)
+    {
+        if (table->entries[i].ptr) table->used++;
+        else table->free[table->nb_free++] = i;
+    }
 }
 
 /* close all the process handles and free the handle table */
@@ -208,8 +293,17 @@ struct handle_table *alloc_handle_table( struct process *process, int count )
     table->process = process;
     table->count   = count;
     table->last    = -1;
-    table->free    = 0;
-    if ((table->entries = mem_alloc( count * sizeof(*table->entries) ))) return table;
+    table->next    = 0;
+    table->used    = 0;
+    table->nb_free = 0;
+    table->mirror  = NULL;
+    table->entries = NULL;
+    if ((table->free = mem_alloc( count * sizeof(*table->free) )) &&
+        (table->entries = mem_alloc( count * sizeof(*table->entries) )))
+    {
+        memset( table->entries, 0, count * sizeof(*table->entries) );
+        return table;
+    }
     release_object( table );
     return NULL;
 }
@@ -218,14 +312,22 @@ struct handle_table *alloc_handle_table( struct process *process, int count )
 static int grow_handle_table( struct handle_table *table )
 {
     struct handle_entry *new_entries;
+    int *new_free;
     int count = min( table->count * 2, MAX_HANDLE_ENTRIES );
 
     if (count == table->count ||
-        !(new_entries = realloc( table->entries, count * sizeof(struct handle_entry) )))
+        !(new_free = realloc( table->free, count * sizeof(*new_free) )))
+    {
+        set_error( STATUS_INSUFFICIENT_RESOURCES );
+        return 0;
+    }
+    table->free = new_free;
+    if (!(new_entries = realloc( table->entries, count * sizeof(struct handle_entry) )))
     {
         set_error( STATUS_INSUFFICIENT_RESOURCES );
         return 0;
     }
+    memset( new_entries + table->count, 0, (count - table->count) * sizeof(*new_entries) );
     table->entries = new_entries;
     table->count   = count;
     return 1;
@@ -234,20 +336,21 @@ static int grow_handle_table( struct handle_table *table )
 /* allocate the first free entry in the handle table */
 static obj_handle_t alloc_entry( struct handle_table *table, void *obj, unsigned int access )
 {
-    struct handle_entry *entry = table->entries + table->free;
+    struct handle_entry *entry;
     int i;
 
-    for (i = table->free; i <= table->last; i++, entry++) if (!entry->ptr) goto found;
-    if (i >= table->count)
+    if (table->nb_free) i = pop_free_entry( table );
+    else
     {
-        if (!grow_handle_table( table )) return 0;
-        entry = table->entries + i;  /* the entries may have moved */
+        if ((i = table->next) >= table->count && !grow_handle_table( table )) return 0;
+        table->next++;
     }
-    table->last = i;
- found:
-    table->free = i + 1;
+    entry = table->entries + i;
+    table->last = max( table->last, i );
+    table->used++;
     entry->ptr    = grab_object_for_handle( obj );
     entry->access = access;
+    update_handle_mirror( table, i );
     return index_to_handle(i);
 }
 
@@ -331,6 +434,13 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
     return entry;
 }
 
+/* update the client-side mirror after a handle entry has been modified in place */
+static void handle_entry_modified( struct process *process, obj_handle_t handle, struct handle_entry *entry )
+{
+    struct handle_table *table = handle_is_global(handle) ? global_table : process->handles;
+    update_handle_mirror( table, entry - table->entries );
+}
+
 /* attempt to shrink a table */
 static void shrink_handle_table( struct handle_table *table )
 {
@@ -350,6 +460,21 @@ static void shrink_handle_table( struct handle_table *table )
     if (!(new_entries = realloc( table->entries, count * sizeof(*new_entries) ))) return;
     table->count   = count;
     table->entries = new_entries;
+    /* the free heap may hold entries beyond the new end of the table */
+    rebuild_free_heap( table );
+}
+
+/* free a handle entry and put it on the free heap */
+static void free_entry( struct handle_table *table, struct handle_entry *entry )
+{
+    int index = entry - table->entries;
+
+    entry->ptr    = NULL;
+    entry->access = 0;
+    push_free_entry( table, index );
+    table->used--;
+    update_handle_mirror( table, index );
+    if (index == table->last) shrink_handle_table( table );
 }
 
 static void inherit_handle( struct process *parent, const obj_handle_t handle, struct handle_table *table )
@@ -364,7 +489,8 @@ static void inherit_handle( struct process *parent, const obj_handle_t handle, s
     index = handle_to_index( handle );
     if (dst[index].ptr) return;
     grab_object_for_handle( src->ptr );
-    dst[index] = *src;
+    dst[index].ptr    = src->ptr;
+    dst[index].access = src->access;
     table->last = max( table->last, index );
 }
 
@@ -386,8 +512,6 @@ struct handle_table *copy_handle_table( struct process *process, struct process
 
     if (handles)
     {
-        memset( table->entries, 0, parent_table->count * sizeof(*table->entries) );
-
         for (i = 0; i < handle_count; i++)
         {
             inherit_handle( parent, handles[i], table );
@@ -403,15 +527,16 @@ struct handle_table *copy_handle_table( struct process *process, struct process
         if ((table->last = parent_table->last) >= 0)
         {
             struct handle_entry *ptr = table->entries;
-            memcpy( ptr, parent_table->entries, (table->last + 1) * sizeof(struct handle_entry) );
             for (i = 0; i <= table->last; i++, ptr++)
             {
-                if (!ptr->ptr) continue;
-                if (ptr->access & RESERVED_INHERIT) grab_object_for_handle( ptr->ptr );
-                else ptr->ptr = NULL; /* don't inherit this entry */
+                const struct handle_entry *src = parent_table->entries + i;
+                if (!src->ptr || !(src->access & RESERVED_INHERIT)) continue;  /* don't inherit this entry */
+                ptr->ptr    = grab_object_for_handle( src->ptr );
+                ptr->access = src->access;
             }
         }
     }
+    rebuild_free_heap( table );
     /* attempt to shrink the table */
     shrink_handle_table( table );
     return table;
@@ -428,10 +553,8 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     if (entry->access & RESERVED_CLOSE_PROTECT) return STATUS_HANDLE_NOT_CLOSABLE;
     obj = entry->ptr;
     if (!obj->ops->close_handle( obj, process, handle )) return STATUS_HANDLE_NOT_CLOSABLE;
-    entry->ptr = NULL;
     table = handle_is_global(handle) ? global_table : process->handles;
-    if (entry < table->entries + table->free) table->free = entry - table->entries;
-    if (entry == table->entries + table->last) shrink_handle_table( table );
+    free_entry( table, entry );
     release_object_from_handle( obj );
     return STATUS_SUCCESS;
 }
@@ -542,6 +665,7 @@ static int set_handle_flags( struct process *process, obj_handle_t handle, int m
     mask  = (mask << RESERVED_SHIFT) & RESERVED_ALL;
     flags = (flags << RESERVED_SHIFT) & mask;
     entry->access = (entry->access & ~mask) | flags;
+    handle_entry_modified( process, handle, entry );
     return (old_access & RESERVED_ALL) >> RESERVED_SHIFT;
 }
 
@@ -590,6 +714,7 @@ obj_handle_t duplicate_handle( struct process *src, obj_handle_t src_handle, str
         {
             if (attr & OBJ_INHERIT) access |= RESERVED_INHERIT;
             entry->access = access;
+            handle_entry_modified( src, src_handle, entry );
             res = src_handle;
         }
         else
@@ -632,6 +757,37 @@ obj_handle_t open_object( struct process *process, obj_handle_t parent, unsigned
     return handle;
 }
 
+/* map the client-side mirror of the handle table of a process */
+static void set_handle_mirror( struct process *process, int fd )
+{
+#ifdef HAVE_SYS_MMAN_H
+    struct handle_table *table = process->handles;
+    struct stat st;
+    void *ptr;
+    int i;
+
+    if (!table)
+    {
+        set_error( STATUS_PROCESS_IS_TERMINATING );
+        return;
+    }
+    if (table->mirror || fstat( fd, &st ) == -1 || !S_ISREG( st.st_mode ) || st.st_size < HANDLE_MIRROR_SIZE)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if ((ptr = mmap( NULL, HANDLE_MIRROR_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        file_set_error();
+        return;
+    }
+    table->mirror = ptr;
+    for (i = 0; i <= table->last; i++) update_handle_mirror( table, i );
+#else
+    set_error( STATUS_NOT_SUPPORTED );
+#endif
+}
+
 /* return the size of the handle table of a given process */
 unsigned int get_handle_table_count( struct process *process )
 {
@@ -646,6 +802,20 @@ DECL_HANDLER(close_handle)
     set_error( err );
 }
 
+/* set up the client-side mirror of the handle table */
+DECL_HANDLER(set_handle_mirror)
+{
+    int fd = thread_get_inflight_fd( current, req->mirror_fd );
+
+    if (fd == -1)
+    {
+        set_error( STATUS_INVALID_HANDLE );
+        return;
+    }
+    set_handle_mirror( current->process, fd );
+    close( fd );
+}
+
 /* set a handle information */
 DECL_HANDLER(set_handle_info)
 {
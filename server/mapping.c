@@ -121,6 +121,55 @@ static const struct object_ops shared_map_ops =
 
 static struct list shared_map_list = LIST_INIT( shared_map_list );
 
+/* cached copy of a PE image relocated to a non-preferred base address */
+struct relocated_image
+{
+    struct object   obj;             /* object header */
+    dev_t           dev;             /* device of the PE file */
+    ino_t           ino;             /* inode of the PE file */
+    off_t           size;            /* size of the PE file */
+    timeout_t       mtime;           /* modification time of the PE file */
+    timeout_t       ctime;           /* status change time of the PE file */
+    client_ptr_t    base;            /* base address the image is relocated to */
+    struct file    *file;            /* temp file holding the relocated image */
+    process_id_t    creator;         /* process filling the file */
+    int             ready;           /* has the file been filled in? */
+    struct list     entry;           /* entry in global relocated images list */
+};
+
+static void relocated_image_dump( struct object *obj, int verbose );
+static void relocated_image_destroy( struct object *obj );
+
+static const struct object_ops relocated_image_ops =
+{
+    sizeof(struct relocated_image), /* size */
+    &no_type,                  /* type */
+    relocated_image_dump,      /* dump */
+    no_add_queue,              /* add_queue */
+    NULL,                      /* remove_queue */
+    NULL,                      /* signaled */
+    NULL,                      /* satisfied */
+    no_signal,                 /* signal */
+    no_get_fd,                 /* get_fd */
+    default_map_access,        /* map_access */
+    default_get_sd,            /* get_sd */
+    default_set_sd,            /* set_sd */
+    no_get_full_name,          /* get_full_name */
+    no_lookup_name,            /* lookup_name */
+    no_link_name,              /* link_name */
+    NULL,                      /* unlink_name */
+    no_open_file,              /* open_file */
+    no_kernel_obj_list,        /* get_kernel_obj_list */
+    no_close_handle,           /* close_handle */
+    relocated_image_destroy    /* destroy */
+};
+
+#define MAX_RELOCATED_IMAGES 64
+
+/* most recently used entries first */
+static struct list relocated_image_list = LIST_INIT( relocated_image_list );
+static unsigned int relocated_image_count;
+
 /* memory view mapped in client address space */
 struct memory_view
 {
@@ -240,6 +289,22 @@ static void shared_map_destroy( struct object *obj )
     list_remove( &shared->entry );
 }
 
+static void relocated_image_dump( struct object *obj, int verbose )
+{
+    struct relocated_image *image = (struct relocated_image *)obj;
+    fprintf( stderr, "Relocated image base=%08x%08x file=%p ready=%d\n",
+             (unsigned int)(image->base >> 32), (unsigned int)image->base, image->file, image->ready );
+}
+
+static void relocated_image_destroy( struct object *obj )
+{
+    struct relocated_image *image = (struct relocated_image *)obj;
+
+    release_object( image->file );
+    list_remove( &image->entry );
+    relocated_image_count--;
+}
+
 /* extend a file beyond the current end of file */
 int grow_file( int unix_fd, file_pos_t new_size )
 {
@@ -444,6 +509,84 @@ static struct shared_map *get_shared_file( struct fd *fd )
     return NULL;
 }
 
+/* get the file times with the best precision available */
+static void get_relocated_image_times( const struct stat *st, timeout_t *mtime, timeout_t *ctime )
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    *mtime = (timeout_t)st->st_mtim.tv_sec * TICKS_PER_SEC + st->st_mtim.tv_nsec / 100;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    *mtime = (timeout_t)st->st_mtimespec.tv_sec * TICKS_PER_SEC + st->st_mtimespec.tv_nsec / 100;
+#else
+    *mtime = (timeout_t)st->st_mtime * TICKS_PER_SEC;
+#endif
+#ifdef HAVE_STRUCT_STAT_ST_CTIM
+    *ctime = (timeout_t)st->st_ctim.tv_sec * TICKS_PER_SEC + st->st_ctim.tv_nsec / 100;
+#elif defined(HAVE_STRUCT_STAT_ST_CTIMESPEC)
+    *ctime = (timeout_t)st->st_ctimespec.tv_sec * TICKS_PER_SEC + st->st_ctimespec.tv_nsec / 100;
+#else
+    *ctime = (timeout_t)st->st_ctime * TICKS_PER_SEC;
+#endif
+}
+
+/* find the cached relocated image of a PE file for a given base address */
+static struct relocated_image *find_relocated_image( const struct stat *st, client_ptr_t base )
+{
+    struct relocated_image *image;
+    timeout_t mtime, ctime;
+
+    /* the change time can't be set from user space, so a rewritten file never matches an
+     * old entry, even if its size and modification time were preserved */
+    get_relocated_image_times( st, &mtime, &ctime );
+    LIST_FOR_EACH_ENTRY( image, &relocated_image_list, struct relocated_image, entry )
+    {
+        if (image->base != base || image->dev != st->st_dev || image->ino != st->st_ino) continue;
+        if (image->size != st->st_size || image->mtime != mtime || image->ctime != ctime) continue;
+        list_remove( &image->entry );
+        list_add_head( &relocated_image_list, &image->entry );
+        return image;
+    }
+    return NULL;
+}
+
+/* remove a relocated image from the cache */
+static void free_relocated_image( struct relocated_image *image )
+{
+    make_object_temporary( &image->obj );
+    release_object( image );
+}
+
+/* add an empty relocated image to the cache, to be filled in by the current process */
+static struct relocated_image *create_relocated_image( const struct stat *st, client_ptr_t base,
+                                                       mem_size_t size )
+{
+    struct relocated_image *image;
+    struct file *file;
+    int fd;
+
+    if ((fd = create_temp_file( size )) == -1) return NULL;
+    if (!(file = create_file_for_fd( fd, FILE_GENERIC_READ|FILE_GENERIC_WRITE, 0 ))) return NULL;
+
+    if (!(image = alloc_object( &relocated_image_ops )))
+    {
+        release_object( file );
+        return NULL;
+    }
+    image->dev     = st->st_dev;
+    image->ino     = st->st_ino;
+    image->size    = st->st_size;
+    get_relocated_image_times( st, &image->mtime, &image->ctime );
+    image->base    = base;
+    image->file    = file;
+    image->creator = current->process->id;
+    image->ready   = 0;
+    list_add_head( &relocated_image_list, &image->entry );
+    make_object_permanent( &image->obj );
+
+    if (++relocated_image_count > MAX_RELOCATED_IMAGES)
+        free_relocated_image( LIST_ENTRY( list_tail( &relocated_image_list ), struct relocated_image, entry ));
+    return image;
+}
+
 /* return the size of the memory mapping and file range of a given section */
 static inline void get_section_sizes( const IMAGE_SECTION_HEADER *sec, size_t *map_size,
                                       off_t *file_start, size_t *file_size )
@@ -1187,6 +1330,81 @@ DECL_HANDLER(get_mapping_info)
     release_object( mapping );
 }
 
+/* get the cached relocated image of a PE mapping */
+DECL_HANDLER(get_relocated_image)
+{
+    struct relocated_image *image;
+    struct mapping *mapping;
+    struct process *process;
+    struct stat st;
+    int unix_fd;
+
+    if (!(mapping = get_mapping_obj( current->process, req->mapping, SECTION_MAP_READ ))) return;
+
+    if (!(mapping->flags & SEC_IMAGE) || !mapping->fd || mapping->shared ||
+        !(mapping->image.image_charact & IMAGE_FILE_DLL) ||
+        (mapping->image.image_charact & IMAGE_FILE_RELOCS_STRIPPED) ||
+        !(mapping->image.image_flags & IMAGE_FLAGS_ImageDynamicallyRelocated) ||
+        (mapping->image.image_flags & IMAGE_FLAGS_ImageMappedFlat) ||
+        req->base == mapping->image.base || (req->base & page_mask))
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        goto done;
+    }
+
+    if ((unix_fd = get_unix_fd( mapping->fd )) == -1) goto done;
+    if (fstat( unix_fd, &st ) == -1)
+    {
+        file_set_error();
+        goto done;
+    }
+
+    if ((image = find_relocated_image( &st, req->base )))
+    {
+        if (image->ready)
+        {
+            reply->file  = alloc_handle( current->process, image->file, GENERIC_READ, 0 );
+            reply->ready = 1;
+            goto done;
+        }
+        /* somebody else is filling it, unless the process died in the meantime */
+        if ((process = get_process_from_id( image->creator )))
+        {
+            release_object( process );
+            goto done;
+        }
+        image->creator = current->process->id;
+    }
+    else if (!(image = create_relocated_image( &st, req->base, mapping->image.map_size ))) goto done;
+
+    reply->file = alloc_handle( current->process, image->file, GENERIC_READ|GENERIC_WRITE, 0 );
+
+done:
+    release_object( mapping );
+}
+
+/* notify that a relocated image has been filled in */
+DECL_HANDLER(set_relocated_image_ready)
+{
+    struct relocated_image *image;
+    struct mapping *mapping;
+    struct stat st;
+    int unix_fd;
+
+    if (!(mapping = get_mapping_obj( current->process, req->mapping, SECTION_MAP_READ ))) return;
+
+    if ((unix_fd = get_unix_fd( mapping->fd )) != -1 && fstat( unix_fd, &st ) != -1 &&
+        (image = find_relocated_image( &st, req->base )) &&
+        !image->ready && image->creator == current->process->id)
+    {
+        if (req->success) image->ready = 1;
+        else free_relocated_image( image );
+    }
+    else set_error( STATUS_INVALID_PARAMETER );
+
+    release_object( mapping );
+}
+
 /* add a memory view in the current process */
 DECL_HANDLER(map_view)
 {
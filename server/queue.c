@@ -816,10 +816,57 @@ static int match_window( user_handle_t win, user_handle_t msg_win )
     return is_child_window( win, msg_win );
 }
 
+/* check whether a posted message can be returned in a prefetch batch */
+static inline int is_prefetchable_message( const struct message *msg, user_handle_t win,
+                                           unsigned int first, unsigned int last )
+{
+    if (msg->data || (msg->msg & 0x80000000)) return 0;  /* needs special handling by the client */
+    return match_window( win, msg->win ) && check_msg_filter( msg->msg, first, last );
+}
+
+/* return the posted messages following a removed one in the reply data */
+/* the batch is always a prefix of the posted list, so that the client preserves message ordering */
+static unsigned int prefetch_posted_messages( struct msg_queue *queue, struct message *removed,
+                                              user_handle_t win, unsigned int first,
+                                              unsigned int last, unsigned int max )
+{
+    struct list *ptr = &removed->entry;
+    struct posted_message *data;
+    struct message *msg;
+    unsigned int i, count = 0;
+
+    /* sent messages must be received before any of the following posted messages */
+    if (!list_empty( &queue->msg_list[SEND_MESSAGE] )) return 0;
+    if (list_head( &queue->msg_list[POST_MESSAGE] ) != &removed->entry) return 0;
+
+    max = min( max, get_reply_max_size() / sizeof(*data) );
+    while (count < max && (ptr = list_next( &queue->msg_list[POST_MESSAGE], ptr )))
+    {
+        if (!is_prefetchable_message( LIST_ENTRY( ptr, struct message, entry ), win, first, last )) break;
+        count++;
+    }
+    if (!count || !(data = set_reply_data_size( count * sizeof(*data) ))) return 0;
+
+    for (i = 0; i < count; i++)
+    {
+        msg = LIST_ENTRY( list_next( &queue->msg_list[POST_MESSAGE], &removed->entry ), struct message, entry );
+        data[i].wparam = msg->wparam;
+        data[i].lparam = msg->lparam;
+        data[i].win    = msg->win;
+        data[i].msg    = msg->msg;
+        data[i].x      = msg->x;
+        data[i].y      = msg->y;
+        data[i].time   = msg->time;
+        data[i].__pad  = 0;
+        remove_queue_message( queue, msg, POST_MESSAGE );
+    }
+    return count;
+}
+
 /* retrieve a posted message */
 static int get_posted_message( struct msg_queue *queue, user_handle_t win,
                                unsigned int first, unsigned int last, unsigned int flags,
-                               struct get_message_reply *reply )
+                               unsigned int prefetch, struct get_message_reply *reply )
 {
     struct message *msg;
 
@@ -857,6 +904,8 @@ found:
             msg->data = NULL;
             msg->data_size = 0;
         }
+        else if (prefetch && !(msg->msg & 0x80000000))
+            reply->prefetched = prefetch_posted_messages( queue, msg, win, first, last, prefetch );
         remove_queue_message( queue, msg, POST_MESSAGE );
     }
     else if (msg->data) set_reply_data( msg->data, msg->data_size );
@@ -2624,12 +2673,12 @@ DECL_HANDLER(get_message)
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
-        get_posted_message( queue, get_win, req->get_first, req->get_last, req->flags, reply ))
+        get_posted_message( queue, get_win, req->get_first, req->get_last, req->flags, req->prefetch, reply ))
         return;
 
     if ((filter & QS_HOTKEY) && queue->hotkey_count &&
         req->get_first <= WM_HOTKEY && req->get_last >= WM_HOTKEY &&
-        get_posted_message( queue, get_win, WM_HOTKEY, WM_HOTKEY, req->flags, reply ))
+        get_posted_message( queue, get_win, WM_HOTKEY, WM_HOTKEY, req->flags, 0, reply ))
         return;
 
     /* only check for quit messages if not posted messages pending */
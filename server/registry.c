@@ -35,6 +35,7 @@
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 #include "ntstatus.h"
@@ -89,6 +90,8 @@ struct key
     int               last_value;  /* last in use value */
     int               nb_values;   /* count of allocated values in array */
     struct key_value *values;      /* values array */
+    struct name_index *subkey_index; /* hash index of the subkeys */
+    struct name_index *value_index;  /* hash index of the values */
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
@@ -102,6 +105,8 @@ struct key
 #define KEY_WOW64    0x0010  /* key contains a Wow6432Node subkey */
 #define KEY_WOWSHARE 0x0020  /* key is a Wow64 shared key (used for Software\Classes) */
 #define KEY_PREDEF   0x0040  /* key is marked as predefined */
+#define KEY_UNSORTED_SUBKEYS 0x0080  /* subkeys array is not sorted (only with a hash index) */
+#define KEY_UNSORTED_VALUES  0x0100  /* values array is not sorted (only with a hash index) */
 
 /* a key value */
 struct key_value
@@ -115,6 +120,22 @@ struct key_value
 
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
+#define MIN_HASHED   64  /* min. number of subkeys or values to use a hash index */
+
+/* hash index of the subkeys or values of a key
+ *
+ * Keys with many subkeys or values get a hash index to speed up lookups. Entries
+ * are then appended to the array instead of being inserted in sorted order, and
+ * the array is only sorted again when it's enumerated or saved. Removing an entry
+ * from the middle of the array drops the index, lookups then use a binary search
+ * and the index is rebuilt on the next insertion, once for a whole batch of
+ * deletions. */
+struct name_index
+{
+    unsigned int      size;        /* number of buckets (power of 2) */
+    unsigned int      used;        /* number of used buckets, including deleted ones */
+    int               buckets[1];  /* array index + 1, 0 if free, -1 if deleted */
+};
 
 #define MAX_NAME_LEN  256    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
@@ -133,13 +154,19 @@ static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index );
+static void sort_subkeys( struct key *key );
+static void sort_values( struct key *key );
 
 /* information about where to save a registry branch */
 struct save_branch_info
 {
     struct key  *key;
     const char  *path;
+    char        *image_path;    /* path of the binary image */
+    file_pos_t   image_size;    /* size of the image header and snapshot, 0 if no valid image */
+    file_pos_t   journal_size;  /* size of the journal following the snapshot */
+    timeout_t    journal_time;  /* time of the oldest journal entry missing from the text file */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
@@ -275,11 +302,13 @@ static void dump_value( const struct key_value *value, FILE *f )
 }
 
 /* save a registry and all its subkeys to a text file */
-static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
+static void save_subkeys( struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
     if (key->flags & KEY_VOLATILE) return;
+    sort_subkeys( key );
+    sort_values( key );
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
@@ -451,6 +480,8 @@ static void key_destroy( struct object *obj )
         free( key->values[i].data );
     }
     free( key->values );
+    free( key->value_index );
+    free( key->subkey_index );
     for (i = 0; i <= key->last_subkey; i++)
     {
         key->subkeys[i]->parent = NULL;
@@ -522,6 +553,8 @@ static struct key *alloc_key( const struct unicode_str *name, timeout_t modif )
         key->nb_values   = 0;
         key->last_value  = -1;
         key->values      = NULL;
+        key->subkey_index = NULL;
+        key->value_index = NULL;
         key->modif       = modif;
         key->parent      = NULL;
         list_init( &key->notify_list );
@@ -583,6 +616,153 @@ static void touch_key( struct key *key, unsigned int change )
         check_notify( k, change, 0 );
 }
 
+/* compare two key or value names, in the sort order of the subkeys and values arrays */
+static int compare_names( const WCHAR *name1, data_size_t len1, const WCHAR *name2, data_size_t len2 )
+{
+    int res = memicmp_strW( name1, name2, min( len1, len2 ));
+    if (!res) res = len1 - len2;
+    return res;
+}
+
+static int compare_subkeys( const void *ptr1, const void *ptr2 )
+{
+    const struct key *key1 = *(const struct key * const *)ptr1;
+    const struct key *key2 = *(const struct key * const *)ptr2;
+    return compare_names( key1->name, key1->namelen, key2->name, key2->namelen );
+}
+
+static int compare_values( const void *ptr1, const void *ptr2 )
+{
+    const struct key_value *value1 = ptr1;
+    const struct key_value *value2 = ptr2;
+    return compare_names( value1->name, value1->namelen, value2->name, value2->namelen );
+}
+
+/* sort an array where new entries have been appended after a sorted part */
+static void sort_appended( void *base, size_t count, size_t size, int (*compare)(const void *, const void *) )
+{
+    char *array = base, *tmp;
+    size_t sorted = 1, i, j, k;
+
+    while (sorted < count && compare( array + (sorted - 1) * size, array + sorted * size ) < 0) sorted++;
+    if (sorted >= count) return;
+    if (!(tmp = malloc( sorted * size )))
+    {
+        qsort( array, count, size, compare );
+        return;
+    }
+    qsort( array + sorted * size, count - sorted, size, compare );
+
+    /* merge the two sorted parts */
+    memcpy( tmp, array, sorted * size );
+    for (i = 0, j = sorted, k = 0; i < sorted; k++)
+    {
+        if (j < count && compare( array + j * size, tmp + i * size ) < 0)
+            memcpy( array + k * size, array + j++ * size, size );
+        else
+            memcpy( array + k * size, tmp + i++ * size, size );
+    }
+    free( tmp );
+}
+
+/* allocate an empty hash index large enough for count entries */
+static struct name_index *alloc_name_index( unsigned int count )
+{
+    struct name_index *index;
+    unsigned int size = 2 * MIN_HASHED;
+
+    while (size < 2 * count) size *= 2;
+    if (!(index = calloc( 1, offsetof( struct name_index, buckets[size] )))) return NULL;
+    index->size = size;
+    return index;
+}
+
+/* add an entry to a hash index; return 0 if the index is full and needs to be rebuilt */
+static int add_name_index( struct name_index *index, const WCHAR *name, data_size_t len, int pos )
+{
+    unsigned int hash;
+
+    if (2 * (index->used + 1) > index->size) return 0;
+    hash = hash_strW( name, len, index->size );
+    while (index->buckets[hash] > 0) hash = (hash + 1) & (index->size - 1);
+    if (!index->buckets[hash]) index->used++;
+    index->buckets[hash] = pos + 1;
+    return 1;
+}
+
+/* remove the last entry of the array from a hash index */
+static void remove_name_index( struct name_index *index, const WCHAR *name, data_size_t len, int pos )
+{
+    unsigned int hash = hash_strW( name, len, index->size );
+
+    while (index->buckets[hash] != pos + 1) hash = (hash + 1) & (index->size - 1);
+    index->buckets[hash] = -1;
+}
+
+/* rebuild the hash index of the subkeys, or remove it if it's not needed */
+static void build_subkey_index( struct key *key )
+{
+    int i;
+
+    free( key->subkey_index );
+    key->subkey_index = NULL;
+    if (key->last_subkey + 1 >= MIN_HASHED && (key->subkey_index = alloc_name_index( key->last_subkey + 1 )))
+    {
+        for (i = 0; i <= key->last_subkey; i++)
+            add_name_index( key->subkey_index, key->subkeys[i]->name, key->subkeys[i]->namelen, i );
+    }
+    else sort_subkeys( key );  /* binary search requires a sorted array */
+}
+
+/* sort the subkeys array if needed */
+static void sort_subkeys( struct key *key )
+{
+    if (!(key->flags & KEY_UNSORTED_SUBKEYS)) return;
+    sort_appended( key->subkeys, key->last_subkey + 1, sizeof(*key->subkeys), compare_subkeys );
+    key->flags &= ~KEY_UNSORTED_SUBKEYS;
+    if (key->subkey_index) build_subkey_index( key );
+}
+
+/* drop the hash index of the subkeys until the next insertion */
+static void drop_subkey_index( struct key *key )
+{
+    free( key->subkey_index );
+    key->subkey_index = NULL;
+    sort_subkeys( key );  /* binary search requires a sorted array */
+}
+
+/* rebuild the hash index of the values, or remove it if it's not needed */
+static void build_value_index( struct key *key )
+{
+    int i;
+
+    free( key->value_index );
+    key->value_index = NULL;
+    if (key->last_value + 1 >= MIN_HASHED && (key->value_index = alloc_name_index( key->last_value + 1 )))
+    {
+        for (i = 0; i <= key->last_value; i++)
+            add_name_index( key->value_index, key->values[i].name, key->values[i].namelen, i );
+    }
+    else sort_values( key );  /* binary search requires a sorted array */
+}
+
+/* sort the values array if needed */
+static void sort_values( struct key *key )
+{
+    if (!(key->flags & KEY_UNSORTED_VALUES)) return;
+    sort_appended( key->values, key->last_value + 1, sizeof(*key->values), compare_values );
+    key->flags &= ~KEY_UNSORTED_VALUES;
+    if (key->value_index) build_value_index( key );
+}
+
+/* drop the hash index of the values until the next insertion */
+static void drop_value_index( struct key *key )
+{
+    free( key->value_index );
+    key->value_index = NULL;
+    sort_values( key );  /* binary search requires a sorted array */
+}
+
 /* try to grow the array of subkeys; return 1 if OK, 0 on error */
 static int grow_subkeys( struct key *key )
 {
@@ -631,6 +811,16 @@ static struct key *alloc_subkey( struct key *parent, const struct unicode_str *n
         for (i = ++parent->last_subkey; i > index; i--)
             parent->subkeys[i] = parent->subkeys[i-1];
         parent->subkeys[index] = key;
+        if (parent->subkey_index)
+        {
+            /* with a hash index new subkeys are appended, and the array sorted later */
+            if (index && compare_subkeys( &parent->subkeys[index - 1], &key ) > 0)
+                parent->flags |= KEY_UNSORTED_SUBKEYS;
+            if (index != parent->last_subkey ||
+                !add_name_index( parent->subkey_index, key->name, key->namelen, index ))
+                build_subkey_index( parent );
+        }
+        else if (parent->last_subkey + 1 >= MIN_HASHED) build_subkey_index( parent );
         if (is_wow6432node( key->name, key->namelen ) && !is_wow6432node( parent->name, parent->namelen ))
             parent->flags |= KEY_WOW64;
     }
@@ -649,6 +839,13 @@ static void free_subkey( struct key *parent, int index )
     key = parent->subkeys[index];
     for (i = index; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
     parent->last_subkey--;
+    if (parent->subkey_index)
+    {
+        if (index > parent->last_subkey)
+            remove_name_index( parent->subkey_index, key->name, key->namelen, index );
+        else
+            drop_subkey_index( parent );
+    }
     key->flags |= KEY_DELETED;
     key->parent = NULL;
     if (is_wow6432node( key->name, key->namelen )) parent->flags &= ~KEY_WOW64;
@@ -668,11 +865,29 @@ static void free_subkey( struct key *parent, int index )
 }
 
 /* find the named child of a given key and return its index */
-static struct key *find_subkey( const struct key *key, const struct unicode_str *name, int *index )
+static struct key *find_subkey( struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    if (key->subkey_index)
+    {
+        unsigned int hash = hash_strW( name->str, name->len, key->subkey_index->size );
+
+        while ((i = key->subkey_index->buckets[hash]))
+        {
+            if (i > 0 && !compare_names( key->subkeys[i - 1]->name, key->subkeys[i - 1]->namelen,
+                                         name->str, name->len ))
+            {
+                *index = i - 1;
+                return key->subkeys[i - 1];
+            }
+            hash = (hash + 1) & (key->subkey_index->size - 1);
+        }
+        *index = key->last_subkey + 1;  /* append it, the array will be sorted later */
+        return NULL;
+    }
+
     min = 0;
     max = key->last_subkey;
     while (min <= max)
@@ -867,8 +1082,9 @@ static struct key *create_key( struct key *key, const struct unicode_str *name,
     return key;
 }
 
-/* recursively create a subkey (for internal use only) */
-static struct key *create_key_recursive( struct key *key, const struct unicode_str *name, timeout_t modif )
+/* recursively create a subkey, optionally following the symlinks along the path */
+static struct key *create_key_path( struct key *key, const struct unicode_str *name, timeout_t modif,
+                                    int follow_links )
 {
     struct key *base;
     int index;
@@ -881,7 +1097,7 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
         struct key *subkey;
         if (!(subkey = find_subkey( key, &token, &index ))) break;
         key = subkey;
-        if (!(key = follow_symlink( key, 0 )))
+        if (follow_links && !(key = follow_symlink( key, 0 )))
         {
             set_error( STATUS_OBJECT_NAME_NOT_FOUND );
             return NULL;
@@ -910,6 +1126,12 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
     return key;
 }
 
+/* recursively create a subkey (for internal use only) */
+static struct key *create_key_recursive( struct key *key, const struct unicode_str *name, timeout_t modif )
+{
+    return create_key_path( key, name, modif, 1 );
+}
+
 /* query information about a key or a subkey */
 static void enum_key( struct key *key, int index, int info_class, struct enum_key_reply *reply )
 {
@@ -933,6 +1155,7 @@ static void enum_key( struct key *key, int index, int info_class, struct enum_ke
             set_error( STATUS_NO_MORE_ENTRIES );
             return;
         }
+        sort_subkeys( key );
         key = key->subkeys[index];
     }
 
@@ -1031,9 +1254,14 @@ static int delete_key( struct key *key, int recurse )
         if (0 > delete_key(key->subkeys[key->last_subkey], 1))
             return -1;
 
-    for (index = 0; index <= parent->last_subkey; index++)
+    if (parent->subkey_index)
+    {
+        struct unicode_str name = { key->name, key->namelen };
+        find_subkey( parent, &name, &index );
+    }
+    else for (index = 0; index <= parent->last_subkey; index++)
         if (parent->subkeys[index] == key) break;
-    assert( index <= parent->last_subkey );
+    assert( index <= parent->last_subkey && parent->subkeys[index] == key );
 
     /* we can only delete a key that has no subkeys */
     if (key->last_subkey >= 0)
@@ -1074,11 +1302,29 @@ static int grow_values( struct key *key )
 }
 
 /* find the named value of a given key and return its index in the array */
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    if (key->value_index)
+    {
+        unsigned int hash = hash_strW( name->str, name->len, key->value_index->size );
+
+        while ((i = key->value_index->buckets[hash]))
+        {
+            if (i > 0 && !compare_names( key->values[i - 1].name, key->values[i - 1].namelen,
+                                         name->str, name->len ))
+            {
+                *index = i - 1;
+                return &key->values[i - 1];
+            }
+            hash = (hash + 1) & (key->value_index->size - 1);
+        }
+        *index = key->last_value + 1;  /* append it, the array will be sorted later */
+        return NULL;
+    }
+
     min = 0;
     max = key->last_value;
     while (min <= max)
@@ -1122,6 +1368,18 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
     value->namelen = name->len;
     value->len     = 0;
     value->data    = NULL;
+    if (key->value_index)
+    {
+        /* with a hash index new values are appended, and the array sorted later */
+        if (index && compare_values( &key->values[index - 1], value ) > 0)
+            key->flags |= KEY_UNSORTED_VALUES;
+        if (index != key->last_value || !add_name_index( key->value_index, value->name, value->namelen, index ))
+        {
+            build_value_index( key );
+            value = find_value( key, name, &index );  /* the array may have been sorted */
+        }
+    }
+    else if (key->last_value + 1 >= MIN_HASHED) build_value_index( key );
     return value;
 }
 
@@ -1222,6 +1480,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
         void *data;
         data_size_t namelen, maxlen;
 
+        sort_values( key );
         value = &key->values[i];
         reply->type = value->type;
         namelen = value->namelen;
@@ -1280,10 +1539,13 @@ static void delete_value( struct key *key, const struct unicode_str *name )
         return;
     }
     if (debug_level > 1) dump_operation( key, value, "Delete" );
+    if (key->value_index && index == key->last_value)
+        remove_name_index( key->value_index, value->name, value->namelen, index );
     free( value->name );
     free( value->data );
     for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
     key->last_value--;
+    if (key->value_index && index <= key->last_value) drop_value_index( key );
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
     /* try to shrink the array */
@@ -1769,28 +2031,580 @@ static void load_registry( struct key *key, obj_handle_t handle )
     }
 }
 
+/*
+ * Binary registry images
+ *
+ * When WINEREGISTRY=binary is set, each registry branch is also saved as a
+ * binary image next to its text file (e.g. system.reg.bin). The image starts
+ * with a snapshot of the whole branch, followed by a journal of the keys that
+ * were modified since the snapshot was written. Periodic saves only append
+ * the dirty keys to the journal; the text file and the snapshot are rewritten
+ * together when the journal grows larger than the snapshot, when the oldest
+ * journal entry is more than HIVE_MAX_TEXT_DELAY old, and on exit.
+ *
+ * The image records the size, inode and times of the text file it was written
+ * with, and is only loaded if the text file hasn't been modified since, so the
+ * text file remains the reference format and can still be edited by hand.
+ */
+
+static int use_hive_images;  /* save the branches as binary images */
+
+#define HIVE_VERSION          2
+#define HIVE_MIN_COMPACT_SIZE (256 * 1024)  /* min. journal size before compacting */
+#define HIVE_MAX_TEXT_DELAY   ((timeout_t)5 * 60 * TICKS_PER_SEC)  /* max. time the text file can lag behind */
+#define HIVE_ALIGN(size)      (((size) + 7) & ~(size_t)7)
+
+static const char hive_magic[8] = "WINEHIV";
+
+struct hive_header
+{
+    char          magic[8];       /* hive_magic */
+    unsigned int  version;        /* HIVE_VERSION */
+    unsigned int  prefix_type;    /* prefix architecture */
+    file_pos_t    text_size;      /* size of the matching text file */
+    file_pos_t    text_inode;     /* inode of the matching text file */
+    timeout_t     text_mtime;     /* modification time of the matching text file */
+    timeout_t     text_ctime;     /* status change time of the matching text file */
+    file_pos_t    snapshot_size;  /* size of the snapshot records following the header */
+};
+
+/* a key record; followed by the key path and the class, then the value records,
+ * then the subkey names if HIVE_KEY_SUBKEYS is set */
+struct hive_key
+{
+    unsigned int  size;           /* size of the whole record */
+    unsigned int  flags;          /* HIVE_KEY_* flags */
+    timeout_t     modif;          /* last modification time */
+    unsigned int  depth;          /* depth of the key below the branch key */
+    unsigned int  path_len;       /* length of the key path in bytes */
+    unsigned int  class_len;      /* length of the class in bytes */
+    unsigned int  value_count;    /* number of value records */
+    unsigned int  subkey_count;   /* number of subkey names */
+    unsigned int  reserved;
+};
+
+#define HIVE_KEY_SYMLINK  0x0001  /* key is a symbolic link */
+#define HIVE_KEY_SUBKEYS  0x0002  /* record lists all the subkeys, the others have been deleted */
+#define HIVE_KEY_CHILD    0x0004  /* path is only the name, parent is the last key loaded at depth - 1 */
+
+/* state of the binary image loader */
+struct hive_loader
+{
+    struct key   *base;           /* branch key */
+    struct key  **parents;        /* last key loaded at each depth */
+    unsigned int  depth;          /* number of valid entries in parents */
+    unsigned int  size;           /* allocated size of parents */
+    int           apply;          /* apply the records, or only validate them */
+};
+
+/* a value record; followed by the value name and data */
+struct hive_value
+{
+    unsigned int  name_len;       /* length of the value name in bytes */
+    unsigned int  type;           /* value type */
+    data_size_t   data_len;       /* length of the value data */
+    unsigned int  reserved;
+};
+
+/* buffered output to a binary image */
+struct hive_writer
+{
+    int           fd;             /* output file */
+    char         *buffer;         /* pending data */
+    size_t        size;           /* size of the pending data */
+    size_t        alloc;          /* allocated size of the buffer */
+    file_pos_t    written;        /* total size written to the file */
+    int           error;          /* set if a write failed */
+};
+
+static int flush_hive_writer( struct hive_writer *writer )
+{
+    char *ptr = writer->buffer;
+    size_t size = writer->size;
+    ssize_t ret;
+
+    while (size && !writer->error)
+    {
+        if ((ret = write( writer->fd, ptr, size )) == -1)
+        {
+            if (errno != EINTR) writer->error = 1;
+            continue;
+        }
+        ptr += ret;
+        size -= ret;
+        writer->written += ret;
+    }
+    writer->size = 0;
+    return !writer->error;
+}
+
+/* reserve zeroed space for a record in the output buffer */
+static void *alloc_hive_record( struct hive_writer *writer, size_t size )
+{
+    char *ptr;
+
+    if (writer->size + size > writer->alloc)
+    {
+        if (!flush_hive_writer( writer )) return NULL;
+        if (size > writer->alloc)
+        {
+            size_t alloc = max( size, 65536 );
+            if (!(ptr = realloc( writer->buffer, alloc )))
+            {
+                writer->error = 1;
+                return NULL;
+            }
+            writer->buffer = ptr;
+            writer->alloc = alloc;
+        }
+    }
+    ptr = writer->buffer + writer->size;
+    writer->size += size;
+    memset( ptr, 0, size );
+    return ptr;
+}
+
+/* write the record for a single key */
+static void write_hive_key( struct hive_writer *writer, struct key *key, struct key *base,
+                            unsigned int depth, unsigned int flags )
+{
+    struct hive_key *rec;
+    struct hive_value *val;
+    struct key *k;
+    WCHAR *path;
+    char *ptr;
+    size_t size, path_len = 0;
+    unsigned int subkey_count = 0;
+    unsigned short len;
+    int i;
+
+    sort_subkeys( key );
+    sort_values( key );
+    if ((flags & HIVE_KEY_CHILD) && key != base) path_len = key->namelen;
+    else for (k = key; k != base; k = k->parent)
+        path_len += k->namelen + (k->parent != base ? sizeof(WCHAR) : 0);
+
+    size = sizeof(*rec) + HIVE_ALIGN( path_len + key->classlen );
+    for (i = 0; i <= key->last_value; i++)
+        size += sizeof(*val) + HIVE_ALIGN( key->values[i].namelen + key->values[i].len );
+    if (flags & HIVE_KEY_SUBKEYS)
+    {
+        for (i = 0; i <= key->last_subkey; i++)
+        {
+            if (key->subkeys[i]->flags & KEY_VOLATILE) continue;
+            size += sizeof(len) + key->subkeys[i]->namelen;
+            subkey_count++;
+        }
+    }
+    size = HIVE_ALIGN( size );
+
+    if (!(rec = alloc_hive_record( writer, size ))) return;
+    rec->size         = size;
+    rec->flags        = flags;
+    rec->modif        = key->modif;
+    rec->depth        = depth;
+    rec->path_len     = path_len;
+    rec->class_len    = key->classlen;
+    rec->value_count  = key->last_value + 1;
+    rec->subkey_count = subkey_count;
+    if (key->flags & KEY_SYMLINK) rec->flags |= HIVE_KEY_SYMLINK;
+
+    /* the full path is built backwards from the key */
+    ptr = (char *)(rec + 1);
+    path = (WCHAR *)(ptr + path_len);
+    if ((flags & HIVE_KEY_CHILD) && key != base) memcpy( ptr, key->name, key->namelen );
+    else for (k = key; k != base; k = k->parent)
+    {
+        path -= k->namelen / sizeof(WCHAR);
+        memcpy( path, k->name, k->namelen );
+        if (k->parent != base) *--path = '\\';
+    }
+    ptr += path_len;
+    if (key->classlen) memcpy( ptr, key->class, key->classlen );
+    ptr = (char *)(rec + 1) + HIVE_ALIGN( path_len + key->classlen );
+
+    for (i = 0; i <= key->last_value; i++)
+    {
+        struct key_value *value = &key->values[i];
+
+        val = (struct hive_value *)ptr;
+        val->name_len = value->namelen;
+        val->type     = value->type;
+        val->data_len = value->len;
+        ptr = (char *)(val + 1);
+        if (value->namelen) memcpy( ptr, value->name, value->namelen );
+        if (value->len) memcpy( ptr + value->namelen, value->data, value->len );
+        ptr += HIVE_ALIGN( value->namelen + value->len );
+    }
+
+    if (!(flags & HIVE_KEY_SUBKEYS)) return;
+    for (i = 0; i <= key->last_subkey; i++)
+    {
+        if (key->subkeys[i]->flags & KEY_VOLATILE) continue;
+        len = key->subkeys[i]->namelen;
+        memcpy( ptr, &len, sizeof(len) );
+        memcpy( ptr + sizeof(len), key->subkeys[i]->name, len );
+        ptr += sizeof(len) + len;
+    }
+}
+
+/* write the records for a key and all its subkeys */
+static void write_hive_snapshot( struct hive_writer *writer, struct key *key, struct key *base,
+                                 unsigned int depth )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return;
+    write_hive_key( writer, key, base, depth, HIVE_KEY_CHILD );
+    for (i = 0; i <= key->last_subkey && !writer->error; i++)
+        write_hive_snapshot( writer, key->subkeys[i], base, depth + 1 );
+}
+
+/* write the records for the modified keys of a branch */
+static void write_hive_journal( struct hive_writer *writer, struct key *key, struct key *base )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if (!(key->flags & KEY_DIRTY)) return;
+    write_hive_key( writer, key, base, 0, HIVE_KEY_SUBKEYS );
+    for (i = 0; i <= key->last_subkey && !writer->error; i++)
+        write_hive_journal( writer, key->subkeys[i], base );
+}
+
+/* get a file time with the best precision available, so that changes within a second are noticed */
+static timeout_t get_stat_time( time_t sec, long nsec )
+{
+    return (timeout_t)sec * TICKS_PER_SEC + nsec / 100;
+}
+
+static timeout_t get_text_mtime( const struct stat *st )
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    return get_stat_time( st->st_mtim.tv_sec, st->st_mtim.tv_nsec );
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    return get_stat_time( st->st_mtimespec.tv_sec, st->st_mtimespec.tv_nsec );
+#else
+    return get_stat_time( st->st_mtime, 0 );
+#endif
+}
+
+static timeout_t get_text_ctime( const struct stat *st )
+{
+#ifdef HAVE_STRUCT_STAT_ST_CTIM
+    return get_stat_time( st->st_ctim.tv_sec, st->st_ctim.tv_nsec );
+#elif defined(HAVE_STRUCT_STAT_ST_CTIMESPEC)
+    return get_stat_time( st->st_ctimespec.tv_sec, st->st_ctimespec.tv_nsec );
+#else
+    return get_stat_time( st->st_ctime, 0 );
+#endif
+}
+
+/* save a new binary image of a branch, matching the text file that was just written */
+static int save_hive_snapshot( struct save_branch_info *info )
+{
+    struct hive_writer writer = { -1 };
+    struct hive_header header;
+    struct stat st;
+    char *tmp;
+
+    info->image_size = info->journal_size = 0;
+    info->journal_time = 0;
+    if (stat( info->path, &st ) == -1) return 0;
+    if (!(tmp = malloc( strlen( info->image_path ) + 5 ))) return 0;
+    sprintf( tmp, "%s.tmp", info->image_path );
+    if ((writer.fd = open( tmp, O_CREAT | O_TRUNC | O_WRONLY, 0666 )) == -1)
+    {
+        free( tmp );
+        return 0;
+    }
+
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.magic, hive_magic, sizeof(header.magic) );
+    header.version     = HIVE_VERSION;
+    header.prefix_type = prefix_type;
+    header.text_size   = st.st_size;
+    header.text_inode  = st.st_ino;
+    header.text_mtime  = get_text_mtime( &st );
+    header.text_ctime  = get_text_ctime( &st );
+    if (lseek( writer.fd, sizeof(header), SEEK_SET ) == -1) writer.error = 1;
+
+    write_hive_snapshot( &writer, info->key, info->key, 0 );
+    flush_hive_writer( &writer );
+    free( writer.buffer );
+
+    header.snapshot_size = writer.written;
+    if (!writer.error && lseek( writer.fd, 0, SEEK_SET ) != -1 &&
+        write( writer.fd, &header, sizeof(header) ) == sizeof(header) &&
+        !close( writer.fd ) && !rename( tmp, info->image_path ))
+    {
+        info->image_size = sizeof(header) + writer.written;
+        free( tmp );
+        return 1;
+    }
+    close( writer.fd );
+    unlink( tmp );
+    unlink( info->image_path );
+    free( tmp );
+    return 0;
+}
+
+/* append the modified keys of a branch to the journal of its binary image */
+static int append_hive_journal( struct save_branch_info *info )
+{
+    struct hive_writer writer = { -1 };
+    file_pos_t end = info->image_size + info->journal_size;
+
+    if ((writer.fd = open( info->image_path, O_WRONLY )) == -1) return 0;
+    if (lseek( writer.fd, end, SEEK_SET ) == -1) writer.error = 1;
+    write_hive_journal( &writer, info->key, info->key );
+    flush_hive_writer( &writer );
+    free( writer.buffer );
+
+    /* make sure a partial write doesn't leave a corrupted journal behind */
+    if (writer.error) ftruncate( writer.fd, end );
+    else info->journal_size += writer.written;
+    if (close( writer.fd )) writer.error = 1;
+    return !writer.error;
+}
+
+/* check a key record and apply it to the branch if requested; return the record size, or 0 if invalid */
+static size_t load_hive_key( struct hive_loader *loader, const char *data, size_t avail )
+{
+    const struct hive_key *rec = (const struct hive_key *)data;
+    const struct hive_value *val;
+    struct key_value *value;
+    struct key *parent, *key = NULL;
+    struct unicode_str name;
+    const char *ptr, *end;
+    unsigned short len;
+    unsigned int i;
+    int index;
+
+    if (avail < sizeof(*rec) || rec->size < sizeof(*rec) || rec->size > avail || rec->size % 8) return 0;
+    end = data + rec->size;
+    if ((rec->path_len | rec->class_len) % sizeof(WCHAR)) return 0;
+    if (rec->path_len > rec->size || rec->class_len > rec->size) return 0;
+    if (HIVE_ALIGN( rec->path_len + rec->class_len ) > rec->size - sizeof(*rec)) return 0;
+
+    /* child records must directly follow their parent, other records reset the parents */
+    if (rec->flags & HIVE_KEY_CHILD)
+    {
+        if (rec->depth > loader->depth || !rec->depth != !rec->path_len) return 0;
+        if (rec->depth >= loader->size)
+        {
+            unsigned int size = max( 16, loader->size * 2 );
+            struct key **new_parents;
+
+            if (!(new_parents = realloc( loader->parents, size * sizeof(*new_parents) ))) return 0;
+            loader->parents = new_parents;
+            loader->size = size;
+        }
+        loader->depth = rec->depth + 1;
+    }
+    else if (rec->depth) return 0;
+    else loader->depth = 0;
+
+    name.str = (const WCHAR *)(rec + 1);
+    name.len = rec->path_len;
+    if (!loader->apply) key = NULL;
+    else if (!name.len) key = (struct key *)grab_object( loader->base );
+    /* the records describe the keys themselves, never what a link points to */
+    else if (!(rec->flags & HIVE_KEY_CHILD)) key = create_key_path( loader->base, &name, 0, 0 );
+    else if ((parent = loader->parents[rec->depth - 1]))
+    {
+        /* snapshot records are sorted, so this normally appends to the subkeys array */
+        if ((key = find_subkey( parent, &name, &index ))) grab_object( key );
+        else if ((key = alloc_subkey( parent, &name, index, rec->modif ))) grab_object( key );
+    }
+    if (rec->flags & HIVE_KEY_CHILD) loader->parents[rec->depth] = key;
+
+    if (key)
+    {
+        key->modif = rec->modif;
+        update_key_time( key->parent, rec->modif );
+        if (rec->flags & HIVE_KEY_SYMLINK) key->flags |= KEY_SYMLINK;
+        else key->flags &= ~KEY_SYMLINK;
+        free( key->class );
+        key->class = NULL;
+        key->classlen = 0;
+        if (rec->class_len && (key->class = memdup( (const char *)(rec + 1) + rec->path_len, rec->class_len )))
+            key->classlen = rec->class_len;
+        for (index = 0; index <= key->last_value; index++)
+        {
+            free( key->values[index].name );
+            free( key->values[index].data );
+        }
+        key->last_value = -1;
+        free( key->value_index );
+        key->value_index = NULL;
+        key->flags &= ~KEY_UNSORTED_VALUES;
+    }
+    else if (loader->apply) return rec->size;
+
+    ptr = (const char *)(rec + 1) + HIVE_ALIGN( rec->path_len + rec->class_len );
+    for (i = 0; i < rec->value_count; i++)
+    {
+        val = (const struct hive_value *)ptr;
+        if (end - ptr < sizeof(*val)) goto error;
+        if (val->name_len % sizeof(WCHAR) || val->name_len > rec->size || val->data_len > rec->size) goto error;
+        if (HIVE_ALIGN( val->name_len + val->data_len ) > end - ptr - sizeof(*val)) goto error;
+        ptr = (const char *)(val + 1);
+
+        if (key)
+        {
+            name.str = (const WCHAR *)ptr;
+            name.len = val->name_len;
+            if ((value = find_value( key, &name, &index )) || (value = insert_value( key, &name, index )))
+            {
+                free( value->data );
+                value->type = val->type;
+                value->len  = 0;
+                value->data = NULL;
+                if (val->data_len && (value->data = memdup( ptr + val->name_len, val->data_len )))
+                    value->len = val->data_len;
+            }
+        }
+        ptr += HIVE_ALIGN( val->name_len + val->data_len );
+    }
+
+    if (rec->flags & HIVE_KEY_SUBKEYS)
+    {
+        const char *names = ptr;
+        int j = 0;
+
+        for (i = 0; i < rec->subkey_count; i++)
+        {
+            if (end - ptr < sizeof(len)) goto error;
+            memcpy( &len, ptr, sizeof(len) );
+            if (len % sizeof(WCHAR) || len > end - ptr - sizeof(len)) goto error;
+            ptr += sizeof(len) + len;
+        }
+
+        /* the names are in the same order as the subkeys, delete the ones that aren't listed */
+        if (key) sort_subkeys( key );
+        for (i = 0, ptr = names; key && j <= key->last_subkey; )
+        {
+            int res = 1;
+
+            while (i < rec->subkey_count)
+            {
+                memcpy( &len, ptr, sizeof(len) );
+                if ((res = compare_names( key->subkeys[j]->name, key->subkeys[j]->namelen,
+                                          (const WCHAR *)(ptr + sizeof(len)), len )) <= 0) break;
+                ptr += sizeof(len) + len;
+                i++;
+            }
+            if (!res) j++;
+            else free_subkey( key, j );
+        }
+    }
+    if (key) release_object( key );
+    return rec->size;
+
+error:
+    if (key) release_object( key );
+    return 0;
+}
+
+/* load the binary image of a branch if it matches the text file; return 1 if loaded */
+static int load_hive_image( struct save_branch_info *info, const struct stat *text_st )
+{
+    const struct hive_header *header;
+    struct hive_loader loader = { info->key };
+    struct stat st;
+    const char *data;
+    size_t pos, size, end;
+    int fd, ret = 0;
+
+    if ((fd = open( info->image_path, O_RDONLY )) == -1) return 0;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) ||
+        (data = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED)
+    {
+        close( fd );
+        return 0;
+    }
+    close( fd );
+
+    header = (const struct hive_header *)data;
+    end = sizeof(*header) + header->snapshot_size;
+    if (memcmp( header->magic, hive_magic, sizeof(header->magic) ) ||
+        header->version != HIVE_VERSION ||
+        header->text_size != text_st->st_size ||
+        header->text_inode != text_st->st_ino ||
+        header->text_mtime != get_text_mtime( text_st ) ||
+        header->text_ctime != get_text_ctime( text_st ) ||
+        header->snapshot_size > st.st_size - sizeof(*header))
+        goto done;
+    if (prefix_type != PREFIX_UNKNOWN && header->prefix_type != prefix_type) goto done;
+
+    /* validate everything first, a truncated journal is ignored but the snapshot must be complete */
+    for (pos = sizeof(*header); pos < st.st_size; pos += size)
+        if (!(size = load_hive_key( &loader, data + pos, st.st_size - pos ))) break;
+    if (pos < end) goto done;
+
+    if (prefix_type == PREFIX_UNKNOWN) prefix_type = header->prefix_type;
+    info->image_size = end;
+    info->journal_size = pos - end;
+    if (info->journal_size) info->journal_time = current_time;
+    loader.depth = 0;
+    loader.apply = 1;
+    for (pos = sizeof(*header); pos < info->image_size + info->journal_size; pos += size)
+        size = load_hive_key( &loader, data + pos, st.st_size - pos );
+    ret = 1;
+
+done:
+    free( loader.parents );
+    munmap( (void *)data, st.st_size );
+    return ret;
+}
+
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
-    FILE *f;
+    struct save_branch_info *info;
+    timeout_t start = monotonic_counter();
+    struct stat st;
+    FILE *f = NULL;
+    int loaded = 0;
+
+    assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
-    if ((f = fopen( filename, "r" )))
+    info = &save_branch_info[save_branch_count];
+    info->key = key;
+    info->path = filename;
+    info->image_size = info->journal_size = 0;
+    info->journal_time = 0;
+    if (!(info->image_path = malloc( strlen( filename ) + 5 ))) fatal_error( "out of memory\n" );
+    sprintf( info->image_path, "%s.bin", filename );
+
+    if (!stat( filename, &st ) && load_hive_image( info, &st ))
+    {
+        loaded = 1;
+        /* rewrite the text file if it's missing changes from the journal */
+        if (!use_hive_images && info->journal_size) make_dirty( key );
+        if (debug_level) fprintf( stderr, "%s: loaded binary image in %u ms\n", info->image_path,
+                                  (unsigned int)((monotonic_counter() - start) / 10000) );
+    }
+    else if ((f = fopen( filename, "r" )))
     {
         load_keys( key, filename, f, 0 );
         fclose( f );
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
         {
             fprintf( stderr, "%s is not a valid registry file\n", filename );
+            free( info->image_path );
             return 1;
         }
+        loaded = 1;
+        if (debug_level) fprintf( stderr, "%s: loaded in %u ms\n", filename,
+                                  (unsigned int)((monotonic_counter() - start) / 10000) );
     }
 
-    assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
-
-    save_branch_info[save_branch_count].path = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    save_branch_count++;
+    grab_object( key );
     make_object_permanent( &key->obj );
-    return (f != NULL);
+    return loaded;
 }
 
 static WCHAR *format_user_registry_path( const struct sid *sid, struct unicode_str *path )
@@ -1869,6 +2683,8 @@ void init_registry(void)
 
     if (fchdir( config_dir_fd ) == -1) fatal_error( "chdir to config dir: %s\n", strerror( errno ));
 
+    use_hive_images = (p = getenv( "WINEREGISTRY" )) && !strcmp( p, "binary" );
+
     /* create the root key */
     root_key = alloc_key( &root_name, current_time );
     assert( root_key );
@@ -2008,20 +2824,14 @@ static void save_registry( struct key *key, obj_handle_t handle )
     }
 }
 
-/* save a registry branch to a file */
-static int save_branch( struct key *key, const char *path )
+/* save a registry branch to a text file */
+static int save_branch_text( struct key *key, const char *path )
 {
     struct stat st;
     char *p, *tmp = NULL;
     int fd, count = 0, ret = 0;
     FILE *f;
 
-    if (!(key->flags & KEY_DIRTY))
-    {
-        if (debug_level > 1) dump_operation( key, NULL, "Not saving clean" );
-        return 1;
-    }
-
     /* test the file type */
 
     if ((fd = open( path, O_WRONLY )) != -1)
@@ -2078,7 +2888,49 @@ static int save_branch( struct key *key, const char *path )
 
 done:
     free( tmp );
-    if (ret) make_clean( key );
+    return ret;
+}
+
+/* save a registry branch; the whole text file is only rewritten when flushing or when
+ * the binary image journal gets too large or too old, otherwise only the dirty keys are appended */
+static int save_branch( struct save_branch_info *info, int flush )
+{
+    struct key *key = info->key;
+    timeout_t start = monotonic_counter();
+    const char *path = info->path;
+    int ret;
+
+    if (!(key->flags & KEY_DIRTY) && !(flush && info->journal_size))
+    {
+        if (!use_hive_images || info->image_size)
+        {
+            if (debug_level > 1) dump_operation( key, NULL, "Not saving clean" );
+            return 1;
+        }
+        /* the text file is up to date, only create the initial binary image */
+        if (!save_hive_snapshot( info )) return 1;
+        path = info->image_path;
+        ret = 1;
+    }
+    else if (use_hive_images && !flush && info->image_size &&
+             info->journal_size < max( info->image_size, HIVE_MIN_COMPACT_SIZE ) &&
+             (!info->journal_size || current_time - info->journal_time < HIVE_MAX_TEXT_DELAY))
+    {
+        path = info->image_path;
+        if (!info->journal_size) info->journal_time = current_time;
+        if ((ret = append_hive_journal( info ))) make_clean( key );
+    }
+    else if ((ret = save_branch_text( key, path )))
+    {
+        make_clean( key );
+        info->image_size = info->journal_size = 0;
+        info->journal_time = 0;
+        /* if the image can't be written, the next save will simply rewrite the text again */
+        if (use_hive_images) save_hive_snapshot( info );
+    }
+
+    if (debug_level) fprintf( stderr, "%s: saved in %u ms\n", path,
+                              (unsigned int)((monotonic_counter() - start) / 10000) );
     return ret;
 }
 
@@ -2089,8 +2941,7 @@ static void periodic_save( void *arg )
 
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
-    for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
+    for (i = 0; i < save_branch_count; i++) save_branch( &save_branch_info[i], 0 );
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2110,7 +2961,7 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].path ))
+        if (!save_branch( &save_branch_info[i], 1 ))
         {
             fprintf( stderr, "wineserver: could not save registry branch to %s",
                      save_branch_info[i].path );
@@ -31,7 +31,11 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -246,6 +250,102 @@ void write_reply( struct thread *thread )
         fatal_protocol_error( thread, "reply write: %s\n", strerror( errno ));
 }
 
+#ifdef __linux__
+
+/* the shared area is mapped in several processes, so we can't use private futexes */
+static inline void futex_wake( int *addr )
+{
+    syscall( __NR_futex, addr, 1 /* FUTEX_WAKE */, 1, NULL, 0, 0 );
+}
+
+/* map the shared request area of a thread */
+int init_request_shm( struct thread *thread, int fd )
+{
+    struct stat st;
+    void *ptr;
+
+    if (thread->request_shm)  /* already initialised */
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return 0;
+    }
+    if (fstat( fd, &st ) == -1 || !S_ISREG( st.st_mode ) || st.st_size < REQUEST_SHM_SIZE)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return 0;
+    }
+    if ((ptr = mmap( NULL, REQUEST_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        file_set_error();
+        return 0;
+    }
+    thread->request_shm = ptr;
+    return 1;
+}
+
+/* unmap the shared request area of a thread, waking up the client if it's still waiting */
+void free_request_shm( struct thread *thread )
+{
+    if (!thread->request_shm) return;
+    futex_wake( &thread->request_shm->state );
+    munmap( thread->request_shm, REQUEST_SHM_SIZE );
+    thread->request_shm = NULL;
+}
+
+/* store the reply in the shared request area of the current thread */
+static void send_shm_reply( union generic_reply *reply )
+{
+    struct request_shm *shm = current->request_shm;
+
+    if (current->req.request_header.reply_size > REQUEST_SHM_DATA_SIZE)
+    {
+        fatal_protocol_error( current, "reply too large for shared area %u\n",
+                              current->req.request_header.reply_size );
+        return;
+    }
+    memcpy( &shm->reply, reply, sizeof(*reply) );
+    if (current->reply_size) memcpy( shm->data, current->reply_data, current->reply_size );
+    free( current->reply_data );
+    current->reply_data = NULL;
+
+    /* the client only sleeps on the futex after spinning for a while, */
+    /* so most of the time the reply doesn't need any system call */
+    __atomic_store_n( &shm->state, REQUEST_SHM_REPLY, __ATOMIC_SEQ_CST );
+    if (__atomic_load_n( &shm->waiting, __ATOMIC_SEQ_CST )) futex_wake( &shm->state );
+}
+
+/* check whether the client expects the reply in the shared request area */
+static int is_shm_request( struct thread *thread )
+{
+    struct request_shm *shm = thread->request_shm;
+
+    return shm && __atomic_load_n( &shm->state, __ATOMIC_ACQUIRE ) == REQUEST_SHM_REQUEST;
+}
+
+#else  /* __linux__ */
+
+int init_request_shm( struct thread *thread, int fd )
+{
+    set_error( STATUS_NOT_SUPPORTED );
+    return 0;
+}
+
+void free_request_shm( struct thread *thread )
+{
+}
+
+static void send_shm_reply( union generic_reply *reply )
+{
+    assert( 0 );
+}
+
+static int is_shm_request( struct thread *thread )
+{
+    return 0;
+}
+
+#endif  /* __linux__ */
+
 /* send a reply to the current thread */
 static void send_reply( union generic_reply *reply )
 {
@@ -313,7 +413,8 @@ static void call_req_handler( struct thread *thread )
             reply.reply_header.error = current->error;
             reply.reply_header.reply_size = current->reply_size;
             if (debug_level) trace_reply( req, &reply );
-            send_reply( &reply );
+            if (is_shm_request( current )) send_shm_reply( &reply );
+            else send_reply( &reply );
         }
         else
         {
@@ -54,6 +54,8 @@ extern int receive_fd( struct process *process );
 extern int send_client_fd( struct process *process, int fd, obj_handle_t handle );
 extern void read_request( struct thread *thread );
 extern void write_reply( struct thread *thread );
+extern int init_request_shm( struct thread *thread, int fd );
+extern void free_request_shm( struct thread *thread );
 extern timeout_t monotonic_counter(void);
 extern void open_master_socket(void);
 extern void close_master_socket( timeout_t timeout );
@@ -126,6 +128,8 @@ DECL_HANDLER(get_startup_info);
 DECL_HANDLER(init_process_done);
 DECL_HANDLER(init_first_thread);
 DECL_HANDLER(init_thread);
+DECL_HANDLER(set_request_shm);
+DECL_HANDLER(set_handle_mirror);
 DECL_HANDLER(terminate_process);
 DECL_HANDLER(terminate_thread);
 DECL_HANDLER(get_process_info);
@@ -182,6 +186,8 @@ DECL_HANDLER(create_mapping);
 DECL_HANDLER(open_mapping);
 DECL_HANDLER(get_mapping_info);
 DECL_HANDLER(map_view);
+DECL_HANDLER(get_relocated_image);
+DECL_HANDLER(set_relocated_image_ready);
 DECL_HANDLER(unmap_view);
 DECL_HANDLER(get_mapping_committed_range);
 DECL_HANDLER(add_mapping_committed_range);
@@ -407,6 +413,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_init_process_done,
     (req_handler)req_init_first_thread,
     (req_handler)req_init_thread,
+    (req_handler)req_set_request_shm,
+    (req_handler)req_set_handle_mirror,
     (req_handler)req_terminate_process,
     (req_handler)req_terminate_thread,
     (req_handler)req_get_process_info,
@@ -463,6 +471,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_mapping,
     (req_handler)req_get_mapping_info,
     (req_handler)req_map_view,
+    (req_handler)req_get_relocated_image,
+    (req_handler)req_set_relocated_image_ready,
     (req_handler)req_unmap_view,
     (req_handler)req_get_mapping_committed_range,
     (req_handler)req_add_mapping_committed_range,
@@ -765,6 +775,10 @@ C_ASSERT( FIELD_OFFSET(struct init_thread_request, entry) == 32 );
 C_ASSERT( sizeof(struct init_thread_request) == 40 );
 C_ASSERT( FIELD_OFFSET(struct init_thread_reply, suspend) == 8 );
 C_ASSERT( sizeof(struct init_thread_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct set_request_shm_request, shm_fd) == 12 );
+C_ASSERT( sizeof(struct set_request_shm_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct set_handle_mirror_request, mirror_fd) == 12 );
+C_ASSERT( sizeof(struct set_handle_mirror_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct terminate_process_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct terminate_process_request, exit_code) == 16 );
 C_ASSERT( sizeof(struct terminate_process_request) == 24 );
@@ -1102,6 +1116,16 @@ C_ASSERT( FIELD_OFFSET(struct map_view_request, base) == 24 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, size) == 32 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, start) == 40 );
 C_ASSERT( sizeof(struct map_view_request) == 48 );
+C_ASSERT( FIELD_OFFSET(struct get_relocated_image_request, mapping) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_relocated_image_request, base) == 16 );
+C_ASSERT( sizeof(struct get_relocated_image_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_relocated_image_reply, file) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_relocated_image_reply, ready) == 12 );
+C_ASSERT( sizeof(struct get_relocated_image_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct set_relocated_image_ready_request, mapping) == 12 );
+C_ASSERT( FIELD_OFFSET(struct set_relocated_image_ready_request, base) == 16 );
+C_ASSERT( FIELD_OFFSET(struct set_relocated_image_ready_request, success) == 24 );
+C_ASSERT( sizeof(struct set_relocated_image_ready_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct unmap_view_request, base) == 16 );
 C_ASSERT( sizeof(struct unmap_view_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_committed_range_request, base) == 16 );
@@ -1340,7 +1364,8 @@ C_ASSERT( FIELD_OFFSET(struct get_message_request, get_last) == 24 );
 C_ASSERT( FIELD_OFFSET(struct get_message_request, hw_id) == 28 );
 C_ASSERT( FIELD_OFFSET(struct get_message_request, wake_mask) == 32 );
 C_ASSERT( FIELD_OFFSET(struct get_message_request, changed_mask) == 36 );
-C_ASSERT( sizeof(struct get_message_request) == 40 );
+C_ASSERT( FIELD_OFFSET(struct get_message_request, prefetch) == 40 );
+C_ASSERT( sizeof(struct get_message_request) == 48 );
 C_ASSERT( FIELD_OFFSET(struct get_message_reply, win) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_message_reply, msg) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_message_reply, wparam) == 16 );
@@ -1351,7 +1376,8 @@ C_ASSERT( FIELD_OFFSET(struct get_message_reply, y) == 40 );
 C_ASSERT( FIELD_OFFSET(struct get_message_reply, time) == 44 );
 C_ASSERT( FIELD_OFFSET(struct get_message_reply, active_hooks) == 48 );
 C_ASSERT( FIELD_OFFSET(struct get_message_reply, total) == 52 );
-C_ASSERT( sizeof(struct get_message_reply) == 56 );
+C_ASSERT( FIELD_OFFSET(struct get_message_reply, prefetched) == 56 );
+C_ASSERT( sizeof(struct get_message_reply) == 64 );
 C_ASSERT( FIELD_OFFSET(struct reply_message_request, remove) == 12 );
 C_ASSERT( FIELD_OFFSET(struct reply_message_request, result) == 16 );
 C_ASSERT( sizeof(struct reply_message_request) == 24 );
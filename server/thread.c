@@ -240,6 +240,7 @@ static inline void init_thread_structure( struct thread *thread )
     thread->request_fd      = NULL;
     thread->reply_fd        = NULL;
     thread->wait_fd         = NULL;
+    thread->request_shm     = NULL;
     thread->state           = RUNNING;
     thread->exit_code       = 0;
     thread->priority        = 0;
@@ -420,6 +421,7 @@ static void cleanup_thread( struct thread *thread )
     if (thread->request_fd) release_object( thread->request_fd );
     if (thread->reply_fd) release_object( thread->reply_fd );
     if (thread->wait_fd) release_object( thread->wait_fd );
+    free_request_shm( thread );
     cleanup_clipboard_thread(thread);
     destroy_thread_windows( thread );
     free_msg_queue( thread );
@@ -1452,6 +1454,20 @@ DECL_HANDLER(init_thread)
     reply->suspend = (current->suspend || current->process->suspend || current->context != NULL);
 }
 
+/* set up the shared memory area used for replies to the current thread */
+DECL_HANDLER(set_request_shm)
+{
+    int fd = thread_get_inflight_fd( current, req->shm_fd );
+
+    if (fd == -1)
+    {
+        set_error( STATUS_INVALID_HANDLE );
+        return;
+    }
+    init_request_shm( current, fd );
+    close( fd );
+}
+
 /* terminate a thread */
 DECL_HANDLER(terminate_thread)
 {
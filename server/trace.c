@@ -1463,6 +1463,16 @@ static void dump_init_thread_reply( const struct init_thread_reply *req )
     fprintf( stderr, " suspend=%d", req->suspend );
 }
 
+static void dump_set_request_shm_request( const struct set_request_shm_request *req )
+{
+    fprintf( stderr, " shm_fd=%d", req->shm_fd );
+}
+
+static void dump_set_handle_mirror_request( const struct set_handle_mirror_request *req )
+{
+    fprintf( stderr, " mirror_fd=%d", req->mirror_fd );
+}
+
 static void dump_terminate_process_request( const struct terminate_process_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -2145,6 +2155,25 @@ static void dump_map_view_request( const struct map_view_request *req )
     dump_varargs_unicode_str( ", name=", cur_size );
 }
 
+static void dump_get_relocated_image_request( const struct get_relocated_image_request *req )
+{
+    fprintf( stderr, " mapping=%04x", req->mapping );
+    dump_uint64( ", base=", &req->base );
+}
+
+static void dump_get_relocated_image_reply( const struct get_relocated_image_reply *req )
+{
+    fprintf( stderr, " file=%04x", req->file );
+    fprintf( stderr, ", ready=%d", req->ready );
+}
+
+static void dump_set_relocated_image_ready_request( const struct set_relocated_image_ready_request *req )
+{
+    fprintf( stderr, " mapping=%04x", req->mapping );
+    dump_uint64( ", base=", &req->base );
+    fprintf( stderr, ", success=%d", req->success );
+}
+
 static void dump_unmap_view_request( const struct unmap_view_request *req )
 {
     dump_uint64( " base=", &req->base );
@@ -2644,6 +2673,7 @@ static void dump_get_message_request( const struct get_message_request *req )
     fprintf( stderr, ", hw_id=%08x", req->hw_id );
     fprintf( stderr, ", wake_mask=%08x", req->wake_mask );
     fprintf( stderr, ", changed_mask=%08x", req->changed_mask );
+    fprintf( stderr, ", prefetch=%08x", req->prefetch );
 }
 
 static void dump_get_message_reply( const struct get_message_reply *req )
@@ -2658,6 +2688,7 @@ static void dump_get_message_reply( const struct get_message_reply *req )
     fprintf( stderr, ", time=%08x", req->time );
     fprintf( stderr, ", active_hooks=%08x", req->active_hooks );
     fprintf( stderr, ", total=%u", req->total );
+    fprintf( stderr, ", prefetched=%08x", req->prefetched );
     dump_varargs_message_data( ", data=", cur_size );
 }
 
@@ -4491,6 +4522,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_init_process_done_request,
     (dump_func)dump_init_first_thread_request,
     (dump_func)dump_init_thread_request,
+    (dump_func)dump_set_request_shm_request,
+    (dump_func)dump_set_handle_mirror_request,
     (dump_func)dump_terminate_process_request,
     (dump_func)dump_terminate_thread_request,
     (dump_func)dump_get_process_info_request,
@@ -4547,6 +4580,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_mapping_request,
     (dump_func)dump_get_mapping_info_request,
     (dump_func)dump_map_view_request,
+    (dump_func)dump_get_relocated_image_request,
+    (dump_func)dump_set_relocated_image_ready_request,
     (dump_func)dump_unmap_view_request,
     (dump_func)dump_get_mapping_committed_range_request,
     (dump_func)dump_add_mapping_committed_range_request,
@@ -4769,6 +4804,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_init_process_done_reply,
     (dump_func)dump_init_first_thread_reply,
     (dump_func)dump_init_thread_reply,
+    NULL,
+    NULL,
     (dump_func)dump_terminate_process_reply,
     (dump_func)dump_terminate_thread_reply,
     (dump_func)dump_get_process_info_reply,
@@ -4825,6 +4862,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_mapping_reply,
     (dump_func)dump_get_mapping_info_reply,
     NULL,
+    (dump_func)dump_get_relocated_image_reply,
+    NULL,
     NULL,
     (dump_func)dump_get_mapping_committed_range_reply,
     NULL,
@@ -5047,6 +5086,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "init_process_done",
     "init_first_thread",
     "init_thread",
+    "set_request_shm",
+    "set_handle_mirror",
     "terminate_process",
     "terminate_thread",
     "get_process_info",
@@ -5103,6 +5144,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_mapping",
     "get_mapping_info",
     "map_view",
+    "get_relocated_image",
+    "set_relocated_image_ready",
     "unmap_view",
     "get_mapping_committed_range",
     "add_mapping_committed_range",